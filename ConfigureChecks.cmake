@@ -36,6 +36,7 @@ check_include_file("g_ascii_strtoull.h"  NEED_G_ASCII_STRTOULL_H)
 check_include_file("inet/aton.h"         NEED_INET_ATON_H)
 check_include_file("inttypes.h"          HAVE_INTTYPES_H)
 check_include_file("lauxlib.h"           HAVE_LAUXLIB_H)
+check_include_file("linux/if_packet.h"   HAVE_LINUX_IF_PACKET_H)
 check_include_file("memory.h"            HAVE_MEMORY_H)
 check_include_file("netinet/in.h"        HAVE_NETINET_IN_H)
 check_include_file("netdb.h"             HAVE_NETDB_H)
@@ -67,6 +68,8 @@ include(CheckFunctionExists)
 check_function_exists("chown"            HAVE_CHOWN)
 check_function_exists("gethostbyname2"   HAVE_GETHOSTBYNAME2)
 check_function_exists("getopt"           HAVE_GETOPT)
+check_function_exists("fopencookie"      HAVE_FOPENCOOKIE)
+check_function_exists("funopen"          HAVE_FUNOPEN)
 check_function_exists("getprotobynumber" HAVE_GETPROTOBYNUMBER)
 check_function_exists("inet_ntop"        HAVE_INET_NTOP_PROTO)
 check_function_exists("issetugid"        HAVE_ISSETUGID)
@@ -74,4 +77,5 @@ check_function_exists("mmap"             HAVE_MMAP)
 check_function_exists("mprotect"         HAVE_MPROTECT)
 check_function_exists("mkdtemp"          HAVE_MKDTEMP)
 check_function_exists("mkstemp"          HAVE_MKSTEMP)
+check_function_exists("posix_fadvise"    HAVE_POSIX_FADVISE)
 check_function_exists("sysconf"          HAVE_SYSCONF)
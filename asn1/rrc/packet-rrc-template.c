@@ -143,7 +143,7 @@ dissect_rrc(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
 	rrc_tree = proto_item_add_subtree(rrc_item, ett_rrc);
 
 	if (rrcinf) {
-		switch (rrcinf->msgtype[pinfo->fd->subnum]) {
+		switch (rrcinf->msgtype[pinfo->subnum]) {
 			case RRC_MESSAGE_TYPE_PCCH:
 				call_dissector(rrc_pcch_handle, tvb, pinfo, rrc_tree);
 				break;
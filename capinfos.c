@@ -931,6 +931,10 @@ main(int argc, char *argv[])
 #ifdef _WIN32
   arg_list_utf_16to8(argc, argv);
 #endif /* _WIN32 */
+#if !GLIB_CHECK_VERSION(2,31,0)
+  /* Initialize the thread system; wiretap reads ahead of us on one. */
+  g_thread_init(NULL);
+#endif
 
   /*
    * Get credential information for later use.
@@ -1164,6 +1168,8 @@ main(int argc, char *argv[])
     if(wth) {
       if ((opt > optind) && (long_report))
         printf("\n");
+      /* Have wiretap read the file ahead of us on another thread. */
+      wtap_set_prefetch(wth, 0);
       status = process_cap_file(wth, argv[opt]);
 
       wtap_close(wth);
@@ -0,0 +1,174 @@
+/* capture-queue.c
+ * Routines for the queues between dumpcap's capture threads and its writer
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "capture-queue.h"
+
+/* Entries start on 8-byte boundaries, so that their headers are aligned;
+   that also leaves room for a padding entry at the end of the ring
+   whenever there's any room at all. */
+#define ENTRY_ALIGN(len)    (((len) + 7U) & ~7U)
+
+/* Keep what each side writes on a cache line of its own. */
+#define CACHE_LINE          64
+
+struct capture_queue {
+    guint8     *buf;
+    guint32     size;
+    guint32     mask;
+    /* producer */
+    volatile gint head;         /* bytes pushed, modulo 2^32 */
+    volatile gint high_water;
+    char        pad1[CACHE_LINE];
+    /* consumer */
+    volatile gint tail;         /* bytes released */
+    guint32     read;           /* bytes moved on from */
+    char        pad2[CACHE_LINE];
+};
+
+capture_queue_t *
+capture_queue_new(guint32 size)
+{
+    capture_queue_t *queue;
+    guint32 real_size;
+
+    for (real_size = 4096; real_size < size && real_size < 0x80000000U; real_size <<= 1)
+        ;
+
+    queue = g_new0(capture_queue_t, 1);
+    queue->buf = (guint8 *)g_malloc(real_size);
+    queue->size = real_size;
+    queue->mask = real_size - 1;
+    return queue;
+}
+
+void
+capture_queue_free(capture_queue_t *queue)
+{
+    if (queue == NULL)
+        return;
+    g_free(queue->buf);
+    g_free(queue);
+}
+
+guint32
+capture_queue_size(capture_queue_t *queue)
+{
+    return queue->size;
+}
+
+gboolean
+capture_queue_push(capture_queue_t *queue, const struct pcap_pkthdr *phdr,
+                   const u_char *pd, gpointer block)
+{
+    capture_queue_entry *entry;
+    guint32 head, tail, offset, need, pad, used;
+
+    need = (guint32)sizeof(capture_queue_entry);
+    if (phdr != NULL) {
+        /* Don't let one packet take more than half the ring. */
+        if (phdr->caplen > queue->size / 2)
+            return FALSE;
+        need += phdr->caplen;
+    }
+    need = ENTRY_ALIGN(need);
+
+    head = (guint32)g_atomic_int_get(&queue->head);
+    tail = (guint32)g_atomic_int_get(&queue->tail);
+    offset = head & queue->mask;
+    pad = (offset + need > queue->size) ? queue->size - offset : 0;
+    if (head + pad + need - tail > queue->size)
+        return FALSE;
+
+    if (pad != 0) {
+        entry = (capture_queue_entry *)(queue->buf + offset);
+        entry->size = pad;
+        entry->padding = TRUE;
+        head += pad;
+        offset = 0;
+    }
+
+    entry = (capture_queue_entry *)(queue->buf + offset);
+    entry->size = need;
+    entry->padding = FALSE;
+    entry->block = (phdr != NULL) ? NULL : block;
+    if (phdr != NULL) {
+        entry->phdr = *phdr;
+        memcpy(entry + 1, pd, phdr->caplen);
+    } else {
+        memset(&entry->phdr, 0, sizeof entry->phdr);
+    }
+
+    used = head + need - tail;
+    if (used > (guint32)g_atomic_int_get(&queue->high_water))
+        g_atomic_int_set(&queue->high_water, (gint)used);
+
+    /* Publish the entry only once it's all there. */
+    g_atomic_int_set(&queue->head, (gint)(head + need));
+    return TRUE;
+}
+
+guint32
+capture_queue_high_water(capture_queue_t *queue)
+{
+    return (guint32)g_atomic_int_get(&queue->high_water);
+}
+
+const capture_queue_entry *
+capture_queue_peek(capture_queue_t *queue)
+{
+    const capture_queue_entry *entry;
+    guint32 head;
+
+    head = (guint32)g_atomic_int_get(&queue->head);
+    while (queue->read != head) {
+        entry = (const capture_queue_entry *)(queue->buf + (queue->read & queue->mask));
+        if (!entry->padding)
+            return entry;
+        queue->read += entry->size;
+    }
+    return NULL;
+}
+
+void
+capture_queue_next(capture_queue_t *queue)
+{
+    const capture_queue_entry *entry;
+
+    entry = (const capture_queue_entry *)(queue->buf + (queue->read & queue->mask));
+    queue->read += entry->size;
+}
+
+void
+capture_queue_release(capture_queue_t *queue)
+{
+    g_atomic_int_set(&queue->tail, (gint)queue->read);
+}
@@ -0,0 +1,90 @@
+/* capture-queue.h
+ * Declarations of routines for the queues between dumpcap's capture
+ * threads and its writer
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __CAPTURE_QUEUE_H__
+#define __CAPTURE_QUEUE_H__
+
+#include <pcap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A capture queue is a byte ring with exactly one thread putting packets
+ * into it and one taking them out, so it needs no lock: the producer only
+ * ever moves the head and the consumer the tail.  Each packet is copied
+ * into the ring, after its header, so pushing one costs no allocation.
+ *
+ * An entry can also stand for something the producer owns, such as a
+ * block of packets still in the kernel's ring, in which case it carries
+ * only a pointer to it.
+ *
+ * The consumer can look at any number of entries before handing their
+ * space back, so that it can write them out in a batch straight from the
+ * queue.
+ */
+typedef struct capture_queue capture_queue_t;
+
+typedef struct {
+    guint32            size;      /* of the entry, including this header */
+    gboolean           padding;   /* nothing here; the ring wraps */
+    gpointer           block;     /* if not NULL, there's no packet */
+    struct pcap_pkthdr phdr;
+    /* followed by phdr.caplen bytes of packet data */
+} capture_queue_entry;
+
+#define CAPTURE_QUEUE_ENTRY_DATA(entry) ((const u_char *)((entry) + 1))
+
+/* A queue with room for "size" bytes, rounded up to a power of two. */
+extern capture_queue_t *capture_queue_new(guint32 size);
+extern void capture_queue_free(capture_queue_t *queue);
+extern guint32 capture_queue_size(capture_queue_t *queue);
+
+/* Producer: copy a packet into the queue, or queue "block" if "phdr" is
+ * NULL.  Returns FALSE if there's no room for it. */
+extern gboolean capture_queue_push(capture_queue_t *queue,
+    const struct pcap_pkthdr *phdr, const u_char *pd, gpointer block);
+
+/* The most the queue has had in it, in bytes; any thread can ask. */
+extern guint32 capture_queue_high_water(capture_queue_t *queue);
+
+/* Consumer: the entry after the ones already looked at, or NULL if the
+ * queue has nothing more. */
+extern const capture_queue_entry *capture_queue_peek(capture_queue_t *queue);
+
+/* Consumer: move on from the entry capture_queue_peek() returned.  It,
+ * and the data in it, stay where they are until released. */
+extern void capture_queue_next(capture_queue_t *queue);
+
+/* Consumer: hand the space of every entry moved on from back to the
+ * producer. */
+extern void capture_queue_release(capture_queue_t *queue);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __CAPTURE_QUEUE_H__ */
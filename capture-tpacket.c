@@ -0,0 +1,433 @@
+/* capture-tpacket.c
+ * Routines for capturing through Linux TPACKET_V3 rings
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <glib.h>
+
+#include "capture-tpacket.h"
+
+#ifdef TPACKET_RING_SUPPORTED
+
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+
+/*
+ * Each block holds up to a megabyte of packets, which is enough for
+ * anything up to the largest packet we can capture; the kernel hands a
+ * block over when it's full or, on a quiet link, after TPACKET_BLOCK_TIMEOUT
+ * milliseconds.
+ */
+#define TPACKET_BLOCK_SIZE      (1024*1024)
+#define TPACKET_FRAME_SIZE      2048
+#define TPACKET_MIN_BLOCKS      4
+#define TPACKET_BLOCK_TIMEOUT   10
+
+struct tpacket_ring {
+    int         fd;
+    int         linktype;
+    int         snaplen;
+    guint8     *map;
+    size_t      map_len;
+    guint       block_nr;
+    guint       next;       /* the next block to hand over */
+    gint        held;       /* blocks handed over and not released yet */
+    /* for tpacket_block_unpack() */
+    guint       pkt_max;
+    struct pcap_pkthdr *phdrs;
+    const u_char **pds;
+    guint8     *vlan_buf;   /* packets with their VLAN tags put back */
+    /* totals of the kernel's counters, which it resets when read */
+    guint32     received;
+    guint32     dropped;
+    guint32     freezes;
+};
+
+#define TPACKET_BLOCK(ring, i)  \
+    ((tpacket_block_t *)((ring)->map + (size_t)(i) * TPACKET_BLOCK_SIZE))
+
+tpacket_ring_t *
+tpacket_ring_open(const char *iface, int snaplen, gboolean promisc,
+                  int buffer_size, int fanout_group, int *err,
+                  char *errmsg, size_t errmsg_len)
+{
+    tpacket_ring_t *ring;
+    struct ifreq ifr;
+    struct sockaddr_ll sll;
+    struct tpacket_req3 req;
+    struct packet_mreq mreq;
+    int version = TPACKET_V3;
+    int ifindex;
+    /* Until we're given a filter, take nothing. */
+    struct sock_filter reject_all = BPF_STMT(BPF_RET|BPF_K, 0);
+    struct sock_fprog reject_prog = { 1, &reject_all };
+    const char *what;
+
+    ifindex = if_nametoindex(iface);
+    if (ifindex == 0) {
+        *err = ENODEV;
+        g_snprintf(errmsg, (gulong) errmsg_len,
+                   "%s is not a network interface", iface);
+        return NULL;
+    }
+
+    ring = g_new0(tpacket_ring_t, 1);
+    ring->snaplen = snaplen;
+    ring->map = MAP_FAILED;
+
+    /* Protocol 0, so that nothing arrives until we bind. */
+    ring->fd = socket(PF_PACKET, SOCK_RAW, 0);
+    if (ring->fd == -1) {
+        what = "create a packet socket";
+        goto fail;
+    }
+
+    memset(&ifr, 0, sizeof ifr);
+    g_strlcpy(ifr.ifr_name, iface, sizeof ifr.ifr_name);
+    if (ioctl(ring->fd, SIOCGIFHWADDR, &ifr) == -1) {
+        what = "get the interface's link-layer type";
+        goto fail;
+    }
+    switch (ifr.ifr_hwaddr.sa_family) {
+
+    case ARPHRD_ETHER:
+    case ARPHRD_LOOPBACK:
+        ring->linktype = DLT_EN10MB;
+        break;
+
+    default:
+        *err = EPROTONOSUPPORT;
+        g_snprintf(errmsg, (gulong) errmsg_len,
+                   "%s is not an Ethernet interface (ARPHRD type %u)",
+                   iface, ifr.ifr_hwaddr.sa_family);
+        tpacket_ring_close(ring);
+        return NULL;
+    }
+
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version,
+                   sizeof version) == -1) {
+        *err = errno;
+        if (*err == EINVAL) {
+            /* Kernel older than 3.2. */
+            *err = EPROTONOSUPPORT;
+        }
+        g_snprintf(errmsg, (gulong) errmsg_len,
+                   "TPACKET_V3 is not supported: %s", g_strerror(errno));
+        tpacket_ring_close(ring);
+        return NULL;
+    }
+
+    if (setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &reject_prog,
+                   sizeof reject_prog) == -1) {
+        what = "set the initial filter";
+        goto fail;
+    }
+
+    if (buffer_size < 1)
+        buffer_size = 1;
+    ring->block_nr = (guint)buffer_size * (1024*1024 / TPACKET_BLOCK_SIZE);
+    if (ring->block_nr < TPACKET_MIN_BLOCKS)
+        ring->block_nr = TPACKET_MIN_BLOCKS;
+    memset(&req, 0, sizeof req);
+    req.tp_block_size = TPACKET_BLOCK_SIZE;
+    req.tp_block_nr = ring->block_nr;
+    req.tp_frame_size = TPACKET_FRAME_SIZE;
+    req.tp_frame_nr = ring->block_nr * (TPACKET_BLOCK_SIZE / TPACKET_FRAME_SIZE);
+    req.tp_retire_blk_tov = TPACKET_BLOCK_TIMEOUT;
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req,
+                   sizeof req) == -1) {
+        what = "set up the receive ring";
+        goto fail;
+    }
+    ring->map_len = (size_t)ring->block_nr * TPACKET_BLOCK_SIZE;
+    ring->map = (guint8 *)mmap(NULL, ring->map_len, PROT_READ|PROT_WRITE,
+                               MAP_SHARED|MAP_LOCKED, ring->fd, 0);
+    if (ring->map == MAP_FAILED) {
+        /* Probably RLIMIT_MEMLOCK; try again without locking it. */
+        ring->map = (guint8 *)mmap(NULL, ring->map_len, PROT_READ|PROT_WRITE,
+                                   MAP_SHARED, ring->fd, 0);
+    }
+    if (ring->map == MAP_FAILED) {
+        what = "map the receive ring";
+        goto fail;
+    }
+
+    memset(&sll, 0, sizeof sll);
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_ALL);
+    sll.sll_ifindex = ifindex;
+    if (bind(ring->fd, (struct sockaddr *)&sll, sizeof sll) == -1) {
+        what = "bind to the interface";
+        goto fail;
+    }
+
+    if (promisc) {
+        memset(&mreq, 0, sizeof mreq);
+        mreq.mr_ifindex = ifindex;
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(ring->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq,
+                       sizeof mreq) == -1) {
+            what = "put the interface in promiscuous mode";
+            goto fail;
+        }
+    }
+
+    if (fanout_group != -1) {
+        int fanout = (fanout_group & 0xffff) | (PACKET_FANOUT_HASH << 16);
+
+#ifdef PACKET_FANOUT_FLAG_DEFRAG
+        /* Keep fragments together with the rest of their flow. */
+        fanout |= PACKET_FANOUT_FLAG_DEFRAG << 16;
+#endif
+        if (setsockopt(ring->fd, SOL_PACKET, PACKET_FANOUT, &fanout,
+                       sizeof fanout) == -1) {
+            what = "join the fanout group";
+            goto fail;
+        }
+    }
+
+    return ring;
+
+fail:
+    *err = errno;
+    g_snprintf(errmsg, (gulong) errmsg_len, "Couldn't %s for %s: %s",
+               what, iface, g_strerror(*err));
+    tpacket_ring_close(ring);
+    return NULL;
+}
+
+int
+tpacket_ring_linktype(tpacket_ring_t *ring)
+{
+    return ring->linktype;
+}
+
+gboolean
+tpacket_ring_set_filter(tpacket_ring_t *ring, struct bpf_program *fcode,
+                        int *err)
+{
+    struct sock_fprog prog;
+
+    /* A struct bpf_insn is laid out just like a struct sock_filter. */
+    prog.len = fcode->bf_len;
+    prog.filter = (struct sock_filter *)fcode->bf_insns;
+    if (setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog,
+                   sizeof prog) == -1) {
+        *err = errno;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean
+tpacket_block_ready(tpacket_block_t *block)
+{
+    /* The kernel changes this behind our back. */
+    return (*(volatile guint32 *)&block->hdr.bh1.block_status & TP_STATUS_USER) != 0;
+}
+
+tpacket_block_t *
+tpacket_ring_next_block(tpacket_ring_t *ring, int timeout, int *err)
+{
+    tpacket_block_t *block;
+    struct pollfd pfd;
+
+    *err = 0;
+    if ((guint)g_atomic_int_get(&ring->held) == ring->block_nr) {
+        /* We're holding every block, so the next one's still ours; give
+           whoever's writing them out a moment. */
+        g_usleep(1000);
+        return NULL;
+    }
+
+    block = TPACKET_BLOCK(ring, ring->next);
+    if (!tpacket_block_ready(block)) {
+        pfd.fd = ring->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout) == -1) {
+            if (errno != EINTR)
+                *err = errno;
+            return NULL;
+        }
+        if (pfd.revents & POLLERR) {
+            int sock_err;
+            socklen_t len = sizeof sock_err;
+
+            if (getsockopt(ring->fd, SOL_SOCKET, SO_ERROR, &sock_err,
+                           &len) == 0 && sock_err != 0) {
+                *err = sock_err;
+                return NULL;
+            }
+        }
+        if (!tpacket_block_ready(block))
+            return NULL;
+    }
+
+    /* Don't look at the packets before the status. */
+    __sync_synchronize();
+    ring->next = (ring->next + 1) % ring->block_nr;
+    g_atomic_int_inc(&ring->held);
+    return block;
+}
+
+guint
+tpacket_block_unpack(tpacket_ring_t *ring, tpacket_block_t *block,
+                     const struct pcap_pkthdr **phdrs,
+                     const u_char * const **pds)
+{
+    struct tpacket3_hdr *hdr;
+    struct pcap_pkthdr *phdr;
+    guint n_pkts, i;
+    guint8 *vlan_ptr, *pd;
+    guint16 tpid, tci;
+
+    n_pkts = block->hdr.bh1.num_pkts;
+    if (n_pkts > ring->pkt_max) {
+        ring->pkt_max = n_pkts;
+        ring->phdrs = g_renew(struct pcap_pkthdr, ring->phdrs, n_pkts);
+        ring->pds = g_renew(const u_char *, ring->pds, n_pkts);
+    }
+
+    vlan_ptr = ring->vlan_buf;
+    hdr = (struct tpacket3_hdr *)((guint8 *)block +
+                                  block->hdr.bh1.offset_to_first_pkt);
+    for (i = 0; i < n_pkts; i++) {
+        phdr = &ring->phdrs[i];
+        phdr->ts.tv_sec = hdr->tp_sec;
+        phdr->ts.tv_usec = hdr->tp_nsec;
+        phdr->caplen = hdr->tp_snaplen;
+        phdr->len = hdr->tp_len;
+        pd = (guint8 *)hdr + hdr->tp_mac;
+
+        /*
+         * The kernel takes the VLAN tag off the packet if the driver
+         * hasn't already; put it back, as libpcap does, in a copy of
+         * the packet.  Each copy is smaller than the packet and its
+         * header were in the block, so they all fit in one block's worth.
+         */
+        if ((hdr->tp_status & TP_STATUS_VLAN_VALID) && phdr->caplen >= 12) {
+            if (vlan_ptr == NULL)
+                vlan_ptr = ring->vlan_buf = (guint8 *)g_malloc(TPACKET_BLOCK_SIZE);
+#ifdef TP_STATUS_VLAN_TPID_VALID
+            if (hdr->tp_status & TP_STATUS_VLAN_TPID_VALID)
+                tpid = hdr->hv1.tp_vlan_tpid;
+            else
+#endif
+                tpid = ETH_P_8021Q;
+            tci = hdr->hv1.tp_vlan_tci;
+            memcpy(vlan_ptr, pd, 12);
+            vlan_ptr[12] = tpid >> 8;
+            vlan_ptr[13] = tpid & 0xff;
+            vlan_ptr[14] = tci >> 8;
+            vlan_ptr[15] = tci & 0xff;
+            memcpy(vlan_ptr + 16, pd + 12, phdr->caplen - 12);
+            pd = vlan_ptr;
+            vlan_ptr += phdr->caplen + 4;
+            phdr->caplen += 4;
+            phdr->len += 4;
+        }
+        if (phdr->caplen > (bpf_u_int32)ring->snaplen)
+            phdr->caplen = ring->snaplen;
+        ring->pds[i] = pd;
+
+        hdr = (struct tpacket3_hdr *)((guint8 *)hdr + hdr->tp_next_offset);
+    }
+
+    *phdrs = ring->phdrs;
+    *pds = ring->pds;
+    return n_pkts;
+}
+
+void
+tpacket_block_release(tpacket_ring_t *ring, tpacket_block_t *block)
+{
+    /* We're done with the packets before the kernel gets the block back. */
+    __sync_synchronize();
+    block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    g_atomic_int_add(&ring->held, -1);
+}
+
+gboolean
+tpacket_ring_stats(tpacket_ring_t *ring, guint32 *received, guint32 *dropped,
+                   guint32 *freezes, int *err)
+{
+    struct tpacket_stats_v3 stats;
+    socklen_t len = sizeof stats;
+
+    if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &stats,
+                   &len) == -1) {
+        *err = errno;
+        return FALSE;
+    }
+    /* tp_packets includes the ones that were dropped. */
+    ring->received += stats.tp_packets - stats.tp_drops;
+    ring->dropped += stats.tp_drops;
+    ring->freezes += stats.tp_freeze_q_cnt;
+    *received = ring->received;
+    *dropped = ring->dropped;
+    *freezes = ring->freezes;
+    return TRUE;
+}
+
+void
+tpacket_ring_close(tpacket_ring_t *ring)
+{
+    if (ring->map != MAP_FAILED)
+        munmap(ring->map, ring->map_len);
+    if (ring->fd != -1)
+        close(ring->fd);
+    g_free(ring->phdrs);
+    g_free(ring->pds);
+    g_free(ring->vlan_buf);
+    g_free(ring);
+}
+
+#endif /* TPACKET_RING_SUPPORTED */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentwidth=4:tabwidth=8:noTabs=true:
+ */
@@ -0,0 +1,110 @@
+/* capture-tpacket.h
+ * Declarations of routines for capturing through Linux TPACKET_V3 rings
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __CAPTURE_TPACKET_H__
+#define __CAPTURE_TPACKET_H__
+
+/*
+ * On Linux, dumpcap can capture from an Ethernet interface without going
+ * through libpcap: it opens a PF_PACKET socket with a TPACKET_V3 receive
+ * ring, into which the kernel copies packets a block of many packets at a
+ * time, and hands each block over as a whole once it's full or a short
+ * timeout has expired.  A block stays ours, and the packets in it can be
+ * written out straight from the ring, until we give it back.
+ *
+ * Several rings on the same interface can be put in a fanout group, in
+ * which case the kernel spreads the interface's traffic over them by flow,
+ * so that each can be read by a thread of its own.
+ */
+#if defined(HAVE_LIBPCAP) && defined(HAVE_LINUX_IF_PACKET_H)
+#include <linux/if_packet.h>
+#ifdef TPACKET3_HDRLEN
+#define TPACKET_RING_SUPPORTED
+#endif
+#endif
+
+#ifdef TPACKET_RING_SUPPORTED
+
+#include <pcap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct tpacket_ring tpacket_ring_t;
+typedef struct tpacket_block_desc tpacket_block_t;
+
+/* Open a ring of "buffer_size" megabytes on "iface", joining fanout group
+ * "fanout_group" unless it's -1.  On failure, returns NULL and sets "*err"
+ * and "errmsg"; "*err" is ENODEV if "iface" isn't a network interface and
+ * EPROTONOSUPPORT if it isn't one we can capture on this way, in which
+ * case the caller should use libpcap instead.
+ *
+ * Until a filter is set with tpacket_ring_set_filter(), the ring rejects
+ * every packet. */
+extern tpacket_ring_t *tpacket_ring_open(const char *iface, int snaplen,
+    gboolean promisc, int buffer_size, int fanout_group, int *err,
+    char *errmsg, size_t errmsg_len);
+
+/* The DLT_ value for the packets in the ring. */
+extern int tpacket_ring_linktype(tpacket_ring_t *ring);
+
+/* Filter the packets going into the ring with "fcode", which must have
+ * been compiled for tpacket_ring_linktype() and our snapshot length. */
+extern gboolean tpacket_ring_set_filter(tpacket_ring_t *ring,
+    struct bpf_program *fcode, int *err);
+
+/* Wait up to "timeout" milliseconds for the kernel to hand over the next
+ * block.  Returns NULL, with "*err" set to 0, if it doesn't. */
+extern tpacket_block_t *tpacket_ring_next_block(tpacket_ring_t *ring,
+    int timeout, int *err);
+
+/* Fill in a header and a data pointer for each packet in "block",
+ * returning how many there are.  The timestamps are in nanoseconds, in
+ * the tv_usec field, and both arrays belong to the ring; they stay valid
+ * until the next call or until the block is released.  Only one thread
+ * may unpack a ring's blocks. */
+extern guint tpacket_block_unpack(tpacket_ring_t *ring, tpacket_block_t *block,
+    const struct pcap_pkthdr **phdrs, const u_char * const **pds);
+
+/* Give "block" back to the kernel.  Blocks must be released in the order
+ * in which tpacket_ring_next_block() returned them, but that can be done
+ * on another thread. */
+extern void tpacket_block_release(tpacket_ring_t *ring, tpacket_block_t *block);
+
+/* How many packets the kernel has put into the ring and how many it has
+ * dropped because the ring was full, since the ring was opened, and how
+ * many times it found the ring full. */
+extern gboolean tpacket_ring_stats(tpacket_ring_t *ring, guint32 *received,
+    guint32 *dropped, guint32 *freezes, int *err);
+
+extern void tpacket_ring_close(tpacket_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* TPACKET_RING_SUPPORTED */
+
+#endif /* __CAPTURE_TPACKET_H__ */
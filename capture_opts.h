@@ -188,6 +188,11 @@ typedef struct capture_options_tag {
     gchar    *save_file;            /**< the capture file name */
     gboolean group_read_access;     /**< TRUE is group read permission needs to be set */
     gboolean use_pcapng;            /**< TRUE if file format is pcapng */
+    gchar    *shm_ring_file;        /**< shared-memory ring through which
+                                         dumpcap hands packets to its parent,
+                                         or NULL */
+    guint    shm_ring_size;         /**< size in MB of the ring to set up for
+                                         dumpcap, 0 for none */
 
     /* GUI related */
     gboolean real_time_mode;        /**< Update list of packets in real time */
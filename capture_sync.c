@@ -101,7 +101,9 @@
 #include "ui/ui_util.h"
 
 #include <wsutil/file_util.h>
+#include <wsutil/shm_ring.h>
 #include "log.h"
+#include "tempfile.h"
 
 #ifdef _WIN32
 #include <process.h>    /* For spawning child process */
@@ -516,6 +518,36 @@ sync_pipe_start(capture_options *capture_opts) {
         argv = sync_pipe_add_arg(argv, &argc, "-w");
         argv = sync_pipe_add_arg(argv, &argc, capture_opts->save_file);
     }
+
+#ifdef SHM_RING_SUPPORTED
+    /* Have dumpcap hand us the packets through a shared-memory ring,
+       rather than our reading them back from the capture file; if we
+       can't set one up, we just read the file. */
+    g_free(capture_opts->shm_ring_file);
+    capture_opts->shm_ring_file = NULL;
+    if (capture_opts->shm_ring_size != 0 && !capture_opts->multi_files_on) {
+        char *tmpname;
+        int ring_fd;
+        int err;
+
+        ring_fd = create_tempfile(&tmpname, "wireshark_ring");
+        if (ring_fd != -1) {
+            if (shm_ring_init(ring_fd,
+                    MIN(capture_opts->shm_ring_size, SHM_RING_MAX_SIZE / (1024*1024)) * 1024 * 1024,
+                    &err)) {
+                capture_opts->shm_ring_file = g_strdup(tmpname);
+                argv = sync_pipe_add_arg(argv, &argc, "-R");
+                argv = sync_pipe_add_arg(argv, &argc, capture_opts->shm_ring_file);
+            } else {
+                g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_WARNING,
+                      "Can't set up the shared ring \"%s\": %s", tmpname, g_strerror(err));
+                ws_unlink(tmpname);
+            }
+            ws_close(ring_fd);
+        }
+    }
+#endif
+
     for (i = 0; i < argc; i++) {
         g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_DEBUG, "argv[%d]: %s", i, argv[i]);
     }
@@ -1671,6 +1703,50 @@ sync_pipe_input_cb(gint source, gpointer user_data)
     case SP_DROPS:
         capture_input_drops(capture_opts, (guint32)strtoul(buffer, NULL, 10));
         break;
+    case SP_QUEUE_HWM: {
+        char *ch;
+        guint index;
+        guint32 high_water, size;
+        interface_options interface_opts;
+
+        ch = strtok(buffer, ":");
+        index = (guint)strtoul(ch, NULL, 10);
+        ch = strtok(NULL, ":");
+        high_water = ch ? (guint32)strtoul(ch, NULL, 10) : 0;
+        ch = strtok(NULL, ":");
+        size = ch ? (guint32)strtoul(ch, NULL, 10) : 0;
+        if (index < capture_opts->ifaces->len) {
+            interface_opts = g_array_index(capture_opts->ifaces, interface_options, index);
+            g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_INFO,
+                  "Queue high-water mark on interface %s: %u of %u bytes",
+                  interface_opts.name, high_water, size);
+        }
+        break;
+        }
+    case SP_RING_DROPS: {
+        char *ch;
+        guint index, ring;
+        guint32 received, dropped, freezes;
+        interface_options interface_opts;
+
+        ch = strtok(buffer, ":");
+        index = (guint)strtoul(ch, NULL, 10);
+        ch = strtok(NULL, ":");
+        ring = ch ? (guint)strtoul(ch, NULL, 10) : 0;
+        ch = strtok(NULL, ":");
+        received = ch ? (guint32)strtoul(ch, NULL, 10) : 0;
+        ch = strtok(NULL, ":");
+        dropped = ch ? (guint32)strtoul(ch, NULL, 10) : 0;
+        ch = strtok(NULL, ":");
+        freezes = ch ? (guint32)strtoul(ch, NULL, 10) : 0;
+        if (index < capture_opts->ifaces->len) {
+            interface_opts = g_array_index(capture_opts->ifaces, interface_options, index);
+            g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_INFO,
+                  "Packets received/dropped on interface %s ring %u: %u/%u (ring full %u times)",
+                  interface_opts.name, ring, received, dropped, freezes);
+        }
+        break;
+        }
     default:
         g_assert_not_reached();
     }
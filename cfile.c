@@ -49,4 +49,5 @@ cap_file_init(capture_file *cf)
   cf->dfilter         = NULL;
   cf->redissecting    = FALSE;
   cf->frames          = NULL;
+  cf->search_hits     = NULL;
 }
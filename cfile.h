@@ -103,6 +103,7 @@ typedef struct _capture_file {
   search_charset_t scs_type;    /* Character set for text search */
   search_direction dir;         /* Direction in which to do searches */
   gboolean     search_in_progress; /* TRUE if user just clicked OK in the Find dialog or hit <control>N/B */
+  struct _search_hits *search_hits; /* Packets found by "Find all", or NULL */
   /* packet data */
   union wtap_pseudo_header pseudo_header; /* Packet pseudo_header */
   guint8       pd[WTAP_MAX_PACKET_SIZE];  /* Packet data */
@@ -32,6 +32,10 @@
 #include <string.h>
 #include <errno.h>
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include <glib.h>
 #include <epan/epan.h>
 
@@ -40,15 +44,45 @@
 #include <epan/filesystem.h>
 #include <wsutil/privileges.h>
 #include <epan/prefs.h>
+#include <epan/epan_dissect.h>
+#include <epan/frame_data.h>
+#include <epan/strutil.h>
+#include <epan/multisearch.h>
 #include "ui/util.h"
 #include "epan/dfilter/dfilter.h"
 #include "register.h"
+#include "wtap.h"
+
+#ifndef HAVE_GETOPT
+#include "wsutil/wsgetopt.h"
+#endif
 
 static void failure_message(const char *msg_format, va_list ap);
 static void open_failure_message(const char *filename, int err,
 	gboolean for_writing);
 static void read_failure_message(const char *filename, int err);
 static void write_failure_message(const char *filename, int err);
+static int benchmark(const char *cf_name, const char *filter_file,
+	int iterations);
+static int search_benchmark(const char *cf_name, const char *pattern_file,
+	int iterations);
+
+static void
+usage(void)
+{
+	fprintf(stderr, "Usage: dftest [-c] <filter>\n");
+	fprintf(stderr, "       dftest -b <capture file> [-n <iterations>] <filter file>\n");
+	fprintf(stderr, "       dftest -s <capture file> [-n <iterations>] <string file>\n");
+	fprintf(stderr, "\n");
+	fprintf(stderr, "  -c                show the compiled form of the bytecode as well\n");
+	fprintf(stderr, "  -b <capture file> time the bytecode interpreter against the compiled\n");
+	fprintf(stderr, "                    form for each filter in <filter file>\n");
+	fprintf(stderr, "  -s <capture file> time searching the packets' data for the strings in\n");
+	fprintf(stderr, "                    <string file> one by one, byte at a time and with\n");
+	fprintf(stderr, "                    epan_memmem(), against searching for all at once\n");
+	fprintf(stderr, "  -n <iterations>   apply each filter, or search each packet, this many\n");
+	fprintf(stderr, "                    times per packet (default 100)\n");
+}
 
 int
 main(int argc, char **argv)
@@ -59,6 +93,12 @@ main(int argc, char **argv)
 	int		gpf_open_errno, gpf_read_errno;
 	int		pf_open_errno, pf_read_errno;
 	dfilter_t	*df;
+	int		opt;
+	gboolean	dump_compiled = FALSE;
+	char		*bench_cf_name = NULL;
+	char		*search_cf_name = NULL;
+	int		iterations = 100;
+	int		status;
 
 	/*
 	 * Get credential information for later use.
@@ -125,14 +165,55 @@ main(int argc, char **argv)
 	line that its preferences have changed. */
 	prefs_apply_all();
 
+	while ((opt = getopt(argc, argv, "b:cn:s:")) != -1) {
+		switch (opt) {
+
+		case 'b':
+			bench_cf_name = optarg;
+			break;
+
+		case 'c':
+			dump_compiled = TRUE;
+			break;
+
+		case 'n':
+			iterations = atoi(optarg);
+			if (iterations <= 0) {
+				fprintf(stderr, "dftest: The number of iterations must be positive.\n");
+				exit(1);
+			}
+			break;
+
+		case 's':
+			search_cf_name = optarg;
+			break;
+
+		default:
+			usage();
+			exit(1);
+		}
+	}
+
 	/* Check for filter on command line */
-	if (argc <= 1) {
-		fprintf(stderr, "Usage: dftest <filter>\n");
+	if (optind >= argc) {
+		usage();
 		exit(1);
 	}
 
+	if (bench_cf_name != NULL) {
+		status = benchmark(bench_cf_name, argv[optind], iterations);
+		epan_cleanup();
+		exit(status);
+	}
+
+	if (search_cf_name != NULL) {
+		status = search_benchmark(search_cf_name, argv[optind], iterations);
+		epan_cleanup();
+		exit(status);
+	}
+
 	/* Get filter text */
-	text = get_args_as_string(argc, argv, 1);
+	text = get_args_as_string(argc, argv, optind);
 
 	printf("Filter: \"%s\"\n", text);
 
@@ -148,14 +229,414 @@ main(int argc, char **argv)
 
 	if (df == NULL)
 		printf("Filter is empty\n");
-	else
+	else {
 		dfilter_dump(df);
+		if (dump_compiled) {
+			printf("\n");
+			dfilter_dump_compiled(df);
+		}
+	}
 
 	dfilter_free(df);
 	epan_cleanup();
 	exit(0);
 }
 
+typedef struct {
+	char		*text;
+	dfilter_t	*df;
+	GTimer		*interpreted;
+	GTimer		*compiled;
+	guint32		mismatches;
+} bench_filter_t;
+
+/*
+ * Read the filters, one per line, from filter_file, skipping empty lines
+ * and comments.
+ */
+static GPtrArray *
+read_bench_filters(const char *filter_file)
+{
+	FILE		*fp;
+	char		line[2048];
+	char		*text;
+	GPtrArray	*filters;
+	bench_filter_t	*bf;
+
+	fp = fopen(filter_file, "r");
+	if (fp == NULL) {
+		open_failure_message(filter_file, errno, FALSE);
+		return NULL;
+	}
+
+	filters = g_ptr_array_new();
+	while (fgets(line, sizeof line, fp) != NULL) {
+		text = g_strstrip(line);
+		if (*text == '\0' || *text == '#')
+			continue;
+
+		bf = g_new0(bench_filter_t, 1);
+		if (!dfilter_compile(text, &bf->df) || bf->df == NULL) {
+			fprintf(stderr, "dftest: \"%s\": %s\n", text,
+				dfilter_error_msg ? dfilter_error_msg : "empty filter");
+			g_free(bf);
+			continue;
+		}
+		bf->text = g_strdup(text);
+		bf->interpreted = g_timer_new();
+		g_timer_stop(bf->interpreted);
+		bf->compiled = g_timer_new();
+		g_timer_stop(bf->compiled);
+		g_ptr_array_add(filters, bf);
+	}
+	fclose(fp);
+
+	return filters;
+}
+
+/*
+ * Dissect every packet in cf_name once, and apply each of the filters to
+ * it "iterations" times with the bytecode interpreter and as many times
+ * with the compiled form, timing both and checking that they agree.
+ */
+static int
+benchmark(const char *cf_name, const char *filter_file, int iterations)
+{
+	GPtrArray	*filters;
+	bench_filter_t	*bf;
+	wtap		*wth;
+	int		err;
+	gchar		*err_info = NULL;
+	gint64		data_offset;
+	frame_data	fdata, ref_frame;
+	const frame_data *ref = NULL;
+	epan_dissect_t	edt;
+	nstime_t	elapsed_time;
+	guint32		framenum = 0, cum_bytes = 0;
+	guint		i;
+	int		n;
+	gboolean	interpreted_result = FALSE, compiled_result = FALSE;
+	double		t_interpreted, t_compiled;
+	int		status = 0;
+
+	filters = read_bench_filters(filter_file);
+	if (filters == NULL)
+		return 2;
+	if (filters->len == 0) {
+		fprintf(stderr, "dftest: There are no filters in \"%s\".\n", filter_file);
+		g_ptr_array_free(filters, TRUE);
+		return 2;
+	}
+
+	wth = wtap_open_offline(cf_name, &err, &err_info, FALSE);
+	if (wth == NULL) {
+		fprintf(stderr, "dftest: The file \"%s\" could not be opened: %s.\n",
+			cf_name, wtap_strerror(err));
+		if (err_info != NULL) {
+			fprintf(stderr, "(%s)\n", err_info);
+			g_free(err_info);
+		}
+		status = 2;
+		goto out;
+	}
+
+	init_dissection();
+	nstime_set_zero(&elapsed_time);
+
+	while (wtap_read(wth, &err, &err_info, &data_offset)) {
+		framenum++;
+		frame_data_init(&fdata, framenum, wtap_phdr(wth), data_offset, cum_bytes);
+
+		epan_dissect_init(&edt, TRUE, FALSE);
+		for (i = 0; i < filters->len; i++) {
+			bf = (bench_filter_t *)g_ptr_array_index(filters, i);
+			epan_dissect_prime_dfilter(&edt, bf->df);
+		}
+
+		/* The filters are what's being timed; no relative times. */
+		frame_data_set_before_dissect(&fdata, &elapsed_time,
+			&ref, NULL);
+		if (ref == &fdata) {
+			ref_frame = fdata;
+			ref = &ref_frame;
+		}
+		epan_dissect_run(&edt, wtap_pseudoheader(wth), wtap_buf_ptr(wth),
+			&fdata, NULL);
+		frame_data_set_after_dissect(&fdata, &cum_bytes);
+
+		for (i = 0; i < filters->len; i++) {
+			bf = (bench_filter_t *)g_ptr_array_index(filters, i);
+
+			g_timer_continue(bf->interpreted);
+			for (n = 0; n < iterations; n++)
+				interpreted_result = dfilter_apply_interpreted(bf->df, edt.tree);
+			g_timer_stop(bf->interpreted);
+
+			g_timer_continue(bf->compiled);
+			for (n = 0; n < iterations; n++)
+				compiled_result = dfilter_apply(bf->df, edt.tree);
+			g_timer_stop(bf->compiled);
+
+			if (interpreted_result != compiled_result)
+				bf->mismatches++;
+		}
+
+		epan_dissect_cleanup(&edt);
+		frame_data_cleanup(&fdata);
+	}
+	if (err != 0) {
+		fprintf(stderr, "dftest: An error occurred while reading \"%s\": %s.\n",
+			cf_name, wtap_strerror(err));
+		if (err_info != NULL) {
+			fprintf(stderr, "(%s)\n", err_info);
+			g_free(err_info);
+		}
+		status = 2;
+	}
+	wtap_close(wth);
+
+	printf("%u packets, %d iterations per packet\n\n", framenum, iterations);
+	printf("%12s %12s %8s %10s  %s\n", "interpreted", "compiled", "speedup",
+		"mismatches", "filter");
+	for (i = 0; i < filters->len; i++) {
+		bf = (bench_filter_t *)g_ptr_array_index(filters, i);
+		t_interpreted = g_timer_elapsed(bf->interpreted, NULL);
+		t_compiled = g_timer_elapsed(bf->compiled, NULL);
+		printf("%11.3fs %11.3fs %7.2fx %10u  %s\n", t_interpreted, t_compiled,
+			t_compiled > 0 ? t_interpreted / t_compiled : 0.0,
+			bf->mismatches, bf->text);
+		if (bf->mismatches != 0)
+			status = 3;
+	}
+
+out:
+	for (i = 0; i < filters->len; i++) {
+		bf = (bench_filter_t *)g_ptr_array_index(filters, i);
+		dfilter_free(bf->df);
+		g_timer_destroy(bf->interpreted);
+		g_timer_destroy(bf->compiled);
+		g_free(bf->text);
+		g_free(bf);
+	}
+	g_ptr_array_free(filters, TRUE);
+
+	return status;
+}
+
+/*
+ * Read the strings to search for, one per line, from pattern_file,
+ * skipping empty lines and comments.
+ */
+static GPtrArray *
+read_bench_patterns(const char *pattern_file)
+{
+	FILE		*fp;
+	char		line[2048];
+	char		*text;
+	GPtrArray	*patterns;
+
+	fp = fopen(pattern_file, "r");
+	if (fp == NULL) {
+		open_failure_message(pattern_file, errno, FALSE);
+		return NULL;
+	}
+
+	patterns = g_ptr_array_new();
+	while (fgets(line, sizeof line, fp) != NULL) {
+		text = g_strstrip(line);
+		if (*text == '\0' || *text == '#')
+			continue;
+		g_ptr_array_add(patterns, g_strdup(text));
+	}
+	fclose(fp);
+
+	return patterns;
+}
+
+/* What epan_memmem() used to do */
+static const guint8 *
+naive_memmem(const guint8 *haystack, guint haystack_len,
+	const guint8 *needle, guint needle_len)
+{
+	const guint8 *begin;
+
+	if (needle_len == 0 || needle_len > haystack_len)
+		return NULL;
+
+	for (begin = haystack; begin <= haystack + haystack_len - needle_len; ++begin) {
+		if (begin[0] == needle[0] &&
+		    !memcmp(&begin[1], needle + 1, needle_len - 1))
+			return begin;
+	}
+	return NULL;
+}
+
+typedef struct {
+	gboolean	*seen;
+	guint32		found = 0;
+} bench_search_t;
+
+static gboolean
+bench_search_found(guint pattern, guint offset _U_, void *user_data)
+{
+	bench_search_t	*search = (bench_search_t *)user_data;
+
+	if (!search->seen[pattern]) {
+		search->seen[pattern] = TRUE;
+		search->found++;
+	}
+	return TRUE;
+}
+
+/*
+ * Search the data of every packet in cf_name for each of the strings in
+ * pattern_file "iterations" times, one string at a time with the old
+ * byte-at-a-time loop and with epan_memmem(), and then for all of them
+ * at once with a multisearch_t, timing each and checking that they find
+ * the same strings in the same packets.
+ */
+static int
+search_benchmark(const char *cf_name, const char *pattern_file, int iterations)
+{
+	GPtrArray	*patterns;
+	multisearch_t	*ms;
+	bench_search_t	search;
+	GTimer		*t_naive, *t_memmem, *t_multi;
+	wtap		*wth;
+	int		err;
+	gchar		*err_info = NULL;
+	gint64		data_offset;
+	const guint8	*data;
+	guint		data_len;
+	const char	*pattern;
+	guint32		framenum = 0;
+	guint64		bytes = 0;
+	guint32		found_naive = 0, found_memmem = 0, found_multi = 0;
+	guint32		found = 0;
+	guint		i;
+	int		n;
+	double		secs;
+	int		status = 0;
+
+	patterns = read_bench_patterns(pattern_file);
+	if (patterns == NULL)
+		return 2;
+	if (patterns->len == 0) {
+		fprintf(stderr, "dftest: There are no strings in \"%s\".\n", pattern_file);
+		g_ptr_array_free(patterns, TRUE);
+		return 2;
+	}
+
+	ms = multisearch_new();
+	for (i = 0; i < patterns->len; i++) {
+		pattern = (const char *)g_ptr_array_index(patterns, i);
+		multisearch_add(ms, (const guint8 *)pattern, (guint)strlen(pattern));
+	}
+	multisearch_compile(ms);
+	search.seen = g_new(gboolean, patterns->len);
+	search.found = 0;
+
+	t_naive = g_timer_new();
+	g_timer_stop(t_naive);
+	t_memmem = g_timer_new();
+	g_timer_stop(t_memmem);
+	t_multi = g_timer_new();
+	g_timer_stop(t_multi);
+
+	wth = wtap_open_offline(cf_name, &err, &err_info, FALSE);
+	if (wth == NULL) {
+		fprintf(stderr, "dftest: The file \"%s\" could not be opened: %s.\n",
+			cf_name, wtap_strerror(err));
+		if (err_info != NULL) {
+			fprintf(stderr, "(%s)\n", err_info);
+			g_free(err_info);
+		}
+		status = 2;
+		goto out;
+	}
+
+	while (wtap_read(wth, &err, &err_info, &data_offset)) {
+		framenum++;
+		data = wtap_buf_ptr(wth);
+		data_len = wtap_phdr(wth)->caplen;
+		bytes += data_len;
+
+		g_timer_continue(t_naive);
+		for (n = 0; n < iterations; n++) {
+			for (i = 0, found = 0; i < patterns->len; i++) {
+				pattern = (const char *)g_ptr_array_index(patterns, i);
+				if (naive_memmem(data, data_len, (const guint8 *)pattern,
+				    (guint)strlen(pattern)))
+					found++;
+			}
+		}
+		g_timer_stop(t_naive);
+		found_naive += found;
+
+		g_timer_continue(t_memmem);
+		for (n = 0; n < iterations; n++) {
+			for (i = 0, found = 0; i < patterns->len; i++) {
+				pattern = (const char *)g_ptr_array_index(patterns, i);
+				if (epan_memmem(data, data_len, (const guint8 *)pattern,
+				    (guint)strlen(pattern)))
+					found++;
+			}
+		}
+		g_timer_stop(t_memmem);
+		found_memmem += found;
+
+		g_timer_continue(t_multi);
+		for (n = 0; n < iterations; n++) {
+			memset(search.seen, 0, patterns->len * sizeof (gboolean));
+			search.found = 0;
+			multisearch_find_all(ms, data, data_len,
+				bench_search_found, &search);
+		}
+		g_timer_stop(t_multi);
+		found_multi += search.found;
+	}
+	if (err != 0) {
+		fprintf(stderr, "dftest: An error occurred while reading \"%s\": %s.\n",
+			cf_name, wtap_strerror(err));
+		if (err_info != NULL) {
+			fprintf(stderr, "(%s)\n", err_info);
+			g_free(err_info);
+		}
+		status = 2;
+	}
+	wtap_close(wth);
+
+	printf("%u packets, %" G_GINT64_MODIFIER "u bytes, %u strings, %d iterations per packet\n\n",
+		framenum, bytes, patterns->len, iterations);
+	printf("%-16s %12s %12s %10s\n", "", "time", "MB/s", "found");
+	secs = g_timer_elapsed(t_naive, NULL);
+	printf("%-16s %11.3fs %12.1f %10u\n", "byte at a time", secs,
+		secs > 0 ? bytes * iterations / secs / 1e6 : 0.0, found_naive);
+	secs = g_timer_elapsed(t_memmem, NULL);
+	printf("%-16s %11.3fs %12.1f %10u\n", "epan_memmem", secs,
+		secs > 0 ? bytes * iterations / secs / 1e6 : 0.0, found_memmem);
+	secs = g_timer_elapsed(t_multi, NULL);
+	printf("%-16s %11.3fs %12.1f %10u\n", "all at once", secs,
+		secs > 0 ? bytes * iterations / secs / 1e6 : 0.0, found_multi);
+
+	if (found_memmem != found_naive || found_multi != found_naive) {
+		fprintf(stderr, "dftest: The searches found different numbers of strings.\n");
+		status = 3;
+	}
+
+out:
+	g_timer_destroy(t_naive);
+	g_timer_destroy(t_memmem);
+	g_timer_destroy(t_multi);
+	g_free(search.seen);
+	multisearch_free(ms);
+	for (i = 0; i < patterns->len; i++)
+		g_free(g_ptr_array_index(patterns, i));
+	g_ptr_array_free(patterns, TRUE);
+
+	return status;
+}
+
 /*
  * General errors are reported with an console message in "dftest".
  */
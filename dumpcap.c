@@ -120,6 +120,9 @@
 #include "tempfile.h"
 #include "log.h"
 #include "wsutil/file_util.h"
+#include "wsutil/shm_ring.h"
+#include "capture-tpacket.h"
+#include "capture-queue.h"
 
 /*
  * Get information about libpcap format from "wiretap/libpcap.h".
@@ -142,12 +145,6 @@ FILE *debug_log;   /* for logging debug messages to  */
                    /*  is defined                    */
 #endif
 
-static GAsyncQueue *pcap_queue;
-static gint64 pcap_queue_bytes;
-static gint64 pcap_queue_packets;
-static gint64 pcap_queue_byte_limit = 1024 * 1024;
-static gint64 pcap_queue_packet_limit = 1000;
-
 static gboolean capture_child = FALSE; /* FALSE: standalone call, TRUE: this is an Wireshark capture child */
 #ifdef _WIN32
 static gchar *sig_pipe_name = NULL;
@@ -222,6 +219,17 @@ typedef enum {
     INITFILTER_OTHER_ERROR
 } initfilter_status_t;
 
+#ifdef TPACKET_RING_SUPPORTED
+/* One of an interface's TPACKET_V3 rings, and the thread reading it. */
+typedef struct _ring_reader {
+    struct _pcap_options *pcap_opts;
+    guint          index;                 /* which of the interface's rings this is */
+    tpacket_ring_t *ring;
+    GThread        *tid;
+    capture_queue_t *queue;               /* where the thread puts the blocks it reads */
+} ring_reader;
+#endif
+
 typedef struct _pcap_options {
     guint32        received;
     guint32        dropped;
@@ -232,6 +240,8 @@ typedef struct _pcap_options {
     gboolean       pcap_err;
     guint          interface_id;
     GThread        *tid;
+    capture_queue_t *queue;               /* where tid puts the packets it reads */
+    guint32        queue_hwm;             /* the most we've reported it holding */
     int            snaplen;
     int            linktype;
     gboolean       ts_nsec;               /* TRUE if we're using nanosecond precision. */
@@ -262,6 +272,13 @@ typedef struct _pcap_options {
     GMutex *cap_pipe_read_mtx;
     GAsyncQueue *cap_pipe_pending_q, *cap_pipe_done_q;
 #endif
+#ifdef TPACKET_RING_SUPPORTED
+    /* TPACKET_V3 rings we read from instead of pcap_h; pcap_h is then
+       a dead handle, only used to compile the capture filter. */
+    guint          ring_count;
+    ring_reader    *rings;
+    int            ring_err;              /* error reading from a ring */
+#endif
 } pcap_options;
 
 typedef struct _loop_data {
@@ -280,13 +297,40 @@ typedef struct _loop_data {
     int            save_file_fd;
     long           bytes_written;
     guint32        autostop_files;
+    GArray        *ring_marks;            /* If writing to a shared ring, where each packet
+                                             not already sent out to the sync_pipe ends */
 } loop_data;
 
-typedef struct _pcap_queue_element {
+/*
+ * With -t, each capture thread puts what it reads into a queue of its own,
+ * which only the writer - the thread running the capture loop - takes
+ * anything out of; this is the writer's view of one of those queues.
+ */
+typedef struct _capture_source {
     pcap_options       *pcap_opts;
-    struct pcap_pkthdr phdr;
-    u_char             *pd;
-} pcap_queue_element;
+    capture_queue_t    *queue;
+#ifdef TPACKET_RING_SUPPORTED
+    ring_reader        *reader;           /* NULL if the thread reads pcap_h */
+    /* the block whose packets are being written out */
+    tpacket_block_t    *block;
+    const struct pcap_pkthdr *block_phdrs;
+    const u_char * const *block_pds;
+    guint              block_count;
+    guint              block_next;
+#endif
+    gint64             head_since;        /* when the writer first saw its oldest packet, or 0 */
+} capture_source;
+
+/* Packets from one interface, on their way to the capture file. */
+#define WRITER_BATCH 1024
+
+typedef struct _writer_batch {
+    pcap_options       *pcap_opts;
+    guint              count;
+    struct pcap_pkthdr phdrs[WRITER_BATCH];
+    const u_char       *pds[WRITER_BATCH];
+    int                written;           /* packets written since the writer last looked */
+} writer_batch;
 
 /*
  * Standard secondary message for unexpected errors.
@@ -337,6 +381,26 @@ static gboolean need_timeout_workaround;
 
 #define WRITER_THREAD_TIMEOUT 100000 /* usecs */
 
+/*
+ * Room, in bytes, in each capture thread's queue; when it's full, the
+ * thread drops what it reads.
+ */
+#define CAPTURE_QUEUE_SIZE (4*1024*1024)
+
+/*
+ * With -O, how long, in microseconds, the writer holds on to a packet in
+ * case a thread that has nothing queued comes up with an older one, and
+ * how long it waits for one to do so before looking again.
+ */
+#define MERGE_HOLDBACK     100000
+#define MERGE_WAIT         10000
+
+static GArray *capture_sources;         /* of capture_source */
+static writer_batch *batch;
+static GMutex *writer_mtx;
+static GCond *writer_cond;
+static volatile gint writer_waiting;    /* the writer wants to be told about new packets */
+
 static void
 console_log_handler(const char *log_domain, GLogLevelFlags log_level,
                     const char *message, gpointer user_data _U_);
@@ -345,12 +409,25 @@ console_log_handler(const char *log_domain, GLogLevelFlags log_level,
 static capture_options global_capture_opts;
 static gboolean quiet = FALSE;
 static gboolean use_threads = FALSE;
+static gboolean merge_by_time = FALSE;  /* write packets from all interfaces in timestamp order */
+#ifdef TPACKET_RING_SUPPORTED
+static guint tpacket_rings = 0;     /* rings per interface; 0 to use libpcap */
+#endif
 static guint64 start_time;
 
 static void capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr,
                                          const u_char *pd);
 static void capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr,
                                          const u_char *pd);
+static int capture_loop_write_batch(pcap_options *pcap_opts, guint count,
+                                    const struct pcap_pkthdr *phdrs, const u_char * const *pds);
+#ifdef SHM_RING_SUPPORTED
+static void capture_loop_ring_full(guint64 written, void *user_data);
+#endif
+#ifdef TPACKET_RING_SUPPORTED
+static int capture_loop_write_block(ring_reader *reader, tpacket_block_t *block);
+static void capture_loop_queue_block(ring_reader *reader, tpacket_block_t *block);
+#endif
 static void capture_loop_get_errmsg(char *errmsg, int errmsglen, const char *fname,
                                     int err, gboolean is_close);
 
@@ -359,6 +436,12 @@ static void WS_MSVC_NORETURN exit_main(int err) G_GNUC_NORETURN;
 static void report_new_capture_file(const char *filename);
 static void report_packet_count(int packet_count);
 static void report_packet_drops(guint32 received, guint32 drops, gchar *name);
+static void report_queue_high_water(guint32 high_water, guint32 size,
+                                    const gchar *name, guint interface_id);
+#ifdef TPACKET_RING_SUPPORTED
+static void report_ring_drops(guint32 received, guint32 drops, guint32 freezes,
+                              const gchar *name, guint interface_id, guint index);
+#endif
 static void report_capture_error(const char *error_msg, const char *secondary_error_msg);
 static void report_cfilter_error(capture_options *capture_opts, guint i, const char *errmsg);
 
@@ -481,6 +564,12 @@ print_usage(gboolean print_ver)
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -t                       use a separate thread per interface\n");
+    fprintf(output, "  -O                       use a separate thread per interface, and write\n");
+    fprintf(output, "                           the packets in timestamp order\n");
+#ifdef TPACKET_RING_SUPPORTED
+    fprintf(output, "  -K <rings>               capture from each interface through this many\n");
+    fprintf(output, "                           TPACKET_V3 rings, each with its own thread\n");
+#endif
     fprintf(output, "  -q                       don't report packet capture counts\n");
     fprintf(output, "  -v                       print version information and exit\n");
     fprintf(output, "  -h                       display this help and exit\n");
@@ -2315,6 +2404,78 @@ cap_pipe_dispatch(loop_data *ld, pcap_options *pcap_opts, guchar *data, char *er
 }
 
 
+#ifdef TPACKET_RING_SUPPORTED
+/** Open "tpacket_rings" TPACKET_V3 rings on an interface, in a fanout
+ *  group if there's more than one.
+ *  Returns 1 if it succeeds, 0 if the interface can't be captured on that
+ *  way and libpcap should be used instead, -1 otherwise. */
+static int
+capture_loop_open_rings(interface_options *interface_opts, pcap_options *pcap_opts,
+                        char *errmsg, size_t errmsg_len)
+{
+    tpacket_ring_t *ring;
+    int fanout_group;
+    int buffer_size;
+    int err;
+    guint i;
+
+    if (interface_opts->monitor_mode ||
+        (interface_opts->linktype != -1 && interface_opts->linktype != DLT_EN10MB)) {
+        return 0;
+    }
+#ifdef HAVE_PCAP_CREATE
+    buffer_size = interface_opts->buffer_size;
+#else
+    buffer_size = 1;
+#endif
+
+    /* Fanout group IDs are system-wide, and the members of a group all
+       have to be on the same interface. */
+    if (tpacket_rings > 1)
+        fanout_group = (int)(((guint)getpid() << 4) + pcap_opts->interface_id) & 0xffff;
+    else
+        fanout_group = -1;
+
+    pcap_opts->rings = (ring_reader *)g_malloc0(tpacket_rings * sizeof (ring_reader));
+    for (i = 0; i < tpacket_rings; i++) {
+        ring = tpacket_ring_open(interface_opts->name, interface_opts->snaplen,
+                                 interface_opts->promisc_mode, buffer_size,
+                                 fanout_group, &err, errmsg, errmsg_len);
+        if (ring == NULL) {
+            if (i == 0 && (err == ENODEV || err == EPROTONOSUPPORT)) {
+                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+                      "capture_loop_open_rings: %s", errmsg);
+                *errmsg = '\0';
+                g_free(pcap_opts->rings);
+                pcap_opts->rings = NULL;
+                return 0;
+            }
+            /* capture_loop_close_input() will close the ones we've opened. */
+            return -1;
+        }
+        pcap_opts->rings[i].pcap_opts = pcap_opts;
+        pcap_opts->rings[i].index = i;
+        pcap_opts->rings[i].ring = ring;
+        pcap_opts->rings[i].tid = NULL;
+        pcap_opts->rings[i].queue = NULL;
+        pcap_opts->ring_count++;
+    }
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+          "capture_loop_open_rings: %u ring%s on %s", tpacket_rings,
+          plurality(tpacket_rings, "", "s"), interface_opts->name);
+
+    pcap_opts->linktype = tpacket_ring_linktype(pcap_opts->rings[0].ring);
+    pcap_opts->pcap_h = pcap_open_dead(pcap_opts->linktype, interface_opts->snaplen);
+    if (pcap_opts->pcap_h == NULL) {
+        g_snprintf(errmsg, (gulong) errmsg_len, "Could not allocate memory.");
+        return -1;
+    }
+    /* The kernel time stamps packets to the nanosecond. */
+    pcap_opts->ts_nsec = TRUE;
+    return 1;
+}
+#endif
+
 /** Open the capture input file (pcap or capture pipe).
  *  Returns TRUE if it succeeds, FALSE otherwise. */
 static gboolean
@@ -2405,6 +2566,8 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
         pcap_opts->pcap_err = FALSE;
         pcap_opts->interface_id = i;
         pcap_opts->tid = NULL;
+        pcap_opts->queue = NULL;
+        pcap_opts->queue_hwm = 0;
         pcap_opts->snaplen = 0;
         pcap_opts->linktype = -1;
         pcap_opts->ts_nsec = FALSE;
@@ -2434,10 +2597,31 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
 #endif
         pcap_opts->cap_pipe_pending_q = g_async_queue_new();
         pcap_opts->cap_pipe_done_q = g_async_queue_new();
+#endif
+#ifdef TPACKET_RING_SUPPORTED
+        pcap_opts->ring_count = 0;
+        pcap_opts->rings = NULL;
+        pcap_opts->ring_err = 0;
 #endif
         g_array_append_val(ld->pcaps, pcap_opts);
 
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_open_input : %s", interface_opts.name);
+#ifdef TPACKET_RING_SUPPORTED
+        if (tpacket_rings > 0) {
+            switch (capture_loop_open_rings(&interface_opts, pcap_opts, errmsg, errmsg_len)) {
+
+            case -1:
+                return FALSE;
+
+            case 0:
+                /* Not something we can capture on that way; use libpcap. */
+                break;
+
+            default:
+                continue;
+            }
+        }
+#endif
         pcap_opts->pcap_h = open_capture_device(&interface_opts, &open_err_str);
 
         if (pcap_opts->pcap_h != NULL) {
@@ -2567,6 +2751,9 @@ static void capture_loop_close_input(loop_data *ld)
 {
     guint i;
     pcap_options *pcap_opts;
+#ifdef TPACKET_RING_SUPPORTED
+    guint j;
+#endif
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_close_input");
 
@@ -2584,6 +2771,15 @@ static void capture_loop_close_input(loop_data *ld)
             CloseHandle(pcap_opts->cap_pipe_h);
             pcap_opts->cap_pipe_h = INVALID_HANDLE_VALUE;
         }
+#endif
+#ifdef TPACKET_RING_SUPPORTED
+        /* if open, close the rings */
+        for (j = 0; j < pcap_opts->ring_count; j++) {
+            tpacket_ring_close(pcap_opts->rings[j].ring);
+        }
+        pcap_opts->ring_count = 0;
+        g_free(pcap_opts->rings);
+        pcap_opts->rings = NULL;
 #endif
         /* if open, close the pcap "input file" */
         if (pcap_opts->pcap_h != NULL) {
@@ -2604,15 +2800,19 @@ static void capture_loop_close_input(loop_data *ld)
 
 /* init the capture filter */
 static initfilter_status_t
-capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
+capture_loop_init_filter(pcap_options *pcap_opts,
                          const gchar * name, const gchar * cfilter)
 {
+    pcap_t *pcap_h = pcap_opts->pcap_h;
     struct bpf_program fcode;
+#ifdef TPACKET_RING_SUPPORTED
+    guint i;
+#endif
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_init_filter: %s", cfilter);
 
     /* capture filters only work on real interfaces */
-    if (cfilter && !from_cap_pipe) {
+    if (cfilter && !pcap_opts->from_cap_pipe) {
         /* A capture filter was specified; set it up. */
         if (!compile_capture_filter(name, pcap_h, &fcode, cfilter)) {
             /* Treat this specially - our caller might try to compile this
@@ -2620,6 +2820,19 @@ capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
                the display and capture filter syntaxes are different. */
             return INITFILTER_BAD_FILTER;
         }
+#ifdef TPACKET_RING_SUPPORTED
+        /* The rings' sockets run the filter themselves. */
+        for (i = 0; i < pcap_opts->ring_count; i++) {
+            if (!tpacket_ring_set_filter(pcap_opts->rings[i].ring, &fcode,
+                                         &pcap_opts->ring_err)) {
+#ifdef HAVE_PCAP_FREECODE
+                pcap_freecode(&fcode);
+#endif
+                return INITFILTER_OTHER_ERROR;
+            }
+        }
+        if (pcap_opts->ring_count == 0)
+#endif
         if (pcap_setfilter(pcap_h, &fcode) < 0) {
 #ifdef HAVE_PCAP_FREECODE
             pcap_freecode(&fcode);
@@ -2657,6 +2870,13 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
     /* Set up to write to the capture file. */
     if (capture_opts->multi_files_on) {
         ld->pdh = ringbuf_init_libpcap_fdopen(&err);
+#ifdef SHM_RING_SUPPORTED
+    } else if (capture_opts->shm_ring_file != NULL) {
+        /* Write to the shared ring, and to the file as well if we have one. */
+        ld->ring_marks = g_array_new(FALSE, FALSE, sizeof (long));
+        ld->pdh = shm_ring_fopen(capture_opts->shm_ring_file, ld->save_file_fd,
+                                 capture_loop_ring_full, ld, &err);
+#endif
     } else {
         ld->pdh = libpcap_fdopen(ld->save_file_fd, &err);
     }
@@ -2744,6 +2964,33 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
     return TRUE;
 }
 
+#ifdef TPACKET_RING_SUPPORTED
+/* get the totals of the kernel's counters for an interface's rings and,
+   if "name" isn't NULL, report the counters for each ring */
+static gboolean
+capture_loop_get_ring_stats(pcap_options *pcap_opts, const gchar *name,
+                            guint32 *received, guint32 *dropped, int *err)
+{
+    guint32 ring_received, ring_dropped, ring_freezes;
+    guint i;
+
+    *received = 0;
+    *dropped = 0;
+    for (i = 0; i < pcap_opts->ring_count; i++) {
+        if (!tpacket_ring_stats(pcap_opts->rings[i].ring, &ring_received,
+                                &ring_dropped, &ring_freezes, err)) {
+            return FALSE;
+        }
+        if (name != NULL)
+            report_ring_drops(ring_received, ring_dropped, ring_freezes, name,
+                              pcap_opts->interface_id, i);
+        *received += ring_received;
+        *dropped += ring_dropped;
+    }
+    return TRUE;
+}
+#endif
+
 static gboolean
 capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err_close)
 {
@@ -2763,7 +3010,21 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
                 if (!pcap_opts->from_cap_pipe) {
                     guint64 isb_ifrecv, isb_ifdrop;
                     struct pcap_stat stats;
-
+#ifdef TPACKET_RING_SUPPORTED
+                    guint32 ring_received, ring_dropped;
+                    int err;
+
+                    if (pcap_opts->ring_count > 0) {
+                        if (capture_loop_get_ring_stats(pcap_opts, NULL, &ring_received,
+                                                        &ring_dropped, &err)) {
+                            isb_ifrecv = ring_received;
+                            isb_ifdrop = ring_dropped + pcap_opts->dropped;
+                        } else {
+                            isb_ifrecv = G_MAXUINT64;
+                            isb_ifdrop = G_MAXUINT64;
+                        }
+                    } else
+#endif
                     if (pcap_stats(pcap_opts->pcap_h, &stats) >= 0) {
                         isb_ifrecv = pcap_opts->received;
                         isb_ifdrop = stats.ps_drop + pcap_opts->dropped;
@@ -2810,6 +3071,26 @@ capture_loop_dispatch(loop_data *ld,
 #endif
 
     packet_count_before = ld->packet_count;
+#ifdef TPACKET_RING_SUPPORTED
+    if (pcap_opts->ring_count > 0) {
+        /* dispatch from our ring; without threads, there's only one */
+        tpacket_block_t *block;
+        int err;
+
+#ifdef LOG_CAPTURE_VERBOSE
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_dispatch: from TPACKET_V3 ring");
+#endif
+        block = tpacket_ring_next_block(pcap_opts->rings[0].ring, CAP_READ_TIMEOUT, &err);
+        if (block != NULL) {
+            inpkts = capture_loop_write_block(&pcap_opts->rings[0], block);
+            tpacket_block_release(pcap_opts->rings[0].ring, block);
+        } else if (err != 0) {
+            pcap_opts->ring_err = err;
+            ld->go = FALSE;
+        }
+    }
+    else
+#endif
     if (pcap_opts->from_cap_pipe) {
         /* dispatch from capture pipe */
 #ifdef LOG_CAPTURE_VERBOSE
@@ -3010,6 +3291,15 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_open_output: %s",
           (capture_opts->save_file) ? capture_opts->save_file : "(not specified)");
 
+    if (capture_opts->shm_ring_file != NULL && capture_opts->save_file == NULL) {
+        /* Our parent reads the packets from the shared ring, and nobody
+           asked for them to be saved, so don't bother with a temporary
+           file; the ring is our capture file. */
+        *save_file_fd = -1;
+        capture_opts->save_file = g_strdup(capture_opts->shm_ring_file);
+        return TRUE;
+    }
+
     if (capture_opts->save_file != NULL) {
         /* We return to the caller while the capture is in progress.
          * Therefore we need to take a copy of save_file in
@@ -3225,6 +3515,365 @@ pcap_read_handler(void* arg)
     return (NULL);
 }
 
+#ifdef TPACKET_RING_SUPPORTED
+static void *
+ring_read_handler(void* arg)
+{
+    ring_reader *reader;
+    tpacket_block_t *block;
+    int err;
+
+    reader = (ring_reader *)arg;
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Started thread for ring %u of interface %d.",
+          reader->index, reader->pcap_opts->interface_id);
+
+    while (global_ld.go) {
+        /* queue whole blocks as the kernel hands them over */
+        block = tpacket_ring_next_block(reader->ring, CAP_READ_TIMEOUT, &err);
+        if (block != NULL) {
+            capture_loop_queue_block(reader, block);
+        } else if (err != 0) {
+            reader->pcap_opts->ring_err = err;
+            global_ld.go = FALSE;
+        }
+    }
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Stopped thread for ring %u of interface %d.",
+          reader->index, reader->pcap_opts->interface_id);
+    g_thread_exit(NULL);
+    return (NULL);
+}
+#endif
+
+/* set up a queue for each capture thread */
+static void
+capture_loop_init_queues(void)
+{
+    pcap_options *pcap_opts;
+    capture_source source;
+    guint i;
+#ifdef TPACKET_RING_SUPPORTED
+    guint j;
+#endif
+
+    capture_sources = g_array_new(FALSE, TRUE, sizeof(capture_source));
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+        memset(&source, 0, sizeof source);
+        source.pcap_opts = pcap_opts;
+#ifdef TPACKET_RING_SUPPORTED
+        if (pcap_opts->ring_count > 0) {
+            for (j = 0; j < pcap_opts->ring_count; j++) {
+                pcap_opts->rings[j].queue = capture_queue_new(CAPTURE_QUEUE_SIZE);
+                source.queue = pcap_opts->rings[j].queue;
+                source.reader = &pcap_opts->rings[j];
+                g_array_append_val(capture_sources, source);
+            }
+            continue;
+        }
+#endif
+        pcap_opts->queue = capture_queue_new(CAPTURE_QUEUE_SIZE);
+        pcap_opts->queue_hwm = 0;
+        source.queue = pcap_opts->queue;
+        g_array_append_val(capture_sources, source);
+    }
+    batch = g_new0(writer_batch, 1);
+#if GLIB_CHECK_VERSION(2,31,0)
+    writer_mtx = g_new(GMutex, 1);
+    g_mutex_init(writer_mtx);
+    writer_cond = g_new(GCond, 1);
+    g_cond_init(writer_cond);
+#else
+    writer_mtx = g_mutex_new();
+    writer_cond = g_cond_new();
+#endif
+    writer_waiting = 0;
+}
+
+/* free the queues; the capture threads must have stopped */
+static void
+capture_loop_free_queues(void)
+{
+    capture_source *source;
+    guint i;
+
+    for (i = 0; i < capture_sources->len; i++) {
+        source = &g_array_index(capture_sources, capture_source, i);
+#ifdef TPACKET_RING_SUPPORTED
+        if (source->reader != NULL) {
+            source->reader->queue = NULL;
+        } else
+#endif
+        source->pcap_opts->queue = NULL;
+        capture_queue_free(source->queue);
+    }
+    g_array_free(capture_sources, TRUE);
+    capture_sources = NULL;
+    g_free(batch);
+    batch = NULL;
+#if GLIB_CHECK_VERSION(2,31,0)
+    g_mutex_clear(writer_mtx);
+    g_free(writer_mtx);
+    g_cond_clear(writer_cond);
+    g_free(writer_cond);
+#else
+    g_mutex_free(writer_mtx);
+    g_cond_free(writer_cond);
+#endif
+}
+
+/* a capture thread has queued something; wake the writer up if it's
+   waiting for that */
+static void
+capture_loop_wake_writer(void)
+{
+    if (g_atomic_int_get(&writer_waiting)) {
+        g_mutex_lock(writer_mtx);
+        g_cond_signal(writer_cond);
+        g_mutex_unlock(writer_mtx);
+    }
+}
+
+/* write out the batch, and hand the queue space of everything in it back
+   to the capture threads */
+static void
+capture_loop_flush_batch(void)
+{
+    guint i;
+
+    if (batch->count != 0) {
+        batch->written += capture_loop_write_batch(batch->pcap_opts, batch->count,
+                                                   batch->phdrs, batch->pds);
+        batch->count = 0;
+    }
+    for (i = 0; i < capture_sources->len; i++) {
+        capture_queue_release(g_array_index(capture_sources, capture_source, i).queue);
+    }
+}
+
+/* Find the oldest packet a capture thread has queued that hasn't been
+   batched yet.
+   Returns FALSE if there isn't one. */
+static gboolean
+capture_source_head(capture_source *source, const struct pcap_pkthdr **phdr,
+                    const u_char **pd)
+{
+    const capture_queue_entry *entry;
+
+    for (;;) {
+#ifdef TPACKET_RING_SUPPORTED
+        if (source->block != NULL) {
+            if (source->block_next < source->block_count) {
+                *phdr = &source->block_phdrs[source->block_next];
+                *pd = source->block_pds[source->block_next];
+                return TRUE;
+            }
+            /* The packets batched from the block have to be written out
+               before the block goes back to the kernel. */
+            capture_loop_flush_batch();
+            tpacket_block_release(source->reader->ring, source->block);
+            source->block = NULL;
+        }
+#endif
+        entry = capture_queue_peek(source->queue);
+        if (entry == NULL)
+            return FALSE;
+#ifdef TPACKET_RING_SUPPORTED
+        if (entry->block != NULL) {
+            source->block = (tpacket_block_t *)entry->block;
+            source->block_count = tpacket_block_unpack(source->reader->ring, source->block,
+                                                       &source->block_phdrs, &source->block_pds);
+            source->block_next = 0;
+            capture_queue_next(source->queue);
+            continue;
+        }
+#endif
+        *phdr = &entry->phdr;
+        *pd = CAPTURE_QUEUE_ENTRY_DATA(entry);
+        return TRUE;
+    }
+}
+
+/* add the packet capture_source_head() found to the batch */
+static void
+capture_source_take_head(capture_source *source, const struct pcap_pkthdr *phdr,
+                         const u_char *pd)
+{
+    if (batch->count != 0 &&
+        (batch->pcap_opts != source->pcap_opts || batch->count == WRITER_BATCH)) {
+        capture_loop_flush_batch();
+    }
+    batch->pcap_opts = source->pcap_opts;
+    batch->phdrs[batch->count] = *phdr;
+    batch->pds[batch->count] = pd;
+    batch->count++;
+
+#ifdef TPACKET_RING_SUPPORTED
+    if (source->block != NULL) {
+        source->block_next++;
+    } else
+#endif
+    capture_queue_next(source->queue);
+    source->head_since = 0;
+}
+
+/* TRUE if a capture thread has queued something that hasn't been written
+   out yet */
+static gboolean
+capture_loop_queues_pending(void)
+{
+    capture_source *source;
+    guint i;
+
+    for (i = 0; i < capture_sources->len; i++) {
+        source = &g_array_index(capture_sources, capture_source, i);
+#ifdef TPACKET_RING_SUPPORTED
+        if (source->block != NULL)
+            return TRUE;
+#endif
+        if (capture_queue_peek(source->queue) != NULL)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Write out what the capture threads have queued, a batch at a time, and
+   with -O in timestamp order; unless "draining", a packet is held back
+   for a while if a thread with nothing queued might still come up with
+   an older one, in which case "*held" is set.
+   Returns the number of packets written. */
+static int
+capture_loop_write_queues(gboolean draining, gboolean *held)
+{
+    capture_source *source, *oldest;
+    const struct pcap_pkthdr *phdr, *oldest_phdr = NULL;
+    const u_char *pd, *oldest_pd = NULL;
+    guint64 ts, oldest_ts = 0;
+    gboolean empty_source;
+    GTimeVal now;
+    gint64 now_usec;
+    guint i, n;
+
+    *held = FALSE;
+    batch->written = 0;
+
+    if (!merge_by_time) {
+        /* Take turns, so that a busy interface can't hold up the rest. */
+        for (i = 0; i < capture_sources->len; i++) {
+            source = &g_array_index(capture_sources, capture_source, i);
+            for (n = 0; n < WRITER_BATCH && capture_source_head(source, &phdr, &pd); n++) {
+                capture_source_take_head(source, phdr, pd);
+            }
+        }
+        capture_loop_flush_batch();
+        return batch->written;
+    }
+
+    g_get_current_time(&now);
+    now_usec = (gint64)now.tv_sec * 1000000 + now.tv_usec;
+    for (n = 0; n < WRITER_BATCH * capture_sources->len; n++) {
+        oldest = NULL;
+        empty_source = FALSE;
+        for (i = 0; i < capture_sources->len; i++) {
+            source = &g_array_index(capture_sources, capture_source, i);
+            if (!capture_source_head(source, &phdr, &pd)) {
+                empty_source = TRUE;
+                continue;
+            }
+            if (source->head_since == 0)
+                source->head_since = now_usec;
+            /* in nanoseconds, whatever the interface's precision */
+            ts = (guint64)phdr->ts.tv_sec * 1000000000 +
+                 (guint64)phdr->ts.tv_usec * (source->pcap_opts->ts_nsec ? 1 : 1000);
+            if (oldest == NULL || ts < oldest_ts) {
+                oldest = source;
+                oldest_ts = ts;
+                oldest_phdr = phdr;
+                oldest_pd = pd;
+            }
+        }
+        if (oldest == NULL)
+            break;
+        if (empty_source && !draining &&
+            now_usec - oldest->head_since < MERGE_HOLDBACK) {
+            *held = TRUE;
+            break;
+        }
+        capture_source_take_head(oldest, oldest_phdr, oldest_pd);
+    }
+    capture_loop_flush_batch();
+    return batch->written;
+}
+
+/* wait for the capture threads to queue something, unless they have
+   already */
+static void
+capture_loop_wait_for_queues(gboolean held)
+{
+    gint64 timeout;
+#if !GLIB_CHECK_VERSION(2,31,0)
+    GTimeVal until;
+#endif
+
+    g_mutex_lock(writer_mtx);
+    g_atomic_int_set(&writer_waiting, 1);
+    if (held) {
+        /* there's something queued, but it has to wait */
+        timeout = MERGE_WAIT;
+    } else if (capture_loop_queues_pending()) {
+        timeout = 0;
+    } else {
+        timeout = WRITER_THREAD_TIMEOUT;
+    }
+    if (timeout != 0) {
+#if GLIB_CHECK_VERSION(2,31,0)
+        g_cond_wait_until(writer_cond, writer_mtx, g_get_monotonic_time() + timeout);
+#else
+        g_get_current_time(&until);
+        g_time_val_add(&until, (glong)timeout);
+        g_cond_timed_wait(writer_cond, writer_mtx, &until);
+#endif
+    }
+    g_atomic_int_set(&writer_waiting, 0);
+    g_mutex_unlock(writer_mtx);
+}
+
+/* Tell the user, or our parent, how full each interface's queue has got;
+   our parent hears about it whenever it's got fuller, standalone users
+   only at the end of the capture. */
+static void
+capture_loop_report_queues(capture_options *capture_opts, gboolean final)
+{
+    pcap_options *pcap_opts;
+    interface_options interface_opts;
+    capture_source *source;
+    guint32 high_water, size;
+    guint i, j;
+
+    if (!capture_child && !final)
+        return;
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+        interface_opts = g_array_index(capture_opts->ifaces, interface_options, i);
+        high_water = 0;
+        size = 0;
+        /* With several rings, the fullest of their queues. */
+        for (j = 0; j < capture_sources->len; j++) {
+            source = &g_array_index(capture_sources, capture_source, j);
+            if (source->pcap_opts == pcap_opts &&
+                capture_queue_high_water(source->queue) >= high_water) {
+                high_water = capture_queue_high_water(source->queue);
+                size = capture_queue_size(source->queue);
+            }
+        }
+        if (!capture_child || high_water > pcap_opts->queue_hwm) {
+            report_queue_high_water(high_water, size, interface_opts.name,
+                                    pcap_opts->interface_id);
+            pcap_opts->queue_hwm = high_water;
+        }
+    }
+}
+
 /* Do the low-level work of a capture.
    Returns TRUE if it succeeds, FALSE otherwise. */
 static gboolean
@@ -3249,6 +3898,9 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     pcap_options *pcap_opts;
     interface_options interface_opts;
     guint i, error_index = 0;
+#ifdef TPACKET_RING_SUPPORTED
+    guint j;
+#endif
 
     *errmsg           = '\0';
     *secondary_errmsg = '\0';
@@ -3266,6 +3918,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     global_ld.inpkts_to_sync_pipe = 0;
     global_ld.err                 = 0;  /* no error seen yet */
     global_ld.pdh                 = NULL;
+    global_ld.ring_marks          = NULL;
     global_ld.autostop_files      = 0;
     global_ld.save_file_fd        = -1;
 
@@ -3289,8 +3942,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
          * is NULL. This might be a bug in WPCap. Therefore we provide an empty
          * string.
          */
-        switch (capture_loop_init_filter(pcap_opts->pcap_h, pcap_opts->from_cap_pipe,
-                                         interface_opts.name,
+        switch (capture_loop_init_filter(pcap_opts, interface_opts.name,
                                          interface_opts.cfilter?interface_opts.cfilter:"")) {
 
         case INITFILTER_NO_ERROR:
@@ -3303,6 +3955,12 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             goto error;
 
         case INITFILTER_OTHER_ERROR:
+#ifdef TPACKET_RING_SUPPORTED
+            if (pcap_opts->ring_count > 0)
+                g_snprintf(errmsg, sizeof(errmsg), "Can't install filter (%s).",
+                           g_strerror(pcap_opts->ring_err));
+            else
+#endif
             g_snprintf(errmsg, sizeof(errmsg), "Can't install filter (%s).",
                        pcap_geterr(pcap_opts->pcap_h));
             g_snprintf(secondary_errmsg, sizeof(secondary_errmsg), "%s", please_report);
@@ -3338,7 +3996,8 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
            update its windows to indicate that we have a live capture in
            progress. */
         libpcap_dump_flush(global_ld.pdh, NULL);
-        report_new_capture_file(capture_opts->save_file);
+        report_new_capture_file(capture_opts->shm_ring_file != NULL ?
+                                capture_opts->shm_ring_file : capture_opts->save_file);
     }
 
     /* initialize capture stop (and alike) conditions */
@@ -3373,11 +4032,22 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     /* WOW, everything is prepared! */
     /* please fasten your seat belts, we will enter now the actual capture loop */
     if (use_threads) {
-        pcap_queue = g_async_queue_new();
-        pcap_queue_bytes = 0;
-        pcap_queue_packets = 0;
+        capture_loop_init_queues();
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+#ifdef TPACKET_RING_SUPPORTED
+            if (pcap_opts->ring_count > 0) {
+                /* a thread for each ring */
+                for (j = 0; j < pcap_opts->ring_count; j++) {
+#if GLIB_CHECK_VERSION(2,31,0)
+                    pcap_opts->rings[j].tid = g_thread_new("Capture ring read", ring_read_handler, &pcap_opts->rings[j]);
+#else
+                    pcap_opts->rings[j].tid = g_thread_create(ring_read_handler, &pcap_opts->rings[j], TRUE, NULL);
+#endif
+                }
+                continue;
+            }
+#endif
 #if GLIB_CHECK_VERSION(2,31,0)
             /* XXX - Add an interface name here? */
             pcap_opts->tid = g_thread_new("Capture read", pcap_read_handler, pcap_opts);
@@ -3389,38 +4059,10 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     while (global_ld.go) {
         /* dispatch incoming packets */
         if (use_threads) {
-            pcap_queue_element *queue_element;
-#if GLIB_CHECK_VERSION(2,31,18)
-
-            g_async_queue_lock(pcap_queue);
-            queue_element = g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-#else
-            GTimeVal write_thread_time;
+            gboolean held;
 
-            g_get_current_time(&write_thread_time);
-            g_time_val_add(&write_thread_time, WRITER_THREAD_TIMEOUT);
-            g_async_queue_lock(pcap_queue);
-            queue_element = g_async_queue_timed_pop_unlocked(pcap_queue, &write_thread_time);
-#endif
-            if (queue_element) {
-                pcap_queue_bytes -= queue_element->phdr.caplen;
-                pcap_queue_packets -= 1;
-            }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element) {
-                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                      "Dequeued a packet of length %d captured on interface %d.",
-                      queue_element->phdr.caplen, queue_element->pcap_opts->interface_id);
-
-                capture_loop_write_packet_cb((u_char *) queue_element->pcap_opts,
-                                             &queue_element->phdr,
-                                             queue_element->pd);
-                g_free(queue_element->pd);
-                g_free(queue_element);
-                inpkts = 1;
-            } else {
-                inpkts = 0;
-            }
+            inpkts = capture_loop_write_queues(FALSE, &held);
+            capture_loop_wait_for_queues(held);
         } else {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, 0);
             inpkts = capture_loop_dispatch(&global_ld, errmsg,
@@ -3486,13 +4128,20 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                 libpcap_dump_flush(global_ld.pdh, NULL);
 
                 /* Send our parent a message saying we've written out
-                   "global_ld.inpkts_to_sync_pipe" packets to the capture file. */
-                if (!quiet)
+                   "global_ld.inpkts_to_sync_pipe" packets to the capture file;
+                   if the shared ring filled up while we flushed, we might
+                   have told it about them already. */
+                if (!quiet && global_ld.inpkts_to_sync_pipe > 0)
                     report_packet_count(global_ld.inpkts_to_sync_pipe);
 
                 global_ld.inpkts_to_sync_pipe = 0;
+                if (global_ld.ring_marks != NULL)
+                    g_array_set_size(global_ld.ring_marks, 0);
             }
 
+            if (use_threads)
+                capture_loop_report_queues(capture_opts, FALSE);
+
             /* check capture duration condition */
             if (cnd_autostop_duration != NULL && cnd_eval(cnd_autostop_duration)) {
                 /* The maximum capture time has elapsed; stop the capture. */
@@ -3512,40 +4161,34 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Capture loop stopping ...");
     if (use_threads) {
-        pcap_queue_element *queue_element;
+        gboolean held;
 
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+#ifdef TPACKET_RING_SUPPORTED
+            if (pcap_opts->ring_count > 0) {
+                for (j = 0; j < pcap_opts->ring_count; j++) {
+                    g_thread_join(pcap_opts->rings[j].tid);
+                }
+                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Threads of interface %u terminated.",
+                      pcap_opts->interface_id);
+                continue;
+            }
+#endif
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Waiting for thread of interface %u...",
                   pcap_opts->interface_id);
             g_thread_join(pcap_opts->tid);
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Thread of interface %u terminated.",
                   pcap_opts->interface_id);
         }
-        while (1) {
-            g_async_queue_lock(pcap_queue);
-            queue_element = g_async_queue_try_pop_unlocked(pcap_queue);
-            if (queue_element) {
-                pcap_queue_bytes -= queue_element->phdr.caplen;
-                pcap_queue_packets -= 1;
-            }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element == NULL) {
-                break;
-            }
-            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                  "Dequeued a packet of length %d captured on interface %d.",
-                  queue_element->phdr.caplen, queue_element->pcap_opts->interface_id);
-            capture_loop_write_packet_cb((u_char *)queue_element->pcap_opts,
-                                         &queue_element->phdr,
-                                         queue_element->pd);
-            g_free(queue_element->pd);
-            g_free(queue_element);
-            global_ld.inpkts_to_sync_pipe += 1;
-            if (capture_opts->output_to_pipe) {
-                libpcap_dump_flush(global_ld.pdh, NULL);
-            }
+        while (capture_loop_queues_pending()) {
+            global_ld.inpkts_to_sync_pipe += capture_loop_write_queues(TRUE, &held);
+        }
+        if (capture_opts->output_to_pipe) {
+            libpcap_dump_flush(global_ld.pdh, NULL);
         }
+        capture_loop_report_queues(capture_opts, TRUE);
+        capture_loop_free_queues();
     }
 
 
@@ -3593,6 +4236,20 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                 report_capture_error(errmsg, please_report);
             }
             break;
+#ifdef TPACKET_RING_SUPPORTED
+        } else if (pcap_opts->ring_err != 0) {
+            /* As above. */
+            if (pcap_opts->ring_err == ENETDOWN || pcap_opts->ring_err == ENXIO) {
+                report_capture_error("The network adapter on which the capture was being done "
+                                     "is no longer running; the capture has stopped.",
+                                     "");
+            } else {
+                g_snprintf(errmsg, sizeof(errmsg), "Error while capturing packets: %s",
+                           g_strerror(pcap_opts->ring_err));
+                report_capture_error(errmsg, please_report);
+            }
+            break;
+#endif
         } else if (pcap_opts->from_cap_pipe && pcap_opts->cap_pipe_err == PIPERR) {
             report_capture_error(errmsg, "");
             break;
@@ -3616,10 +4273,14 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
     /* there might be packets not yet notified to the parent */
     /* (do this after closing the file, so all packets are already flushed) */
-    if(global_ld.inpkts_to_sync_pipe) {
+    if(global_ld.inpkts_to_sync_pipe > 0) {
         if (!quiet)
             report_packet_count(global_ld.inpkts_to_sync_pipe);
-        global_ld.inpkts_to_sync_pipe = 0;
+    }
+    global_ld.inpkts_to_sync_pipe = 0;
+    if (global_ld.ring_marks != NULL) {
+        g_array_free(global_ld.ring_marks, TRUE);
+        global_ld.ring_marks = NULL;
     }
 
     /* If we've displayed a message about a write error, there's no point
@@ -3652,6 +4313,28 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
         dropped = pcap_opts->dropped;
         if (pcap_opts->pcap_h != NULL) {
             g_assert(!pcap_opts->from_cap_pipe);
+#ifdef TPACKET_RING_SUPPORTED
+            if (pcap_opts->ring_count > 0) {
+                guint32 ring_received, ring_dropped;
+                int err;
+
+                /* Report each ring's counters, so that they can be sized. */
+                if (capture_loop_get_ring_stats(pcap_opts, interface_opts.name,
+                                                &ring_received, &ring_dropped, &err)) {
+                    *stats_known = TRUE;
+                    stats->ps_recv = ring_received;
+                    stats->ps_drop = ring_dropped;
+                    stats->ps_ifdrop = 0;
+                    received = ring_received;
+                    dropped += ring_dropped;
+                } else {
+                    g_snprintf(errmsg, sizeof(errmsg),
+                               "Can't get packet-drop statistics: %s",
+                               g_strerror(err));
+                    report_capture_error(errmsg, please_report);
+                }
+            } else
+#endif
             /* Get the capture statistics, so we know how many packets were dropped. */
             if (pcap_stats(pcap_opts->pcap_h, stats) >= 0) {
                 *stats_known = TRUE;
@@ -3803,6 +4486,8 @@ capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
                   "Wrote a packet of length %d captured on interface %u.",
                    phdr->caplen, pcap_opts->interface_id);
             global_ld.packet_count++;
+            if (global_ld.ring_marks != NULL)
+                g_array_append_val(global_ld.ring_marks, global_ld.bytes_written);
             /* if the user told us to stop after x packets, do we already have enough? */
             if ((global_ld.packet_max > 0) && (global_ld.packet_count >= global_ld.packet_max)) {
                 global_ld.go = FALSE;
@@ -3817,8 +4502,6 @@ capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
                              const u_char *pd)
 {
     pcap_options *pcap_opts = (pcap_options *) (void *) pcap_opts_p;
-    pcap_queue_element *queue_element;
-    gboolean limit_reached;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -3828,50 +4511,130 @@ capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
         return;
     }
 
-    queue_element = (pcap_queue_element *)g_malloc(sizeof(pcap_queue_element));
-    if (queue_element == NULL) {
-       pcap_opts->dropped++;
-       return;
-    }
-    queue_element->pcap_opts = pcap_opts;
-    queue_element->phdr = *phdr;
-    queue_element->pd = (u_char *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
-        pcap_opts->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, phdr->caplen);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit > 0) && (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit > 0) && (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = FALSE;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += phdr->caplen;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = TRUE;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
+    if (!capture_queue_push(pcap_opts->queue, phdr, pd, NULL)) {
+        /* The writer is too far behind. */
         pcap_opts->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Dropped a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_opts->interface_id);
+        return;
+    }
+    pcap_opts->received++;
+    capture_loop_wake_writer();
+}
+
+/* some packets captured on one interface were taken off the queues; write
+   them out, unless we've been told to stop, and return the number written */
+static int
+capture_loop_write_batch(pcap_options *pcap_opts, guint count,
+                         const struct pcap_pkthdr *phdrs, const u_char * const *pds)
+{
+    int err;
+    guint ts_mul = pcap_opts->ts_nsec ? 1000000000 : 1000000;
+    gboolean successful;
+    guint i;
+
+    /* As in capture_loop_write_packet_cb(). */
+    if (!global_ld.go || global_ld.pdh == NULL)
+        return 0;
+
+    if ((global_ld.packet_max > 0) &&
+        (count > (guint)(global_ld.packet_max - global_ld.packet_count))) {
+        count = global_ld.packet_max - global_ld.packet_count;
+    }
+
+    if (global_ld.ring_marks != NULL) {
+        /* The shared ring isn't written with system calls anyway, and
+           capture_loop_ring_full() needs to know where each packet ends. */
+        successful = TRUE;
+        for (i = 0; successful && i < count; i++) {
+            if (global_capture_opts.use_pcapng) {
+                successful = libpcap_write_enhanced_packet_block(global_ld.pdh, &phdrs[i], pcap_opts->interface_id, ts_mul, pds[i], &global_ld.bytes_written, &err);
+            } else {
+                successful = libpcap_write_packet(global_ld.pdh, &phdrs[i], pds[i], &global_ld.bytes_written, &err);
+            }
+            if (successful)
+                g_array_append_val(global_ld.ring_marks, global_ld.bytes_written);
+        }
+    } else if (global_capture_opts.use_pcapng) {
+        /* The packets get written with as few system calls as possible. */
+        successful = libpcap_write_enhanced_packet_blocks(global_ld.pdh, count, phdrs, pcap_opts->interface_id, ts_mul, pds, &global_ld.bytes_written, &err);
     } else {
-        pcap_opts->received++;
-        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-              "Queued a packet of length %d captured on interface %u.",
-              phdr->caplen, pcap_opts->interface_id);
+        successful = libpcap_write_packets(global_ld.pdh, count, phdrs, pds, &global_ld.bytes_written, &err);
+    }
+    if (!successful) {
+        global_ld.go = FALSE;
+        global_ld.err = err;
+        return 0;
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-          "Queue size is now %" G_GINT64_MODIFIER "d bytes (%" G_GINT64_MODIFIER "d packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+          "Wrote %u packets captured on interface %u.",
+          count, pcap_opts->interface_id);
+    global_ld.packet_count += count;
+    /* if the user told us to stop after x packets, do we already have enough? */
+    if ((global_ld.packet_max > 0) && (global_ld.packet_count >= global_ld.packet_max)) {
+        global_ld.go = FALSE;
+    }
+    return count;
+}
+
+#ifdef SHM_RING_SUPPORTED
+/* the shared ring is full; our parent only reads as many packets as we've
+   told it about, so it can't make room until it's told about the ones
+   that are in the ring, without waiting for the next update */
+static void
+capture_loop_ring_full(guint64 written, void *user_data)
+{
+    loop_data *ld = (loop_data *)user_data;
+    guint n;
+
+    for (n = 0; n < ld->ring_marks->len; n++) {
+        if ((guint64)g_array_index(ld->ring_marks, long, n) > written)
+            break;
+    }
+    if (n == 0)
+        return;
+    g_array_remove_range(ld->ring_marks, 0, n);
+    if (!quiet)
+        report_packet_count(n);
+    ld->inpkts_to_sync_pipe -= n;
+}
+#endif
+
+#ifdef TPACKET_RING_SUPPORTED
+/* a block of packets was captured on a ring, write them out; returns the
+   number of packets written */
+static int
+capture_loop_write_block(ring_reader *reader, tpacket_block_t *block)
+{
+    const struct pcap_pkthdr *phdrs;
+    const u_char * const *pds;
+    guint count;
+
+    /* The packets get written straight from the ring. */
+    count = tpacket_block_unpack(reader->ring, block, &phdrs, &pds);
+    return capture_loop_write_batch(reader->pcap_opts, count, phdrs, pds);
+}
+
+/* a block of packets was captured on a ring, queue it */
+static void
+capture_loop_queue_block(ring_reader *reader, tpacket_block_t *block)
+{
+    /* The packets stay in the ring until they've been written, so it's
+       the ring's size, not the queue's, that says how far behind the
+       writer can get; when it's too far, the kernel drops packets, and
+       counts them in the ring's statistics.  The queue only fills up
+       if the ring has more blocks than it has room for entries. */
+    while (!capture_queue_push(reader->queue, NULL, NULL, block)) {
+        if (!global_ld.go) {
+            tpacket_block_release(reader->ring, block);
+            return;
+        }
+        g_usleep(1000);
+    }
+    capture_loop_wake_writer();
 }
+#endif
 
 /* And now our feature presentation... [ fade to music ] */
 int
@@ -3951,7 +4714,19 @@ main(int argc, char *argv[])
 #define OPTSTRING_d ""
 #endif
 
-#define OPTSTRING "a:" OPTSTRING_A "b:" OPTSTRING_B "c:" OPTSTRING_d "Df:ghi:" OPTSTRING_I "L" OPTSTRING_m "MnpPq" OPTSTRING_r "Ss:t" OPTSTRING_u "vw:y:Z:"
+#ifdef SHM_RING_SUPPORTED
+#define OPTSTRING_R "R:"
+#else
+#define OPTSTRING_R ""
+#endif
+
+#ifdef TPACKET_RING_SUPPORTED
+#define OPTSTRING_K "K:"
+#else
+#define OPTSTRING_K ""
+#endif
+
+#define OPTSTRING "a:" OPTSTRING_A "b:" OPTSTRING_B "c:" OPTSTRING_d "Df:ghi:" OPTSTRING_I OPTSTRING_K "L" OPTSTRING_m "MnOpPq" OPTSTRING_r OPTSTRING_R "Ss:t" OPTSTRING_u "vw:y:Z:"
 
 #ifdef DEBUG_CHILD_DUMPCAP
     if ((debug_log = ws_fopen("dumpcap_debug_log.tmp","w")) == NULL) {
@@ -4279,6 +5054,13 @@ main(int argc, char *argv[])
             }
 #endif
             break;
+#ifdef SHM_RING_SUPPORTED
+            /*** hidden option: hand packets to our parent through a shared ring ***/
+        case 'R':
+            g_free(global_capture_opts.shm_ring_file);
+            global_capture_opts.shm_ring_file = g_strdup(optarg);
+            break;
+#endif
 
         case 'q':        /* Quiet */
             quiet = TRUE;
@@ -4286,6 +5068,17 @@ main(int argc, char *argv[])
         case 't':
             use_threads = TRUE;
             break;
+        case 'O':        /* Merge the interfaces' packets by timestamp */
+            use_threads = TRUE;
+            merge_by_time = TRUE;
+            break;
+#ifdef TPACKET_RING_SUPPORTED
+        case 'K':        /* Capture through TPACKET_V3 rings */
+            tpacket_rings = get_positive_int(optarg, "number of rings");
+            if (tpacket_rings > 1)
+                use_threads = TRUE;
+            break;
+#endif
             /*** all non capture option specific ***/
         case 'D':        /* Print a list of capture devices and exit */
             list_interfaces = TRUE;
@@ -4375,6 +5168,13 @@ main(int argc, char *argv[])
 #endif
             }
         }
+        /* The shared ring is a single stream, so it can't follow the
+           ring buffer from file to file. */
+        if (global_capture_opts.shm_ring_file != NULL &&
+            global_capture_opts.multi_files_on) {
+            cmdarg_err("A shared ring can't be used with a ring buffer.");
+            exit_main(1);
+        }
     }
 
     /*
@@ -4746,6 +5546,52 @@ report_packet_drops(guint32 received, guint32 drops, gchar *name)
     }
 }
 
+static void
+report_queue_high_water(guint32 high_water, guint32 size, const gchar *name,
+                        guint interface_id)
+{
+    char tmp[SP_DECISIZE*3+2+1];
+
+    if(capture_child) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+            "Queue high-water mark on interface %s: %u of %u bytes",
+            name, high_water, size);
+        g_snprintf(tmp, sizeof(tmp), "%u:%u:%u", interface_id, high_water, size);
+        pipe_write_block(2, SP_QUEUE_HWM, tmp);
+    } else {
+        fprintf(stderr,
+            "Queue high-water mark on interface %s: %u of %u KB (%.1f%%)\n",
+            name, high_water / 1024, size / 1024,
+            size ? 100.0 * high_water / size : 0.0);
+        fflush(stderr);
+    }
+}
+
+#ifdef TPACKET_RING_SUPPORTED
+static void
+report_ring_drops(guint32 received, guint32 drops, guint32 freezes,
+                  const gchar *name, guint interface_id, guint index)
+{
+    char tmp[SP_DECISIZE*5+4+1];
+
+    if(capture_child) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+            "Packets received/dropped on interface %s ring %u: %u/%u (ring full %u times)",
+            name, index, received, drops, freezes);
+        g_snprintf(tmp, sizeof(tmp), "%u:%u:%u:%u:%u", interface_id, index,
+                   received, drops, freezes);
+        pipe_write_block(2, SP_RING_DROPS, tmp);
+    } else {
+        fprintf(stderr,
+            "Packets received/dropped on interface %s ring %u: %u/%u (%.1f%%), ring full %u time%s\n",
+            name, index, received, drops,
+            received ? 100.0 * received / (received + drops) : 0.0,
+            freezes, plurality(freezes, "", "s"));
+        fflush(stderr);
+    }
+}
+#endif
+
 
 /****************************************************************************************************************/
 /* signal_pipe handling */
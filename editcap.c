@@ -81,19 +81,44 @@ struct select_item {
 
 /*
  * Duplicate frame detection
+ *
+ * The digests of the last dup_ring_size packets are kept in a ring, and
+ * indexed by an open-addressed hash table from digest to the newest ring
+ * entry with that digest, so that looking for a duplicate doesn't mean
+ * going through the whole window.  Each entry links to the next older one
+ * with the same digest, for the time window check, which has to look at
+ * their timestamps.
  */
 typedef struct _fd_hash_t {
   md5_byte_t digest[16];
   guint32 len;
   nstime_t time;
+  guint32 seq;          /* sequence number of the entry; 0 if unused */
+  int prev;             /* older entry with the same digest, or -1... */
+  guint32 prev_seq;     /* ...which is gone if its seq isn't this any more */
 } fd_hash_t;
 
 #define DEFAULT_DUP_DEPTH 5     /* Used with -d */
-#define MAX_DUP_DEPTH 1000000   /* the maximum window (and actual size of fd_hash[]) for de-duplication */
-
-fd_hash_t fd_hash[MAX_DUP_DEPTH];
-int dup_window = DEFAULT_DUP_DEPTH;
-int cur_dup_entry = 0;
+#define MAX_DUP_DEPTH 1000000   /* the maximum window (and the size of fd_hash[] for -w) for de-duplication */
+
+static fd_hash_t *fd_hash;      /* the ring */
+static int dup_ring_size;
+static int dup_window = DEFAULT_DUP_DEPTH;
+static int cur_dup_entry = 0;
+static guint32 dup_seq = 0;
+static int *fd_index;           /* ring entry for each digest, or -1 */
+static guint fd_index_mask;
+
+/* Digests that can be used */
+#define DUP_DIGEST_MD5  0
+#define DUP_DIGEST_FAST 1       /* MurmurHash3, x64 128-bit variant */
+static int dup_digest = DUP_DIGEST_MD5;
+
+/* Fields that are masked out before the digest is calculated, so that
+   copies of a packet that went through a router are duplicates, too */
+#define DUP_MASK_TTL    0x01    /* IPv4 TTL, IPv6 hop limit */
+#define DUP_MASK_IPCSUM 0x02    /* IPv4 header checksum */
+static int dup_mask = 0;
 
 #define ONE_MILLION 1000000
 #define ONE_BILLION 1000000000
@@ -516,98 +541,356 @@ set_rel_time(char *optarg_str_p)
   relative_time_window.nsecs = val;
 }
 
+static const char *
+dup_digest_name(void)
+{
+  return dup_digest == DUP_DIGEST_FAST ? "Fast" : "MD5";
+}
+
 static gboolean
-is_duplicate(guint8* fd, guint32 len) {
-  int i;
-  md5_state_t ms;
+set_dup_mask(const char *fields)
+{
+  gchar **field_list, **field;
+  gboolean ok = TRUE;
+
+  field_list = g_strsplit(fields, ",", 0);
+  for (field = field_list; *field != NULL; field++) {
+    if (strcmp(*field, "ttl") == 0)
+      dup_mask |= DUP_MASK_TTL;
+    else if (strcmp(*field, "ipcsum") == 0)
+      dup_mask |= DUP_MASK_IPCSUM;
+    else
+      ok = FALSE;
+  }
+  g_strfreev(field_list);
+  return ok;
+}
 
-  cur_dup_entry++;
-  if (cur_dup_entry >= dup_window)
-    cur_dup_entry = 0;
+static guint64
+rotl64(guint64 x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
 
-  /* Calculate our digest */
-  md5_init(&ms);
-  md5_append(&ms, fd, len);
-  md5_finish(&ms, fd_hash[cur_dup_entry].digest);
+static guint64
+fmix64(guint64 k)
+{
+  k ^= k >> 33;
+  k *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+  k ^= k >> 33;
+  k *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+  k ^= k >> 33;
+  return k;
+}
 
-  fd_hash[cur_dup_entry].len = len;
+/*
+ * MurmurHash3 (x64, 128-bit, seed 0), by Austin Appleby, who placed it in
+ * the public domain.  Not cryptographic, but as good a hash as MD5 for
+ * telling packets apart, and several times faster.
+ */
+static void
+murmur3_128(const guint8 *data, guint32 len, md5_byte_t digest[16])
+{
+  const guint64 c1 = G_GUINT64_CONSTANT(0x87c37b91114253d5);
+  const guint64 c2 = G_GUINT64_CONSTANT(0x4cf5ad432745937f);
+  const guint8 *tail = data + (len & ~15U);
+  guint64 h1 = 0, h2 = 0, k1, k2;
+  guint32 i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    memcpy(&k1, data + i, 8);
+    memcpy(&k2, data + i + 8, 8);
+    k1 = GUINT64_FROM_LE(k1);
+    k2 = GUINT64_FROM_LE(k2);
+
+    k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+    k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+    h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+  }
 
-  /* Look for duplicates */
-  for (i = 0; i < dup_window; i++) {
-    if (i == cur_dup_entry)
-      continue;
+  k1 = k2 = 0;
+  switch (len & 15) {
+  case 15: k2 ^= (guint64)tail[14] << 48;
+    /* FALLTHROUGH */
+  case 14: k2 ^= (guint64)tail[13] << 40;
+    /* FALLTHROUGH */
+  case 13: k2 ^= (guint64)tail[12] << 32;
+    /* FALLTHROUGH */
+  case 12: k2 ^= (guint64)tail[11] << 24;
+    /* FALLTHROUGH */
+  case 11: k2 ^= (guint64)tail[10] << 16;
+    /* FALLTHROUGH */
+  case 10: k2 ^= (guint64)tail[9] << 8;
+    /* FALLTHROUGH */
+  case 9:  k2 ^= (guint64)tail[8];
+    k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+    /* FALLTHROUGH */
+  case 8:  k1 ^= (guint64)tail[7] << 56;
+    /* FALLTHROUGH */
+  case 7:  k1 ^= (guint64)tail[6] << 48;
+    /* FALLTHROUGH */
+  case 6:  k1 ^= (guint64)tail[5] << 40;
+    /* FALLTHROUGH */
+  case 5:  k1 ^= (guint64)tail[4] << 32;
+    /* FALLTHROUGH */
+  case 4:  k1 ^= (guint64)tail[3] << 24;
+    /* FALLTHROUGH */
+  case 3:  k1 ^= (guint64)tail[2] << 16;
+    /* FALLTHROUGH */
+  case 2:  k1 ^= (guint64)tail[1] << 8;
+    /* FALLTHROUGH */
+  case 1:  k1 ^= (guint64)tail[0];
+    k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+  }
 
-    if (fd_hash[i].len == fd_hash[cur_dup_entry].len &&
-        memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-      return TRUE;
+  h1 ^= len;
+  h2 ^= len;
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix64(h1);
+  h2 = fmix64(h2);
+  h1 += h2;
+  h2 += h1;
+
+  for (i = 0; i < 8; i++) {
+    digest[i] = (md5_byte_t)(h1 >> (8 * i));
+    digest[i + 8] = (md5_byte_t)(h2 >> (8 * i));
+  }
+}
+
+/*
+ * If any fields are to be masked, and the packet has an IP header we can
+ * find, return a copy of the packet from the IP header on, with those
+ * fields zeroed, and set *lenp to its length; a router rewrites the
+ * link-layer header, so that's left out.  Otherwise return the packet
+ * itself.
+ */
+static const guint8 *
+mask_volatile_fields(const guint8 *fd, guint32 *lenp, int encap)
+{
+  guint32 len = *lenp;
+  static guint8 masked[WTAP_MAX_PACKET_SIZE];
+  guint32 off;
+  guint16 etype;
+
+  if (dup_mask == 0)
+    return fd;
+
+  switch (encap) {
+
+  case WTAP_ENCAP_ETHERNET:
+    off = 12;
+    if (len < off + 2)
+      return fd;
+    etype = (fd[off] << 8) | fd[off + 1];
+    /* Skip any 802.1Q or 802.1ad tags */
+    while ((etype == 0x8100 || etype == 0x88a8 || etype == 0x9100) &&
+           len >= off + 6) {
+      off += 4;
+      etype = (fd[off] << 8) | fd[off + 1];
     }
+    off += 2;
+    break;
+
+  case WTAP_ENCAP_SLL:
+    off = 16;
+    if (len < off)
+      return fd;
+    etype = (fd[14] << 8) | fd[15];
+    break;
+
+  case WTAP_ENCAP_RAW_IP:
+  case WTAP_ENCAP_RAW_IP4:
+  case WTAP_ENCAP_RAW_IP6:
+    off = 0;
+    if (len < 1)
+      return fd;
+    etype = ((fd[0] >> 4) == 6) ? 0x86dd : 0x0800;
+    break;
+
+  default:
+    return fd;
   }
 
-  return FALSE;
+  if (etype == 0x0800 && len >= off + 20 && (fd[off] >> 4) == 4) {
+    *lenp = len - off;
+    memcpy(masked, fd + off, *lenp);
+    if (dup_mask & DUP_MASK_TTL)
+      masked[8] = 0;
+    if (dup_mask & DUP_MASK_IPCSUM)
+      masked[10] = masked[11] = 0;
+    return masked;
+  }
+  if (etype == 0x86dd && len >= off + 40 && (fd[off] >> 4) == 6) {
+    *lenp = len - off;
+    memcpy(masked, fd + off, *lenp);
+    if (dup_mask & DUP_MASK_TTL)
+      masked[7] = 0;
+    return masked;
+  }
+  return fd;
 }
 
-static gboolean
-is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
+static void
+init_dup_detection(int ring_size)
+{
   int i;
+  guint index_size;
+
+  dup_ring_size = ring_size > 0 ? ring_size : 1;
+  fd_hash = g_new(fd_hash_t, dup_ring_size);
+  for (i = 0; i < dup_ring_size; i++) {
+    memset(&fd_hash[i].digest, 0, 16);
+    fd_hash[i].len = 0;
+    nstime_set_unset(&fd_hash[i].time);
+    fd_hash[i].seq = 0;
+    fd_hash[i].prev = -1;
+    fd_hash[i].prev_seq = 0;
+  }
+  cur_dup_entry = 0;
+  dup_seq = 0;
+
+  /* Never more than half full */
+  for (index_size = 4; index_size < (guint)dup_ring_size * 2; index_size *= 2)
+    ;
+  fd_index = g_new(int, index_size);
+  for (i = 0; i < (int)index_size; i++)
+    fd_index[i] = -1;
+  fd_index_mask = index_size - 1;
+}
+
+static guint
+dup_index_home(const fd_hash_t *entry)
+{
+  guint32 h;
+
+  /* The digest is as good a hash as any */
+  memcpy(&h, entry->digest, sizeof h);
+  return (h ^ entry->len) & fd_index_mask;
+}
+
+/* Slot in fd_index[] of the entry's digest, or of the empty slot it'd go in */
+static guint
+dup_index_slot(const fd_hash_t *entry)
+{
+  guint i;
+  int j;
+
+  for (i = dup_index_home(entry); (j = fd_index[i]) != -1; i = (i + 1) & fd_index_mask) {
+    if (fd_hash[j].len == entry->len &&
+        memcmp(fd_hash[j].digest, entry->digest, 16) == 0)
+      break;
+  }
+  return i;
+}
+
+/* Drop a ring entry that's about to be reused from the index */
+static void
+dup_index_remove(int entry)
+{
+  guint i, j, k;
+
+  i = dup_index_slot(&fd_hash[entry]);
+  if (fd_index[i] != entry) {
+    /* A newer entry with the same digest is in the index instead */
+    return;
+  }
+
+  /* Move up any entries after it that wouldn't be found past the hole */
+  for (j = (i + 1) & fd_index_mask; fd_index[j] != -1; j = (j + 1) & fd_index_mask) {
+    k = dup_index_home(&fd_hash[fd_index[j]]);
+    if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+      fd_index[i] = fd_index[j];
+      i = j;
+    }
+  }
+  fd_index[i] = -1;
+}
+
+/*
+ * Put the packet's digest in the next entry of the ring, and return the
+ * newest older entry with the same digest, or -1 if there's none.
+ */
+static int
+add_dup_entry(const guint8 *fd, guint32 len, int encap, const nstime_t *current)
+{
+  fd_hash_t *entry;
+  const guint8 *data;
   md5_state_t ms;
+  guint slot;
+  int prev;
 
   cur_dup_entry++;
-  if (cur_dup_entry >= dup_window)
+  if (cur_dup_entry >= dup_ring_size)
     cur_dup_entry = 0;
+  entry = &fd_hash[cur_dup_entry];
+  if (entry->seq != 0)
+    dup_index_remove(cur_dup_entry);
 
   /* Calculate our digest */
-  md5_init(&ms);
-  md5_append(&ms, fd, len);
-  md5_finish(&ms, fd_hash[cur_dup_entry].digest);
+  data = mask_volatile_fields(fd, &len, encap);
+  if (dup_digest == DUP_DIGEST_FAST) {
+    murmur3_128(data, len, entry->digest);
+  } else {
+    md5_init(&ms);
+    md5_append(&ms, data, len);
+    md5_finish(&ms, entry->digest);
+  }
+
+  entry->len = len;
+  if (current != NULL) {
+    entry->time.secs = current->secs;
+    entry->time.nsecs = current->nsecs;
+  } else
+    nstime_set_unset(&entry->time);
+  entry->seq = ++dup_seq;
+
+  slot = dup_index_slot(entry);
+  prev = fd_index[slot];
+  entry->prev = prev;
+  entry->prev_seq = prev != -1 ? fd_hash[prev].seq : 0;
+  fd_index[slot] = cur_dup_entry;
+  return prev;
+}
+
+static gboolean
+is_duplicate(guint8* fd, guint32 len, int encap) {
+  /* Everything in the index is in the window */
+  return add_dup_entry(fd, len, encap, NULL) != -1;
+}
 
-  fd_hash[cur_dup_entry].len = len;
-  fd_hash[cur_dup_entry].time.secs = current->secs;
-  fd_hash[cur_dup_entry].time.nsecs = current->nsecs;
+static gboolean
+is_duplicate_rel_time(guint8* fd, guint32 len, int encap, const nstime_t *current) {
+  int i, next;
+  guint32 seq;
 
   /*
-   * Look for relative time related duplicates.
-   * This is hopefully a reasonably efficient mechanism for
-   * finding duplicates by rel time in the fd_hash[] cache.
-   * We check starting from the most recently added hash
-   * entries and work backwards towards older packets.
-   * This approach allows the dup test to be terminated
-   * when the relative time of a cached entry is found to
-   * be beyond the dup time window.
+   * Look for relative time related duplicates: go through the older
+   * packets with the same digest, newest first, until one's within the
+   * dup time window, or they're older than that.
    *
    * Of course this assumes that the input trace file is
    * "well-formed" in the sense that the packet timestamps are
    * in strict chronologically increasing order (which is NOT
    * always the case!!).
-   *
-   * The fd_hash[] table was deliberatly created large (1,000,000).
-   * Looking for time related duplicates in large trace files with
-   * non-fractional dup time window values can potentially take
-   * a long time to complete.
    */
-
-  for (i = cur_dup_entry - 1;; i--) {
+  i = add_dup_entry(fd, len, encap, current);
+  seq = i != -1 ? fd_hash[i].seq : 0;
+  for (; i != -1; i = next) {
     nstime_t delta;
     int cmp;
 
-    if (i < 0) {
-      i = dup_window - 1;
-    }
-
-    if (i == cur_dup_entry) {
-      /*
-       * We've decremented back to where we started.
-       * Check no more!
-       */
-      break;
-    }
-
-    if (nstime_is_unset(&(fd_hash[i].time))) {
+    if (fd_hash[i].seq != seq) {
       /*
-       * We've decremented to an unused fd_hash[] entry.
+       * That entry has been reused for a newer packet; this one was so
+       * long ago that it's not in fd_hash[] any more.
        * Check no more!
        */
       break;
     }
+    next = fd_hash[i].prev;
+    seq = fd_hash[i].prev_seq;
 
     nstime_delta(&delta, current, &fd_hash[i].time);
 
@@ -643,10 +926,8 @@ is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
        * Check no more!
        */
       break;
-    } else if (fd_hash[i].len == fd_hash[cur_dup_entry].len &&
-          memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-      return TRUE;
     }
+    return TRUE;
   }
 
   return FALSE;
@@ -692,6 +973,11 @@ usage(gboolean is_error)
   fprintf(output, "                         LESS THAN <dup time window> prior to current packet.\n");
   fprintf(output, "                         A <dup time window> is specified in relative seconds\n");
   fprintf(output, "                         (e.g. 0.000001).\n");
+  fprintf(output, "  -K <digest>            use <digest> to compare packets: \"md5\" (the default)\n");
+  fprintf(output, "                         or \"fast\", a non-cryptographic 128-bit hash.\n");
+  fprintf(output, "  -M <field>[,<field>]   ignore fields of the IP header that routers change\n");
+  fprintf(output, "                         when comparing packets: \"ttl\" (TTL or hop limit)\n");
+  fprintf(output, "                         and/or \"ipcsum\" (IPv4 header checksum).\n");
   fprintf(output, "\n");
   fprintf(output, "           NOTE: The use of the 'Duplicate packet removal' options with\n");
   fprintf(output, "           other editcap options except -v may not always work as expected.\n");
@@ -734,7 +1020,7 @@ usage(gboolean is_error)
   fprintf(output, "  -v                     verbose output.\n");
   fprintf(output, "                         If -v is used with any of the 'Duplicate Packet\n");
   fprintf(output, "                         Removal' options (-d, -D or -w) then Packet lengths\n");
-  fprintf(output, "                         and MD5 hashes are printed to standard-out.\n");
+  fprintf(output, "                         and hashes are printed to standard-out.\n");
   fprintf(output, "\n");
 }
 
@@ -851,6 +1137,10 @@ main(int argc, char *argv[])
 #ifdef _WIN32
   arg_list_utf_16to8(argc, argv);
 #endif /* _WIN32 */
+#if !GLIB_CHECK_VERSION(2,31,0)
+  /* Initialize the thread system; wiretap reads ahead of us on one. */
+  g_thread_init(NULL);
+#endif
 
   /*
    * Get credential information for later use.
@@ -869,7 +1159,7 @@ main(int argc, char *argv[])
 #endif
 
   /* Process the options */
-  while ((opt = getopt(argc, argv, "A:B:c:C:dD:E:F:hrs:i:t:S:T:vw:")) !=-1) {
+  while ((opt = getopt(argc, argv, "A:B:c:C:dD:E:F:hK:M:rs:i:t:S:T:vw:")) !=-1) {
 
     switch (opt) {
 
@@ -938,6 +1228,26 @@ main(int argc, char *argv[])
       }
       break;
 
+    case 'K':
+      if (strcmp(optarg, "md5") == 0)
+        dup_digest = DUP_DIGEST_MD5;
+      else if (strcmp(optarg, "fast") == 0)
+        dup_digest = DUP_DIGEST_FAST;
+      else {
+        fprintf(stderr, "editcap: \"%s\" isn't a valid digest; use \"md5\" or \"fast\"\n",
+            optarg);
+        exit(1);
+      }
+      break;
+
+    case 'M':
+      if (!set_dup_mask(optarg)) {
+        fprintf(stderr, "editcap: \"%s\" isn't a valid list of fields to mask; use \"ttl\" and/or \"ipcsum\"\n",
+            optarg);
+        exit(1);
+      }
+      break;
+
     case 'w':
       dup_detect = FALSE;
       dup_detect_by_time = TRUE;
@@ -1116,17 +1426,15 @@ main(int argc, char *argv[])
     if (out_frame_type == -2)
       out_frame_type = wtap_file_encap(wth);
 
+    /* Have wiretap read the file ahead of us on another thread. */
+    wtap_set_prefetch(wth, 0);
+
     for (i = optind + 2; i < argc; i++)
       if (add_selection(argv[i]) == FALSE)
         break;
 
-    if (dup_detect || dup_detect_by_time) {
-      for (i = 0; i < dup_window; i++) {
-        memset(&fd_hash[i].digest, 0, 16);
-        fd_hash[i].len = 0;
-        nstime_set_unset(&fd_hash[i].time);
-      }
-    }
+    if (dup_detect || dup_detect_by_time)
+      init_dup_detection(dup_window);
 
     while (wtap_read(wth, &err, &err_info, &data_offset)) {
       read_count++;
@@ -1357,9 +1665,9 @@ main(int argc, char *argv[])
 
         /* suppress duplicates by packet window */
         if (dup_detect) {
-          if (is_duplicate(buf, phdr->caplen)) {
+          if (is_duplicate(buf, phdr->caplen, phdr->pkt_encap)) {
             if (verbose) {
-              fprintf(stdout, "Skipped: %u, Len: %u, MD5 Hash: ", count, phdr->caplen);
+              fprintf(stdout, "Skipped: %u, Len: %u, %s Hash: ", count, phdr->caplen, dup_digest_name());
               for (i = 0; i < 16; i++) {
                 fprintf(stdout, "%02x", (unsigned char)fd_hash[cur_dup_entry].digest[i]);
               }
@@ -1370,7 +1678,7 @@ main(int argc, char *argv[])
             continue;
           } else {
             if (verbose) {
-              fprintf(stdout, "Packet: %u, Len: %u, MD5 Hash: ", count, phdr->caplen);
+              fprintf(stdout, "Packet: %u, Len: %u, %s Hash: ", count, phdr->caplen, dup_digest_name());
               for (i = 0; i < 16; i++) {
                 fprintf(stdout, "%02x", (unsigned char)fd_hash[cur_dup_entry].digest[i]);
               }
@@ -1386,9 +1694,9 @@ main(int argc, char *argv[])
           current.secs = phdr->ts.secs;
           current.nsecs = phdr->ts.nsecs;
 
-          if (is_duplicate_rel_time(buf, phdr->caplen, &current)) {
+          if (is_duplicate_rel_time(buf, phdr->caplen, phdr->pkt_encap, &current)) {
             if (verbose) {
-              fprintf(stdout, "Skipped: %u, Len: %u, MD5 Hash: ", count, phdr->caplen);
+              fprintf(stdout, "Skipped: %u, Len: %u, %s Hash: ", count, phdr->caplen, dup_digest_name());
               for (i = 0; i < 16; i++) {
                 fprintf(stdout, "%02x", (unsigned char)fd_hash[cur_dup_entry].digest[i]);
               }
@@ -1399,7 +1707,7 @@ main(int argc, char *argv[])
             continue;
           } else {
             if (verbose) {
-              fprintf(stdout, "Packet: %u, Len: %u, MD5 Hash: ", count, phdr->caplen);
+              fprintf(stdout, "Packet: %u, Len: %u, %s Hash: ", count, phdr->caplen, dup_digest_name());
               for (i = 0; i < 16; i++) {
                 fprintf(stdout, "%02x", (unsigned char)fd_hash[cur_dup_entry].digest[i]);
               }
@@ -922,20 +922,23 @@ set_time_hour_min_sec(const nstime_t *ts, gchar *buf)
 static void
 col_set_rel_time(const frame_data *fd, column_info *cinfo, const int col)
 {
+  nstime_t rel_ts;
+
   if (!fd->flags.has_ts) {
     cinfo->col_buf[col][0] = '\0';
     return;
   }
+  frame_delta_abs_time(fd, fd->frame_ref_num, &rel_ts);
   switch (timestamp_get_seconds_type()) {
   case TS_SECONDS_DEFAULT:
-    set_time_seconds(&fd->rel_ts, cinfo->col_buf[col]);
+    set_time_seconds(&rel_ts, cinfo->col_buf[col]);
     cinfo->col_expr.col_expr[col] = "frame.time_relative";
     g_strlcpy(cinfo->col_expr.col_expr_val[col],cinfo->col_buf[col],COL_MAX_LEN);
     break;
   case TS_SECONDS_HOUR_MIN_SEC:
-    set_time_hour_min_sec(&fd->rel_ts, cinfo->col_buf[col]);
+    set_time_hour_min_sec(&rel_ts, cinfo->col_buf[col]);
     cinfo->col_expr.col_expr[col] = "frame.time_relative";
-    set_time_seconds(&fd->rel_ts, cinfo->col_expr.col_expr_val[col]);
+    set_time_seconds(&rel_ts, cinfo->col_expr.col_expr_val[col]);
     break;
   default:
     g_assert_not_reached();
@@ -946,16 +949,19 @@ col_set_rel_time(const frame_data *fd, column_info *cinfo, const int col)
 static void
 col_set_delta_time(const frame_data *fd, column_info *cinfo, const int col)
 {
+  nstime_t del_cap_ts;
+
+  frame_delta_abs_time(fd, fd->num - 1, &del_cap_ts);
   switch (timestamp_get_seconds_type()) {
   case TS_SECONDS_DEFAULT:
-    set_time_seconds(&fd->del_cap_ts, cinfo->col_buf[col]);
+    set_time_seconds(&del_cap_ts, cinfo->col_buf[col]);
     cinfo->col_expr.col_expr[col] = "frame.time_delta";
     g_strlcpy(cinfo->col_expr.col_expr_val[col],cinfo->col_buf[col],COL_MAX_LEN);
     break;
   case TS_SECONDS_HOUR_MIN_SEC:
-    set_time_hour_min_sec(&fd->del_cap_ts, cinfo->col_buf[col]);
+    set_time_hour_min_sec(&del_cap_ts, cinfo->col_buf[col]);
     cinfo->col_expr.col_expr[col] = "frame.time_delta";
-    set_time_seconds(&fd->del_cap_ts, cinfo->col_expr.col_expr_val[col]);
+    set_time_seconds(&del_cap_ts, cinfo->col_expr.col_expr_val[col]);
     break;
   default:
     g_assert_not_reached();
@@ -967,20 +973,23 @@ col_set_delta_time(const frame_data *fd, column_info *cinfo, const int col)
 static void
 col_set_delta_time_dis(const frame_data *fd, column_info *cinfo, const int col)
 {
+  nstime_t del_dis_ts;
+
   if (!fd->flags.has_ts) {
     cinfo->col_buf[col][0] = '\0';
     return;
   }
+  frame_delta_abs_time(fd, fd->prev_dis_num, &del_dis_ts);
   switch (timestamp_get_seconds_type()) {
   case TS_SECONDS_DEFAULT:
-    set_time_seconds(&fd->del_dis_ts, cinfo->col_buf[col]);
+    set_time_seconds(&del_dis_ts, cinfo->col_buf[col]);
     cinfo->col_expr.col_expr[col] = "frame.time_delta_displayed";
     g_strlcpy(cinfo->col_expr.col_expr_val[col],cinfo->col_buf[col],COL_MAX_LEN);
     break;
   case TS_SECONDS_HOUR_MIN_SEC:
-    set_time_hour_min_sec(&fd->del_dis_ts, cinfo->col_buf[col]);
+    set_time_hour_min_sec(&del_dis_ts, cinfo->col_buf[col]);
     cinfo->col_expr.col_expr[col] = "frame.time_delta_displayed";
-    set_time_seconds(&fd->del_dis_ts, cinfo->col_expr.col_expr_val[col]);
+    set_time_seconds(&del_dis_ts, cinfo->col_expr.col_expr_val[col]);
     break;
   default:
     g_assert_not_reached();
@@ -1138,6 +1147,7 @@ col_set_epoch_time(const frame_data *fd, column_info *cinfo, const int col)
 void
 set_fd_time(frame_data *fd, gchar *buf)
 {
+  nstime_t delta_ts;
 
   switch (timestamp_get_type()) {
     case TS_ABSOLUTE:
@@ -1150,12 +1160,13 @@ set_fd_time(frame_data *fd, gchar *buf)
 
     case TS_RELATIVE:
       if (fd->flags.has_ts) {
+        frame_delta_abs_time(fd, fd->frame_ref_num, &delta_ts);
         switch (timestamp_get_seconds_type()) {
         case TS_SECONDS_DEFAULT:
-          set_time_seconds(&fd->rel_ts, buf);
+          set_time_seconds(&delta_ts, buf);
           break;
         case TS_SECONDS_HOUR_MIN_SEC:
-          set_time_seconds(&fd->rel_ts, buf);
+          set_time_seconds(&delta_ts, buf);
           break;
         default:
           g_assert_not_reached();
@@ -1167,12 +1178,13 @@ set_fd_time(frame_data *fd, gchar *buf)
 
     case TS_DELTA:
       if (fd->flags.has_ts) {
+        frame_delta_abs_time(fd, fd->num - 1, &delta_ts);
         switch (timestamp_get_seconds_type()) {
         case TS_SECONDS_DEFAULT:
-          set_time_seconds(&fd->del_cap_ts, buf);
+          set_time_seconds(&delta_ts, buf);
           break;
         case TS_SECONDS_HOUR_MIN_SEC:
-          set_time_hour_min_sec(&fd->del_cap_ts, buf);
+          set_time_hour_min_sec(&delta_ts, buf);
           break;
         default:
           g_assert_not_reached();
@@ -1184,12 +1196,13 @@ set_fd_time(frame_data *fd, gchar *buf)
 
     case TS_DELTA_DIS:
       if (fd->flags.has_ts) {
+        frame_delta_abs_time(fd, fd->prev_dis_num, &delta_ts);
         switch (timestamp_get_seconds_type()) {
         case TS_SECONDS_DEFAULT:
-          set_time_seconds(&fd->del_dis_ts, buf);
+          set_time_seconds(&delta_ts, buf);
           break;
         case TS_SECONDS_HOUR_MIN_SEC:
-          set_time_hour_min_sec(&fd->del_dis_ts, buf);
+          set_time_hour_min_sec(&delta_ts, buf);
           break;
         default:
           g_assert_not_reached();
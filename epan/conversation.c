@@ -33,6 +33,7 @@
 #include "packet.h"
 #include "emem.h"
 #include "conversation.h"
+#include "proto_data_map.h"
 
 /*
  * Hash table for conversations with no wildcards.
@@ -74,13 +75,26 @@ static conversation_key *conversation_keys;
 static guint32 new_index;
 
 /*
- * Protocol-specific data attached to a conversation_t structure - protocol
- * index and opaque pointer.
+ * Conversation aging; see conversation_set_aging().  When it's on, the
+ * conversations are kept on a list, most recently used first, and they
+ * and their keys are g_malloc()ed rather than se_ allocated, so that they
+ * can be freed one at a time.
  */
-typedef struct _conv_proto_data {
+static gboolean conversation_aging = FALSE;
+static guint conversation_idle_timeout;
+static guint conversation_max;
+static guint32 conversation_now;
+static conversation_t *conversation_lru_head;
+static conversation_t *conversation_lru_tail;
+
+typedef struct {
 	int	proto;
-	void	*proto_data;
-} conv_proto_data;
+	conversation_evict_func func;
+} conversation_evict_callback_t;
+
+static GSList *conversation_evict_callbacks;
+
+static conversation_stats_t conversation_stats;
 
 /*
  * Creates a new conversation with known endpoints based on a conversation
@@ -409,19 +423,94 @@ conversation_match_no_addr2_or_port2(gconstpointer v, gconstpointer w)
 }
 
 /*
- * Free the proto_data.  The conversation itself is se_allocated.
+ * The hash table a conversation with the given options goes in.
+ */
+static GHashTable *
+conversation_hashtable_for(const guint options)
+{
+	if (options & NO_ADDR2) {
+		if (options & (NO_PORT2|NO_PORT2_FORCE))
+			return conversation_hashtable_no_addr2_or_port2;
+		else
+			return conversation_hashtable_no_addr2;
+	} else {
+		if (options & (NO_PORT2|NO_PORT2_FORCE))
+			return conversation_hashtable_no_port2;
+		else
+			return conversation_hashtable_exact;
+	}
+}
+
+/*
+ * Have the protocols with data for an aged conversation free what they
+ * keep for it.
  */
 static void
-free_data_list(gpointer key _U_, gpointer value, gpointer user_data _U_)
+conversation_call_evict_callbacks(conversation_t *conv)
 {
-	conversation_t *conv = (conversation_t *)value;
+	GSList *cb_item;
+	conversation_evict_callback_t *cb;
+	void *proto_data;
+
+	for (cb_item = conversation_evict_callbacks; cb_item != NULL; cb_item = cb_item->next) {
+		cb = (conversation_evict_callback_t *)cb_item->data;
+		proto_data = conversation_get_proto_data(conv, cb->proto);
+		if (proto_data != NULL)
+			cb->func(conv, proto_data);
+	}
+}
 
-	/* TODO: se_slist? */
-	g_slist_free(conv->data_list);
+/*
+ * Free an aged conversation; it must already be out of the hash tables.
+ */
+static void
+conversation_free(conversation_t *conv)
+{
+	g_free((void *)conv->key_ptr->addr1.data);
+	g_free((void *)conv->key_ptr->addr2.data);
+	g_free(conv->key_ptr);
+	proto_data_map_free(conv->data_list);
+	g_free(conv);
+}
 
-	/* Not really necessary, but... */
-	conv->data_list = NULL;
+static void
+conversation_lru_unlink(conversation_t *conv)
+{
+	if (conv->lru_prev != NULL)
+		conv->lru_prev->lru_next = conv->lru_next;
+	else
+		conversation_lru_head = conv->lru_next;
+	if (conv->lru_next != NULL)
+		conv->lru_next->lru_prev = conv->lru_prev;
+	else
+		conversation_lru_tail = conv->lru_prev;
+}
 
+/*
+ * Make a conversation the most recently used one.
+ */
+static void
+conversation_lru_push(conversation_t *conv)
+{
+	conv->last_seen = conversation_now;
+	conv->lru_prev = NULL;
+	conv->lru_next = conversation_lru_head;
+	if (conversation_lru_head != NULL)
+		conversation_lru_head->lru_prev = conv;
+	else
+		conversation_lru_tail = conv;
+	conversation_lru_head = conv;
+}
+
+static void
+conversation_touch(conversation_t *conv)
+{
+	if (conv == conversation_lru_head) {
+		conv->last_seen = conversation_now;
+		return;
+	}
+	conversation_lru_unlink(conv);
+	conversation_lru_push(conv);
 }
 
 /*
@@ -430,25 +519,24 @@ free_data_list(gpointer key _U_, gpointer value, gpointer user_data _U_)
 void
 conversation_cleanup(void)
 {
-	/*  Clean up the hash tables, but only after freeing any proto_data
-	 *  that may be hanging off the conversations.
-	 *  The conversation keys are se_ allocated so we don't have to clean them up.
+	conversation_t *conv, *next;
+
+	/*  Clean up the hash tables.
+	 *  Unless we're aging them, the conversations, their keys and the maps
+	 *  of proto_data hanging off them are se_ allocated so we don't have
+	 *  to clean them up.
 	 */
 	conversation_keys = NULL;
 	if (conversation_hashtable_exact != NULL) {
-		g_hash_table_foreach(conversation_hashtable_exact, free_data_list, NULL);
 		g_hash_table_destroy(conversation_hashtable_exact);
 	}
 	if (conversation_hashtable_no_addr2 != NULL) {
-		g_hash_table_foreach(conversation_hashtable_no_addr2, free_data_list, NULL);
 		g_hash_table_destroy(conversation_hashtable_no_addr2);
 	}
 	if (conversation_hashtable_no_port2 != NULL) {
-		g_hash_table_foreach(conversation_hashtable_no_port2, free_data_list, NULL);
 		g_hash_table_destroy(conversation_hashtable_no_port2);
 	}
 	if (conversation_hashtable_no_addr2_or_port2 != NULL) {
-		g_hash_table_foreach(conversation_hashtable_no_addr2_or_port2, free_data_list, NULL);
 		g_hash_table_destroy(conversation_hashtable_no_addr2_or_port2);
 	}
 
@@ -456,6 +544,17 @@ conversation_cleanup(void)
 	conversation_hashtable_no_addr2 = NULL;
 	conversation_hashtable_no_port2 = NULL;
 	conversation_hashtable_no_addr2_or_port2 = NULL;
+
+	/* The ones still live at the end of the file are freed as if aged
+	 * out, so that what the protocols g_malloc()ed for them is too. */
+	for (conv = conversation_lru_head; conv != NULL; conv = next) {
+		next = conv->lru_next;
+		conversation_call_evict_callbacks(conv);
+		conversation_free(conv);
+	}
+	conversation_lru_head = NULL;
+	conversation_lru_tail = NULL;
+	conversation_stats.live = 0;
 }
 
 /*
@@ -605,6 +704,72 @@ conversation_remove_from_hashtable(GHashTable *hashtable, conversation_t *conv)
 	}
 }
 
+static void
+conversation_evict(conversation_t *conv)
+{
+	conversation_call_evict_callbacks(conv);
+	conversation_remove_from_hashtable(conversation_hashtable_for(conv->options), conv);
+	conversation_lru_unlink(conv);
+	conversation_free(conv);
+	conversation_stats.live--;
+}
+
+void
+conversation_set_aging(const guint idle_timeout, const guint max_conversations)
+{
+	conversation_idle_timeout = idle_timeout;
+	conversation_max = max_conversations;
+	conversation_aging = (idle_timeout != 0 || max_conversations != 0);
+}
+
+gboolean
+conversation_aging_enabled(void)
+{
+	return conversation_aging;
+}
+
+void
+conversation_age(const nstime_t *now)
+{
+	conversation_t *conv;
+
+	if (!conversation_aging)
+		return;
+
+	conversation_now = (guint32)now->secs;
+	while ((conv = conversation_lru_tail) != NULL) {
+		if (conversation_max != 0 && conversation_stats.live > conversation_max) {
+			conversation_evict(conv);
+			conversation_stats.evicted_limit++;
+		} else if (conversation_idle_timeout != 0 &&
+		    conversation_now > conv->last_seen &&
+		    conversation_now - conv->last_seen >= conversation_idle_timeout) {
+			conversation_evict(conv);
+			conversation_stats.evicted_idle++;
+		} else {
+			/* The rest have been used more recently. */
+			break;
+		}
+	}
+}
+
+void
+conversation_register_evict_callback(const int proto, conversation_evict_func func)
+{
+	conversation_evict_callback_t *cb;
+
+	cb = g_new(conversation_evict_callback_t, 1);
+	cb->proto = proto;
+	cb->func = func;
+	conversation_evict_callbacks = g_slist_append(conversation_evict_callbacks, cb);
+}
+
+void
+conversation_get_stats(conversation_stats_t *stats)
+{
+	*stats = conversation_stats;
+}
+
 /*
  * Given two address/port pairs for a packet, create a new conversation
  * to contain packets between those address/port pairs.
@@ -625,30 +790,28 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	conversation_t *conversation=NULL;
 	conversation_key *new_key;
 
-	if (options & NO_ADDR2) {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_addr2_or_port2;
-		} else {
-			hashtable = conversation_hashtable_no_addr2;
-		}
+	hashtable = conversation_hashtable_for(options);
+
+	if (conversation_aging) {
+		new_key = g_new(conversation_key, 1);
+		new_key->next = NULL;
+		COPY_ADDRESS(&new_key->addr1, addr1);
+		COPY_ADDRESS(&new_key->addr2, addr2);
 	} else {
-		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_port2;
-		} else {
-			hashtable = conversation_hashtable_exact;
-		}
+		new_key = se_alloc(sizeof(struct conversation_key));
+		new_key->next = conversation_keys;
+		conversation_keys = new_key;
+		SE_COPY_ADDRESS(&new_key->addr1, addr1);
+		SE_COPY_ADDRESS(&new_key->addr2, addr2);
 	}
-
-	new_key = se_alloc(sizeof(struct conversation_key));
-	new_key->next = conversation_keys;
-	conversation_keys = new_key;
-	SE_COPY_ADDRESS(&new_key->addr1, addr1);
-	SE_COPY_ADDRESS(&new_key->addr2, addr2);
 	new_key->ptype = ptype;
 	new_key->port1 = port1;
 	new_key->port2 = port2;
 
-	conversation = se_new(conversation_t); 
+	if (conversation_aging)
+		conversation = g_new(conversation_t, 1);
+	else
+		conversation = se_new(conversation_t); 
 	memset(conversation, 0, sizeof(conversation_t));
 
 	conversation->index = new_index;
@@ -666,6 +829,13 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 
 	conversation_insert_into_hashtable(hashtable, conversation);
 
+	if (conversation_aging)
+		conversation_lru_push(conversation);
+	conversation_stats.created++;
+	conversation_stats.live++;
+	if (conversation_stats.live > conversation_stats.peak)
+		conversation_stats.peak = conversation_stats.live;
+
 	return conversation;
 }
 
@@ -721,7 +891,12 @@ conversation_set_addr2(conversation_t *conv, const address *addr)
 		conversation_remove_from_hashtable(conversation_hashtable_no_port2, conv);
 	}
 	conv->options &= ~NO_ADDR2;
-	SE_COPY_ADDRESS(&conv->key_ptr->addr2, addr);
+	if (conversation_aging) {
+		g_free((void *)conv->key_ptr->addr2.data);
+		COPY_ADDRESS(&conv->key_ptr->addr2, addr);
+	} else {
+		SE_COPY_ADDRESS(&conv->key_ptr->addr2, addr);
+	}
 	if (conv->options & NO_PORT2) {
 		conversation_insert_into_hashtable(conversation_hashtable_no_port2, conv);
 	} else {
@@ -813,8 +988,8 @@ conversation_lookup_hashtable(GHashTable *hashtable, const guint32 frame_num, co
  *
  *	otherwise, we found no matching conversation, and return NULL.
  */
-conversation_t *
-find_conversation(const guint32 frame_num, const address *addr_a, const address *addr_b, const port_type ptype,
+static conversation_t *
+lookup_conversation(const guint32 frame_num, const address *addr_a, const address *addr_b, const port_type ptype,
     const guint32 port_a, const guint32 port_b, const guint options)
 {
    conversation_t *conversation;
@@ -1120,70 +1295,38 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
    return NULL;
 }
 
-static gint
-p_compare(gconstpointer a, gconstpointer b)
+conversation_t *
+find_conversation(const guint32 frame_num, const address *addr_a, const address *addr_b, const port_type ptype,
+    const guint32 port_a, const guint32 port_b, const guint options)
 {
-	const conv_proto_data *ap = (const conv_proto_data *)a;
-	const conv_proto_data *bp = (const conv_proto_data *)b;
+	conversation_t *conversation;
 
-	if (ap->proto > bp->proto)
-		return 1;
-	else if (ap->proto == bp->proto)
-		return 0;
-	else
-		return -1;
+	conversation = lookup_conversation(frame_num, addr_a, addr_b, ptype,
+	    port_a, port_b, options);
+	if (conversation != NULL && conversation_aging)
+		conversation_touch(conversation);
+	return conversation;
 }
 
 void
 conversation_add_proto_data(conversation_t *conv, const int proto, void *proto_data)
 {
-	conv_proto_data *p1 = se_alloc(sizeof(conv_proto_data));
-
-	p1->proto = proto;
-	p1->proto_data = proto_data;
-
-	/* Add it to the list of items for this conversation. */
-
-	conv->data_list = g_slist_insert_sorted(conv->data_list, (gpointer *)p1,
-	    p_compare);
+	/* An aged conversation's map is freed along with it. */
+	if (conversation_aging && conv->data_list == NULL)
+		conv->data_list = proto_data_map_new();
+	proto_data_map_add(&conv->data_list, proto, proto_data);
 }
 
 void *
 conversation_get_proto_data(const conversation_t *conv, const int proto)
 {
-	conv_proto_data temp, *p1;
-	GSList *item;
-
-	temp.proto = proto;
-	temp.proto_data = NULL;
-
-	item = g_slist_find_custom(conv->data_list, (gpointer *)&temp,
-	    p_compare);
-
-	if (item != NULL) {
-		p1 = (conv_proto_data *)item->data;
-		return p1->proto_data;
-	}
-
-	return NULL;
+	return proto_data_map_get(conv->data_list, proto);
 }
 
 void
 conversation_delete_proto_data(conversation_t *conv, const int proto)
 {
-	conv_proto_data temp;
-	GSList *item;
-
-	temp.proto = proto;
-	temp.proto_data = NULL;
-
-	item = g_slist_find_custom(conv->data_list, (gpointer *)&temp,
-	    p_compare);
-
-	while(item){
-		conv->data_list = g_slist_remove(conv->data_list, item->data);
-		item=item->next;
-	}
+	proto_data_map_remove(conv->data_list, proto);
 }
 
 void
@@ -76,13 +76,35 @@ typedef struct conversation {
 								/** pointer to the last conversation on hash chain */
 	guint32	index;				/** unique ID for conversation */
 	guint32 setup_frame;		/** frame number that setup this conversation */
-	GSList *data_list;			/** list of data associated with conversation */
+	struct _proto_data_map *data_list;	/** data associated with conversation */
 	dissector_handle_t dissector_handle;
 								/** handle for protocol dissector client associated with conversation */
 	guint	options;			/** wildcard flags */
 	conversation_key *key_ptr;	/** pointer to the key for this conversation */
+	struct conversation *lru_prev;	/** when aging, the next more recently used conversation */
+	struct conversation *lru_next;	/** when aging, the next less recently used conversation */
+	guint32 last_seen;		/** when aging, seconds of capture time it was last used */
 } conversation_t;
 
+/**
+ * Counts of conversations, for conversation_get_stats().
+ */
+typedef struct {
+	guint	live;			/** conversations that currently exist */
+	guint	peak;			/** most that have existed at once */
+	guint64	created;		/** conversations created */
+	guint64	evicted_idle;		/** conversations aged out for being idle */
+	guint64	evicted_limit;		/** conversations aged out to stay under the limit */
+} conversation_stats_t;
+
+/**
+ * Called for a protocol's data when the conversation it hangs off is aged
+ * out, or is still live when conversation_cleanup() frees it, so that the
+ * protocol can free whatever it keeps for the conversation that isn't se_
+ * allocated.
+ */
+typedef void (*conversation_evict_func)(conversation_t *conv, void *proto_data);
+
 /**
  * Destroy all existing conversations
  */
@@ -94,6 +116,38 @@ extern void conversation_cleanup(void);
  */
 extern void conversation_init(void);
 
+/**
+ * Age out conversations: ones that haven't been used for "idle_timeout"
+ * seconds of capture time, and, if there are more than "max_conversations",
+ * the least recently used ones.  Either limit can be 0 for none; both 0
+ * turns aging off, which is the default.
+ *
+ * This is only for programs that dissect each packet once, in order, such
+ * as TShark without -2: an aged out conversation, and everything hanging
+ * off it, is freed, and a later packet of it starts a new one.  Set this
+ * before any conversations are created.
+ */
+extern void conversation_set_aging(const guint idle_timeout, const guint max_conversations);
+
+/** TRUE if conversation_set_aging() turned aging on. */
+extern gboolean conversation_aging_enabled(void);
+
+/**
+ * Age out conversations, "now" being the time stamp of the packet about to
+ * be dissected.  Call this between packets, never while one is being
+ * dissected; does nothing if aging is off.
+ */
+extern void conversation_age(const nstime_t *now);
+
+/**
+ * Have "func" called when a conversation with data for "proto" is aged out.
+ * A protocol that keeps pointers to a conversation, or memory for it that
+ * isn't se_ allocated, outside that data must register one of these.
+ */
+extern void conversation_register_evict_callback(const int proto, conversation_evict_func func);
+
+extern void conversation_get_stats(conversation_stats_t *stats);
+
 /*
  * Given two address/port pairs for a packet, create a new conversation
  * to contain packets between those address/port pairs.
@@ -39,7 +39,10 @@ struct _dfilter_t {
 	gboolean	*attempted_load;
 	int		*interesting_fields;
 	int		num_interesting_fields;
+	int		*interesting_protocols;
+	int		num_interesting_protocols;
 	GPtrArray	*deprecated;
+	struct _dfvm_code_t *code;	/* insns compiled by dfvm_compile() */
 };
 
 typedef struct {
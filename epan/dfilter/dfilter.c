@@ -149,8 +149,12 @@ dfilter_free(dfilter_t *df)
 	if (df->consts) {
 		free_insns(df->consts);
 	}
+	if (df->code) {
+		dfvm_code_free(df->code);
+	}
 
 	g_free(df->interesting_fields);
+	g_free(df->interesting_protocols);
 
 	/* clear registers */
 	for (i = 0; i < df->max_registers; i++) {
@@ -173,6 +177,32 @@ dfilter_free(dfilter_t *df)
 }
 
 
+/* Find the protocols of the dfilter's interesting fields. */
+static void
+find_interesting_protocols(dfilter_t *df)
+{
+	int	i, j, id;
+
+	df->interesting_protocols = NULL;
+	df->num_interesting_protocols = 0;
+	if (df->num_interesting_fields == 0)
+		return;
+
+	df->interesting_protocols = g_new(int, df->num_interesting_fields);
+	for (i = 0; i < df->num_interesting_fields; i++) {
+		id = df->interesting_fields[i];
+		if (!proto_registrar_is_protocol(id))
+			id = proto_registrar_get_parent(id);
+
+		for (j = 0; j < df->num_interesting_protocols; j++) {
+			if (df->interesting_protocols[j] == id)
+				break;
+		}
+		if (j == df->num_interesting_protocols)
+			df->interesting_protocols[df->num_interesting_protocols++] = id;
+	}
+}
+
 static dfwork_t*
 dfwork_new(void)
 {
@@ -336,6 +366,7 @@ dfilter_compile(const gchar *text, dfilter_t **dfp)
 		dfw->consts = NULL;
 		dfilter->interesting_fields = dfw_interesting_fields(dfw,
 			&dfilter->num_interesting_fields);
+		find_interesting_protocols(dfilter);
 
 		/* Initialize run-time space */
 		dfilter->num_registers = dfw->first_constant;
@@ -346,6 +377,9 @@ dfilter_compile(const gchar *text, dfilter_t **dfp)
 		/* Initialize constants */
 		dfvm_init_const(dfilter);
 
+		/* Compile the bytecode into the form that's actually run */
+		dfilter->code = dfvm_compile(dfilter);
+
 		/* Add any deprecated items */
 		dfilter->deprecated = deprecated;
 
@@ -375,13 +409,19 @@ FAILURE:
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree)
 {
-	return dfvm_apply(df, tree);
+	return dfvm_apply_compiled(df, tree);
 }
 
 gboolean
 dfilter_apply_edt(dfilter_t *df, epan_dissect_t* edt)
 {
-	return dfvm_apply(df, edt->tree);
+	return dfvm_apply_compiled(df, edt->tree);
+}
+
+gboolean
+dfilter_apply_interpreted(dfilter_t *df, proto_tree *tree)
+{
+	return dfvm_apply(df, tree);
 }
 
 
@@ -395,6 +435,32 @@ dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
     }
 }
 
+void
+dfilter_prune_proto_tree(const dfilter_t *df, proto_tree *tree)
+{
+	int i;
+
+	dfilter_prime_proto_tree(df, tree);
+
+	for (i = 0; i < df->num_interesting_protocols; i++) {
+		proto_tree_prune_keep_protocol(tree, df->interesting_protocols[i]);
+	}
+}
+
+const int *
+dfilter_interesting_fields(const dfilter_t *df, int *num_fields)
+{
+	*num_fields = df->num_interesting_fields;
+	return df->interesting_fields;
+}
+
+const int *
+dfilter_interesting_protocols(const dfilter_t *df, int *num_protocols)
+{
+	*num_protocols = df->num_interesting_protocols;
+	return df->interesting_protocols;
+}
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df) {
 	if (df->deprecated && df->deprecated->len > 0) {
@@ -420,3 +486,9 @@ dfilter_dump(dfilter_t *df)
 		printf("\n");
 	}
 }
+
+void
+dfilter_dump_compiled(dfilter_t *df)
+{
+	dfvm_dump_compiled(stdout, df);
+}
@@ -83,10 +83,32 @@ dfilter_apply_edt(dfilter_t *df, epan_dissect_t* edt);
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree);
 
+/* Apply compiled dfilter by interpreting its bytecode, rather than
+ * running the compiled form of it as dfilter_apply() does. Meant for
+ * testing and benchmarking the compiler. */
+gboolean
+dfilter_apply_interpreted(dfilter_t *df, proto_tree *tree);
+
 /* Prime a proto_tree using the fields/protocols used in a dfilter. */
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
 
+/* Prime a proto_tree using the fields/protocols used in a dfilter, and
+ * let the dissection be pruned to the protocols those belong to; see
+ * proto_tree_prune_keep_protocol(). */
+void
+dfilter_prune_proto_tree(const dfilter_t *df, proto_tree *tree);
+
+/* Return the IDs of the fields and protocols that a dfilter can look at.
+ * The array belongs to the dfilter. */
+const int *
+dfilter_interesting_fields(const dfilter_t *df, int *num_fields);
+
+/* Return the IDs of the protocols that a dfilter can look at, either
+ * themselves or through their fields. The array belongs to the dfilter. */
+const int *
+dfilter_interesting_protocols(const dfilter_t *df, int *num_protocols);
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df);
 
@@ -94,6 +116,10 @@ dfilter_deprecated_tokens(dfilter_t *df);
 void
 dfilter_dump(dfilter_t *df);
 
+/* Print the compiled form of the bytecode of dfilter to stdout */
+void
+dfilter_dump_compiled(dfilter_t *df);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -24,6 +24,11 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+
+#include <epan/exceptions.h>
+#include <epan/tvbuff.h>
+
 #include "dfvm.h"
 
 dfvm_insn_t*
@@ -50,6 +55,9 @@ dfvm_value_free(dfvm_value_t *v)
 		case DRANGE:
 			drange_free(v->value.drange);
 			break;
+		case MULTISEARCH:
+			multisearch_free(v->value.multisearch);
+			break;
 		default:
 			/* nothing */
 			;
@@ -132,6 +140,7 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_CONTAINS_SET:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -266,6 +275,12 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					id, arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_CONTAINS_SET:
+				fprintf(f, "%05d ANY_CONTAINS_SET\treg#%u contains any of %u strings\n",
+					id, arg1->value.numeric,
+					multisearch_count(arg2->value.multisearch));
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -376,6 +391,61 @@ any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 }
 
 
+/* Does the value contain any of the strings in ms?  The bytes looked in
+ * are those that the type's cmp_contains() would look in. */
+static gboolean
+contains_any(const multisearch_t *ms, fvalue_t *fv)
+{
+	tvbuff_t		*tvb;
+	volatile gboolean	found = FALSE;
+
+	switch (fv->ftype->ftype) {
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+			return multisearch_find(ms, (const guint8 *)fv->value.string,
+					(guint)strlen(fv->value.string)) != -1;
+
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+			return multisearch_find(ms, fv->value.bytes->data,
+					fv->value.bytes->len) != -1;
+
+		case FT_PROTOCOL:
+			tvb = fv->value.tvb;
+			if (tvb == NULL)
+				return FALSE;
+			TRY {
+				found = multisearch_find(ms,
+						tvb_get_ptr(tvb, 0, tvb_length(tvb)),
+						tvb_length(tvb)) != -1;
+			}
+			CATCH_ALL {
+				/* nothing */
+			}
+			ENDTRY;
+			return found;
+
+		default:
+			/* gencode.c only makes sets for the types above */
+			g_assert_not_reached();
+			return FALSE;
+	}
+}
+
+static gboolean
+any_contains_set(dfilter_t *df, int reg, const multisearch_t *ms)
+{
+	GList	*list;
+
+	for (list = df->registers[reg]; list; list = g_list_next(list)) {
+		if (contains_any(ms, (fvalue_t *)list->data)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 /* Free the list nodes w/o freeing the memory that each
  * list node points to. */
 static void
@@ -533,6 +603,11 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_CONTAINS_SET:
+				accum = any_contains_set(df, arg1->value.numeric,
+						arg2->value.multisearch);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
@@ -607,6 +682,7 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_CONTAINS_SET:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -619,3 +695,728 @@ dfvm_init_const(dfilter_t *df)
 
 	return;
 }
+
+/*
+ * Compiled ("threaded") form of the instructions.
+ *
+ * dfvm_apply() decodes every instruction and its operands each time a
+ * filter is run.  dfvm_compile() does that once, when the filter is
+ * compiled, turning each instruction into a dfvm_cinsn_t that points to a
+ * function doing the work of just that instruction.  Each function
+ * returns the index of the instruction to run next, so the conditional
+ * jumps that follow an instruction are folded into it.
+ *
+ * In addition, a test of a field against a constant, i.e. the sequence
+ *
+ *	READ_TREE	field -> reg#A
+ *	IF-FALSE-GOTO	n
+ *	ANY_xx		reg#A xx reg#const
+ *
+ * is folded into the READ_TREE when the constant is an integer, IPv4
+ * address or Ethernet address, and reg#A isn't used anywhere else.  The
+ * folded instruction compares the values of the field_info's directly
+ * with the constant, without building a list of fvalue_t's in a register.
+ */
+
+typedef struct _dfvm_cinsn_t dfvm_cinsn_t;
+
+typedef int (*DfvmCinsnFunc)(dfilter_t *df, proto_tree *tree,
+		const dfvm_cinsn_t *ci, gboolean *accum);
+
+struct _dfvm_cinsn_t {
+	DfvmCinsnFunc	func;
+	const char	*name;		/* for dfvm_dump_compiled() */
+	dfvm_insn_t	*insn;		/* instruction this was compiled from */
+	int		on_true;	/* next instruction if accum is TRUE; -1 to return */
+	int		on_false;	/* next instruction if accum is FALSE; -1 to return */
+	FvalueCmpFunc	cmp;		/* ANY_ tests */
+
+	/* Tests of a field against a constant folded into READ_TREE */
+	header_field_info *hfinfo;
+	fvalue_t	*fv;
+	dfvm_opcode_t	fold_op;
+	union {
+		guint32		uinteger;
+		gint32		sinteger;
+		ipv4_addr	ipv4;
+		guint8		ether[FT_ETHER_LEN];
+	} k;
+};
+
+struct _dfvm_code_t {
+	dfvm_cinsn_t	*cinsns;
+	int		len;
+};
+
+#define CINSN_NEXT(ci, accum)	((accum) ? (ci)->on_true : (ci)->on_false)
+
+static int
+c_check_exists(dfilter_t *df _U_, proto_tree *tree, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	header_field_info	*hfinfo;
+
+	*accum = FALSE;
+	for (hfinfo = ci->hfinfo; hfinfo; hfinfo = hfinfo->same_name_next) {
+		if (proto_check_for_protocol_or_field(tree, hfinfo->id)) {
+			*accum = TRUE;
+			break;
+		}
+	}
+	return CINSN_NEXT(ci, *accum);
+}
+
+static int
+c_read_tree(dfilter_t *df, proto_tree *tree, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	*accum = read_tree(df, tree, ci->hfinfo, ci->insn->arg2->value.numeric);
+	return CINSN_NEXT(ci, *accum);
+}
+
+static int
+c_call_function(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	dfvm_insn_t	*insn = ci->insn;
+	GList		*param1 = NULL;
+	GList		*param2 = NULL;
+
+	if (insn->arg3) {
+		param1 = df->registers[insn->arg3->value.numeric];
+	}
+	if (insn->arg4) {
+		param2 = df->registers[insn->arg4->value.numeric];
+	}
+	*accum = insn->arg1->value.funcdef->function(param1, param2,
+			&df->registers[insn->arg2->value.numeric]);
+	return CINSN_NEXT(ci, *accum);
+}
+
+static int
+c_mk_range(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	dfvm_insn_t	*insn = ci->insn;
+
+	mk_range(df, insn->arg1->value.numeric, insn->arg2->value.numeric,
+			insn->arg3->value.drange);
+	return CINSN_NEXT(ci, *accum);
+}
+
+static int
+c_any_test(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	*accum = any_test(df, ci->cmp, ci->insn->arg1->value.numeric,
+			ci->insn->arg2->value.numeric);
+	return CINSN_NEXT(ci, *accum);
+}
+
+static int
+c_any_contains_set(dfilter_t *df, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	*accum = any_contains_set(df, ci->insn->arg1->value.numeric,
+			ci->insn->arg2->value.multisearch);
+	return CINSN_NEXT(ci, *accum);
+}
+
+static int
+c_not(dfilter_t *df _U_, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	*accum = !*accum;
+	return CINSN_NEXT(ci, *accum);
+}
+
+/* Jumps, returns, and tests that were folded into an earlier instruction */
+static int
+c_goto(dfilter_t *df _U_, proto_tree *tree _U_, const dfvm_cinsn_t *ci,
+		gboolean *accum)
+{
+	return CINSN_NEXT(ci, *accum);
+}
+
+/* Defines a function that's TRUE if any value "v" of the field satisfies
+ * TEST against the constant in ci->k. */
+#define DEFINE_FIELD_TEST(fname, TEST)					\
+static int								\
+fname(dfilter_t *df _U_, proto_tree *tree, const dfvm_cinsn_t *ci,	\
+		gboolean *accum)					\
+{									\
+	header_field_info	*hfinfo;				\
+	GPtrArray		*finfos;				\
+	fvalue_t		*v;					\
+	guint			i;					\
+									\
+	for (hfinfo = ci->hfinfo; hfinfo; hfinfo = hfinfo->same_name_next) { \
+		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);	\
+		if (finfos == NULL)					\
+			continue;					\
+		for (i = 0; i < finfos->len; i++) {			\
+			v = &((field_info *)g_ptr_array_index(finfos, i))->value; \
+			if (TEST) {					\
+				*accum = TRUE;				\
+				return ci->on_true;			\
+			}						\
+		}							\
+	}								\
+	*accum = FALSE;							\
+	return ci->on_false;						\
+}
+
+DEFINE_FIELD_TEST(c_uint_eq, v->value.uinteger == ci->k.uinteger)
+DEFINE_FIELD_TEST(c_uint_ne, v->value.uinteger != ci->k.uinteger)
+DEFINE_FIELD_TEST(c_uint_gt, v->value.uinteger > ci->k.uinteger)
+DEFINE_FIELD_TEST(c_uint_ge, v->value.uinteger >= ci->k.uinteger)
+DEFINE_FIELD_TEST(c_uint_lt, v->value.uinteger < ci->k.uinteger)
+DEFINE_FIELD_TEST(c_uint_le, v->value.uinteger <= ci->k.uinteger)
+DEFINE_FIELD_TEST(c_uint_and, (v->value.uinteger & ci->k.uinteger) != 0)
+
+DEFINE_FIELD_TEST(c_sint_gt, v->value.sinteger > ci->k.sinteger)
+DEFINE_FIELD_TEST(c_sint_ge, v->value.sinteger >= ci->k.sinteger)
+DEFINE_FIELD_TEST(c_sint_lt, v->value.sinteger < ci->k.sinteger)
+DEFINE_FIELD_TEST(c_sint_le, v->value.sinteger <= ci->k.sinteger)
+
+/* Same as ipv4_addr_eq() etc.: compare using the shorter of the masks */
+#define IPV4_MASKED(addr)	\
+	((addr) & MIN(v->value.ipv4.nmask, ci->k.ipv4.nmask))
+
+DEFINE_FIELD_TEST(c_ipv4_eq, IPV4_MASKED(v->value.ipv4.addr) == IPV4_MASKED(ci->k.ipv4.addr))
+DEFINE_FIELD_TEST(c_ipv4_ne, IPV4_MASKED(v->value.ipv4.addr) != IPV4_MASKED(ci->k.ipv4.addr))
+DEFINE_FIELD_TEST(c_ipv4_gt, IPV4_MASKED(v->value.ipv4.addr) > IPV4_MASKED(ci->k.ipv4.addr))
+DEFINE_FIELD_TEST(c_ipv4_ge, IPV4_MASKED(v->value.ipv4.addr) >= IPV4_MASKED(ci->k.ipv4.addr))
+DEFINE_FIELD_TEST(c_ipv4_lt, IPV4_MASKED(v->value.ipv4.addr) < IPV4_MASKED(ci->k.ipv4.addr))
+DEFINE_FIELD_TEST(c_ipv4_le, IPV4_MASKED(v->value.ipv4.addr) <= IPV4_MASKED(ci->k.ipv4.addr))
+DEFINE_FIELD_TEST(c_ipv4_and,
+	(v->value.ipv4.addr & v->value.ipv4.nmask & ci->k.ipv4.addr & ci->k.ipv4.nmask) != 0)
+
+DEFINE_FIELD_TEST(c_ether_eq,
+	v->value.bytes->len == FT_ETHER_LEN && memcmp(v->value.bytes->data, ci->k.ether, FT_ETHER_LEN) == 0)
+DEFINE_FIELD_TEST(c_ether_ne,
+	v->value.bytes->len != FT_ETHER_LEN || memcmp(v->value.bytes->data, ci->k.ether, FT_ETHER_LEN) != 0)
+
+typedef enum {
+	FOLD_UINT,
+	FOLD_SINT,
+	FOLD_IPV4,
+	FOLD_ETHER
+} fold_kind_t;
+
+static const struct {
+	fold_kind_t	kind;
+	dfvm_opcode_t	op;
+	DfvmCinsnFunc	func;
+	const char	*name;
+} fold_funcs[] = {
+	{ FOLD_UINT,	ANY_EQ,			c_uint_eq,	"UINT_EQ" },
+	{ FOLD_UINT,	ANY_NE,			c_uint_ne,	"UINT_NE" },
+	{ FOLD_UINT,	ANY_GT,			c_uint_gt,	"UINT_GT" },
+	{ FOLD_UINT,	ANY_GE,			c_uint_ge,	"UINT_GE" },
+	{ FOLD_UINT,	ANY_LT,			c_uint_lt,	"UINT_LT" },
+	{ FOLD_UINT,	ANY_LE,			c_uint_le,	"UINT_LE" },
+	{ FOLD_UINT,	ANY_BITWISE_AND,	c_uint_and,	"UINT_AND" },
+	{ FOLD_SINT,	ANY_EQ,			c_uint_eq,	"SINT_EQ" },
+	{ FOLD_SINT,	ANY_NE,			c_uint_ne,	"SINT_NE" },
+	{ FOLD_SINT,	ANY_GT,			c_sint_gt,	"SINT_GT" },
+	{ FOLD_SINT,	ANY_GE,			c_sint_ge,	"SINT_GE" },
+	{ FOLD_SINT,	ANY_LT,			c_sint_lt,	"SINT_LT" },
+	{ FOLD_SINT,	ANY_LE,			c_sint_le,	"SINT_LE" },
+	{ FOLD_SINT,	ANY_BITWISE_AND,	c_uint_and,	"SINT_AND" },
+	{ FOLD_IPV4,	ANY_EQ,			c_ipv4_eq,	"IPV4_EQ" },
+	{ FOLD_IPV4,	ANY_NE,			c_ipv4_ne,	"IPV4_NE" },
+	{ FOLD_IPV4,	ANY_GT,			c_ipv4_gt,	"IPV4_GT" },
+	{ FOLD_IPV4,	ANY_GE,			c_ipv4_ge,	"IPV4_GE" },
+	{ FOLD_IPV4,	ANY_LT,			c_ipv4_lt,	"IPV4_LT" },
+	{ FOLD_IPV4,	ANY_LE,			c_ipv4_le,	"IPV4_LE" },
+	{ FOLD_IPV4,	ANY_BITWISE_AND,	c_ipv4_and,	"IPV4_AND" },
+	{ FOLD_ETHER,	ANY_EQ,			c_ether_eq,	"ETHER_EQ" },
+	{ FOLD_ETHER,	ANY_NE,			c_ether_ne,	"ETHER_NE" }
+};
+
+static gboolean
+fold_kind(ftenum_t ftype, fold_kind_t *kind)
+{
+	switch (ftype) {
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_FRAMENUM:
+			*kind = FOLD_UINT;
+			return TRUE;
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			*kind = FOLD_SINT;
+			return TRUE;
+		case FT_IPv4:
+			*kind = FOLD_IPV4;
+			return TRUE;
+		case FT_ETHER:
+			*kind = FOLD_ETHER;
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+/* "const xx field" is "field yy const" */
+static dfvm_opcode_t
+mirror_op(dfvm_opcode_t op)
+{
+	switch (op) {
+		case ANY_GT:
+			return ANY_LT;
+		case ANY_GE:
+			return ANY_LE;
+		case ANY_LT:
+			return ANY_GT;
+		case ANY_LE:
+			return ANY_GE;
+		default:
+			return op;
+	}
+}
+
+static const char *
+op_string(dfvm_opcode_t op)
+{
+	switch (op) {
+		case ANY_EQ:		return "==";
+		case ANY_NE:		return "!=";
+		case ANY_GT:		return ">";
+		case ANY_GE:		return ">=";
+		case ANY_LT:		return "<";
+		case ANY_LE:		return "<=";
+		case ANY_BITWISE_AND:	return "&";
+		default:		return "?";
+	}
+}
+
+/* Returns the constant that's put into a register, or NULL if the
+ * register doesn't hold a constant. */
+static fvalue_t *
+const_fvalue(dfilter_t *df, guint32 reg)
+{
+	dfvm_insn_t	*insn;
+	guint		i;
+
+	if (reg < df->num_registers)
+		return NULL;
+
+	for (i = 0; i < df->consts->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->consts, i);
+		if (insn->op == PUT_FVALUE && insn->arg2->value.numeric == reg)
+			return insn->arg1->value.fvalue;
+	}
+	return NULL;
+}
+
+static void
+count_register_use(guint *reg_uses, dfvm_value_t *arg)
+{
+	if (arg && arg->type == REGISTER)
+		reg_uses[arg->value.numeric]++;
+}
+
+static gboolean
+is_jump(const dfvm_cinsn_t *ci)
+{
+	return ci->insn->op == IF_TRUE_GOTO || ci->insn->op == IF_FALSE_GOTO;
+}
+
+/* Can the test at id + 2 be folded into the READ_TREE at id?  See the
+ * comment at the top of this section.  If so, returns the register read
+ * by the READ_TREE and the function doing the folded test.  The jumps
+ * must have been threaded already. */
+static gboolean
+can_fold_test(dfilter_t *df, dfvm_code_t *code, int id, guint32 *p_reg,
+		fvalue_t **p_fv, dfvm_opcode_t *p_op, DfvmCinsnFunc *p_func,
+		const char **p_name)
+{
+	dfvm_insn_t		*read, *test;
+	header_field_info	*hfinfo;
+	fvalue_t		*fv;
+	dfvm_opcode_t		op;
+	fold_kind_t		kind;
+	guint32			reg;
+	guint			i;
+	int			j;
+
+	if (id + 2 >= code->len)
+		return FALSE;
+
+	read = code->cinsns[id].insn;
+	test = code->cinsns[id + 2].insn;
+	if (read->op != READ_TREE || code->cinsns[id + 1].insn->op != IF_FALSE_GOTO)
+		return FALSE;
+
+	/* The test must only be reached from the READ_TREE, i.e. with the
+	 * register loaded by it */
+	for (j = 0; j < code->len; j++) {
+		if (j == id || is_jump(&code->cinsns[j]))
+			continue;
+		if (code->cinsns[j].on_true == id + 2 || code->cinsns[j].on_false == id + 2)
+			return FALSE;
+	}
+
+	switch (test->op) {
+		case ANY_EQ:
+		case ANY_NE:
+		case ANY_GT:
+		case ANY_GE:
+		case ANY_LT:
+		case ANY_LE:
+		case ANY_BITWISE_AND:
+			break;
+		default:
+			return FALSE;
+	}
+
+	reg = read->arg2->value.numeric;
+	if (test->arg1->value.numeric == reg) {
+		fv = const_fvalue(df, test->arg2->value.numeric);
+		op = test->op;
+	}
+	else if (test->arg2->value.numeric == reg) {
+		fv = const_fvalue(df, test->arg1->value.numeric);
+		op = mirror_op(test->op);
+	}
+	else
+		return FALSE;
+
+	if (fv == NULL || !fold_kind(fv->ftype->ftype, &kind))
+		return FALSE;
+
+	/* All the fields with this name must be of the constant's type */
+	for (hfinfo = read->arg1->value.hfinfo; hfinfo; hfinfo = hfinfo->same_name_next) {
+		if (hfinfo->type != fv->ftype->ftype)
+			return FALSE;
+	}
+	if (kind == FOLD_ETHER && fv->value.bytes->len != FT_ETHER_LEN)
+		return FALSE;
+
+	for (i = 0; i < G_N_ELEMENTS(fold_funcs); i++) {
+		if (fold_funcs[i].kind == kind && fold_funcs[i].op == op) {
+			*p_reg = reg;
+			*p_fv = fv;
+			*p_op = op;
+			*p_func = fold_funcs[i].func;
+			*p_name = fold_funcs[i].name;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* Follow the jumps starting at id, given the value of accum, which jumps
+ * don't change, and return the first instruction that isn't a jump. */
+static int
+resolve_jumps(dfvm_code_t *code, int id, gboolean accum)
+{
+	while (id >= 0 && id < code->len && is_jump(&code->cinsns[id])) {
+		id = accum ? code->cinsns[id].on_true : code->cinsns[id].on_false;
+	}
+	return id;
+}
+
+dfvm_code_t*
+dfvm_compile(dfilter_t *df)
+{
+	dfvm_code_t	*code;
+	dfvm_cinsn_t	*ci;
+	dfvm_insn_t	*insn;
+	int		id, length;
+	guint		*reg_uses, *reg_folds;
+	guint32		reg;
+	fvalue_t	*fv;
+	dfvm_opcode_t	op;
+	DfvmCinsnFunc	func;
+	const char	*name;
+
+	length = df->insns->len;
+
+	code = g_new(dfvm_code_t, 1);
+	code->len = length;
+	code->cinsns = g_new0(dfvm_cinsn_t, length);
+
+	reg_uses = g_new0(guint, df->max_registers);
+	reg_folds = g_new0(guint, df->max_registers);
+
+	/* Translate each instruction on its own */
+	for (id = 0; id < length; id++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, id);
+		ci = &code->cinsns[id];
+
+		ci->insn = insn;
+		ci->on_true = id + 1;
+		ci->on_false = id + 1;
+
+		switch (insn->op) {
+			case CHECK_EXISTS:
+				ci->func = c_check_exists;
+				ci->name = "CHECK_EXISTS";
+				ci->hfinfo = insn->arg1->value.hfinfo;
+				break;
+
+			case READ_TREE:
+				ci->func = c_read_tree;
+				ci->name = "READ_TREE";
+				ci->hfinfo = insn->arg1->value.hfinfo;
+				break;
+
+			case CALL_FUNCTION:
+				ci->func = c_call_function;
+				ci->name = "CALL_FUNCTION";
+				break;
+
+			case MK_RANGE:
+				ci->func = c_mk_range;
+				ci->name = "MK_RANGE";
+				break;
+
+			case ANY_EQ:
+				ci->func = c_any_test;
+				ci->name = "ANY_EQ";
+				ci->cmp = fvalue_eq;
+				break;
+
+			case ANY_NE:
+				ci->func = c_any_test;
+				ci->name = "ANY_NE";
+				ci->cmp = fvalue_ne;
+				break;
+
+			case ANY_GT:
+				ci->func = c_any_test;
+				ci->name = "ANY_GT";
+				ci->cmp = fvalue_gt;
+				break;
+
+			case ANY_GE:
+				ci->func = c_any_test;
+				ci->name = "ANY_GE";
+				ci->cmp = fvalue_ge;
+				break;
+
+			case ANY_LT:
+				ci->func = c_any_test;
+				ci->name = "ANY_LT";
+				ci->cmp = fvalue_lt;
+				break;
+
+			case ANY_LE:
+				ci->func = c_any_test;
+				ci->name = "ANY_LE";
+				ci->cmp = fvalue_le;
+				break;
+
+			case ANY_BITWISE_AND:
+				ci->func = c_any_test;
+				ci->name = "ANY_BITWISE_AND";
+				ci->cmp = fvalue_bitwise_and;
+				break;
+
+			case ANY_CONTAINS:
+				ci->func = c_any_test;
+				ci->name = "ANY_CONTAINS";
+				ci->cmp = fvalue_contains;
+				break;
+
+			case ANY_MATCHES:
+				ci->func = c_any_test;
+				ci->name = "ANY_MATCHES";
+				ci->cmp = fvalue_matches;
+				break;
+
+			case ANY_CONTAINS_SET:
+				ci->func = c_any_contains_set;
+				ci->name = "ANY_CONTAINS_SET";
+				break;
+
+			case NOT:
+				ci->func = c_not;
+				ci->name = "NOT";
+				break;
+
+			case RETURN:
+				ci->func = c_goto;
+				ci->name = "RETURN";
+				ci->on_true = -1;
+				ci->on_false = -1;
+				break;
+
+			case IF_TRUE_GOTO:
+				ci->func = c_goto;
+				ci->name = "IF-TRUE-GOTO";
+				ci->on_true = insn->arg1->value.numeric;
+				break;
+
+			case IF_FALSE_GOTO:
+				ci->func = c_goto;
+				ci->name = "IF-FALSE-GOTO";
+				ci->on_false = insn->arg1->value.numeric;
+				break;
+
+			case PUT_FVALUE:
+			default:
+				/* Constants are in df->consts */
+				g_assert_not_reached();
+				break;
+		}
+
+		if (insn->op != IF_TRUE_GOTO && insn->op != IF_FALSE_GOTO) {
+			count_register_use(reg_uses, insn->arg1);
+			count_register_use(reg_uses, insn->arg2);
+			count_register_use(reg_uses, insn->arg3);
+			count_register_use(reg_uses, insn->arg4);
+		}
+	}
+
+	/* Thread the jumps: an instruction goes straight to the first
+	 * instruction that isn't a jump. */
+	for (id = 0; id < length; id++) {
+		ci = &code->cinsns[id];
+		ci->on_true = resolve_jumps(code, ci->on_true, TRUE);
+		ci->on_false = resolve_jumps(code, ci->on_false, FALSE);
+	}
+
+	/* Fold tests of a field against a constant.  A register can be
+	 * dropped only if every use of it is in such a test. */
+	for (id = 0; id < length; id++) {
+		if (can_fold_test(df, code, id, &reg, &fv, &op, &func, &name))
+			reg_folds[reg] += 2;
+	}
+	for (id = 0; id < length; id++) {
+		if (!can_fold_test(df, code, id, &reg, &fv, &op, &func, &name))
+			continue;
+		if (reg_folds[reg] != reg_uses[reg])
+			continue;
+
+		ci = &code->cinsns[id];
+		ci->func = func;
+		ci->name = name;
+		ci->fv = fv;
+		ci->fold_op = op;
+		switch (fv->ftype->ftype) {
+			case FT_IPv4:
+				ci->k.ipv4 = fv->value.ipv4;
+				break;
+			case FT_ETHER:
+				memcpy(ci->k.ether, fv->value.bytes->data, FT_ETHER_LEN);
+				break;
+			default:
+				ci->k.uinteger = fv->value.uinteger;
+				break;
+		}
+
+		/* The test's outcome is now known here, so continue
+		 * where the test would have */
+		ci->on_true = code->cinsns[id + 2].on_true;
+		ci->on_false = code->cinsns[id + 2].on_false;
+
+		/* The test itself is now reached only if this succeeded */
+		code->cinsns[id + 2].func = c_goto;
+		code->cinsns[id + 2].name = "(folded)";
+	}
+
+	g_free(reg_uses);
+	g_free(reg_folds);
+
+	return code;
+}
+
+void
+dfvm_code_free(dfvm_code_t *code)
+{
+	g_free(code->cinsns);
+	g_free(code);
+}
+
+static void
+dump_next(FILE *f, int id)
+{
+	if (id < 0)
+		fprintf(f, "RETURN");
+	else
+		fprintf(f, "%05d", id);
+}
+
+void
+dfvm_dump_compiled(FILE *f, dfilter_t *df)
+{
+	dfvm_code_t	*code = df->code;
+	dfvm_cinsn_t	*ci;
+	dfvm_insn_t	*insn;
+	char		*value_str;
+	int		id;
+
+	fprintf(f, "Compiled:\n");
+
+	for (id = 0; id < code->len; id++) {
+		ci = &code->cinsns[id];
+		insn = ci->insn;
+
+		fprintf(f, "%05d %-15s ", id, ci->name);
+		if (ci->fv) {
+			value_str = fvalue_to_string_repr(ci->fv,
+				FTREPR_DFILTER, NULL);
+			fprintf(f, "%s %s %s <%s>", ci->hfinfo->abbrev,
+				op_string(ci->fold_op), value_str,
+				fvalue_type_name(ci->fv));
+			g_free(value_str);
+		}
+		else if (ci->func == c_goto) {
+			/* jumps and folded tests are only landing places */
+		}
+		else if (ci->hfinfo) {
+			fprintf(f, "%s", ci->hfinfo->abbrev);
+			if (insn->op == READ_TREE)
+				fprintf(f, " -> reg#%u", insn->arg2->value.numeric);
+		}
+		else if (insn->op == CALL_FUNCTION) {
+			fprintf(f, "%s -> reg#%u", insn->arg1->value.funcdef->name,
+				insn->arg2->value.numeric);
+		}
+		else if (insn->op == ANY_CONTAINS_SET) {
+			fprintf(f, "reg#%u, %u strings", insn->arg1->value.numeric,
+				multisearch_count(insn->arg2->value.multisearch));
+		}
+		else if (insn->op == MK_RANGE) {
+			fprintf(f, "reg#%u -> reg#%u", insn->arg1->value.numeric,
+				insn->arg2->value.numeric);
+		}
+		else if (insn->arg1 && insn->arg2) {
+			fprintf(f, "reg#%u, reg#%u", insn->arg1->value.numeric,
+				insn->arg2->value.numeric);
+		}
+
+		if (insn->op != RETURN) {
+			fprintf(f, "\ttrue: ");
+			dump_next(f, ci->on_true);
+			fprintf(f, " false: ");
+			dump_next(f, ci->on_false);
+		}
+		fprintf(f, "\n");
+	}
+}
+
+gboolean
+dfvm_apply_compiled(dfilter_t *df, proto_tree *tree)
+{
+	const dfvm_cinsn_t	*cinsns = df->code->cinsns;
+	gboolean		accum = TRUE;
+	int			id = 0;
+
+	g_assert(tree);
+
+	do {
+		id = cinsns[id].func(df, tree, &cinsns[id], &accum);
+	} while (id >= 0);
+
+	free_register_overhead(df);
+	return accum;
+}
@@ -25,6 +25,7 @@
 
 #include <stdio.h>
 #include <epan/proto.h>
+#include <epan/multisearch.h>
 #include "dfilter-int.h"
 #include "syntax-tree.h"
 #include "drange.h"
@@ -38,7 +39,8 @@ typedef enum {
 	REGISTER,
 	INTEGER,
 	DRANGE,
-	FUNCTION_DEF
+	FUNCTION_DEF,
+	MULTISEARCH
 } dfvm_value_type_t;
 
 typedef struct {
@@ -50,6 +52,7 @@ typedef struct {
 		drange			*drange;
 		header_field_info	*hfinfo;
         df_func_def_t   *funcdef;
+		multisearch_t		*multisearch;
 	} value;
 
 } dfvm_value_t;
@@ -73,6 +76,7 @@ typedef enum {
 	ANY_BITWISE_AND,
 	ANY_CONTAINS,
 	ANY_MATCHES,
+	ANY_CONTAINS_SET,
 	MK_RANGE,
     CALL_FUNCTION
 
@@ -105,4 +109,19 @@ dfvm_apply(dfilter_t *df, proto_tree *tree);
 void
 dfvm_init_const(dfilter_t *df);
 
+/* Threaded form of a dfilter's instructions; see dfvm_compile() */
+typedef struct _dfvm_code_t dfvm_code_t;
+
+dfvm_code_t*
+dfvm_compile(dfilter_t *df);
+
+void
+dfvm_code_free(dfvm_code_t *code);
+
+void
+dfvm_dump_compiled(FILE *f, dfilter_t *df);
+
+gboolean
+dfvm_apply_compiled(dfilter_t *df, proto_tree *tree);
+
 #endif
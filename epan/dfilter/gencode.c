@@ -24,6 +24,8 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+
 #include "dfilter-int.h"
 #include "gencode.h"
 #include "dfvm.h"
@@ -319,6 +321,203 @@ gen_entity(dfwork_t *dfw, stnode_t *st_arg, dfvm_value_t **p_jmp)
 }
 
 
+/* If st_node is a "field contains constant" test that can be done along
+ * with others of the same field by searching for all of their constants
+ * at once, returns the first field of that name, else NULL. */
+static header_field_info *
+contains_set_field(stnode_t *st_node)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	header_field_info	*hfinfo, *hfi;
+	fvalue_t	*fv;
+
+	if (stnode_type_id(st_node) != STTYPE_TEST)
+		return NULL;
+
+	sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+	if (st_op != TEST_OP_CONTAINS ||
+	    stnode_type_id(st_arg1) != STTYPE_FIELD ||
+	    stnode_type_id(st_arg2) != STTYPE_FVALUE)
+		return NULL;
+
+	fv = (fvalue_t *)stnode_data(st_arg2);
+	switch (fvalue_ftype(fv)->ftype) {
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_PROTOCOL:
+			break;
+		default:
+			return NULL;
+	}
+
+	/* Rewind to find the first field of this name. */
+	hfinfo = (header_field_info*)stnode_data(st_arg1);
+	while (hfinfo->same_name_prev) {
+		hfinfo = hfinfo->same_name_prev;
+	}
+
+	/* All the fields with this name must be of the constant's type */
+	for (hfi = hfinfo; hfi; hfi = hfi->same_name_next) {
+		if (hfi->type != fvalue_ftype(fv)->ftype)
+			return NULL;
+	}
+	return hfinfo;
+}
+
+/* The operands of a chain of ORs, in order */
+static void
+or_operands(stnode_t *st_node, GSList **p_operands)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+
+	if (stnode_type_id(st_node) == STTYPE_TEST) {
+		sttype_test_get(st_node, &st_op, &st_arg1, &st_arg2);
+		if (st_op == TEST_OP_OR) {
+			or_operands(st_arg1, p_operands);
+			or_operands(st_arg2, p_operands);
+			return;
+		}
+	}
+	*p_operands = g_slist_append(*p_operands, st_node);
+}
+
+/* "field contains c1 || field contains c2 || ...", as a single search
+ * of each value of the field for all of the constants. */
+static void
+gen_contains_set(dfwork_t *dfw, header_field_info *hfinfo, GSList *tests)
+{
+	test_op_t	st_op;
+	stnode_t	*st_arg1, *st_arg2;
+	fvalue_t	*fv;
+	multisearch_t	*ms;
+	tvbuff_t	*tvb;
+	const char	*str;
+	guint		len;
+	int		reg;
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2, *jmp;
+
+	ms = multisearch_new();
+	for (; tests; tests = g_slist_next(tests)) {
+		sttype_test_get((stnode_t *)tests->data, &st_op, &st_arg1, &st_arg2);
+		fv = (fvalue_t *)stnode_data(st_arg2);
+		switch (fvalue_ftype(fv)->ftype) {
+			case FT_PROTOCOL:
+				tvb = (tvbuff_t *)fvalue_get(fv);
+				len = fvalue_length(fv);
+				multisearch_add(ms,
+					len ? tvb_get_ptr(tvb, 0, len) : NULL, len);
+				break;
+			case FT_BYTES:
+			case FT_UINT_BYTES:
+				multisearch_add(ms, (const guint8 *)fvalue_get(fv),
+					fvalue_length(fv));
+				break;
+			default:
+				str = (const char *)fvalue_get(fv);
+				multisearch_add(ms, (const guint8 *)str,
+					(guint)strlen(str));
+				break;
+		}
+		/* The constant isn't put in a register, so it's not freed
+		 * along with the instructions. */
+		FVALUE_FREE(fv);
+	}
+	multisearch_compile(ms);
+
+	reg = dfw_append_read_tree(dfw, hfinfo);
+
+	insn = dfvm_insn_new(IF_FALSE_GOTO);
+	jmp = dfvm_value_new(INSN_NUMBER);
+	insn->arg1 = jmp;
+	dfw_append_insn(dfw, insn);
+
+	insn = dfvm_insn_new(ANY_CONTAINS_SET);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = reg;
+	val2 = dfvm_value_new(MULTISEARCH);
+	val2->value.multisearch = ms;
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	dfw_append_insn(dfw, insn);
+
+	jmp->value.numeric = dfw->next_insn_id;
+}
+
+/*
+ * A chain of ORs in which two or more of the operands are "contains"
+ * tests of the same field: each such group is done as one search for all
+ * of the group's constants, and the rest as usual.  Returns FALSE, having
+ * generated nothing, if there are no such groups.
+ */
+static gboolean
+gen_or_contains_sets(dfwork_t *dfw, stnode_t *st_node)
+{
+	GSList		*operands = NULL, *items = NULL, *jmps = NULL;
+	GSList		*l, *m, *group;
+	header_field_info	*hfinfo;
+	gboolean	any_groups = FALSE;
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1;
+
+	or_operands(st_node, &operands);
+
+	/* Each item is a GSList of the tests that are done together */
+	for (l = operands; l; l = g_slist_next(l)) {
+		if (l->data == NULL)
+			continue;	/* already in a group */
+		group = g_slist_append(NULL, l->data);
+		hfinfo = contains_set_field((stnode_t *)l->data);
+		if (hfinfo) {
+			for (m = g_slist_next(l); m; m = g_slist_next(m)) {
+				if (m->data && contains_set_field((stnode_t *)m->data) == hfinfo) {
+					group = g_slist_append(group, m->data);
+					m->data = NULL;
+				}
+			}
+			if (g_slist_length(group) > 1)
+				any_groups = TRUE;
+		}
+		items = g_slist_append(items, group);
+	}
+	g_slist_free(operands);
+
+	if (any_groups) {
+		for (l = items; l; l = g_slist_next(l)) {
+			group = (GSList *)l->data;
+			if (group->next)
+				gen_contains_set(dfw,
+					contains_set_field((stnode_t *)group->data), group);
+			else
+				gencode(dfw, (stnode_t *)group->data);
+
+			if (l->next) {
+				insn = dfvm_insn_new(IF_TRUE_GOTO);
+				val1 = dfvm_value_new(INSN_NUMBER);
+				insn->arg1 = val1;
+				dfw_append_insn(dfw, insn);
+				jmps = g_slist_prepend(jmps, val1);
+			}
+		}
+		for (l = jmps; l; l = g_slist_next(l)) {
+			((dfvm_value_t *)l->data)->value.numeric = dfw->next_insn_id;
+		}
+		g_slist_free(jmps);
+	}
+
+	for (l = items; l; l = g_slist_next(l)) {
+		g_slist_free((GSList *)l->data);
+	}
+	g_slist_free(items);
+
+	return any_groups;
+}
+
 static void
 gen_test(dfwork_t *dfw, stnode_t *st_node)
 {
@@ -378,6 +577,9 @@ gen_test(dfwork_t *dfw, stnode_t *st_node)
 			break;
 
 		case TEST_OP_OR:
+			if (gen_or_contains_sets(dfw, st_node))
+				break;
+
 			gencode(dfw, st_arg1);
 
 			insn = dfvm_insn_new(IF_TRUE_GOTO);
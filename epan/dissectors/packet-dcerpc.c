@@ -927,8 +927,13 @@ dcerpc_get_proto_sub_dissector(e_uuid_t *uuid, guint16 ver)
  */
 static GHashTable *dcerpc_binds = NULL;
 
+/*
+ * The tables are keyed by the index of the conversation, not a pointer
+ * to it: with conversation aging, a conversation can be freed, and a new
+ * one allocated at the same address, while the tables are still in use.
+ */
 typedef struct _dcerpc_bind_key {
-    conversation_t *conv;
+    guint32         conv_index;
     guint16         ctx_id;
     guint16         smb_fid;
 } dcerpc_bind_key;
@@ -944,7 +949,7 @@ dcerpc_bind_equal(gconstpointer k1, gconstpointer k2)
 {
     const dcerpc_bind_key *key1 = (const dcerpc_bind_key *)k1;
     const dcerpc_bind_key *key2 = (const dcerpc_bind_key *)k2;
-    return ((key1->conv == key2->conv)
+    return ((key1->conv_index == key2->conv_index)
             && (key1->ctx_id == key2->ctx_id)
             && (key1->smb_fid == key2->smb_fid));
 }
@@ -955,7 +960,7 @@ dcerpc_bind_hash(gconstpointer k)
     const dcerpc_bind_key *key = (const dcerpc_bind_key *)k;
     guint hash;
 
-    hash = GPOINTER_TO_UINT(key->conv) + key->ctx_id + key->smb_fid;
+    hash = key->conv_index + key->ctx_id + key->smb_fid;
     return hash;
 
 }
@@ -968,13 +973,13 @@ static GHashTable *dcerpc_cn_calls = NULL;
 static GHashTable *dcerpc_dg_calls = NULL;
 
 typedef struct _dcerpc_cn_call_key {
-    conversation_t *conv;
+    guint32 conv_index;
     guint32 call_id;
     guint16 smb_fid;
 } dcerpc_cn_call_key;
 
 typedef struct _dcerpc_dg_call_key {
-    conversation_t *conv;
+    guint32         conv_index;
     guint32         seqnum;
     e_uuid_t        act_id ;
 } dcerpc_dg_call_key;
@@ -985,7 +990,7 @@ dcerpc_cn_call_equal(gconstpointer k1, gconstpointer k2)
 {
     const dcerpc_cn_call_key *key1 = (const dcerpc_cn_call_key *)k1;
     const dcerpc_cn_call_key *key2 = (const dcerpc_cn_call_key *)k2;
-    return ((key1->conv == key2->conv)
+    return ((key1->conv_index == key2->conv_index)
             && (key1->call_id == key2->call_id)
             && (key1->smb_fid == key2->smb_fid));
 }
@@ -995,7 +1000,7 @@ dcerpc_dg_call_equal(gconstpointer k1, gconstpointer k2)
 {
     const dcerpc_dg_call_key *key1 = (const dcerpc_dg_call_key *)k1;
     const dcerpc_dg_call_key *key2 = (const dcerpc_dg_call_key *)k2;
-    return ((key1->conv == key2->conv)
+    return ((key1->conv_index == key2->conv_index)
             && (key1->seqnum == key2->seqnum)
             && ((memcmp(&key1->act_id, &key2->act_id, sizeof (e_uuid_t)) == 0)));
 }
@@ -1004,14 +1009,14 @@ static guint
 dcerpc_cn_call_hash(gconstpointer k)
 {
     const dcerpc_cn_call_key *key = (const dcerpc_cn_call_key *)k;
-    return GPOINTER_TO_UINT(key->conv) + key->call_id + key->smb_fid;
+    return key->conv_index + key->call_id + key->smb_fid;
 }
 
 static guint
 dcerpc_dg_call_hash(gconstpointer k)
 {
     const dcerpc_dg_call_key *key = (const dcerpc_dg_call_key *)k;
-    return (GPOINTER_TO_UINT(key->conv) + key->seqnum + key->act_id.Data1
+    return (key->conv_index + key->seqnum + key->act_id.Data1
             + (key->act_id.Data2 << 16)    + key->act_id.Data3
             + (key->act_id.Data4[0] << 24) + (key->act_id.Data4[1] << 16)
             + (key->act_id.Data4[2] << 8)  + (key->act_id.Data4[3] << 0)
@@ -2936,7 +2941,7 @@ dissect_dcerpc_cn_bind(tvbuff_t *tvb, gint offset, packet_info *pinfo,
             dcerpc_bind_value *value;
 
             key = se_alloc(sizeof (dcerpc_bind_key));
-            key->conv = conv;
+            key->conv_index = conv->index;
             key->ctx_id = ctx_id;
             key->smb_fid = dcerpc_get_transport_salt(pinfo);
 
@@ -3402,7 +3407,7 @@ dcerpc_add_conv_to_bind_table(decode_dcerpc_bind_values_t *binding)
     bind_value->transport = uuid_data_repr_proto;
 
     key = se_alloc(sizeof (dcerpc_bind_key));
-    key->conv = conv;
+    key->conv_index = conv->index;
     key->ctx_id = binding->ctx_id;
     key->smb_fid = binding->smb_fid;
 
@@ -3482,7 +3487,7 @@ dissect_dcerpc_cn_rqst(tvbuff_t *tvb, gint offset, packet_info *pinfo,
             dcerpc_bind_key bind_key;
             dcerpc_bind_value *bind_value;
 
-            bind_key.conv = conv;
+            bind_key.conv_index = conv->index;
             bind_key.ctx_id = ctx_id;
             bind_key.smb_fid = dcerpc_get_transport_salt(pinfo);
 
@@ -3491,7 +3496,7 @@ dissect_dcerpc_cn_rqst(tvbuff_t *tvb, gint offset, packet_info *pinfo,
                     dcerpc_cn_call_key call_key;
                     dcerpc_call_value *call_value;
 
-                    call_key.conv = conv;
+                    call_key.conv_index = conv->index;
                     call_key.call_id = hdr->call_id;
                     call_key.smb_fid = dcerpc_get_transport_salt(pinfo);
                     if ((call_value = g_hash_table_lookup(dcerpc_cn_calls, &call_key))) {
@@ -3510,7 +3515,7 @@ dissect_dcerpc_cn_rqst(tvbuff_t *tvb, gint offset, packet_info *pinfo,
                        matched table
                     */
                     call_key = se_alloc(sizeof (dcerpc_cn_call_key));
-                    call_key->conv = conv;
+                    call_key->conv_index = conv->index;
                     call_key->call_id = hdr->call_id;
                     call_key->smb_fid = dcerpc_get_transport_salt(pinfo);
 
@@ -3647,7 +3652,7 @@ dissect_dcerpc_cn_resp(tvbuff_t *tvb, gint offset, packet_info *pinfo,
             dcerpc_cn_call_key call_key;
             dcerpc_call_value *call_value;
 
-            call_key.conv = conv;
+            call_key.conv_index = conv->index;
             call_key.call_id = hdr->call_id;
             call_key.smb_fid = dcerpc_get_transport_salt(pinfo);
 
@@ -3798,7 +3803,7 @@ dissect_dcerpc_cn_fault(tvbuff_t *tvb, gint offset, packet_info *pinfo,
             dcerpc_cn_call_key call_key;
             dcerpc_call_value *call_value;
 
-            call_key.conv = conv;
+            call_key.conv_index = conv->index;
             call_key.call_id = hdr->call_id;
             call_key.smb_fid = dcerpc_get_transport_salt(pinfo);
 
@@ -4972,7 +4977,7 @@ dissect_dcerpc_dg_rqst(tvbuff_t *tvb, int offset, packet_info *pinfo,
         dcerpc_dg_call_key *call_key;
 
         call_key = se_alloc(sizeof (dcerpc_dg_call_key));
-        call_key->conv = conv;
+        call_key->conv_index = conv->index;
         call_key->seqnum = hdr->seqnum;
         call_key->act_id = hdr->act_id;
 
@@ -5049,7 +5054,7 @@ dissect_dcerpc_dg_resp(tvbuff_t *tvb, int offset, packet_info *pinfo,
         dcerpc_call_value *call_value;
         dcerpc_dg_call_key call_key;
 
-        call_key.conv = conv;
+        call_key.conv_index = conv->index;
         call_key.seqnum = hdr->seqnum;
         call_key.act_id = hdr->act_id;
 
@@ -5116,7 +5121,7 @@ dissect_dcerpc_dg_ping_ack(tvbuff_t *tvb, int offset, packet_info *pinfo,
     dcerpc_call_value  *call_value;
     dcerpc_dg_call_key  call_key;
 
-    call_key.conv = conv;
+    call_key.conv_index = conv->index;
     call_key.seqnum = hdr->seqnum;
     call_key.act_id = hdr->act_id;
 
@@ -129,6 +129,7 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 	proto_tree  *comments_tree;
 	proto_item  *item;
 	const gchar *cap_plurality, *frame_plurality;
+	const gchar *comment;
 
 	tree=parent_tree;
 
@@ -186,14 +187,15 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 		}
 	}
 
-	if(pinfo->fd->opt_comment){
+	comment = frame_data_get_comment(pinfo->fd);
+	if(comment){
 		item = proto_tree_add_item(tree, proto_pkt_comment, tvb, 0, -1, ENC_NA);
 		comments_tree = proto_item_add_subtree(item, ett_comments);
 		comment_item = proto_tree_add_string_format(comments_tree, hf_comments_text, tvb, 0, -1,
-							                   pinfo->fd->opt_comment, "%s",
-							                   pinfo->fd->opt_comment);
+							                   comment, "%s",
+							                   comment);
 		expert_add_info_format(pinfo, comment_item, PI_COMMENTS_GROUP, PI_COMMENT,
-					                       "%s",  pinfo->fd->opt_comment);
+					                       "%s",  comment);
 
 
 	}
@@ -242,6 +244,8 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 		proto_tree_add_int(fh_tree, hf_frame_wtap_encap, tvb, 0, 0, pinfo->fd->lnk_t);
 
 		if (pinfo->fd->flags.has_ts) {
+			nstime_t shift_offset, del_cap_ts, del_dis_ts;
+
 			proto_tree_add_time(fh_tree, hf_frame_arrival_time, tvb,
 					    0, 0, &(pinfo->fd->abs_ts));
 			if(pinfo->fd->abs_ts.nsecs < 0 || pinfo->fd->abs_ts.nsecs >= 1000000000) {
@@ -253,8 +257,9 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 				expert_add_info_format(pinfo, item, PI_MALFORMED, PI_WARN,
 						       "Arrival Time: Fractional second out of range (0-1000000000)");
 			}
+			frame_data_get_shift_offset(pinfo->fd, &shift_offset);
 			item = proto_tree_add_time(fh_tree, hf_frame_shift_offset, tvb,
-					    0, 0, &(pinfo->fd->shift_offset));
+					    0, 0, &shift_offset);
 			PROTO_ITEM_SET_GENERATED(item);
 
 			if(generate_epoch_time) {
@@ -262,16 +267,18 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree)
 						    0, 0, &(pinfo->fd->abs_ts));
 			}
 
+			frame_delta_abs_time(pinfo->fd, pinfo->fd->num - 1, &del_cap_ts);
 			item = proto_tree_add_time(fh_tree, hf_frame_time_delta, tvb,
-						   0, 0, &(pinfo->fd->del_cap_ts));
+						   0, 0, &del_cap_ts);
 			PROTO_ITEM_SET_GENERATED(item);
 
+			frame_delta_abs_time(pinfo->fd, pinfo->fd->prev_dis_num, &del_dis_ts);
 			item = proto_tree_add_time(fh_tree, hf_frame_time_delta_displayed, tvb,
-						   0, 0, &(pinfo->fd->del_dis_ts));
+						   0, 0, &del_dis_ts);
 			PROTO_ITEM_SET_GENERATED(item);
 
 			item = proto_tree_add_time(fh_tree, hf_frame_time_relative, tvb,
-						   0, 0, &(pinfo->fd->rel_ts));
+						   0, 0, &(pinfo->rel_ts));
 			PROTO_ITEM_SET_GENERATED(item);
 
 			if(pinfo->fd->flags.ref_time){
@@ -443,28 +443,42 @@ process_tcp_payload(tvbuff_t *tvb, volatile int offset, packet_info *pinfo,
     struct tcp_analysis *tcpd);
 
 
+/* With conversation aging, the state of a conversation is freed when it's
+   aged out (see tcp_conversation_evicted()) rather than at the end of the
+   file, so it's g_malloc()ed, not se_ allocated. */
+static emem_tree_t *
+tcp_conversation_tree_create(const char *name)
+{
+    if (conversation_aging_enabled())
+        return pe_tree_create(EMEM_TREE_TYPE_RED_BLACK, name);
+    return se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, name);
+}
+
 struct tcp_analysis *
 init_tcp_conversation_data(packet_info *pinfo)
 {
     struct tcp_analysis *tcpd;
 
     /* Initialize the tcp protocol data structure to add to the tcp conversation */
-    tcpd=se_alloc0(sizeof(struct tcp_analysis));
+    if (conversation_aging_enabled())
+        tcpd=g_malloc0(sizeof(struct tcp_analysis));
+    else
+        tcpd=se_alloc0(sizeof(struct tcp_analysis));
     tcpd->flow1.win_scale=-1;
     tcpd->flow1.window = G_MAXUINT32;
-    tcpd->flow1.multisegment_pdus=se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, "tcp_multisegment_pdus");
+    tcpd->flow1.multisegment_pdus=tcp_conversation_tree_create("tcp_multisegment_pdus");
     /*
     tcpd->flow1.username = NULL;
     tcpd->flow1.command = NULL;
     */
     tcpd->flow2.window = G_MAXUINT32;
     tcpd->flow2.win_scale=-1;
-    tcpd->flow2.multisegment_pdus=se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, "tcp_multisegment_pdus");
+    tcpd->flow2.multisegment_pdus=tcp_conversation_tree_create("tcp_multisegment_pdus");
     /*
     tcpd->flow2.username = NULL;
     tcpd->flow2.command = NULL;
     */
-    tcpd->acked_table=se_tree_create_non_persistent(EMEM_TREE_TYPE_RED_BLACK, "tcp_analyze_acked_table");
+    tcpd->acked_table=tcp_conversation_tree_create("tcp_analyze_acked_table");
     tcpd->ts_first.secs=pinfo->fd->abs_ts.secs;
     tcpd->ts_first.nsecs=pinfo->fd->abs_ts.nsecs;
     tcpd->ts_prev.secs=pinfo->fd->abs_ts.secs;
@@ -551,8 +565,13 @@ add_tcp_process_info(guint32 frame_num, address *local_addr, address *remote_add
 
     flow->process_uid = uid;
     flow->process_pid = pid;
-    flow->username = se_strdup(username);
-    flow->command = se_strdup(command);
+    if (conversation_aging_enabled()) {
+        flow->username = g_strdup(username);
+        flow->command = g_strdup(command);
+    } else {
+        flow->username = se_strdup(username);
+        flow->command = se_strdup(command);
+    }
 }
 
 
@@ -707,7 +726,8 @@ pdu_store_sequencenumber_of_next_pdu(packet_info *pinfo, guint32 seq, guint32 nx
 {
     struct tcp_multisegment_pdu *msp;
 
-    msp=se_alloc(sizeof(struct tcp_multisegment_pdu));
+    /* It lives as long as the tree it's in, which isn't always ours. */
+    msp=multisegment_pdus->malloc(sizeof(struct tcp_multisegment_pdu));
     msp->nxtpdu=nxtpdu;
     msp->seq=seq;
     msp->first_frame=pinfo->fd->num;
@@ -774,7 +794,10 @@ tcp_analyze_get_acked_struct(guint32 frame, guint32 seq, guint32 ack, gboolean c
 
     tcpd->ta = se_tree_lookup32_array(tcpd->acked_table, key);
     if((!tcpd->ta) && createflag){
-        tcpd->ta = se_alloc0(sizeof(struct tcp_acked));
+        if (conversation_aging_enabled())
+            tcpd->ta = g_malloc0(sizeof(struct tcp_acked));
+        else
+            tcpd->ta = se_alloc0(sizeof(struct tcp_acked));
         se_tree_insert32_array(tcpd->acked_table, key, (void *)tcpd->ta);
     }
 }
@@ -4618,6 +4641,12 @@ dissect_tcp(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
     length_remaining = tvb_length_remaining(tvb, offset);
 
     if (tcph->th_have_seglen) {
+        if (!pinfo->fd->flags.visited) {
+            /* Remember where the stream's segments are, so that it can be
+               followed without going through the whole capture. */
+            follow_tcp_index_segment(tcpd->stream, pinfo->fd->num,
+                                     tcph->th_seq, tcph->th_seglen);
+        }
         if( data_out_file ) {
             reassemble_tcp( tcpd->stream,                         /* tcp stream index */
                             tcph->th_seq,                         /* sequence number */
@@ -4760,6 +4789,55 @@ tcp_init(void)
 {
     tcp_stream_index = 0;
     fragment_table_init(&tcp_fragment_table);
+    follow_tcp_index_reset();
+}
+
+/* Free the segments of a PDU of an aged-out conversation that never got
+   completed.  We don't know which direction it was in, so try both. */
+static gboolean
+tcp_msp_free_fragments(void *data, void *user_data)
+{
+    struct tcp_multisegment_pdu *msp = (struct tcp_multisegment_pdu *)data;
+    conversation_t *conv = (conversation_t *)user_data;
+    packet_info pinfo;
+
+    memset(&pinfo, 0, sizeof pinfo);
+    pinfo.src = conv->key_ptr->addr1;
+    pinfo.dst = conv->key_ptr->addr2;
+    g_free(fragment_delete(&pinfo, msp->first_frame, tcp_fragment_table));
+    pinfo.src = conv->key_ptr->addr2;
+    pinfo.dst = conv->key_ptr->addr1;
+    g_free(fragment_delete(&pinfo, msp->first_frame, tcp_fragment_table));
+    return FALSE;
+}
+
+static gboolean
+tcp_free_tree_data(void *data, void *user_data _U_)
+{
+    g_free(data);
+    return FALSE;
+}
+
+/* Free the reassembly state of an aged-out conversation, and the state
+   init_tcp_conversation_data() and friends g_malloc()ed for it. */
+static void
+tcp_conversation_evicted(conversation_t *conv, void *proto_data)
+{
+    struct tcp_analysis *tcpd = (struct tcp_analysis *)proto_data;
+
+    pe_tree_foreach(tcpd->flow1.multisegment_pdus, tcp_msp_free_fragments, conv);
+    pe_tree_foreach(tcpd->flow2.multisegment_pdus, tcp_msp_free_fragments, conv);
+    pe_tree_foreach(tcpd->flow1.multisegment_pdus, tcp_free_tree_data, NULL);
+    pe_tree_foreach(tcpd->flow2.multisegment_pdus, tcp_free_tree_data, NULL);
+    pe_tree_foreach(tcpd->acked_table, tcp_free_tree_data, NULL);
+    pe_tree_free(tcpd->flow1.multisegment_pdus);
+    pe_tree_free(tcpd->flow2.multisegment_pdus);
+    pe_tree_free(tcpd->acked_table);
+    g_free(tcpd->flow1.username);
+    g_free(tcpd->flow1.command);
+    g_free(tcpd->flow2.username);
+    g_free(tcpd->flow2.command);
+    g_free(tcpd);
 }
 
 void
@@ -5607,6 +5685,7 @@ proto_register_tcp(void)
         &tcp_no_subdissector_on_error);
 
     register_init_routine(tcp_init);
+    conversation_register_evict_callback(proto_tcp, tcp_conversation_evicted);
 }
 
 void
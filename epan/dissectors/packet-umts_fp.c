@@ -603,7 +603,7 @@ dissect_tb_data(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
         }
 
         /* Show TBs from non-empty channels */
-        pinfo->fd->subnum = chan; /* set subframe number to current TB */
+        pinfo->subnum = chan; /* set subframe number to current TB */
         for (n=0; n < p_fp_info->chan_num_tbs[chan]; n++) {
             proto_item *ti;
             if (data_tree) {
@@ -698,7 +698,7 @@ dissect_macd_pdu_data(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 
         /* Data bytes! */
         if (data_tree) {
-            pinfo->fd->subnum = pdu; /* set subframe number to current TB */
+            pinfo->subnum = pdu; /* set subframe number to current TB */
             pdu_ti = proto_tree_add_item(data_tree, hf_fp_mac_d_pdu, tvb,
                                          offset + (bit_offset/8),
                                          ((bit_offset % 8) + length + 7) / 8,
@@ -2561,7 +2561,7 @@ dissect_e_dch_channel_info(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
 
                     if (preferences_call_mac_dissectors) {
                         tvbuff_t *next_tvb;
-                        pinfo->fd->subnum = macd_idx; /* set subframe number to current TB */
+                        pinfo->subnum = macd_idx; /* set subframe number to current TB */
                         /* create new TVB and pass further on */
                         next_tvb = tvb_new_subset(tvb, offset + bit_offset/8,
                                 ((bit_offset % 8) + size + 7) / 8, -1);
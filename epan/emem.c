@@ -154,8 +154,50 @@ typedef struct _emem_header_t {
 
 } emem_header_t;
 
-static emem_header_t ep_packet_mem;
-static emem_header_t se_packet_mem;
+/*
+ * An arena holds a packet-lifetime (ep) pool and a capture-lifetime (se)
+ * pool.  The ep_ and se_ functions allocate from the arena that's current
+ * for the calling thread, which is the default arena unless the thread
+ * has made another one current with emem_arena_set_current().
+ */
+struct _emem_arena_t {
+	emem_header_t ep_mem;
+	emem_header_t se_mem;
+};
+
+static emem_arena_t default_arena;
+
+/*
+ * Set once some thread has made an arena other than the default arena
+ * current; until then there's no need to look up the calling thread's
+ * arena, which keeps allocation as cheap as it was before arenas.
+ */
+static volatile gboolean emem_arenas_in_use = FALSE;
+
+#if GLIB_CHECK_VERSION(2,32,0)
+static GPrivate current_arena_key = G_PRIVATE_INIT(NULL);
+#define CURRENT_ARENA_GET()	((emem_arena_t *) g_private_get(&current_arena_key))
+#define CURRENT_ARENA_SET(arena)	g_private_set(&current_arena_key, (arena))
+#else
+static GStaticPrivate current_arena_key = G_STATIC_PRIVATE_INIT;
+#define CURRENT_ARENA_GET()	((emem_arena_t *) g_static_private_get(&current_arena_key))
+#define CURRENT_ARENA_SET(arena)	g_static_private_set(&current_arena_key, (arena), NULL)
+#endif
+
+/* Protects the canary random number generator used when creating arenas */
+G_LOCK_DEFINE_STATIC(emem_arena_create);
+
+static emem_arena_t *
+emem_current_arena(void)
+{
+	emem_arena_t *arena;
+
+	if (G_LIKELY(!emem_arenas_in_use))
+		return &default_arena;
+
+	arena = CURRENT_ARENA_GET();
+	return (arena != NULL) ? arena : &default_arena;
+}
 
 /*
  *  Memory scrubbing is expensive but can be useful to ensure we don't:
@@ -254,6 +296,7 @@ ep_check_canary_integrity(const char* fmt, ...)
 		0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0 };
 	gchar here[128];
 	emem_chunk_t* npc = NULL;
+	emem_header_t *mem = &emem_current_arena()->ep_mem;
 
 	if (! intense_canary_checking ) return;
 
@@ -261,11 +304,11 @@ ep_check_canary_integrity(const char* fmt, ...)
 	g_vsnprintf(here, sizeof(here), fmt, ap);
 	va_end(ap);
 
-	for (npc = ep_packet_mem.free_list; npc != NULL; npc = npc->next) {
+	for (npc = mem->free_list; npc != NULL; npc = npc->next) {
 		void *canary_next = npc->canary_last;
 
 		while (canary_next != NULL) {
-			canary_next = emem_canary_next(ep_packet_mem.canary, canary_next, NULL);
+			canary_next = emem_canary_next(mem->canary, canary_next, NULL);
 			/* XXX, check if canary_next is inside allocated memory? */
 
 			if (canary_next == (void *) -1)
@@ -290,44 +333,36 @@ emem_init_chunk(emem_header_t *mem)
 }
 
 
-/* Initialize the packet-lifetime memory allocation pool.
- * This function should be called only once when Wireshark or TShark starts
- * up.
+/* Initialize a packet-lifetime memory allocation pool.
  */
 static void
-ep_init_chunk(void)
+ep_init_chunk(emem_header_t *mem)
 {
-	ep_packet_mem.free_list=NULL;
-	ep_packet_mem.used_list=NULL;
-	ep_packet_mem.trees=NULL;	/* not used by this allocator */
-
-	ep_packet_mem.debug_use_chunks = (getenv("WIRESHARK_DEBUG_EP_NO_CHUNKS") == NULL);
-	ep_packet_mem.debug_use_canary = ep_packet_mem.debug_use_chunks && (getenv("WIRESHARK_DEBUG_EP_NO_CANARY") == NULL);
-	ep_packet_mem.debug_verify_pointers = (getenv("WIRESHARK_EP_VERIFY_POINTERS") != NULL);
+	mem->free_list=NULL;
+	mem->used_list=NULL;
+	mem->trees=NULL;	/* not used by this allocator */
 
-#ifdef DEBUG_INTENSE_CANARY_CHECKS
-	intense_canary_checking = (getenv("WIRESHARK_DEBUG_EP_INTENSE_CANARY") != NULL);
-#endif
+	mem->debug_use_chunks = (getenv("WIRESHARK_DEBUG_EP_NO_CHUNKS") == NULL);
+	mem->debug_use_canary = mem->debug_use_chunks && (getenv("WIRESHARK_DEBUG_EP_NO_CANARY") == NULL);
+	mem->debug_verify_pointers = (getenv("WIRESHARK_EP_VERIFY_POINTERS") != NULL);
 
-	emem_init_chunk(&ep_packet_mem);
+	emem_init_chunk(mem);
 }
 
-/* Initialize the capture-lifetime memory allocation pool.
- * This function should be called only once when Wireshark or TShark starts
- * up.
+/* Initialize a capture-lifetime memory allocation pool.
  */
 static void
-se_init_chunk(void)
+se_init_chunk(emem_header_t *mem)
 {
-	se_packet_mem.free_list = NULL;
-	se_packet_mem.used_list = NULL;
-	se_packet_mem.trees = NULL;
+	mem->free_list = NULL;
+	mem->used_list = NULL;
+	mem->trees = NULL;
 
-	se_packet_mem.debug_use_chunks = (getenv("WIRESHARK_DEBUG_SE_NO_CHUNKS") == NULL);
-	se_packet_mem.debug_use_canary = se_packet_mem.debug_use_chunks && (getenv("WIRESHARK_DEBUG_SE_USE_CANARY") != NULL);
-	se_packet_mem.debug_verify_pointers = (getenv("WIRESHARK_SE_VERIFY_POINTERS") != NULL);
+	mem->debug_use_chunks = (getenv("WIRESHARK_DEBUG_SE_NO_CHUNKS") == NULL);
+	mem->debug_use_canary = mem->debug_use_chunks && (getenv("WIRESHARK_DEBUG_SE_USE_CANARY") != NULL);
+	mem->debug_verify_pointers = (getenv("WIRESHARK_SE_VERIFY_POINTERS") != NULL);
 
-	emem_init_chunk(&se_packet_mem);
+	emem_init_chunk(mem);
 }
 
 /*  Initialize all the allocators here.
@@ -337,8 +372,12 @@ se_init_chunk(void)
 void
 emem_init(void)
 {
-	ep_init_chunk();
-	se_init_chunk();
+	ep_init_chunk(&default_arena.ep_mem);
+	se_init_chunk(&default_arena.se_mem);
+
+#ifdef DEBUG_INTENSE_CANARY_CHECKS
+	intense_canary_checking = (getenv("WIRESHARK_DEBUG_EP_INTENSE_CANARY") != NULL);
+#endif
 
 	if (getenv("WIRESHARK_DEBUG_SCRUB_MEMORY"))
 		debug_use_memory_scrubber  = TRUE;
@@ -390,21 +429,21 @@ print_alloc_stats()
 
 	fprintf(stderr, "\n-------- EP allocator statistics --------\n");
 	fprintf(stderr, "%s chunks, %s canaries, %s memory scrubber\n",
-	       ep_packet_mem.debug_use_chunks ? "Using" : "Not using",
-	       ep_packet_mem.debug_use_canary ? "using" : "not using",
+	       default_arena.ep_mem.debug_use_chunks ? "Using" : "Not using",
+	       default_arena.ep_mem.debug_use_canary ? "using" : "not using",
 	       debug_use_memory_scrubber ? "using" : "not using");
 
-	if (! (ep_packet_mem.free_list || !ep_packet_mem.used_list)) {
+	if (! (default_arena.ep_mem.free_list || !default_arena.ep_mem.used_list)) {
 		fprintf(stderr, "No memory allocated\n");
 		ep_stat = FALSE;
 	}
-	if (ep_packet_mem.debug_use_chunks && ep_stat) {
+	if (default_arena.ep_mem.debug_use_chunks && ep_stat) {
 		/* Nothing interesting without chunks */
 		/*  Only look at the used_list since those chunks are fully
 		 *  used.  Looking at the free list would skew our view of what
 		 *  we have wasted.
 		 */
-		for (chunk = ep_packet_mem.used_list; chunk; chunk = chunk->next) {
+		for (chunk = default_arena.ep_mem.used_list; chunk; chunk = chunk->next) {
 			num_chunks++;
 			total_used += (chunk->amount_free_init - chunk->amount_free);
 			total_allocation += chunk->amount_free_init;
@@ -440,32 +479,32 @@ print_alloc_stats()
 	fprintf(stderr, "Total number of chunk allocations %u\n",
 		total_no_chunks);
 	fprintf(stderr, "%s chunks, %s canaries\n",
-	       se_packet_mem.debug_use_chunks ? "Using" : "Not using",
-	       se_packet_mem.debug_use_canary ? "using" : "not using");
+	       default_arena.se_mem.debug_use_chunks ? "Using" : "Not using",
+	       default_arena.se_mem.debug_use_canary ? "using" : "not using");
 
-	if (! (se_packet_mem.free_list || !se_packet_mem.used_list)) {
+	if (! (default_arena.se_mem.free_list || !default_arena.se_mem.used_list)) {
 		fprintf(stderr, "No memory allocated\n");
 		return;
 	}
 
-	if (!se_packet_mem.debug_use_chunks )
+	if (!default_arena.se_mem.debug_use_chunks )
 		return; /* Nothing interesting without chunks?? */
 
 	/*  Only look at the used_list since those chunks are fully used.
 	 *  Looking at the free list would skew our view of what we have wasted.
 	 */
-	for (chunk = se_packet_mem.used_list; chunk; chunk = chunk->next) {
+	for (chunk = default_arena.se_mem.used_list; chunk; chunk = chunk->next) {
 		num_chunks++;
 		total_used += (chunk->amount_free_init - chunk->amount_free);
 		total_allocation += chunk->amount_free_init;
 		total_free += chunk->amount_free;
 
-		if (se_packet_mem.debug_use_canary){
+		if (default_arena.se_mem.debug_use_canary){
 			void *ptr = chunk->canary_last;
 			int len;
 
 			while (ptr != NULL) {
-				ptr = emem_canary_next(se_packet_mem.canary, ptr, &len);
+				ptr = emem_canary_next(default_arena.se_mem.canary, ptr, &len);
 
 				if (ptr == (void *) -1)
 					g_error("Memory corrupted");
@@ -561,8 +600,10 @@ emem_verify_pointer(const emem_header_t *hdr, const void *ptr)
 gboolean
 ep_verify_pointer(const void *ptr)
 {
-	if (ep_packet_mem.debug_verify_pointers)
-		return emem_verify_pointer(&ep_packet_mem, ptr);
+	emem_header_t *mem = &emem_current_arena()->ep_mem;
+
+	if (mem->debug_verify_pointers)
+		return emem_verify_pointer(mem, ptr);
 	else
 		return FALSE;
 }
@@ -570,8 +611,10 @@ ep_verify_pointer(const void *ptr)
 gboolean
 se_verify_pointer(const void *ptr)
 {
-	if (se_packet_mem.debug_verify_pointers)
-		return emem_verify_pointer(&se_packet_mem, ptr);
+	emem_header_t *mem = &emem_current_arena()->se_mem;
+
+	if (mem->debug_verify_pointers)
+		return emem_verify_pointer(mem, ptr);
 	else
 		return FALSE;
 }
@@ -688,6 +731,23 @@ emem_destroy_chunk(emem_chunk_t *npc)
 	g_free(npc);
 }
 
+/* Free a chunk created by emem_create_chunk_gp(), guard pages and all. */
+static void
+emem_destroy_chunk_gp(emem_chunk_t *npc)
+{
+#if defined (_WIN32)
+	VirtualFree(npc->buf, 0, MEM_RELEASE);
+#elif defined(USE_GUARD_PAGES)
+	munmap(npc->buf, EMEM_PACKET_CHUNK_SIZE);
+#else
+	g_free(npc->buf);
+#endif
+#ifdef SHOW_EMEM_STATS
+	total_no_chunks--;
+#endif
+	g_free(npc);
+}
+
 static emem_chunk_t *
 emem_create_chunk_gp(size_t size)
 {
@@ -766,7 +826,7 @@ emem_alloc_chunk(size_t size, emem_header_t *mem)
 
 #ifdef SHOW_EMEM_STATS
 	/* Do this check here so we can include the canary size */
-	if (mem == &se_packet_mem) {
+	if (mem == &default_arena.se_mem) {
 		if (asize < 32)
 			allocations[0]++;
 		else if (asize < 64)
@@ -870,7 +930,7 @@ emem_alloc(size_t size, emem_header_t *mem)
 void *
 ep_alloc(size_t size)
 {
-	return emem_alloc(size, &ep_packet_mem);
+	return emem_alloc(size, &emem_current_arena()->ep_mem);
 }
 
 /* allocate 'size' amount of memory with an allocation lifetime until the
@@ -879,7 +939,7 @@ ep_alloc(size_t size)
 void *
 se_alloc(size_t size)
 {
-	return emem_alloc(size, &se_packet_mem);
+	return emem_alloc(size, &emem_current_arena()->se_mem);
 }
 
 void *
@@ -1247,7 +1307,7 @@ emem_free_all(emem_header_t *mem)
 void
 ep_free_all(void)
 {
-	emem_free_all(&ep_packet_mem);
+	emem_free_all(&emem_current_arena()->ep_mem);
 }
 
 /* release all allocated memory back to the pool. */
@@ -1258,7 +1318,78 @@ se_free_all(void)
 	print_alloc_stats();
 #endif
 
-	emem_free_all(&se_packet_mem);
+	emem_free_all(&emem_current_arena()->se_mem);
+}
+
+/* Create an arena with its own, empty, ep and se pools, set up for the
+ * same debugging options as the default arena. */
+emem_arena_t *
+emem_arena_new(void)
+{
+	emem_arena_t *arena;
+
+	arena = g_new(emem_arena_t, 1);
+
+	G_LOCK(emem_arena_create);
+	ep_init_chunk(&arena->ep_mem);
+	se_init_chunk(&arena->se_mem);
+	G_UNLOCK(emem_arena_create);
+
+	return arena;
+}
+
+/* Return all the memory of a pool to the OS. */
+static void
+emem_destroy_header(emem_header_t *mem)
+{
+	emem_chunk_t *npc;
+	emem_tree_t *tree_list;
+
+	/* Check the canaries and scrub the memory, as for any other release */
+	emem_free_all(mem);
+
+	while (mem->free_list) {
+		npc = mem->free_list;
+		mem->free_list = npc->next;
+		emem_destroy_chunk_gp(npc);
+	}
+
+	while (mem->trees) {
+		tree_list = mem->trees;
+		mem->trees = tree_list->next;
+		g_free(tree_list);
+	}
+}
+
+/* Free an arena and everything allocated from it.  It must not be current
+ * for any thread. */
+void
+emem_arena_destroy(emem_arena_t *arena)
+{
+	g_assert(arena != &default_arena);
+
+	emem_destroy_header(&arena->ep_mem);
+	emem_destroy_header(&arena->se_mem);
+	g_free(arena);
+}
+
+/* Make an arena current for the calling thread; NULL makes the default
+ * arena current again.  Returns the arena that was current before, or NULL
+ * if that was the default arena. */
+emem_arena_t *
+emem_arena_set_current(emem_arena_t *arena)
+{
+	emem_arena_t *prev_arena = NULL;
+
+	if (emem_arenas_in_use)
+		prev_arena = CURRENT_ARENA_GET();
+	else if (arena == NULL)
+		return NULL;
+
+	emem_arenas_in_use = TRUE;
+	CURRENT_ARENA_SET(arena);
+
+	return prev_arena;
 }
 
 void
@@ -1325,13 +1456,15 @@ se_tree_create(int type, const char *name)
 {
 	emem_tree_t *tree_list;
 
+	emem_header_t *mem = &emem_current_arena()->se_mem;
+
 	tree_list=g_malloc(sizeof(emem_tree_t));
-	tree_list->next=se_packet_mem.trees;
+	tree_list->next=mem->trees;
 	tree_list->type=type;
 	tree_list->tree=NULL;
 	tree_list->name=name;
 	tree_list->malloc=se_alloc;
-	se_packet_mem.trees=tree_list;
+	mem->trees=tree_list;
 
 	return tree_list;
 }
@@ -1818,6 +1951,30 @@ pe_tree_create(int type, const char *name)
 	return tree_list;
 }
 
+static void
+pe_tree_free_nodes(emem_tree_node_t *node)
+{
+	if (!node)
+		return;
+
+	pe_tree_free_nodes(node->left);
+	pe_tree_free_nodes(node->right);
+	if (node->u.is_subtree == EMEM_TREE_NODE_IS_SUBTREE)
+		pe_tree_free(node->data);
+	g_free(node);
+}
+
+void
+pe_tree_free(emem_tree_t *tree)
+{
+	if (!tree)
+		return;
+
+	g_assert(tree->malloc == (void *(*)(size_t)) g_malloc);
+	pe_tree_free_nodes(tree->tree);
+	g_free(tree);
+}
+
 /* create another (sub)tree using the same memory allocation scope
  * as the parent tree.
  */
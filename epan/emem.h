@@ -161,6 +161,30 @@ gchar* se_strdup_printf(const gchar* fmt, ...)
 /** release all memory allocated */
 void se_free_all(void);
 
+/**************************************************************
+ * arenas
+ **************************************************************/
+/* An arena is a private pair of packet and capture lifetime pools.  All the
+ * ep_ and se_ functions above, including ep_free_all() and se_free_all(),
+ * operate on the arena that's current for the calling thread; a thread that
+ * never makes an arena current uses the default arena set up by emem_init().
+ * This lets several threads dissect independently without sharing pools.
+ */
+typedef struct _emem_arena_t emem_arena_t;
+
+/** Create a new, empty, arena */
+emem_arena_t *emem_arena_new(void);
+
+/** Free an arena and all memory allocated from it, including the se trees
+ * that were created while it was current.  The arena must not be current
+ * for any thread. */
+void emem_arena_destroy(emem_arena_t *arena);
+
+/** Make an arena current for the calling thread, or make the default
+ * arena current again if arena is NULL.  Returns the arena that was
+ * current before, NULL meaning the default arena. */
+emem_arena_t *emem_arena_set_current(emem_arena_t *arena);
+
 /**************************************************************
  * slab allocator
  **************************************************************/
@@ -314,6 +338,12 @@ emem_tree_t *pe_tree_create(int type, const char *name) G_GNUC_MALLOC;
 #define pe_tree_lookup_string emem_tree_lookup_string
 #define pe_tree_foreach emem_tree_foreach
 
+/** Free a tree made by pe_tree_create(), and its subtrees, for a
+ * protocol that drops its state before the program exits.  The data in
+ * it isn't freed; free that with pe_tree_foreach() first if need be.
+ */
+void pe_tree_free(emem_tree_t *tree);
+
 
 
 /* ******************************************************************
@@ -246,6 +246,12 @@ epan_dissect_prime_dfilter(epan_dissect_t *edt, const dfilter_t* dfcode)
     dfilter_prime_proto_tree(dfcode, edt->tree);
 }
 
+void
+epan_dissect_prune_dfilter(epan_dissect_t *edt, const dfilter_t* dfcode)
+{
+    dfilter_prune_proto_tree(dfcode, edt->tree);
+}
+
 /* ----------------------- */
 const gchar *
 epan_custom_set(epan_dissect_t *edt, int field_id,
@@ -158,6 +158,13 @@ epan_dissect_run(epan_dissect_t *edt, void* pseudo_header,
 void
 epan_dissect_prime_dfilter(epan_dissect_t *edt, const dfilter_t *dfcode);
 
+/** Prime a proto_tree using the fields/protocols used in a dfilter, and
+ *  skip the dissectors of other protocols once those used in the dfilter
+ *  have been dissected. Only for dissections done just to apply dfcode:
+ *  the tree, columns and taps will lack everything else. */
+void
+epan_dissect_prune_dfilter(epan_dissect_t *edt, const dfilter_t *dfcode);
+
 /** fill the dissect run output into the packet list columns */
 void
 epan_dissect_fill_in_columns(epan_dissect_t *edt, const gboolean fill_col_exprs, const gboolean fill_fd_colums);
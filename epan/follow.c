@@ -49,7 +49,6 @@ typedef struct _tcp_frag {
   gulong              len;
   gulong              data_len;
   gchar              *data;
-  struct _tcp_frag   *next;
 } tcp_frag;
 
 FILE* data_out_file = NULL;
@@ -58,11 +57,15 @@ gboolean empty_tcp_stream;
 gboolean incomplete_tcp_stream;
 
 static guint32 tcp_stream_to_follow;
+static gboolean find_tcp_addr;
+static gboolean find_tcp_index;
 static guint8  ip_address[2][MAX_IPADDR_LEN];
 static guint   port[2];
 static guint   bytes_written[2];
 static gboolean is_ipv6 = FALSE;
 
+static gint frag_seq_compare( gconstpointer, gconstpointer );
+static void free_frag( gpointer );
 static int check_fragments( int, tcp_stream_chunk *, gulong );
 static void write_packet_data( int, tcp_stream_chunk *, const char * );
 
@@ -79,6 +82,131 @@ follow_stats(follow_stats_t* stats)
 	}
 }
 
+/*
+ * Index of the segments of every TCP stream, built as the frames are
+ * first dissected, so that a stream can be followed by reading just its
+ * frames rather than the whole capture.  It's indexed by tcp.stream; each
+ * entry is a GArray of follow_tcp_segment_t, in frame order.
+ */
+static gboolean   tcp_indexing = FALSE;
+static gboolean   tcp_index_complete = FALSE;
+static GPtrArray *tcp_index = NULL;
+
+void
+follow_tcp_set_indexing(gboolean enable)
+{
+  tcp_indexing = enable;
+  /* It's only complete if it's been kept since the last reset. */
+  if (!enable)
+    tcp_index_complete = FALSE;
+}
+
+void
+follow_tcp_index_reset(void)
+{
+  guint i;
+
+  if (tcp_index != NULL) {
+    for (i = 0; i < tcp_index->len; i++) {
+      if (g_ptr_array_index(tcp_index, i) != NULL)
+        g_array_free((GArray *)g_ptr_array_index(tcp_index, i), TRUE);
+    }
+    g_ptr_array_free(tcp_index, TRUE);
+    tcp_index = NULL;
+  }
+  tcp_index_complete = tcp_indexing;
+}
+
+void
+follow_tcp_index_invalidate(void)
+{
+  tcp_index_complete = FALSE;
+}
+
+void
+follow_tcp_index_segment(guint32 stream, guint32 frame, guint32 sequence,
+                         guint32 length)
+{
+  GArray *segments;
+  follow_tcp_segment_t seg;
+
+  if (!tcp_indexing)
+    return;
+
+  if (tcp_index == NULL)
+    tcp_index = g_ptr_array_new();
+  if (stream >= tcp_index->len)
+    g_ptr_array_set_size(tcp_index, stream + 1);
+  segments = (GArray *)g_ptr_array_index(tcp_index, stream);
+  if (segments == NULL) {
+    segments = g_array_new(FALSE, FALSE, sizeof (follow_tcp_segment_t));
+    g_ptr_array_index(tcp_index, stream) = segments;
+  }
+
+  seg.frame = frame;
+  seg.seq = sequence;
+  seg.len = length;
+  g_array_append_val(segments, seg);
+}
+
+gboolean
+follow_tcp_stream_segments(guint32 stream, const follow_tcp_segment_t **segments,
+                           guint *count)
+{
+  GArray *stream_segments = NULL;
+
+  *segments = NULL;
+  *count = 0;
+  if (!tcp_index_complete)
+    return FALSE;
+  if (tcp_index != NULL && stream < tcp_index->len)
+    stream_segments = (GArray *)g_ptr_array_index(tcp_index, stream);
+  if (stream_segments != NULL) {
+    *segments = (const follow_tcp_segment_t *)stream_segments->data;
+    *count = stream_segments->len;
+  }
+  return TRUE;
+}
+
+static int
+compare_frame_nums(const void *a, const void *b)
+{
+  guint32 frame_a = *(const guint32 *)a;
+  guint32 frame_b = *(const guint32 *)b;
+
+  if (frame_a < frame_b)
+    return -1;
+  return frame_a > frame_b;
+}
+
+gboolean
+follow_tcp_stream_frames(guint32 **frames, guint *nframes)
+{
+  const follow_tcp_segment_t *segments;
+  guint count, i;
+
+  *frames = NULL;
+  *nframes = 0;
+  /* If we're still to learn the stream from its addresses, we don't
+     know which one it is. */
+  if (find_tcp_index ||
+      !follow_tcp_stream_segments(tcp_stream_to_follow, &segments, &count))
+    return FALSE;
+
+  /* The segments are in the order the frames were first dissected,
+     which should be frame order, but make sure, and a frame might have
+     more than one segment of the stream. */
+  *frames = g_new(guint32, count + 1);
+  for (i = 0; i < count; i++)
+    (*frames)[i] = segments[i].frame;
+  qsort(*frames, count, sizeof (guint32), compare_frame_nums);
+  for (i = 0; i < count; i++) {
+    if (*nframes == 0 || (*frames)[*nframes - 1] != (*frames)[i])
+      (*frames)[(*nframes)++] = (*frames)[i];
+  }
+  return TRUE;
+}
+
 /* this will build libpcap filter text that will only
    pass the packets related to the stream. There is a
    chance that two streams could intersect, but not a
@@ -143,9 +271,7 @@ build_follow_filter( packet_info *pi ) {
   return buf;
 }
 
-static gboolean         find_tcp_addr;
 static address          tcp_addr[2];
-static gboolean         find_tcp_index;
 
 /* select a tcp stream to follow via it's address/port pairs */
 gboolean
@@ -203,7 +329,8 @@ follow_tcp_index(guint32 index)
    session. We will try and handle duplicates, TCP fragments, and out
    of order packets in a smart way. */
 
-static tcp_frag *frags[2] = { 0, 0 };
+/* Out of order segments, in sequence number order */
+static GTree *frags[2] = { NULL, NULL };
 static gulong seq[2];
 static guint8 src_addr[2][MAX_IPADDR_LEN];
 static guint src_port[2] = { 0, 0 };
@@ -296,7 +423,7 @@ reassemble_tcp( guint32 tcp_stream, gulong sequence, gulong acknowledgement,
    * frames are not in the capture file, but were actually seen by the 
    * receiving host (Fixes bug 592).
    */
-  if( frags[1-src_index] ) {
+  if( frags[1-src_index] && g_tree_nnodes(frags[1-src_index]) != 0 ) {
     memcpy(sc.src_addr, dstx, len);
     sc.src_port = dstport;
     sc.dlen     = 0;        /* Will be filled in in check_fragments */
@@ -365,108 +492,117 @@ reassemble_tcp( guint32 tcp_stream, gulong sequence, gulong acknowledgement,
   else {
     /* out of order packet */
     if(data_length > 0 && ((glong)(sequence - seq[src_index]) > 0) ) {
-      tmp_frag = (tcp_frag *)g_malloc( sizeof( tcp_frag ) );
-      tmp_frag->data = (gchar *)g_malloc( data_length );
-      tmp_frag->seq = sequence;
-      tmp_frag->len = length;
-      tmp_frag->data_len = data_length;
-      memcpy( tmp_frag->data, data, data_length );
-      if( frags[src_index] ) {
-	tmp_frag->next = frags[src_index];
-      } else {
-	tmp_frag->next = NULL;
+      if( frags[src_index] == NULL ) {
+	frags[src_index] = g_tree_new_full(frag_seq_compare, NULL, NULL,
+					   free_frag);
+      }
+      tmp_frag = (tcp_frag *)g_tree_lookup( frags[src_index],
+					    GUINT_TO_POINTER(sequence) );
+      /* If we already have a segment starting there, keep the longer */
+      if( tmp_frag == NULL || tmp_frag->len < length ) {
+	tmp_frag = (tcp_frag *)g_malloc( sizeof( tcp_frag ) );
+	tmp_frag->data = (gchar *)g_malloc( data_length );
+	tmp_frag->seq = sequence;
+	tmp_frag->len = length;
+	tmp_frag->data_len = data_length;
+	memcpy( tmp_frag->data, data, data_length );
+	g_tree_replace( frags[src_index], GUINT_TO_POINTER(sequence), tmp_frag );
       }
-      frags[src_index] = tmp_frag;
     }
   }
 } /* end reassemble_tcp */
 
-/* here we search through all the frag we have collected to see if
-   one fits */
+/* Sequence numbers wrap, so compare them as offsets from each other */
+static gint
+frag_seq_compare(gconstpointer a, gconstpointer b)
+{
+  gint32 diff = (gint32)(GPOINTER_TO_UINT(a) - GPOINTER_TO_UINT(b));
+
+  return diff < 0 ? -1 : (diff > 0 ? 1 : 0);
+}
+
+static void
+free_frag(gpointer data)
+{
+  tcp_frag *frag = (tcp_frag *)data;
+
+  g_free( frag->data );
+  g_free( frag );
+}
+
+static gboolean
+first_frag(gpointer key _U_, gpointer value, gpointer data)
+{
+  *(tcp_frag **)data = (tcp_frag *)value;
+  return TRUE;  /* stop at the first */
+}
+
+/* here we see whether the lowest frag we have collected fits; if it
+   doesn't, none of them do */
 static int
 check_fragments( int idx, tcp_stream_chunk *sc, gulong acknowledged ) {
-  tcp_frag *prev = NULL;
-  tcp_frag *current;
-  gulong lowest_seq;
+  tcp_frag *current = NULL;
   gchar *dummy_str;
 
-  current = frags[idx];
-  if( current ) {
-    lowest_seq = current->seq;
-    while( current ) {
-      if( (glong)(lowest_seq - current->seq) > 0 ) {
-        lowest_seq = current->seq;
-      }
+  if( frags[idx] == NULL )
+    return 0;
+  g_tree_foreach( frags[idx], first_frag, &current );
+  if( current == NULL )
+    return 0;
 
-      if( current->seq < seq[idx] ) {
-        gulong newseq;
-        /* this sequence number seems dated, but
-           check the end to make sure it has no more
-           info than we have already seen */
-        newseq = current->seq + current->len;
-        if( newseq > seq[idx] ) {
-          gulong new_pos;
-
-          /* this one has more than we have seen. let's get the
-             payload that we have not seen. This happens when 
-             part of this frame has been retransmitted */
-
-          new_pos = seq[idx] - current->seq;
-
-          if ( current->data_len > new_pos ) {
-            sc->dlen = current->data_len - new_pos;
-            write_packet_data( idx, sc, current->data + new_pos );
-          }
-
-          seq[idx] += (current->len - new_pos);
-        } 
-
-        /* Remove the fragment from the list as the "new" part of it
-         * has been processed or its data has been seen already in 
-         * another packet. */
-        if( prev ) {
-          prev->next = current->next;
-        } else {
-          frags[idx] = current->next;
-        }
-        g_free( current->data );
-        g_free( current );
-        return 1;
-      }
+  if( current->seq < seq[idx] ) {
+    gulong newseq;
+    /* this sequence number seems dated, but
+       check the end to make sure it has no more
+       info than we have already seen */
+    newseq = current->seq + current->len;
+    if( newseq > seq[idx] ) {
+      gulong new_pos;
+
+      /* this one has more than we have seen. let's get the
+         payload that we have not seen. This happens when 
+         part of this frame has been retransmitted */
 
-      if( current->seq == seq[idx] ) {
-        /* this fragment fits the stream */
-        if( current->data ) {
-          sc->dlen = current->data_len;
-          write_packet_data( idx, sc, current->data );
-        }
-        seq[idx] += current->len;
-        if( prev ) {
-          prev->next = current->next;
-        } else {
-          frags[idx] = current->next;
-        }
-        g_free( current->data );
-        g_free( current );
-        return 1;
+      new_pos = seq[idx] - current->seq;
+
+      if ( current->data_len > new_pos ) {
+        sc->dlen = current->data_len - new_pos;
+        write_packet_data( idx, sc, current->data + new_pos );
       }
-      prev = current;
-      current = current->next;
-    }
-    if( (glong)(acknowledged - lowest_seq) > 0 ) {
-      /* There are frames missing in the capture file that were seen
-       * by the receiving host. Add dummy stream chunk with the data
-       * "[xxx bytes missing in capture file]".
-       */
-      dummy_str = g_strdup_printf("[%d bytes missing in capture file]",
-                        (int)(lowest_seq - seq[idx]) );
-      sc->dlen = (guint32) strlen(dummy_str);
-      write_packet_data( idx, sc, dummy_str );
-      g_free(dummy_str);
-      seq[idx] = lowest_seq;
-      return 1;
+
+      seq[idx] += (current->len - new_pos);
+    } 
+
+    /* Remove the fragment as the "new" part of it has been processed
+     * or its data has been seen already in another packet. */
+    g_tree_remove( frags[idx], GUINT_TO_POINTER(current->seq) );
+    return 1;
+  }
+
+  if( current->seq == seq[idx] ) {
+    /* this fragment fits the stream */
+    if( current->data ) {
+      sc->dlen = current->data_len;
+      write_packet_data( idx, sc, current->data );
     }
-  } 
+    seq[idx] += current->len;
+    g_tree_remove( frags[idx], GUINT_TO_POINTER(current->seq) );
+    return 1;
+  }
+
+  if( (glong)(acknowledged - current->seq) > 0 ) {
+    /* There are frames missing in the capture file that were seen
+     * by the receiving host. Add dummy stream chunk with the data
+     * "[xxx bytes missing in capture file]".
+     */
+    dummy_str = g_strdup_printf("[%d bytes missing in capture file]",
+                      (int)(current->seq - seq[idx]) );
+    sc->dlen = (guint32) strlen(dummy_str);
+    write_packet_data( idx, sc, dummy_str );
+    g_free(dummy_str);
+    seq[idx] = current->seq;
+    return 1;
+  }
   return 0;
 }
 
@@ -474,7 +610,6 @@ check_fragments( int idx, tcp_stream_chunk *sc, gulong acknowledged ) {
 void
 reset_tcp_reassembly(void)
 {
-  tcp_frag *current, *next;
   int i;
 
   empty_tcp_stream = TRUE;
@@ -488,14 +623,10 @@ reset_tcp_reassembly(void)
     memset(ip_address[i], '\0', MAX_IPADDR_LEN);
     port[i] = 0;
     bytes_written[i] = 0;
-    current = frags[i];
-    while( current ) {
-      next = current->next;
-      g_free( current->data );
-      g_free( current );
-      current = next;
+    if( frags[i] ) {
+      g_tree_destroy( frags[i] );
+      frags[i] = NULL;
     }
-    frags[i] = NULL;
   }
 }
 
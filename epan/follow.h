@@ -57,4 +57,35 @@ typedef struct {
 
 void follow_stats(follow_stats_t* stats);
 
+/* A TCP segment of a stream, as kept in the index of the streams */
+typedef struct {
+	guint32		frame;		/* number of the frame it's in */
+	guint32		seq;		/* sequence number, as the TCP dissector shows it */
+	guint32		len;		/* segment length */
+} follow_tcp_segment_t;
+
+/* Keep an index of the segments of every TCP stream as the frames are
+   first dissected; it's complete only if it's been kept since the last
+   follow_tcp_index_reset(), i.e. since the dissection was initialized,
+   and every frame added since then has been dissected; a caller that
+   adds frames without dissecting them must call
+   follow_tcp_index_invalidate(). */
+void follow_tcp_set_indexing( gboolean enable );
+void follow_tcp_index_reset( void );
+void follow_tcp_index_invalidate( void );
+void follow_tcp_index_segment( guint32 stream, guint32 frame, guint32 seq,
+                               guint32 len );
+
+/* The segments of a stream, in frame order, or FALSE if the index isn't
+   complete.  A stream with no segments has a count of 0. */
+gboolean follow_tcp_stream_segments( guint32 stream,
+                                     const follow_tcp_segment_t **segments,
+                                     guint *count );
+
+/* The frames of the stream being followed, as selected by
+   build_follow_filter() or follow_tcp_index(), in a g_malloc()ed array,
+   or FALSE if they aren't known; dissecting just them, in that order,
+   with data_out_file set, reassembles the stream. */
+gboolean follow_tcp_stream_frames( guint32 **frames, guint *nframes );
+
 #endif
@@ -31,83 +31,32 @@
 #include <epan/frame_data.h>
 #include <epan/packet.h>
 #include <epan/emem.h>
+#include <epan/proto_data_map.h>
 #include <epan/timestamp.h>
 
 #include <glib.h>
 
-/* Protocol-specific data attached to a frame_data structure - protocol
-   index and opaque pointer. */
-typedef struct _frame_proto_data {
-  int proto;
-  void *proto_data;
-} frame_proto_data;
-
-/* XXX - I declared this static, because it only seems to be used by
- * p_get_proto_data and p_add_proto_data
- */
-static gint p_compare(gconstpointer a, gconstpointer b)
-{
-  const frame_proto_data *ap = (const frame_proto_data *)a;
-  const frame_proto_data *bp = (const frame_proto_data *)b;
-
-  if (ap -> proto > bp -> proto)
-    return 1;
-  else if (ap -> proto == bp -> proto)
-    return 0;
-  else
-    return -1;
-
-}
-
+/* The map is g_malloc()ed, rather than se memory, so that a frame that's
+   thrown away after it's dissected, as in a single-pass TShark, doesn't
+   leave it behind until the file is closed; frame_data_cleanup() frees it. */
 void
 p_add_proto_data(frame_data *fd, int proto, void *proto_data)
 {
-  frame_proto_data *p1 = se_alloc(sizeof(frame_proto_data));
-
-  p1->proto = proto;
-  p1->proto_data = proto_data;
-
-  /* Add it to the GSLIST */
-
-  fd -> pfd = g_slist_insert_sorted(fd -> pfd,
-                    (gpointer *)p1,
-                    p_compare);
+  if (fd->pfd == NULL)
+    fd->pfd = proto_data_map_new();
+  proto_data_map_add(&fd->pfd, proto, proto_data);
 }
 
 void *
 p_get_proto_data(frame_data *fd, int proto)
 {
-  frame_proto_data temp, *p1;
-  GSList *item;
-
-  temp.proto = proto;
-  temp.proto_data = NULL;
-
-  item = g_slist_find_custom(fd->pfd, (gpointer *)&temp, p_compare);
-
-  if (item) {
-    p1 = (frame_proto_data *)item->data;
-    return p1->proto_data;
-  }
-
-  return NULL;
-
+  return proto_data_map_get(fd->pfd, proto);
 }
 
 void
 p_remove_proto_data(frame_data *fd, int proto)
 {
-  frame_proto_data temp;
-  GSList *item;
-
-  temp.proto = proto;
-  temp.proto_data = NULL;
-
-  item = g_slist_find_custom(fd->pfd, (gpointer *)&temp, p_compare);
-
-  if (item) {
-    fd->pfd = g_slist_remove(fd->pfd, item->data);
-  }
+  proto_data_map_remove(fd->pfd, proto);
 }
 
 #define COMPARE_FRAME_NUM()     ((fdata1->num < fdata2->num) ? -1 : \
@@ -123,18 +72,28 @@ p_remove_proto_data(frame_data *fd, int proto)
    a lower time stamp than any frame with a non-reference time;
    if both packets' times are reference times, we compare the
    times of the packets. */
-#define COMPARE_TS(ts) \
+#define COMPARE_TS_REAL(time1, time2) \
                 ((fdata1->flags.ref_time && !fdata2->flags.ref_time) ? -1 : \
                  (!fdata1->flags.ref_time && fdata2->flags.ref_time) ? 1 : \
-                 (fdata1->ts.secs < fdata2->ts.secs) ? -1 : \
-                 (fdata1->ts.secs > fdata2->ts.secs) ? 1 : \
-                 (fdata1->ts.nsecs < fdata2->ts.nsecs) ? -1 :\
-                 (fdata1->ts.nsecs > fdata2->ts.nsecs) ? 1 : \
+                 ((time1).secs < (time2).secs) ? -1 : \
+                 ((time1).secs > (time2).secs) ? 1 : \
+                 ((time1).nsecs < (time2).nsecs) ? -1 :\
+                 ((time1).nsecs > (time2).nsecs) ? 1 : \
                  COMPARE_FRAME_NUM())
 
+#define COMPARE_TS(ts) COMPARE_TS_REAL(fdata1->ts, fdata2->ts)
+
+/* Compare time stamps relative to other frames. */
+#define COMPARE_DELTA_TS(prev_num1, prev_num2) \
+                (frame_delta_abs_time(fdata1, (prev_num1), &delta1), \
+                 frame_delta_abs_time(fdata2, (prev_num2), &delta2), \
+                 COMPARE_TS_REAL(delta1, delta2))
+
 gint
 frame_data_compare(const frame_data *fdata1, const frame_data *fdata2, int field)
 {
+    nstime_t delta1, delta2;
+
     switch (field) {
         case COL_NUMBER:
             return COMPARE_FRAME_NUM();
@@ -149,13 +108,13 @@ frame_data_compare(const frame_data *fdata1, const frame_data *fdata2, int field
                     return COMPARE_TS(abs_ts);
 
                 case TS_RELATIVE:
-                    return COMPARE_TS(rel_ts);
+                    return COMPARE_DELTA_TS(fdata1->frame_ref_num, fdata2->frame_ref_num);
 
                 case TS_DELTA:
-                    return COMPARE_TS(del_cap_ts);
+                    return COMPARE_DELTA_TS(fdata1->num - 1, fdata2->num - 1);
 
                 case TS_DELTA_DIS:
-                    return COMPARE_TS(del_dis_ts);
+                    return COMPARE_DELTA_TS(fdata1->prev_dis_num, fdata2->prev_dis_num);
 
                 case TS_NOT_SET:
                     return 0;
@@ -169,13 +128,13 @@ frame_data_compare(const frame_data *fdata1, const frame_data *fdata2, int field
             return COMPARE_TS(abs_ts);
 
         case COL_REL_TIME:
-            return COMPARE_TS(rel_ts);
+            return COMPARE_DELTA_TS(fdata1->frame_ref_num, fdata2->frame_ref_num);
 
         case COL_DELTA_TIME:
-            return COMPARE_TS(del_cap_ts);
+            return COMPARE_DELTA_TS(fdata1->num - 1, fdata2->num - 1);
 
         case COL_DELTA_TIME_DIS:
-            return COMPARE_TS(del_dis_ts);
+            return COMPARE_DELTA_TS(fdata1->prev_dis_num, fdata2->prev_dis_num);
 
         case COL_PACKET_LENGTH:
             return COMPARE_NUM(pkt_len);
@@ -199,7 +158,8 @@ frame_data_init(frame_data *fdata, guint32 num,
   fdata->cum_bytes = cum_bytes + phdr->len;
   fdata->cap_len = phdr->caplen;
   fdata->file_off = offset;
-  fdata->subnum = 0;
+  fdata->frame_ref_num = 0;
+  fdata->prev_dis_num = 0;
   /* To save some memory, we coerce it into a gint16 */
   g_assert(phdr->pkt_encap <= G_MAXINT16);
   fdata->lnk_t = (gint16) phdr->pkt_encap;
@@ -212,76 +172,51 @@ frame_data_init(frame_data *fdata, guint32 num,
   fdata->flags.ignored = 0;
   fdata->flags.has_ts = (phdr->presence_flags & WTAP_HAS_TS) ? 1 : 0;
   fdata->flags.has_if_id = (phdr->presence_flags & WTAP_HAS_INTERFACE_ID) ? 1 : 0;
+  fdata->flags.has_comment = 0;
+  fdata->flags.has_shift_offset = 0;
   fdata->color_filter = NULL;
   fdata->abs_ts.secs = phdr->ts.secs;
   fdata->abs_ts.nsecs = phdr->ts.nsecs;
-  fdata->shift_offset.secs = 0;
-  fdata->shift_offset.nsecs = 0;
-  fdata->rel_ts.secs = 0;
-  fdata->rel_ts.nsecs = 0;
-  fdata->del_dis_ts.secs = 0;
-  fdata->del_dis_ts.nsecs = 0;
-  fdata->del_cap_ts.secs = 0;
-  fdata->del_cap_ts.nsecs = 0;
-  fdata->opt_comment = phdr->opt_comment;
+  if (phdr->opt_comment != NULL)
+    frame_data_set_comment(fdata, phdr->opt_comment);
 }
 
 void
 frame_data_set_before_dissect(frame_data *fdata,
                 nstime_t *elapsed_time,
-                nstime_t *first_ts,
-                nstime_t *prev_dis_ts,
-                nstime_t *prev_cap_ts)
+                const frame_data **frame_ref,
+                const frame_data *prev_dis)
 {
-  /* If we don't have the time stamp of the first packet in the
-     capture, it's because this is the first packet.  Save the time
-     stamp of this packet as the time stamp of the first packet. */
-  if (nstime_is_unset(first_ts))
-    *first_ts = fdata->abs_ts;
-
-  /* if this frames is marked as a reference time frame, reset
-     firstsec and firstusec to this frame */
-  if(fdata->flags.ref_time)
-    *first_ts = fdata->abs_ts;
-
-  /* If we don't have the time stamp of the previous captured packet,
-     it's because this is the first packet.  Save the time
-     stamp of this packet as the time stamp of the previous captured
-     packet. */
-  if (nstime_is_unset(prev_cap_ts))
-    *prev_cap_ts = fdata->abs_ts;
+  nstime_t rel_ts;
+
+  /* If we don't have the frame the time stamps are relative to, it's
+     because this is the first packet; if this frame is marked as a
+     reference time frame, the time stamps are relative to it from now
+     on. */
+  if (*frame_ref == NULL || fdata->flags.ref_time)
+    *frame_ref = fdata;
+  fdata->frame_ref_num = (*frame_ref)->num;
 
   /* Get the time elapsed between the first packet and this packet. */
-  nstime_delta(&fdata->rel_ts, &fdata->abs_ts, first_ts);
+  nstime_delta(&rel_ts, &fdata->abs_ts, &(*frame_ref)->abs_ts);
 
   /* If it's greater than the current elapsed time, set the elapsed time
      to it (we check for "greater than" so as not to be confused by
      time moving backwards). */
-  if ((gint32)elapsed_time->secs < fdata->rel_ts.secs
-    || ((gint32)elapsed_time->secs == fdata->rel_ts.secs && (gint32)elapsed_time->nsecs < fdata->rel_ts.nsecs)) {
-    *elapsed_time = fdata->rel_ts;
+  if ((gint32)elapsed_time->secs < rel_ts.secs
+    || ((gint32)elapsed_time->secs == rel_ts.secs && (gint32)elapsed_time->nsecs < rel_ts.nsecs)) {
+    *elapsed_time = rel_ts;
   }
 
-  /* Get the time elapsed between the previous displayed packet and
-     this packet. */
-  if (nstime_is_unset(prev_dis_ts))
-    /* If we don't have the time stamp of the previous displayed packet,
-       it's because we have no displayed packets prior to this.
-       Set the delta time to zero. */
-    nstime_set_zero(&fdata->del_dis_ts);
-  else
-    nstime_delta(&fdata->del_dis_ts, &fdata->abs_ts, prev_dis_ts);
-
-  /* Get the time elapsed between the previous captured packet and
-     this packet. */
-  nstime_delta(&fdata->del_cap_ts, &fdata->abs_ts, prev_cap_ts);
-  *prev_cap_ts = fdata->abs_ts;
+  /* If we don't have the previous displayed packet, it's because we
+     have no displayed packets prior to this, and the delta time is
+     zero. */
+  fdata->prev_dis_num = (prev_dis != NULL) ? prev_dis->num : 0;
 }
 
 void
 frame_data_set_after_dissect(frame_data *fdata,
-                guint32 *cum_bytes,
-                nstime_t *prev_dis_ts)
+                guint32 *cum_bytes)
 {
   /* This frame either passed the display filter list or is marked as
      a time reference frame.  All time reference frames are displayed
@@ -295,17 +230,118 @@ frame_data_set_after_dissect(frame_data *fdata,
     *cum_bytes += fdata->pkt_len;
     fdata->cum_bytes = *cum_bytes;
   }
-
-  /* Set the time of the previous displayed frame to the time of this
-     frame. */
-  *prev_dis_ts = fdata->abs_ts;
 }
 
 void
 frame_data_cleanup(frame_data *fdata)
 {
-  if (fdata->pfd)
-    g_slist_free(fdata->pfd);
-
+  proto_data_map_free(fdata->pfd);
   fdata->pfd = NULL;
 }
+
+static frame_data_ts_func get_frame_ts;
+static void *get_frame_ts_data;
+
+void
+frame_data_set_ts_func(frame_data_ts_func func, void *data)
+{
+  get_frame_ts = func;
+  get_frame_ts_data = data;
+}
+
+void
+frame_delta_abs_time(const frame_data *fdata, guint32 prev_num, nstime_t *delta)
+{
+  const nstime_t *prev_abs_ts = NULL;
+
+  if (prev_num == fdata->num) {
+    /* The frame may not have been added to wherever get_frame_ts
+       looks yet. */
+    prev_abs_ts = &fdata->abs_ts;
+  } else if (prev_num != 0 && get_frame_ts != NULL) {
+    prev_abs_ts = get_frame_ts(get_frame_ts_data, prev_num);
+  }
+
+  if (prev_abs_ts != NULL)
+    nstime_delta(delta, &fdata->abs_ts, prev_abs_ts);
+  else
+    nstime_set_zero(delta);
+}
+
+/* Comments and time shifts, keyed by frame number; the flags in the
+   frame_data say whether there's anything here for a frame, so that the
+   tables are only looked at for the few frames that have something. */
+static GHashTable *frame_comments;
+static GHashTable *frame_shift_offsets;
+
+gchar *
+frame_data_get_comment(const frame_data *fdata)
+{
+  if (!fdata->flags.has_comment || frame_comments == NULL)
+    return NULL;
+  return (gchar *)g_hash_table_lookup(frame_comments, GUINT_TO_POINTER(fdata->num));
+}
+
+void
+frame_data_set_comment(frame_data *fdata, gchar *comment)
+{
+  if (comment == NULL) {
+    if (fdata->flags.has_comment && frame_comments != NULL)
+      g_hash_table_remove(frame_comments, GUINT_TO_POINTER(fdata->num));
+    fdata->flags.has_comment = 0;
+    return;
+  }
+
+  if (frame_comments == NULL)
+    frame_comments = g_hash_table_new(g_direct_hash, g_direct_equal);
+  g_hash_table_insert(frame_comments, GUINT_TO_POINTER(fdata->num), comment);
+  fdata->flags.has_comment = 1;
+}
+
+void
+frame_data_get_shift_offset(const frame_data *fdata, nstime_t *shift_offset)
+{
+  const nstime_t *offset = NULL;
+
+  if (fdata->flags.has_shift_offset && frame_shift_offsets != NULL)
+    offset = (const nstime_t *)g_hash_table_lookup(frame_shift_offsets, GUINT_TO_POINTER(fdata->num));
+
+  if (offset != NULL)
+    *shift_offset = *offset;
+  else
+    nstime_set_zero(shift_offset);
+}
+
+void
+frame_data_set_shift_offset(frame_data *fdata, const nstime_t *shift_offset)
+{
+  nstime_t *offset;
+
+  if (shift_offset->secs == 0 && shift_offset->nsecs == 0) {
+    if (fdata->flags.has_shift_offset && frame_shift_offsets != NULL)
+      g_hash_table_remove(frame_shift_offsets, GUINT_TO_POINTER(fdata->num));
+    fdata->flags.has_shift_offset = 0;
+    return;
+  }
+
+  if (frame_shift_offsets == NULL)
+    frame_shift_offsets = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                                NULL, g_free);
+  offset = g_new(nstime_t, 1);
+  *offset = *shift_offset;
+  g_hash_table_insert(frame_shift_offsets, GUINT_TO_POINTER(fdata->num), offset);
+  fdata->flags.has_shift_offset = 1;
+}
+
+void
+frame_data_clear_side_tables(void)
+{
+  if (frame_comments != NULL) {
+    g_hash_table_destroy(frame_comments);
+    frame_comments = NULL;
+  }
+  if (frame_shift_offsets != NULL) {
+    g_hash_table_destroy(frame_shift_offsets);
+    frame_shift_offsets = NULL;
+  }
+}
@@ -38,37 +38,42 @@
 
 /** The frame number is the ordinal number of the frame in the capture, so
    it's 1-origin.  In various contexts, 0 as a frame number means "frame
-   number unknown". */
+   number unknown".
+
+   There's one of these for every frame in a capture file, so it's kept
+   small: the relative and delta time stamps aren't stored, but worked out
+   from the frame numbers of the frames they're relative to (see
+   frame_delta_abs_time()), and comments and time shifts, which few frames
+   have, are kept on the side (see frame_data_get_comment() and
+   frame_data_get_shift_offset()). */
 typedef struct _frame_data {
-  GSList      *pfd;          /**< Per frame proto data */
+  struct _proto_data_map *pfd; /**< Per frame proto data */
   guint32      num;          /**< Frame number */
   guint32      interface_id; /**< identifier of the interface. */
   guint32      pkt_len;      /**< Packet length */
   guint32      cap_len;      /**< Amount actually captured */
   guint32      cum_bytes;    /**< Cumulative bytes into the capture */
-  gint64       file_off;     /**< File offset */
-  guint16      subnum;       /**< subframe number, for protocols that require this */
+  guint32      frame_ref_num; /**< Frame the relative time stamp is relative to */
+  guint32      prev_dis_num; /**< Previous displayed frame (0 if none) */
   gint16       lnk_t;        /**< Per-packet encapsulation/data-link type */
   struct {
-    unsigned int passed_dfilter : 1; /**< 1 = display, 0 = no display */
-    unsigned int dependent_of_displayed : 1; /**< 1 if a displayed frame depends on this frame */
-    unsigned int encoding       : 2; /**< Character encoding (ASCII, EBCDIC...) */
-    unsigned int visited        : 1; /**< Has this packet been visited yet? 1=Yes,0=No*/
-    unsigned int marked         : 1; /**< 1 = marked by user, 0 = normal */
-    unsigned int ref_time       : 1; /**< 1 = marked as a reference time frame, 0 = normal */
-    unsigned int ignored        : 1; /**< 1 = ignore this frame, 0 = normal */
-    unsigned int has_ts         : 1; /**< 1 = has time stamp, 0 = no time stamp */
-    unsigned int has_if_id      : 1; /**< 1 = has interface ID, 0 = no interface ID */
+    guint16 passed_dfilter : 1; /**< 1 = display, 0 = no display */
+    guint16 dependent_of_displayed : 1; /**< 1 if a displayed frame depends on this frame */
+    guint16 encoding       : 2; /**< Character encoding (ASCII, EBCDIC...) */
+    guint16 visited        : 1; /**< Has this packet been visited yet? 1=Yes,0=No*/
+    guint16 marked         : 1; /**< 1 = marked by user, 0 = normal */
+    guint16 ref_time       : 1; /**< 1 = marked as a reference time frame, 0 = normal */
+    guint16 ignored        : 1; /**< 1 = ignore this frame, 0 = normal */
+    guint16 has_ts         : 1; /**< 1 = has time stamp, 0 = no time stamp */
+    guint16 has_if_id      : 1; /**< 1 = has interface ID, 0 = no interface ID */
+    guint16 has_comment    : 1; /**< 1 = has a comment, 0 = no comment */
+    guint16 has_shift_offset : 1; /**< 1 = abs_ts has been shifted, 0 = not shifted */
   } flags;
+  gint64       file_off;     /**< File offset */
 
   const void *color_filter;  /**< Per-packet matching color_filter_t object */
 
   nstime_t     abs_ts;       /**< Absolute timestamp */
-  nstime_t     shift_offset; /**< How much the abs_tm of the frame is shifted */
-  nstime_t     rel_ts;       /**< Relative timestamp (yes, it can be negative) */
-  nstime_t     del_dis_ts;   /**< Delta timestamp to previous displayed frame (yes, it can be negative) */
-  nstime_t     del_cap_ts;   /**< Delta timestamp to previous captured frame (yes, it can be negative) */
-  gchar        *opt_comment; /**< NULL if not available */
 } frame_data;
 
 #ifdef WANT_PACKET_EDITOR
@@ -104,17 +109,63 @@ extern void frame_data_init(frame_data *fdata, guint32 num,
                 const struct wtap_pkthdr *phdr, gint64 offset,
                 guint32 cum_bytes);
 /**
- * Sets the frame data struct values before dissection.
+ * Sets the frame data struct values before dissection.  "frame_ref"
+ * points to the frame relative time stamps are relative to, which is
+ * NULL before the first frame and which this sets to fdata if fdata is
+ * the first frame or a time reference frame; "prev_dis" is the previous
+ * displayed frame, or NULL if there isn't one.
  */
 extern void frame_data_set_before_dissect(frame_data *fdata,
                 nstime_t *elapsed_time,
-                nstime_t *first_ts,
-                nstime_t *prev_dis_ts,
-                nstime_t *prev_cap_ts);
+                const frame_data **frame_ref,
+                const frame_data *prev_dis);
 
 extern void frame_data_set_after_dissect(frame_data *fdata,
-                guint32 *cum_bytes,
-                nstime_t *prev_dis_ts);
+                guint32 *cum_bytes);
+
+/**
+ * Returns the absolute time stamp of frame "frame_num", or NULL if it's
+ * not known.
+ */
+typedef const nstime_t *(*frame_data_ts_func)(void *data, guint32 frame_num);
+
+/**
+ * Sets the routine frame_delta_abs_time() uses to look up other frames'
+ * time stamps; whoever keeps the frames being dissected sets it.
+ */
+extern void frame_data_set_ts_func(frame_data_ts_func func, void *data);
+
+/**
+ * Sets "delta" to the time between frame "prev_num" and fdata, or to
+ * zero if prev_num is 0 or that frame's time stamp isn't known.  With
+ * fdata->frame_ref_num, fdata->num - 1 or fdata->prev_dis_num, that gives
+ * the relative, delta captured and delta displayed time stamps.
+ */
+extern void frame_delta_abs_time(const frame_data *fdata, guint32 prev_num,
+                nstime_t *delta);
+
+/** The frame's comment, or NULL if it has none. */
+extern gchar *frame_data_get_comment(const frame_data *fdata);
+
+/**
+ * Sets the frame's comment, or removes it if "comment" is NULL.  As with
+ * the comment in the wtap_pkthdr, the frame doesn't take it over; freeing
+ * the old one is up to the caller.
+ */
+extern void frame_data_set_comment(frame_data *fdata, gchar *comment);
+
+/** How much the frame's abs_ts has been shifted from the time in the file. */
+extern void frame_data_get_shift_offset(const frame_data *fdata,
+                nstime_t *shift_offset);
+
+extern void frame_data_set_shift_offset(frame_data *fdata,
+                const nstime_t *shift_offset);
+
+/**
+ * Forgets the comments and time shifts of all frames; call it when the
+ * frames they belong to go away.
+ */
+extern void frame_data_clear_side_tables(void);
 
 #endif  /* __FRAME_DATA__ */
 
@@ -0,0 +1,309 @@
+/* multisearch.c
+ * Routines for searching for many byte strings at once
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/strutil.h>
+#include <epan/multisearch.h>
+
+/*
+ * The automaton is a DFA: the trie of the patterns, with every missing
+ * transition filled in from the state's failure link, so each byte of
+ * the data costs one table lookup whatever the number of patterns.  To
+ * keep the table small, the bytes that appear in no pattern all share
+ * one column ("class") of it, and each byte that does has its own.
+ *
+ * State 0 is the root.  A state is where a pattern ends if out[] says
+ * so; other patterns may end there too, namely those that end in the
+ * states reached by following dict[], the nearest suffix of the state
+ * in which a pattern ends.
+ */
+struct _multisearch {
+	GPtrArray *patterns;	/* GByteArray's, in the order added */
+	gboolean compiled;
+	gint single;		/* the only non-empty pattern, or -1 */
+
+	guint16 class_of[256];
+	guint n_classes;
+	guint n_states;
+	gint32 *delta;		/* n_states rows of n_classes next states */
+	gint32 *out;		/* first pattern ending in a state, or -1 */
+	gint32 *dict;		/* nearest suffix state with output, or -1 */
+	gint32 *match;		/* some pattern ending in a state, or -1 */
+	gint32 *pattern_next;	/* next pattern the same as this one, or -1 */
+};
+
+multisearch_t *
+multisearch_new(void)
+{
+	multisearch_t *ms;
+
+	ms = g_new0(multisearch_t, 1);
+	ms->patterns = g_ptr_array_new();
+	ms->single = -1;
+	return ms;
+}
+
+void
+multisearch_free(multisearch_t *ms)
+{
+	guint i;
+
+	if (ms == NULL)
+		return;
+
+	for (i = 0; i < ms->patterns->len; i++)
+		g_byte_array_free((GByteArray *)g_ptr_array_index(ms->patterns, i), TRUE);
+	g_ptr_array_free(ms->patterns, TRUE);
+	g_free(ms->delta);
+	g_free(ms->out);
+	g_free(ms->dict);
+	g_free(ms->match);
+	g_free(ms->pattern_next);
+	g_free(ms);
+}
+
+guint
+multisearch_add(multisearch_t *ms, const guint8 *pattern, guint pattern_len)
+{
+	GByteArray *bytes;
+
+	g_assert(!ms->compiled);
+
+	bytes = g_byte_array_sized_new(pattern_len);
+	g_byte_array_append(bytes, pattern, pattern_len);
+	g_ptr_array_add(ms->patterns, bytes);
+	return ms->patterns->len - 1;
+}
+
+guint
+multisearch_count(const multisearch_t *ms)
+{
+	return ms->patterns->len;
+}
+
+#define PATTERN(ms, p)	((GByteArray *)g_ptr_array_index((ms)->patterns, (p)))
+
+void
+multisearch_compile(multisearch_t *ms)
+{
+	guint n_patterns = ms->patterns->len;
+	guint n_nonempty = 0, max_states = 1;
+	GByteArray *pattern;
+	gint32 *fail, *queue;
+	guint head, tail;
+	guint p, i, c;
+	gint32 s, t, q;
+
+	g_assert(!ms->compiled);
+	ms->compiled = TRUE;
+
+	ms->pattern_next = g_new(gint32, n_patterns > 0 ? n_patterns : 1);
+	for (p = 0; p < n_patterns; p++) {
+		ms->pattern_next[p] = -1;
+		pattern = PATTERN(ms, p);
+		if (pattern->len == 0)
+			continue;
+		n_nonempty++;
+		ms->single = p;
+		max_states += pattern->len;
+	}
+	if (n_nonempty != 1)
+		ms->single = -1;
+	if (n_nonempty <= 1)
+		return;
+
+	/* Class 0 is for the bytes in none of the patterns */
+	memset(ms->class_of, 0, sizeof ms->class_of);
+	ms->n_classes = 1;
+	for (p = 0; p < n_patterns; p++) {
+		pattern = PATTERN(ms, p);
+		for (i = 0; i < pattern->len; i++) {
+			if (ms->class_of[pattern->data[i]] == 0)
+				ms->class_of[pattern->data[i]] = ms->n_classes++;
+		}
+	}
+
+	/* The trie */
+	ms->delta = g_new(gint32, max_states * ms->n_classes);
+	ms->out = g_new(gint32, max_states);
+	for (i = 0; i < max_states * ms->n_classes; i++)
+		ms->delta[i] = -1;
+	for (i = 0; i < max_states; i++)
+		ms->out[i] = -1;
+	ms->n_states = 1;
+
+	for (p = 0; p < n_patterns; p++) {
+		pattern = PATTERN(ms, p);
+		if (pattern->len == 0)
+			continue;
+		s = 0;
+		for (i = 0; i < pattern->len; i++) {
+			c = ms->class_of[pattern->data[i]];
+			if (ms->delta[s * ms->n_classes + c] == -1)
+				ms->delta[s * ms->n_classes + c] = ms->n_states++;
+			s = ms->delta[s * ms->n_classes + c];
+		}
+		if (ms->out[s] == -1) {
+			ms->out[s] = p;
+		} else {
+			/* A duplicate; keep them in the order added */
+			for (q = ms->out[s]; ms->pattern_next[q] != -1; q = ms->pattern_next[q])
+				;
+			ms->pattern_next[q] = p;
+		}
+	}
+
+	ms->delta = g_renew(gint32, ms->delta, ms->n_states * ms->n_classes);
+	ms->out = g_renew(gint32, ms->out, ms->n_states);
+	ms->dict = g_new(gint32, ms->n_states);
+	ms->match = g_new(gint32, ms->n_states);
+
+	/*
+	 * Breadth first, so that a state's failure state, which is
+	 * shallower, is complete by the time the state is reached: its
+	 * missing transitions are then those of its failure state.
+	 */
+	fail = g_new(gint32, ms->n_states);
+	queue = g_new(gint32, ms->n_states);
+	head = tail = 0;
+
+	fail[0] = 0;
+	ms->dict[0] = -1;
+	ms->match[0] = -1;
+	for (c = 0; c < ms->n_classes; c++) {
+		t = ms->delta[c];
+		if (t == -1) {
+			ms->delta[c] = 0;
+		} else {
+			fail[t] = 0;
+			queue[tail++] = t;
+		}
+	}
+
+	while (head < tail) {
+		s = queue[head++];
+
+		ms->dict[s] = ms->out[fail[s]] != -1 ? fail[s] : ms->dict[fail[s]];
+		if (ms->out[s] != -1)
+			ms->match[s] = ms->out[s];
+		else if (ms->dict[s] != -1)
+			ms->match[s] = ms->out[ms->dict[s]];
+		else
+			ms->match[s] = -1;
+
+		for (c = 0; c < ms->n_classes; c++) {
+			t = ms->delta[s * ms->n_classes + c];
+			if (t == -1) {
+				ms->delta[s * ms->n_classes + c] =
+				    ms->delta[fail[s] * ms->n_classes + c];
+			} else {
+				fail[t] = ms->delta[fail[s] * ms->n_classes + c];
+				queue[tail++] = t;
+			}
+		}
+	}
+
+	g_free(queue);
+	g_free(fail);
+}
+
+gint
+multisearch_find(const multisearch_t *ms, const guint8 *data, guint data_len)
+{
+	const gint32 *delta = ms->delta;
+	const gint32 *match = ms->match;
+	const guint16 *class_of = ms->class_of;
+	const guint n_classes = ms->n_classes;
+	GByteArray *pattern;
+	gint32 s = 0;
+	guint i;
+
+	g_assert(ms->compiled);
+
+	if (ms->single != -1) {
+		pattern = PATTERN(ms, ms->single);
+		if (epan_memmem(data, data_len, pattern->data, pattern->len))
+			return ms->single;
+		return -1;
+	}
+	if (ms->n_states == 0)
+		return -1;
+
+	for (i = 0; i < data_len; i++) {
+		s = delta[s * n_classes + class_of[data[i]]];
+		if (match[s] != -1)
+			return match[s];
+	}
+	return -1;
+}
+
+guint
+multisearch_find_all(const multisearch_t *ms, const guint8 *data,
+    guint data_len, multisearch_func func, void *user_data)
+{
+	GByteArray *pattern;
+	const guint8 *found;
+	guint n_found = 0;
+	guint i;
+	gint32 s = 0, t, p;
+
+	g_assert(ms->compiled);
+
+	if (ms->single != -1) {
+		pattern = PATTERN(ms, ms->single);
+		i = 0;
+		while ((found = epan_memmem(data + i, data_len - i,
+		    pattern->data, pattern->len)) != NULL) {
+			n_found++;
+			if (!func(ms->single, (guint)(found - data), user_data))
+				break;
+			i = (guint)(found - data) + 1;
+		}
+		return n_found;
+	}
+	if (ms->n_states == 0)
+		return 0;
+
+	for (i = 0; i < data_len; i++) {
+		s = ms->delta[s * ms->n_classes + ms->class_of[data[i]]];
+		if (ms->match[s] == -1)
+			continue;
+
+		for (t = ms->out[s] != -1 ? s : ms->dict[s]; t != -1; t = ms->dict[t]) {
+			for (p = ms->out[t]; p != -1; p = ms->pattern_next[p]) {
+				n_found++;
+				if (!func(p, i + 1 - PATTERN(ms, p)->len, user_data))
+					return n_found;
+			}
+		}
+	}
+	return n_found;
+}
@@ -0,0 +1,87 @@
+/* multisearch.h
+ * Declarations of routines for searching for many byte strings at once
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __MULTISEARCH_H__
+#define __MULTISEARCH_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * A set of byte strings ("patterns") to look for in data, all of them in
+ * a single pass over it, e.g. for a display filter that ORs together many
+ * "contains" tests, or a list of strings to look for in every packet.
+ *
+ * The patterns are added, then the set is compiled, into an Aho-Corasick
+ * automaton, and can then be searched for any number of times.  A set
+ * with only one pattern is searched for with epan_memmem() instead.
+ */
+typedef struct _multisearch multisearch_t;
+
+/** An empty set of patterns. */
+extern multisearch_t *multisearch_new(void);
+extern void multisearch_free(multisearch_t *ms);
+
+/**
+ * Add a pattern, which is copied, to a set that hasn't been compiled
+ * yet.  Returns the pattern's index; they're numbered from 0 in the
+ * order they're added.  An empty pattern never matches, as with
+ * epan_memmem().
+ */
+extern guint multisearch_add(multisearch_t *ms, const guint8 *pattern,
+    guint pattern_len);
+
+/** The number of patterns that have been added. */
+extern guint multisearch_count(const multisearch_t *ms);
+
+/** Build the automaton; no more patterns can be added after this. */
+extern void multisearch_compile(multisearch_t *ms);
+
+/**
+ * Look for the patterns in data.  Returns the index of a pattern that
+ * ends first in the data, or -1 if none of them are in it.
+ */
+extern gint multisearch_find(const multisearch_t *ms, const guint8 *data,
+    guint data_len);
+
+/**
+ * Call func for every occurrence of every pattern in data, in the order
+ * in which they end, with the pattern's index and the offset in the data
+ * at which it starts.  Stops if func returns FALSE.  Returns the number
+ * of times func was called.
+ */
+typedef gboolean (*multisearch_func)(guint pattern, guint offset,
+    void *user_data);
+
+extern guint multisearch_find_all(const multisearch_t *ms, const guint8 *data,
+    guint data_len, multisearch_func func, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __MULTISEARCH_H__ */
@@ -291,6 +291,7 @@ dissect_packet(epan_dissect_t *edt, union wtap_pseudo_header *pseudo_header,
 	edt->pi.current_proto = "<Missing Protocol Name>";
 	edt->pi.cinfo = cinfo;
 	edt->pi.fd = fd;
+	frame_delta_abs_time(fd, fd->frame_ref_num, &edt->pi.rel_ts);
 	edt->pi.pseudo_header = pseudo_header;
 	edt->pi.dl_src.type = AT_NONE;
 	edt->pi.dl_dst.type = AT_NONE;
@@ -465,6 +466,17 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb,
 		return 0;
 	}
 
+	if (handle->protocol != NULL &&
+	    proto_tree_skip_protocol(tree, proto_get_id(handle->protocol))) {
+		/*
+		 * The tree is being pruned for a filter, and nothing
+		 * this protocol would add can change its result; claim
+		 * the data without dissecting it, so that no other
+		 * dissector is tried on it either.
+		 */
+		return tvb_length(tvb);
+	}
+
 	saved_proto = pinfo->current_proto;
 	saved_can_desegment = pinfo->can_desegment;
 
@@ -1707,6 +1719,15 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors,
 			continue;
 		}
 
+		if (hdtbl_entry->protocol != NULL &&
+		    proto_tree_skip_protocol(tree, proto_get_id(hdtbl_entry->protocol))) {
+			/*
+			 * The tree is being pruned, and this dissector
+			 * couldn't add anything that's looked at.
+			 */
+			continue;
+		}
+
 		if (hdtbl_entry->protocol != NULL) {
 			pinfo->current_proto =
 				proto_get_protocol_short_name(hdtbl_entry->protocol);
@@ -49,6 +49,8 @@ typedef struct _packet_info {
   const char *current_proto;	/* name of protocol currently being dissected */
   column_info *cinfo;		/* Column formatting information */
   frame_data *fd;
+  nstime_t rel_ts;		/* Relative timestamp (yes, it can be negative) */
+  guint16 subnum;		/* subframe number, for protocols that require this */
   union wtap_pseudo_header *pseudo_header;
   GSList *data_src;		/* Frame data sources */
   address dl_src;		/* link-layer source address */
@@ -1377,6 +1377,7 @@ init_prefs(void)
   prefs.gui_ask_unsaved            = TRUE;
   prefs.gui_find_wrap              = TRUE;
   prefs.gui_use_pref_save          = FALSE;
+  prefs.gui_frame_index            = FALSE;
   prefs.gui_webbrowser             = g_strdup(HTML_VIEWER " %s");
   prefs.gui_window_title           = g_strdup("");
   prefs.gui_start_title            = g_strdup("The World's Most Popular Network Protocol Analyzer");
@@ -1405,6 +1406,7 @@ init_prefs(void)
   prefs.capture_real_time             = TRUE;
   prefs.capture_auto_scroll           = TRUE;
   prefs.capture_show_info             = FALSE;
+  prefs.capture_shared_ring_size      = 0;
 
 /* set the default values for the name resolution dialog box */
   prefs.name_resolve             = RESOLV_ALL ^ RESOLV_NETWORK;
@@ -2068,6 +2070,7 @@ prefs_capture_device_monitor_mode(const char *name)
 #define PRS_GUI_ASK_UNSAVED              "gui.ask_unsaved"
 #define PRS_GUI_FIND_WRAP                "gui.find_wrap"
 #define PRS_GUI_USE_PREF_SAVE            "gui.use_pref_save"
+#define PRS_GUI_FRAME_INDEX              "gui.frame_index"
 #define PRS_GUI_GEOMETRY_SAVE_POSITION   "gui.geometry.save.position"
 #define PRS_GUI_GEOMETRY_SAVE_SIZE       "gui.geometry.save.size"
 #define PRS_GUI_GEOMETRY_SAVE_MAXIMIZED  "gui.geometry.save.maximized"
@@ -2118,6 +2121,7 @@ prefs_capture_device_monitor_mode(const char *name)
 #define PRS_CAP_REAL_TIME            "capture.real_time_update"
 #define PRS_CAP_AUTO_SCROLL          "capture.auto_scroll"
 #define PRS_CAP_SHOW_INFO            "capture.show_info"
+#define PRS_CAP_SHARED_RING_SIZE     "capture.shared_ring_size"
 
 /* obsolete preference */
 #define PRS_CAP_SYNTAX_CHECK_FILTER  "capture.syntax_check_filter"
@@ -2558,6 +2562,13 @@ set_pref(gchar *pref_name, gchar *value, void *private_data _U_,
     else {
 	    prefs.gui_use_pref_save = FALSE;
     }
+  } else if (strcmp(pref_name, PRS_GUI_FRAME_INDEX) == 0) {
+    if (g_ascii_strcasecmp(value, "true") == 0) {
+	    prefs.gui_frame_index = TRUE;
+    }
+    else {
+	    prefs.gui_frame_index = FALSE;
+    }
   } else if (strcmp(pref_name, PRS_GUI_WEBBROWSER) == 0) {
     g_free(prefs.gui_webbrowser);
     prefs.gui_webbrowser = g_strdup(value);
@@ -2634,6 +2645,8 @@ set_pref(gchar *pref_name, gchar *value, void *private_data _U_,
     prefs.capture_auto_scroll = ((g_ascii_strcasecmp(value, "true") == 0)?TRUE:FALSE);
   } else if (strcmp(pref_name, PRS_CAP_SHOW_INFO) == 0) {
     prefs.capture_show_info = ((g_ascii_strcasecmp(value, "true") == 0)?TRUE:FALSE);
+  } else if (strcmp(pref_name, PRS_CAP_SHARED_RING_SIZE) == 0) {
+    prefs.capture_shared_ring_size = strtol(value, NULL, 10);
   } else if (strcmp(pref_name, PRS_CAP_SYNTAX_CHECK_FILTER) == 0) {
     /* Obsolete preference. */
     ;
@@ -3425,6 +3438,14 @@ write_prefs(char **pf_path_return)
   fprintf(pf, PRS_GUI_USE_PREF_SAVE ": %s\n",
 	  prefs.gui_use_pref_save == TRUE ? "TRUE" : "FALSE");
 
+  fprintf(pf, "\n# Keep a frame index (\"<file>.wsidx\") next to capture files, and\n");
+  fprintf(pf, "# use it to open them again without reading them sequentially?\n");
+  fprintf(pf, "# TRUE or FALSE (case-insensitive).\n");
+  if (prefs.gui_frame_index == default_prefs.gui_frame_index)
+    fprintf(pf, "#");
+  fprintf(pf, PRS_GUI_FRAME_INDEX ": %s\n",
+	  prefs.gui_frame_index == TRUE ? "TRUE" : "FALSE");
+
   fprintf(pf, "\n# The path to the webbrowser.\n");
   fprintf(pf, "# Ex: mozilla %%s\n");
   if (strcmp(prefs.gui_webbrowser, default_prefs.gui_webbrowser) == 0)
@@ -3703,6 +3724,15 @@ write_prefs(char **pf_path_return)
   fprintf(pf, PRS_CAP_SHOW_INFO ": %s\n",
 	  prefs.capture_show_info == TRUE ? "TRUE" : "FALSE");
 
+  fprintf(pf, "\n# Size in megabytes of the shared-memory ring through which dumpcap\n");
+  fprintf(pf, "# hands packets to TShark while capturing, or 0 to read them back\n");
+  fprintf(pf, "# from the capture file.\n");
+  fprintf(pf, "# A decimal number.\n");
+  if (prefs.capture_shared_ring_size == default_prefs.capture_shared_ring_size)
+    fprintf(pf, "#");
+  fprintf(pf, PRS_CAP_SHARED_RING_SIZE ": %d\n",
+	  prefs.capture_shared_ring_size);
+
   fprintf (pf, "\n######## Printing ########\n");
 
   fprintf (pf, "\n# Can be one of \"text\" or \"postscript\".\n");
@@ -3862,6 +3892,7 @@ copy_prefs(e_prefs *dest, e_prefs *src)
   dest->gui_ask_unsaved = src->gui_ask_unsaved;
   dest->gui_find_wrap = src->gui_find_wrap;
   dest->gui_use_pref_save = src->gui_use_pref_save;
+  dest->gui_frame_index = src->gui_frame_index;
   dest->gui_layout_type = src->gui_layout_type;
   dest->gui_layout_content_1 = src->gui_layout_content_1;
   dest->gui_layout_content_2 = src->gui_layout_content_2;
@@ -3891,6 +3922,7 @@ copy_prefs(e_prefs *dest, e_prefs *src)
   dest->capture_real_time = src->capture_real_time;
   dest->capture_auto_scroll = src->capture_auto_scroll;
   dest->capture_show_info = src->capture_show_info;
+  dest->capture_shared_ring_size = src->capture_shared_ring_size;
   dest->name_resolve = src->name_resolve;
   dest->name_resolve_concurrency = src->name_resolve_concurrency;
   dest->tap_update_interval = src->tap_update_interval;
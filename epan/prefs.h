@@ -142,6 +142,7 @@ typedef struct _e_prefs {
   gboolean gui_ask_unsaved;
   gboolean gui_find_wrap;
   gboolean gui_use_pref_save;
+  gboolean gui_frame_index;
   gchar   *gui_webbrowser;
   gchar   *gui_window_title;
   gchar   *gui_start_title;
@@ -167,6 +168,7 @@ typedef struct _e_prefs {
   gboolean capture_real_time;
   gboolean capture_auto_scroll;
   gboolean capture_show_info;
+  gint     capture_shared_ring_size;
   guint    rtp_player_max_visible;
   guint    tap_update_interval;
   gboolean display_hidden_proto_items;
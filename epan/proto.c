@@ -180,6 +180,9 @@ static proto_item *
 proto_tree_add_pi(proto_tree *tree, int hfindex, tvbuff_t *tvb,
 		  gint start, gint *length, field_info **pfi);
 
+static void
+destroy_tree_data(tree_data_t *tree_data);
+
 static void
 proto_tree_set_representation_value(proto_item *pi, const char *format, va_list ap);
 static void
@@ -292,6 +295,16 @@ static struct ws_memory_slab proto_node_slab =
 static struct ws_memory_slab item_label_slab =
 	WS_MEMORY_SLAB_INIT(item_label_t, 128);
 
+/* Recycled tree_data_t's; see proto_tree_create_root() and
+ * free_node_tree_data(). More than one tree can be alive at a time
+ * (e.g. when a tap dissects a packet while it's being displayed), so
+ * keep a few. Trees may be built and freed in more than one thread,
+ * so the cache is only touched with its lock held. */
+#define TREE_DATA_CACHE_SIZE	4
+static tree_data_t *tree_data_cache[TREE_DATA_CACHE_SIZE];
+static guint tree_data_cache_count = 0;
+G_LOCK_DEFINE_STATIC(tree_data_cache);
+
 #define ITEM_LABEL_NEW(il)				\
 	il = sl_alloc(&item_label_slab);
 #define ITEM_LABEL_FREE(il)				\
@@ -466,6 +479,11 @@ proto_cleanup(void)
 	}
 	g_free(tree_is_expanded);
 	tree_is_expanded = NULL;
+
+	G_LOCK(tree_data_cache);
+	while (tree_data_cache_count > 0)
+		destroy_tree_data(tree_data_cache[--tree_data_cache_count]);
+	G_UNLOCK(tree_data_cache);
 }
 
 static gboolean
@@ -544,10 +562,8 @@ proto_tree_free(proto_tree *tree)
 }
 
 static void
-free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
+reset_interesting_hfid(gint hfid, GPtrArray *ptrs)
 {
-	GPtrArray         *ptrs = value;
-	gint               hfid = (gint)(long)key;
 	header_field_info *hfinfo;
 
 	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
@@ -564,23 +580,49 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 		hfinfo->ref_type = HF_REF_TYPE_NONE;
 	}
 
-	g_ptr_array_free(ptrs, TRUE);
+	/* Keep the array itself for the next tree */
+	g_ptr_array_set_size(ptrs, 0);
+}
+
+static void
+destroy_tree_data(tree_data_t *tree_data)
+{
+	guint i;
+
+	for (i = 0; i < tree_data->interesting_hfids_size; i++) {
+		if (tree_data->interesting_hfids[i])
+			g_ptr_array_free(tree_data->interesting_hfids[i], TRUE);
+	}
+	g_free(tree_data->interesting_hfids);
+	g_free(tree_data->interesting_used);
+	g_free(tree_data->prune_protos);
+	g_free(tree_data);
 }
 
 static void
 free_node_tree_data(tree_data_t *tree_data)
 {
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
+	guint i;
+
+	/* Empty the arrays of the fields that were seen in this tree;
+	 * the others are empty already, so this doesn't depend on the
+	 * number of registered fields. */
+	for (i = 0; i < tree_data->interesting_used_count; i++) {
+		gint hfid = tree_data->interesting_used[i];
 
-		/* And then destroy the hash. */
-		g_hash_table_destroy(tree_data->interesting_hfids);
+		reset_interesting_hfid(hfid, tree_data->interesting_hfids[hfid]);
 	}
+	tree_data->interesting_used_count = 0;
 
-	/* And finally the tree_data_t itself. */
-	g_free(tree_data);
+	/* And recycle the tree_data_t itself, arrays and all. */
+	G_LOCK(tree_data_cache);
+	if (tree_data_cache_count < TREE_DATA_CACHE_SIZE) {
+		tree_data_cache[tree_data_cache_count++] = tree_data;
+		tree_data = NULL;
+	}
+	G_UNLOCK(tree_data_cache);
+	if (tree_data != NULL)
+		destroy_tree_data(tree_data);
 }
 
 #define FREE_NODE_FIELD_INFO(finfo)	\
@@ -1167,25 +1209,41 @@ static GPtrArray *
 proto_lookup_or_create_interesting_hfids(proto_tree *tree,
 					 header_field_info *hfinfo)
 {
+	tree_data_t *tree_data;
 	GPtrArray *ptrs = NULL;
 
 	DISSECTOR_ASSERT(tree);
 	DISSECTOR_ASSERT(hfinfo);
 
 	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT) {
-		if (PTREE_DATA(tree)->interesting_hfids == NULL) {
-			/* Initialize the hash because we now know that it is needed */
-			PTREE_DATA(tree)->interesting_hfids =
-				g_hash_table_new(g_direct_hash, NULL /* g_direct_equal */);
+		tree_data = PTREE_DATA(tree);
+
+		if ((guint)hfinfo->id >= tree_data->interesting_hfids_size) {
+			/* Grow the arrays to cover all the fields registered
+			 * so far; this happens only until they've reached
+			 * that size, as they're recycled across trees. */
+			guint old_size = tree_data->interesting_hfids_size;
+			guint new_size = MAX(gpa_hfinfo.len, (guint)hfinfo->id + 1);
+
+			tree_data->interesting_hfids =
+				g_renew(GPtrArray *, tree_data->interesting_hfids, new_size);
+			memset(&tree_data->interesting_hfids[old_size], 0,
+			       (new_size - old_size) * sizeof(GPtrArray *));
+			tree_data->interesting_used =
+				g_renew(gint, tree_data->interesting_used, new_size);
+			tree_data->interesting_hfids_size = new_size;
 		}
 
-		ptrs = g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(hfinfo->id));
+		ptrs = tree_data->interesting_hfids[hfinfo->id];
 		if (!ptrs) {
-			/* First element triggers the creation of pointer array */
+			/* First element ever triggers the creation of pointer array */
 			ptrs = g_ptr_array_new();
-			g_hash_table_insert(PTREE_DATA(tree)->interesting_hfids,
-					    GINT_TO_POINTER(hfinfo->id), ptrs);
+			tree_data->interesting_hfids[hfinfo->id] = ptrs;
+		}
+		if (ptrs->len == 0) {
+			/* First element in this tree; remember to empty the
+			 * array again when the tree is freed */
+			tree_data->interesting_used[tree_data->interesting_used_count++] = hfinfo->id;
 		}
 	}
 
@@ -4219,10 +4277,28 @@ proto_tree_create_root(void)
 	PROTO_NODE_NEW(pnode);
 	pnode->parent = NULL;
 	PNODE_FINFO(pnode) = NULL;
-	pnode->tree_data = g_new(tree_data_t, 1);
 
-	/* Don't initialize the tree_data_t. Wait until we know we need it */
-	pnode->tree_data->interesting_hfids = NULL;
+	/* Reuse the tree_data_t of an earlier tree if there's one; its
+	 * interesting_hfids arrays were emptied when that tree was freed. */
+	G_LOCK(tree_data_cache);
+	pnode->tree_data = tree_data_cache_count > 0 ?
+		tree_data_cache[--tree_data_cache_count] : NULL;
+	G_UNLOCK(tree_data_cache);
+	if (pnode->tree_data == NULL) {
+		pnode->tree_data = g_new(tree_data_t, 1);
+
+		/* Don't allocate the arrays. Wait until we know we need them */
+		pnode->tree_data->interesting_hfids = NULL;
+		pnode->tree_data->interesting_hfids_size = 0;
+		pnode->tree_data->interesting_used = NULL;
+		pnode->tree_data->interesting_used_count = 0;
+		pnode->tree_data->prune_protos = NULL;
+		pnode->tree_data->prune_protos_size = 0;
+	}
+
+	/* Don't prune unless asked to */
+	pnode->tree_data->prune_protos_count = 0;
+	pnode->tree_data->prune_protos_seen = FALSE;
 
 	/* Set the default to FALSE so it's easier to
 	 * find errors; if we expect to see the protocol tree
@@ -4268,6 +4344,64 @@ proto_tree_prime_hfid(proto_tree *tree _U_, const gint hfid)
 	}
 }
 
+void
+proto_tree_prune_keep_protocol(proto_tree *tree, const int proto_id)
+{
+	tree_data_t *tree_data;
+	guint i;
+
+	if (!tree)
+		return;
+
+	tree_data = PTREE_DATA(tree);
+	for (i = 0; i < tree_data->prune_protos_count; i++) {
+		if (tree_data->prune_protos[i] == proto_id)
+			return;
+	}
+
+	if (tree_data->prune_protos_count == tree_data->prune_protos_size) {
+		tree_data->prune_protos_size = MAX(8, 2 * tree_data->prune_protos_size);
+		tree_data->prune_protos = g_renew(int, tree_data->prune_protos,
+						  tree_data->prune_protos_size);
+	}
+	tree_data->prune_protos[tree_data->prune_protos_count++] = proto_id;
+
+	/* We need to know when the protocol has been added */
+	proto_tree_prime_hfid(tree, proto_id);
+}
+
+gboolean
+proto_tree_skip_protocol(proto_tree *tree, const int proto_id)
+{
+	tree_data_t *tree_data;
+	guint i;
+
+	if (!tree)
+		return FALSE;
+
+	tree_data = PTREE_DATA(tree);
+	if (tree_data->prune_protos_count == 0)
+		return FALSE;	/* not pruning */
+
+	for (i = 0; i < tree_data->prune_protos_count; i++) {
+		if (tree_data->prune_protos[i] == proto_id)
+			return FALSE;
+	}
+
+	/* Dissectors of other protocols are needed until all the ones
+	 * we were asked to keep are in the tree, as they may be what
+	 * leads to them. */
+	if (!tree_data->prune_protos_seen) {
+		for (i = 0; i < tree_data->prune_protos_count; i++) {
+			if (proto_get_finfo_ptr_array(tree, tree_data->prune_protos[i]) == NULL)
+				return FALSE;
+		}
+		tree_data->prune_protos_seen = TRUE;
+	}
+
+	return TRUE;
+}
+
 proto_tree *
 proto_item_add_subtree(proto_item *pi,	const gint idx) {
 	field_info *fi;
@@ -6206,11 +6340,14 @@ proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 	if (!tree)
 		return NULL;
 
-	if (PTREE_DATA(tree)->interesting_hfids != NULL)
-		return g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(id));
-	else
-		return NULL;
+	/* An array that's empty was only kept from an earlier tree */
+	if ((guint)id < PTREE_DATA(tree)->interesting_hfids_size) {
+		GPtrArray *ptrs = PTREE_DATA(tree)->interesting_hfids[id];
+
+		if (ptrs != NULL && ptrs->len > 0)
+			return ptrs;
+	}
+	return NULL;
 }
 
 gboolean
@@ -6219,7 +6356,7 @@ proto_tracking_interesting_fields(const proto_tree *tree)
 	if (!tree)
 		return FALSE;
 
-	return (PTREE_DATA(tree)->interesting_hfids != NULL);
+	return (PTREE_DATA(tree)->interesting_used_count > 0);
 }
 
 /* Helper struct for proto_find_info() and	proto_all_finfos() */
@@ -464,9 +464,18 @@ typedef struct
 #define FI_GET_BITS_SIZE(fi)   (FI_GET_FLAG(fi, FI_BITS_SIZE(63)) >> 8)
 
 /** One of these exists for the entire protocol tree. Each proto_node
- * in the protocol tree points to the same copy. */
+ * in the protocol tree points to the same copy. They are recycled from
+ * one tree to the next, so the interesting_hfids arrays keep their size
+ * across packets. */
 typedef struct {
-    GHashTable  *interesting_hfids;
+    GPtrArray  **interesting_hfids;         /**< finfos of each primed field, indexed by hfid */
+    guint        interesting_hfids_size;    /**< number of entries in interesting_hfids */
+    gint        *interesting_used;          /**< hfids with finfos in this tree */
+    guint        interesting_used_count;    /**< number of entries in interesting_used */
+    int         *prune_protos;              /**< protocols that must still be dissected when pruning */
+    guint        prune_protos_count;        /**< number of entries in prune_protos */
+    guint        prune_protos_size;         /**< allocated entries in prune_protos */
+    gboolean     prune_protos_seen;         /**< all of prune_protos are in the tree */
     gboolean    visible;
     gboolean    fake_protocols;
     gint        count;
@@ -726,6 +735,24 @@ proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols);
 extern void
 proto_tree_prime_hfid(proto_tree *tree, const int hfid);
 
+/** Let the dissection of the packet be pruned: once all the protocols
+ passed to this have been added to the tree, the dissectors of other
+ protocols are no longer called (see proto_tree_skip_protocol()). Used
+ when the tree is only built to apply a filter that looks at nothing
+ but those protocols and their fields.
+ @param tree the tree to be set
+ @param proto_id the protocol that must still be dissected */
+extern void
+proto_tree_prune_keep_protocol(proto_tree *tree, const int proto_id);
+
+/** Check whether the dissector of a protocol can be skipped because the
+ tree is being pruned and nothing the dissector adds can be looked at.
+ @param tree the tree the dissector would add to; may be NULL
+ @param proto_id the protocol of the dissector
+ @return TRUE if the dissector needn't be called */
+extern gboolean
+proto_tree_skip_protocol(proto_tree *tree, const int proto_id);
+
 /** Get a parent item of a subtree.
  @param tree the tree to get the parent from
  @return parent item */
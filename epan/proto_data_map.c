@@ -0,0 +1,222 @@
+/* proto_data_map.c
+ * Routines for maps from protocol index to protocol data
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <glib.h>
+
+#include <epan/emem.h>
+#include <epan/proto_data_map.h>
+
+/* Entries kept in the map itself. */
+#define PROTO_DATA_MAP_INLINE	4
+
+/* Size the hash table starts at; always a power of two, and never more
+   than half full. */
+#define PROTO_DATA_MAP_HASH_SIZE	8
+
+/* Marks an unused slot in the hash table; no protocol has this index. */
+#define PROTO_DATA_MAP_EMPTY	G_MININT
+
+typedef struct {
+	int proto;
+	void *proto_data;
+} proto_data_entry;
+
+struct _proto_data_map {
+	gboolean se_allocated;		/* else it's g_malloc()ed */
+	guint n_inline;
+	proto_data_entry inline_entries[PROTO_DATA_MAP_INLINE];
+	guint n_hashed;
+	guint hash_size;
+	proto_data_entry *hashed;
+};
+
+static guint
+proto_data_map_home(const proto_data_map *map, const int proto)
+{
+	guint h = (guint)proto * 0x9E3779B1U;
+
+	return (h ^ (h >> 16)) & (map->hash_size - 1);
+}
+
+/* Slot of "proto" in the hash table, or of the empty slot it'd go in. */
+static guint
+proto_data_map_slot(const proto_data_map *map, const int proto)
+{
+	guint i;
+
+	for (i = proto_data_map_home(map, proto);
+	     map->hashed[i].proto != PROTO_DATA_MAP_EMPTY && map->hashed[i].proto != proto;
+	     i = (i + 1) & (map->hash_size - 1))
+		;
+	return i;
+}
+
+static void
+proto_data_map_grow(proto_data_map *map)
+{
+	proto_data_entry *old_hashed = map->hashed;
+	guint old_size = map->hash_size;
+	guint i, slot;
+
+	map->hash_size = old_size ? old_size * 2 : PROTO_DATA_MAP_HASH_SIZE;
+	if (map->se_allocated)
+		map->hashed = se_alloc_array(proto_data_entry, map->hash_size);
+	else
+		map->hashed = g_new(proto_data_entry, map->hash_size);
+	for (i = 0; i < map->hash_size; i++)
+		map->hashed[i].proto = PROTO_DATA_MAP_EMPTY;
+
+	for (i = 0; i < old_size; i++) {
+		if (old_hashed[i].proto != PROTO_DATA_MAP_EMPTY) {
+			slot = proto_data_map_slot(map, old_hashed[i].proto);
+			map->hashed[slot] = old_hashed[i];
+		}
+	}
+
+	/* If the old table is se memory, it's just left behind. */
+	if (!map->se_allocated)
+		g_free(old_hashed);
+}
+
+proto_data_map *
+proto_data_map_new(void)
+{
+	return g_new0(proto_data_map, 1);
+}
+
+void
+proto_data_map_free(proto_data_map *map)
+{
+	if (map == NULL)
+		return;
+	g_assert(!map->se_allocated);
+	g_free(map->hashed);
+	g_free(map);
+}
+
+void
+proto_data_map_add(proto_data_map **map, const int proto, void *proto_data)
+{
+	proto_data_map *m = *map;
+	guint i, slot;
+
+	if (m == NULL) {
+		m = se_new0(proto_data_map);
+		m->se_allocated = TRUE;
+		*map = m;
+	}
+
+	/* A protocol's newest data replaces what it had before. */
+	for (i = 0; i < m->n_inline; i++) {
+		if (m->inline_entries[i].proto == proto) {
+			m->inline_entries[i].proto_data = proto_data;
+			return;
+		}
+	}
+	if (m->n_hashed != 0) {
+		slot = proto_data_map_slot(m, proto);
+		if (m->hashed[slot].proto == proto) {
+			m->hashed[slot].proto_data = proto_data;
+			return;
+		}
+	}
+
+	if (m->n_inline < PROTO_DATA_MAP_INLINE) {
+		m->inline_entries[m->n_inline].proto = proto;
+		m->inline_entries[m->n_inline].proto_data = proto_data;
+		m->n_inline++;
+		return;
+	}
+
+	if ((m->n_hashed + 1) * 2 > m->hash_size)
+		proto_data_map_grow(m);
+	slot = proto_data_map_slot(m, proto);
+	m->n_hashed++;
+	m->hashed[slot].proto = proto;
+	m->hashed[slot].proto_data = proto_data;
+}
+
+void *
+proto_data_map_get(const proto_data_map *map, const int proto)
+{
+	guint i;
+
+	if (map == NULL)
+		return NULL;
+
+	for (i = 0; i < map->n_inline; i++) {
+		if (map->inline_entries[i].proto == proto)
+			return map->inline_entries[i].proto_data;
+	}
+
+	if (map->n_hashed != 0) {
+		i = proto_data_map_slot(map, proto);
+		if (map->hashed[i].proto == proto)
+			return map->hashed[i].proto_data;
+	}
+
+	return NULL;
+}
+
+void
+proto_data_map_remove(proto_data_map *map, const int proto)
+{
+	guint i, j, k, mask;
+
+	if (map == NULL)
+		return;
+
+	for (i = 0; i < map->n_inline; i++) {
+		if (map->inline_entries[i].proto == proto) {
+			map->n_inline--;
+			map->inline_entries[i] = map->inline_entries[map->n_inline];
+			return;
+		}
+	}
+
+	if (map->n_hashed == 0)
+		return;
+	i = proto_data_map_slot(map, proto);
+	if (map->hashed[i].proto != proto)
+		return;
+
+	/*
+	 * Move up any entries after it that wouldn't be found past the
+	 * hole otherwise, so that there's no need for tombstones.
+	 */
+	mask = map->hash_size - 1;
+	for (j = (i + 1) & mask; map->hashed[j].proto != PROTO_DATA_MAP_EMPTY; j = (j + 1) & mask) {
+		k = proto_data_map_home(map, map->hashed[j].proto);
+		if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+			map->hashed[i] = map->hashed[j];
+			i = j;
+		}
+	}
+	map->hashed[i].proto = PROTO_DATA_MAP_EMPTY;
+	map->n_hashed--;
+}
@@ -0,0 +1,69 @@
+/* proto_data_map.h
+ * Declarations of routines for maps from protocol index to protocol data
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __PROTO_DATA_MAP_H__
+#define __PROTO_DATA_MAP_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * A map from protocol index to an opaque pointer, as hung off frames and
+ * conversations for the protocols' private data.
+ *
+ * Most frames and conversations have data for only one or two protocols,
+ * so the first few entries are kept in the map itself and searched in
+ * order; any more go in a small hash table.  The map is allocated, with
+ * se_alloc(), when the first entry is added, so a NULL map is an empty
+ * one, and it goes away with the rest of the capture file's se memory.
+ * A map that has to be freed before then, such as a frame's, which
+ * frame_data_cleanup() frees, is made with proto_data_map_new().
+ */
+typedef struct _proto_data_map proto_data_map;
+
+/** An empty map that uses g_malloc()ed memory and is freed explicitly. */
+extern proto_data_map *proto_data_map_new(void);
+extern void proto_data_map_free(proto_data_map *map);
+
+/**
+ * Add data for a protocol, allocating the map if *map is NULL.  If the
+ * protocol already has data in the map, the new data replaces it.
+ */
+extern void proto_data_map_add(proto_data_map **map, const int proto,
+    void *proto_data);
+
+/** Get the data for a protocol, or NULL if it has none. */
+extern void *proto_data_map_get(const proto_data_map *map, const int proto);
+
+/** Remove the data for a protocol, if it has any. */
+extern void proto_data_map_remove(proto_data_map *map, const int proto);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __PROTO_DATA_MAP_H__ */
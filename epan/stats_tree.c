@@ -344,7 +344,7 @@ extern int
 stats_tree_packet(void *p, packet_info *pinfo, epan_dissect_t *edt, const void *pri)
 {
 	stats_tree *st = p;
-	double now = nstime_to_msec(&pinfo->fd->rel_ts);
+	double now = nstime_to_msec(&pinfo->rel_ts);
 
 	if (st->start < 0.0) st->start = now;
 
@@ -493,6 +493,145 @@ new_stat_node(stats_tree *st, const gchar *name, int parent_id,
 }
 /***/
 
+/* what stats_tree_save() says about a node besides its name and counter */
+#define SAVED_NODE_IS_PARENT	0x01
+#define SAVED_NODE_HAS_HASH	0x02
+#define SAVED_NODE_HAS_RANGE	0x04
+
+static void
+save_stat_node(const stat_node *node, GByteArray *buf)
+{
+	const stat_node *child;
+	guint32 n_children = 0;
+	guint8 flags = 0;
+
+	tap_save_string(buf, node->name);
+	tap_save_bytes(buf, &node->counter, sizeof node->counter);
+	if (node->id >= 0) flags |= SAVED_NODE_IS_PARENT;
+	if (node->hash) flags |= SAVED_NODE_HAS_HASH;
+	if (node->rng) flags |= SAVED_NODE_HAS_RANGE;
+	tap_save_bytes(buf, &flags, sizeof flags);
+	if (node->rng)
+		tap_save_bytes(buf, node->rng, sizeof *node->rng);
+
+	for (child = node->children; child; child = child->next)
+		n_children++;
+	tap_save_bytes(buf, &n_children, sizeof n_children);
+	for (child = node->children; child; child = child->next)
+		save_stat_node(child, buf);
+}
+
+/* the tap_save_cb of a tree */
+extern void
+stats_tree_save(void *p, GByteArray *buf)
+{
+	stats_tree *st = p;
+
+	tap_save_bytes(buf, &st->start, sizeof st->start);
+	tap_save_bytes(buf, &st->elapsed, sizeof st->elapsed);
+	save_stat_node(&st->root, buf);
+}
+
+/* reads what save_stat_node() wrote about a node, up to its children */
+static gboolean
+merge_saved_node(tap_merge_data_t *md, gchar **name, gint *counter,
+		 guint8 *flags, range_pair_t *rng, guint32 *n_children)
+{
+	if (!tap_merge_string(md, name))
+		return FALSE;
+	if (*name == NULL ||
+	    !tap_merge_bytes(md, counter, sizeof *counter) ||
+	    !tap_merge_bytes(md, flags, sizeof *flags) ||
+	    ((*flags & SAVED_NODE_HAS_RANGE) &&
+	     !tap_merge_bytes(md, rng, sizeof *rng)) ||
+	    !tap_merge_bytes(md, n_children, sizeof *n_children)) {
+		g_free(*name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* adds the counts saved for the children of a node, which are looked up
+   by name and created if we don't have them, to ours */
+static gboolean
+merge_stat_children(stat_node *node, guint32 n_children, tap_merge_data_t *md)
+{
+	stat_node *child;
+	gchar *name;
+	gint counter;
+	guint8 flags;
+	range_pair_t rng;
+	guint32 n_grandchildren, i;
+
+	for (i = 0; i < n_children; i++) {
+		if (!merge_saved_node(md, &name, &counter, &flags, &rng,
+				      &n_grandchildren))
+			return FALSE;
+
+		if (node->hash) {
+			child = g_hash_table_lookup(node->hash, name);
+		} else {
+			for (child = node->children; child; child = child->next)
+				if (strcmp(child->name, name) == 0)
+					break;
+		}
+
+		if (child == NULL) {
+			/* only parent nodes can have children */
+			if (node->id < 0) {
+				g_free(name);
+				return FALSE;
+			}
+			child = new_stat_node(node->st, name, node->id,
+					      (flags & SAVED_NODE_HAS_HASH) != 0,
+					      (flags & SAVED_NODE_IS_PARENT) != 0);
+			if (flags & SAVED_NODE_HAS_RANGE) {
+				child->rng = g_malloc(sizeof(range_pair_t));
+				*child->rng = rng;
+			}
+		}
+		g_free(name);
+
+		child->counter += counter;
+		if (!merge_stat_children(child, n_grandchildren, md))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* the tap_merge_cb of a tree */
+extern gboolean
+stats_tree_merge(void *p, tap_merge_data_t *md)
+{
+	stats_tree *st = p;
+	double start, elapsed, end;
+	gchar *name;
+	gint counter;
+	guint8 flags;
+	range_pair_t rng;
+	guint32 n_children;
+
+	if (!tap_merge_bytes(md, &start, sizeof start) ||
+	    !tap_merge_bytes(md, &elapsed, sizeof elapsed) ||
+	    !merge_saved_node(md, &name, &counter, &flags, &rng, &n_children))
+		return FALSE;
+	g_free(name);
+
+	/* rates are over the time from the first packet any of us saw to
+	   the last */
+	if (start >= 0.0) {
+		end = start + elapsed;
+		if (st->start >= 0.0 && st->start + st->elapsed > end)
+			end = st->start + st->elapsed;
+		if (st->start < 0.0 || start < st->start)
+			st->start = start;
+		st->elapsed = end - st->start;
+	}
+
+	st->root.counter += counter;
+	return merge_stat_children(&st->root, n_children, md);
+}
+
 extern int
 stats_tree_create_node(stats_tree *st, const gchar *name, int parent_id, gboolean with_hash)
 {
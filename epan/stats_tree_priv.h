@@ -171,6 +171,12 @@ extern void stats_tree_reset(void *p_st);
 /** callback for clear */
 extern void stats_tree_reinit(void *p_st);
 
+/** callbacks for saving the counts of a tree in one process and adding
+   them to those of the same tree in another (see tap_save_cb and
+   tap_merge_cb) */
+extern void stats_tree_save(void *p_st, GByteArray *buf);
+extern gboolean stats_tree_merge(void *p_st, tap_merge_data_t *md);
+
 /* callback for destoy */
 extern void stats_tree_free(stats_tree *st);
 
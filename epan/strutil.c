@@ -740,22 +740,33 @@ xml_escape(const gchar *unescaped)
 }
 
 
-/* Return the first occurrence of needle in haystack.
- * If not found, return NULL.
- * If either haystack or needle has 0 length, return NULL.
- * Algorithm copied from GNU's glibc 2.3.2 memcmp() */
-const guint8 *
-epan_memmem(const guint8 *haystack, guint haystack_len,
+/*
+ * epan_memmem() is what "contains" in display filters and Edit->Find
+ * Packet spend their time in, so where the compiler lets us, candidate
+ * positions are found 16 or 32 at a time: a position can only start a
+ * match if both the first and the last byte of the needle are where they
+ * should be, and comparing those two bytes for a whole vector of
+ * positions at once leaves very few to check with memcmp().
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define EPAN_MEMMEM_SSE2
+#include <emmintrin.h>
+#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+/* Built for AVX2 on its own, and used only if the CPU has it */
+#define EPAN_MEMMEM_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+/* Algorithm copied from GNU's glibc 2.3.2 memcmp() */
+static const guint8 *
+memmem_scalar(const guint8 *haystack, guint haystack_len,
 		const guint8 *needle, guint needle_len)
 {
 	const guint8 *begin;
 	const guint8 *const last_possible
 		= haystack + haystack_len - needle_len;
 
-	if (needle_len == 0) {
-		return NULL;
-	}
-
 	if (needle_len > haystack_len) {
 		return NULL;
 	}
@@ -771,6 +782,116 @@ epan_memmem(const guint8 *haystack, guint haystack_len,
 	return NULL;
 }
 
+#ifdef EPAN_MEMMEM_SSE2
+/* needle_len must be at least 2 and no more than haystack_len */
+static const guint8 *
+memmem_sse2(const guint8 *haystack, guint haystack_len,
+		const guint8 *needle, guint needle_len)
+{
+	const __m128i first = _mm_set1_epi8((char)needle[0]);
+	const __m128i last = _mm_set1_epi8((char)needle[needle_len - 1]);
+	const guint n_starts = haystack_len - needle_len + 1;
+	__m128i block_first, block_last;
+	guint i, mask, bit;
+
+	for (i = 0; i + 16 <= n_starts; i += 16) {
+		block_first = _mm_loadu_si128((const __m128i *)(haystack + i));
+		block_last = _mm_loadu_si128((const __m128i *)(haystack + i + needle_len - 1));
+		mask = _mm_movemask_epi8(_mm_and_si128(
+			_mm_cmpeq_epi8(first, block_first),
+			_mm_cmpeq_epi8(last, block_last)));
+		while (mask != 0) {
+			bit = __builtin_ctz(mask);
+			if (!memcmp(haystack + i + bit + 1, needle + 1, needle_len - 2)) {
+				return haystack + i + bit;
+			}
+			mask &= mask - 1;
+		}
+	}
+
+	return memmem_scalar(haystack + i, haystack_len - i, needle, needle_len);
+}
+#endif
+
+#ifdef EPAN_MEMMEM_AVX2
+/* As memmem_sse2(), 32 positions at a time */
+__attribute__((target("avx2")))
+static const guint8 *
+memmem_avx2(const guint8 *haystack, guint haystack_len,
+		const guint8 *needle, guint needle_len)
+{
+	const __m256i first = _mm256_set1_epi8((char)needle[0]);
+	const __m256i last = _mm256_set1_epi8((char)needle[needle_len - 1]);
+	const guint n_starts = haystack_len - needle_len + 1;
+	__m256i block_first, block_last;
+	guint i, mask, bit;
+
+	for (i = 0; i + 32 <= n_starts; i += 32) {
+		block_first = _mm256_loadu_si256((const __m256i *)(haystack + i));
+		block_last = _mm256_loadu_si256((const __m256i *)(haystack + i + needle_len - 1));
+		mask = (guint)_mm256_movemask_epi8(_mm256_and_si256(
+			_mm256_cmpeq_epi8(first, block_first),
+			_mm256_cmpeq_epi8(last, block_last)));
+		while (mask != 0) {
+			bit = __builtin_ctz(mask);
+			if (!memcmp(haystack + i + bit + 1, needle + 1, needle_len - 2)) {
+				return haystack + i + bit;
+			}
+			mask &= mask - 1;
+		}
+	}
+
+	/* Fewer than 32 positions left */
+	return memmem_sse2(haystack + i, haystack_len - i, needle, needle_len);
+}
+#endif
+
+typedef const guint8 *(*memmem_func_t)(const guint8 *haystack,
+		guint haystack_len, const guint8 *needle, guint needle_len);
+
+/* Chosen, by memmem_select(), the first time it's needed */
+static memmem_func_t memmem_func = NULL;
+
+static memmem_func_t
+memmem_select(void)
+{
+#if defined(EPAN_MEMMEM_AVX2)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return memmem_avx2;
+	return memmem_sse2;
+#elif defined(EPAN_MEMMEM_SSE2)
+	return memmem_sse2;
+#else
+	return memmem_scalar;
+#endif
+}
+
+/* Return the first occurrence of needle in haystack.
+ * If not found, return NULL.
+ * If either haystack or needle has 0 length, return NULL. */
+const guint8 *
+epan_memmem(const guint8 *haystack, guint haystack_len,
+		const guint8 *needle, guint needle_len)
+{
+	if (needle_len == 0) {
+		return NULL;
+	}
+
+	if (needle_len > haystack_len) {
+		return NULL;
+	}
+
+	if (needle_len == 1) {
+		return memchr(haystack, needle[0], haystack_len);
+	}
+
+	if (memmem_func == NULL) {
+		memmem_func = memmem_select();
+	}
+	return memmem_func(haystack, haystack_len, needle, needle_len);
+}
+
 /*
  * Scan the search string to make sure it's valid hex.  Return the
  * number of bytes in nbytes.
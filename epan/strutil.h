@@ -184,7 +184,7 @@ gchar*     xml_escape(const gchar *unescaped);
 
 /**
  * Return the first occurrence of needle in haystack.
- * Algorithm copied from GNU's glibc 2.3.2 memcmp()
+ * Uses SSE2 or, if the CPU has it, AVX2 where the compiler supports them.
  *
  * @param haystack The data to search
  * @param haystack_len The length of the search data
@@ -76,6 +76,8 @@ typedef struct _tap_listener_t {
 	tap_reset_cb reset;
 	tap_packet_cb packet;
 	tap_draw_cb draw;
+	tap_save_cb save;
+	tap_merge_cb merge;
 } tap_listener_t;
 static volatile tap_listener_t *tap_listener_queue=NULL;
 
@@ -421,6 +423,8 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->reset=reset;
 	tl->packet=packet;
 	tl->draw=draw;
+	tl->save=NULL;
+	tl->merge=NULL;
 	tl->next=(tap_listener_t *)tap_listener_queue;
 
 	tap_listener_queue=tl;
@@ -472,6 +476,23 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 	return NULL;
 }
 
+/* this function says how the results of a tap listener can be saved and
+ * merged with those of the same listener in another process
+ */
+void
+set_tap_listener_merge(void *tapdata, tap_save_cb save, tap_merge_cb merge)
+{
+	tap_listener_t *tl;
+
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		if(tl->tapdata==tapdata){
+			tl->save=save;
+			tl->merge=merge;
+			return;
+		}
+	}
+}
+
 /* this function removes a tap listener
  */
 void
@@ -558,6 +579,121 @@ have_filtering_tap_listeners(void)
 	return FALSE;
 }
 
+/*
+ * Return TRUE if the results of all the tap listeners that do more than
+ * help a dissector can be saved and merged.
+ */
+gboolean
+tap_listeners_mergeable(void)
+{
+	tap_listener_t *tl;
+
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		if(!(tl->flags & TL_IS_DISSECTOR_HELPER) && tl->merge==NULL)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * Append the results of all the tap listeners that have them, each
+ * preceded by its length, to "buf"; another process with the same tap
+ * listeners, in the same order, can merge them with merge_tap_listeners().
+ */
+void
+save_tap_listeners(GByteArray *buf)
+{
+	tap_listener_t *tl;
+	guint len_pos;
+	guint32 len;
+
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		if(tl->merge==NULL)
+			continue;
+		len_pos=buf->len;
+		len=0;
+		tap_save_bytes(buf, &len, sizeof len);
+		tl->save(tl->tapdata, buf);
+		len=(guint32)(buf->len - len_pos - sizeof len);
+		memcpy(buf->data + len_pos, &len, sizeof len);
+	}
+}
+
+/*
+ * Add results saved by save_tap_listeners() to those of our own tap
+ * listeners.  Returns FALSE if they don't make sense.
+ */
+gboolean
+merge_tap_listeners(const guint8 *data, guint len)
+{
+	tap_listener_t *tl;
+	tap_merge_data_t md, tl_md;
+	guint32 tl_len;
+
+	md.data=data;
+	md.len=len;
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		if(tl->merge==NULL)
+			continue;
+		if(!tap_merge_bytes(&md, &tl_len, sizeof tl_len) || tl_len>md.len)
+			return FALSE;
+		tl_md.data=md.data;
+		tl_md.len=tl_len;
+		if(!tl->merge(tl->tapdata, &tl_md) || tl_md.len!=0)
+			return FALSE;
+		tl->needs_redraw=TRUE;
+		md.data+=tl_len;
+		md.len-=tl_len;
+	}
+	return md.len==0;
+}
+
+void
+tap_save_bytes(GByteArray *buf, const void *data, guint len)
+{
+	g_byte_array_append(buf, (const guint8 *)data, len);
+}
+
+void
+tap_save_string(GByteArray *buf, const char *str)
+{
+	guint32 len = str ? (guint32)strlen(str) : G_MAXUINT32;
+
+	tap_save_bytes(buf, &len, sizeof len);
+	if(str)
+		tap_save_bytes(buf, str, len);
+}
+
+gboolean
+tap_merge_bytes(tap_merge_data_t *md, void *data, guint len)
+{
+	if(len>md->len)
+		return FALSE;
+	memcpy(data, md->data, len);
+	md->data+=len;
+	md->len-=len;
+	return TRUE;
+}
+
+/* the string is g_malloc()ed, or NULL if a NULL string was saved */
+gboolean
+tap_merge_string(tap_merge_data_t *md, gchar **str)
+{
+	guint32 len;
+
+	*str=NULL;
+	if(!tap_merge_bytes(md, &len, sizeof len))
+		return FALSE;
+	if(len==G_MAXUINT32)
+		return TRUE;
+	if(len>md->len)
+		return FALSE;
+	*str=g_strndup((const gchar *)md->data, len);
+	md->data+=len;
+	md->len-=len;
+	return TRUE;
+}
+
 /*
  * Get the union of all the flags for all the tap listeners; that gives
  * an indication of whether the protocol tree, or the columns, are
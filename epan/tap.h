@@ -31,6 +31,22 @@ typedef void (*tap_reset_cb)(void *tapdata);
 typedef gboolean (*tap_packet_cb)(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const void *data);
 typedef void (*tap_draw_cb)(void *tapdata);
 
+/*
+ * Taps whose results can be gathered by more than one process, each
+ * seeing some of the packets, and combined in one of them, as with
+ * "tshark -J": the save routine appends the results to "buf", and the
+ * merge routine adds results saved by the same tap listener in another
+ * process, read with tap_merge_bytes() and tap_merge_string(), to its own.
+ * The data only goes between copies of the same program, so it's in host
+ * byte order.
+ */
+typedef struct _tap_merge_data_t {
+	const guint8 *data;
+	guint len;
+} tap_merge_data_t;
+typedef void (*tap_save_cb)(void *tapdata, GByteArray *buf);
+typedef gboolean (*tap_merge_cb)(void *tapdata, tap_merge_data_t *md);
+
 /*
  * Flags to indicate what a tap listener's packet routine requires.
  */
@@ -61,4 +77,14 @@ extern gboolean have_filtering_tap_listeners(void);
 extern guint union_of_tap_listener_flags(void);
 extern const void *fetch_tapped_data(int tap_id, int idx);
 
+extern void set_tap_listener_merge(void *tapdata, tap_save_cb tap_save,
+    tap_merge_cb tap_merge);
+extern gboolean tap_listeners_mergeable(void);
+extern void save_tap_listeners(GByteArray *buf);
+extern gboolean merge_tap_listeners(const guint8 *data, guint len);
+extern void tap_save_bytes(GByteArray *buf, const void *data, guint len);
+extern void tap_save_string(GByteArray *buf, const char *str);
+extern gboolean tap_merge_bytes(tap_merge_data_t *md, void *data, guint len);
+extern gboolean tap_merge_string(tap_merge_data_t *md, gchar **str);
+
 #endif
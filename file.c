@@ -45,6 +45,7 @@
 
 #include <epan/epan.h>
 #include <epan/filesystem.h>
+#include <epan/follow.h>
 
 #include "color.h"
 #include "color_filters.h"
@@ -82,16 +83,42 @@ gboolean auto_scroll_live;
 #endif
 
 static guint32 cum_bytes;
-static nstime_t first_ts;
-static nstime_t prev_dis_ts;
-static nstime_t prev_cap_ts;
+static const frame_data *ref;
+static frame_data *prev_dis;
 
 static gulong computed_elapsed;
 
+/*
+ * Refiltering dissects every frame again.  To avoid that, we remember
+ * which frames passed the last few display filters, keyed by the filter
+ * text, so that going back to one of those filters needs no dissection
+ * at all, and a filter that only narrows one of them ("old && more")
+ * only needs the frames that passed "old" to be dissected.
+ *
+ * The results are only good for as long as the dissection and the
+ * per-frame state the filters can look at (marks, time references,
+ * comments) stay the same, so they're thrown away when either changes.
+ */
+#define N_FILTER_RESULTS    8
+
+typedef struct {
+  gchar   *text;          /* canonical filter text */
+  guint32  count;         /* number of frames the bitmaps cover */
+  guint8  *passed;        /* bit per frame: passed the filter */
+  guint8  *dependent;     /* bit per frame: a displayed frame depends on it */
+} filter_result;
+
+static GList *filter_results;   /* most recently used first */
+
+#define FILTER_RESULT_BIT(bits, framenum) \
+  (((bits)[((framenum) - 1) >> 3] >> (((framenum) - 1) & 7)) & 1)
+
 static void cf_reset_state(capture_file *cf);
+static void filter_results_clear(void);
 
 static int read_packet(capture_file *cf, dfilter_t *dfcode,
     gboolean filtering_tap_listeners, guint tap_flags, gint64 offset);
+static void read_packets_from_index(capture_file *cf);
 
 static void rescan_packets(capture_file *cf, const char *action, const char *action_item,
     gboolean refilter, gboolean redissect);
@@ -106,13 +133,7 @@ static match_result match_protocol_tree(capture_file *cf, frame_data *fdata,
 static void match_subtree_text(proto_node *node, gpointer data);
 static match_result match_summary_line(capture_file *cf, frame_data *fdata,
     void *criterion);
-static match_result match_ascii_and_unicode(capture_file *cf, frame_data *fdata,
-    void *criterion);
-static match_result match_ascii(capture_file *cf, frame_data *fdata,
-    void *criterion);
-static match_result match_unicode(capture_file *cf, frame_data *fdata,
-    void *criterion);
-static match_result match_binary(capture_file *cf, frame_data *fdata,
+static match_result match_packet_data(capture_file *cf, frame_data *fdata,
     void *criterion);
 static match_result match_dfilter(capture_file *cf, frame_data *fdata,
     void *criterion);
@@ -273,6 +294,19 @@ static void compute_elapsed(GTimeVal *start_time)
   computed_elapsed = (gulong) (delta_time / 1000); /* ms */
 }
 
+/* How frame_delta_abs_time() gets at other frames' time stamps. */
+static const nstime_t *
+cf_get_frame_ts(void *data, guint32 frame_num)
+{
+  capture_file *cf = (capture_file *)data;
+  frame_data   *fdata;
+
+  if (cf->frames == NULL)
+    return NULL;
+  fdata = frame_data_sequence_find(cf->frames, frame_num);
+  return (fdata != NULL) ? &fdata->abs_ts : NULL;
+}
+
 cf_status_t
 cf_open(capture_file *cf, const char *fname, gboolean is_tempfile, int *err)
 {
@@ -331,11 +365,11 @@ cf_open(capture_file *cf, const char *fname, gboolean is_tempfile, int *err)
 
   /* Allocate a frame_data_sequence for the frames in this file */
   cf->frames = new_frame_data_sequence();
+  frame_data_set_ts_func(cf_get_frame_ts, cf);
 
   nstime_set_zero(&cf->elapsed_time);
-  nstime_set_unset(&first_ts);
-  nstime_set_unset(&prev_dis_ts);
-  nstime_set_unset(&prev_cap_ts);
+  ref = NULL;
+  prev_dis = NULL;
   cum_bytes = 0;
 
   /* Adjust timestamp precision if auto is selected, col width will be adjusted */
@@ -388,6 +422,8 @@ cf_add_encapsulation_type(capture_file *cf, int encap)
 static void
 cf_reset_state(capture_file *cf)
 {
+  guint32 framenum;
+
   /* Die if we're in the middle of reading a file. */
   g_assert(cf->state != FILE_READ_IN_PROGRESS);
 
@@ -408,10 +444,15 @@ cf_reset_state(capture_file *cf)
 
   dfilter_free(cf->rfcode);
   cf->rfcode = NULL;
+  filter_results_clear();
   if (cf->frames != NULL) {
+    for (framenum = 1; framenum <= cf->count; framenum++)
+      frame_data_cleanup(frame_data_sequence_find(cf->frames, framenum));
     free_frame_data_sequence(cf->frames);
     cf->frames = NULL;
   }
+  frame_data_clear_side_tables();
+  cf_find_hits_clear(cf);
 #ifdef WANT_PACKET_EDITOR
   if (cf->edited_frames) {
     g_tree_destroy(cf->edited_frames);
@@ -520,6 +561,7 @@ cf_read(capture_file *cf, gboolean reloading)
   volatile int displayed_once = 0;
 #endif
   gboolean compiled;
+  gboolean indexed = FALSE;
 
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
@@ -569,7 +611,27 @@ cf_read(capture_file *cf, gboolean reloading)
   stop_flag = FALSE;
   g_get_current_time(&start_time);
 
-  while ((wtap_read(cf->wth, &err, &err_info, &data_offset))) {
+  /* If nothing needs every frame dissected while loading, a frame index
+     left behind by an earlier read lets us skip reading the file
+     sequentially; if something does, the seek points in it still let
+     a compressed file be inflated in parallel.  If there's no index,
+     record one while we read the file. */
+  err = 0;
+  if (prefs.gui_frame_index) {
+    if (wtap_index_load(cf->wth, cf->filename)) {
+      if (dfcode == NULL && cf->rfcode == NULL && !filtering_tap_listeners &&
+          tap_flags == 0) {
+        read_packets_from_index(cf);
+        indexed = TRUE;
+        /* None of those frames were dissected, so the TCP dissector
+           hasn't seen their segments. */
+        follow_tcp_index_invalidate();
+      }
+    } else if (!cf->is_tempfile)
+      wtap_index_start(cf->wth);
+  }
+
+  while (!indexed && (wtap_read(cf->wth, &err, &err_info, &data_offset))) {
     if (size >= 0) {
       count++;
       file_pos = wtap_read_so_far(cf->wth);
@@ -653,6 +715,14 @@ cf_read(capture_file *cf, gboolean reloading)
   /* We're done reading sequentially through the file. */
   cf->state = FILE_READ_DONE;
 
+  /* Save the frame index if we read all of the file.  It's only a
+     cache, so failing to write it isn't worth telling anybody about. */
+  if (!indexed && !stop_flag && err == 0) {
+    int index_err;
+
+    wtap_index_write(cf->wth, cf->filename, &index_err);
+  }
+
   /* Close the sequential I/O side, to free up memory it requires. */
   wtap_sequential_close(cf->wth);
 
@@ -1076,6 +1146,245 @@ find_and_mark_frame_depended_upon(gpointer data, gpointer user_data)
   dependent_fd->flags.dependent_of_displayed = 1;
 }
 
+static void
+filter_result_free(filter_result *result)
+{
+  g_free(result->text);
+  g_free(result->passed);
+  g_free(result->dependent);
+  g_free(result);
+}
+
+static void
+filter_results_clear(void)
+{
+  GList *entry;
+
+  for (entry = filter_results; entry != NULL; entry = entry->next)
+    filter_result_free((filter_result *)entry->data);
+  g_list_free(filter_results);
+  filter_results = NULL;
+}
+
+/*
+ * Return the filter text with leading and trailing white space removed
+ * and other runs of white space, outside strings, collapsed to a single
+ * blank, or NULL if the filter's results shouldn't be remembered.
+ */
+static gchar *
+filter_canonical_text(const char *dftext)
+{
+  GString *text;
+  gboolean in_string = FALSE;
+  gboolean space = FALSE;
+  const char *p;
+
+  if (dftext == NULL)
+    return g_strdup("");
+
+  /* What a macro expands to can change under us. */
+  if (strstr(dftext, "${") != NULL)
+    return NULL;
+
+  text = g_string_new("");
+  for (p = dftext; *p != '\0'; p++) {
+    if (!in_string && g_ascii_isspace(*p)) {
+      space = TRUE;
+      continue;
+    }
+    if (space && text->len != 0)
+      g_string_append_c(text, ' ');
+    space = FALSE;
+    g_string_append_c(text, *p);
+    if (in_string && *p == '\\' && p[1] != '\0')
+      g_string_append_c(text, *++p);
+    else if (*p == '"')
+      in_string = !in_string;
+  }
+  return g_string_free(text, FALSE);
+}
+
+/* Look for the results of a filter, making them the most recently used. */
+static filter_result *
+filter_results_lookup(const gchar *text)
+{
+  GList *entry;
+
+  for (entry = filter_results; entry != NULL; entry = entry->next) {
+    if (strcmp(((filter_result *)entry->data)->text, text) == 0) {
+      filter_results = g_list_remove_link(filter_results, entry);
+      filter_results = g_list_concat(entry, filter_results);
+      return (filter_result *)entry->data;
+    }
+  }
+  return NULL;
+}
+
+/* Is "text" the filter "narrowed" combined with something else by "and"? */
+static gboolean
+filter_narrows(const gchar *text, const gchar *narrowed)
+{
+  size_t len = strlen(narrowed);
+
+  if (len == 0)
+    return FALSE;
+  if (text[0] == '(' && strncmp(text + 1, narrowed, len) == 0 &&
+      text[len + 1] == ')') {
+    /* "(old) && more", "(old)&&more" or "(old) and more" */
+    text += len + 2;
+    if (*text == ' ')
+      text++;
+    return strncmp(text, "&&", 2) == 0 || strncmp(text, "and ", 4) == 0;
+  } else if (strncmp(text, narrowed, len) == 0 && text[len] == ' ') {
+    text += len + 1;
+  } else {
+    return FALSE;
+  }
+
+  /*
+   * "and" binds less tightly than anything else in the filter grammar,
+   * so "old and more" is always "(old) and (more)".
+   */
+  return strncmp(text, "&& ", 3) == 0 || strncmp(text, "and ", 4) == 0;
+}
+
+/* Find the results of a filter that "text" narrows. */
+static filter_result *
+filter_results_narrowed(const gchar *text)
+{
+  GList *entry;
+  filter_result *result;
+
+  for (entry = filter_results; entry != NULL; entry = entry->next) {
+    result = (filter_result *)entry->data;
+    if (filter_narrows(text, result->text))
+      return result;
+  }
+  return NULL;
+}
+
+/* Start remembering the results of a filter, in place of any we had. */
+static filter_result *
+filter_results_new(capture_file *cf, gchar *text)
+{
+  filter_result *result;
+  GList *last;
+
+  /* Replace what we had for this filter, if anything. */
+  result = filter_results_lookup(text);
+  if (result != NULL) {
+    filter_results = g_list_remove(filter_results, result);
+    filter_result_free(result);
+  }
+
+  result = g_new(filter_result, 1);
+  result->text = text;
+  result->count = cf->count;
+  result->passed = (guint8 *)g_malloc0((cf->count + 7) / 8);
+  result->dependent = (guint8 *)g_malloc0((cf->count + 7) / 8);
+  filter_results = g_list_prepend(filter_results, result);
+
+  if (g_list_length(filter_results) > N_FILTER_RESULTS) {
+    last = g_list_last(filter_results);
+    filter_result_free((filter_result *)last->data);
+    filter_results = g_list_delete_link(filter_results, last);
+  }
+  return result;
+}
+
+/* Remember which frames passed the current filter. */
+static void
+filter_results_add(capture_file *cf, gchar *text)
+{
+  filter_result *result;
+  guint32 framenum;
+  frame_data *fdata;
+
+  result = filter_results_new(cf, text);
+  for (framenum = 1; framenum <= cf->count; framenum++) {
+    fdata = frame_data_sequence_find(cf->frames, framenum);
+    if (fdata->flags.passed_dfilter)
+      result->passed[(framenum - 1) >> 3] |= 1 << ((framenum - 1) & 7);
+    if (fdata->flags.dependent_of_displayed)
+      result->dependent[(framenum - 1) >> 3] |= 1 << ((framenum - 1) & 7);
+  }
+}
+
+/*
+ * Something other than the filter itself, such as an index a dissector
+ * keeps, says which frames pass a filter; remember that, so that applying
+ * the filter doesn't have to dissect them all to find out.
+ */
+void
+cf_filter_results_set(capture_file *cf, const char *dftext,
+                      const guint32 *frames, guint nframes)
+{
+  filter_result *result;
+  gchar *text;
+  guint i;
+
+  text = filter_canonical_text(dftext);
+  if (text == NULL)
+    return;
+
+  result = filter_results_new(cf, text);
+  for (i = 0; i < nframes; i++) {
+    if (frames[i] >= 1 && frames[i] <= cf->count)
+      result->passed[(frames[i] - 1) >> 3] |= 1 << ((frames[i] - 1) & 7);
+  }
+}
+
+/* Do we know which frames pass a filter without dissecting them? */
+gboolean
+cf_filter_results_known(capture_file *cf _U_, const char *dftext)
+{
+  gchar *text;
+  gboolean known;
+
+  text = filter_canonical_text(dftext);
+  if (text == NULL)
+    return FALSE;
+  known = filter_results_lookup(text) != NULL;
+  g_free(text);
+  return known;
+}
+
+/*
+ * Something a display filter can look at has changed for some frames;
+ * what we remember about earlier filters may no longer be right.
+ */
+void
+cf_filter_results_invalidate(capture_file *cf _U_)
+{
+  filter_results_clear();
+}
+
+/*
+ * Do for a frame whose filter result we already know what
+ * add_packet_to_packet_list() does, without dissecting it.
+ */
+static void
+add_filtered_packet_to_packet_list(frame_data *fdata, capture_file *cf,
+    gboolean passed, gboolean dependent)
+{
+  frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                &ref, prev_dis);
+
+  fdata->flags.passed_dfilter = passed ? 1 : 0;
+  if (dependent)
+    fdata->flags.dependent_of_displayed = 1;
+
+  if(fdata->flags.passed_dfilter || fdata->flags.ref_time)
+  {
+    cf->displayed_count++;
+    frame_data_set_after_dissect(fdata, &cum_bytes);
+    prev_dis = fdata;
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+    cf->last_displayed = fdata->num;
+  }
+}
+
 static int
 add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
     dfilter_t *dfcode, gboolean filtering_tap_listeners,
@@ -1092,7 +1401,7 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
   cinfo = (tap_flags & TL_REQUIRES_COLUMNS) ? &cf->cinfo : NULL;
 
   frame_data_set_before_dissect(fdata, &cf->elapsed_time,
-                                &first_ts, &prev_dis_ts, &prev_cap_ts);
+                                &ref, prev_dis);
 
   /* If either
     + we have a display filter and are re-applying it;
@@ -1146,7 +1455,8 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
 
   if(fdata->flags.passed_dfilter || fdata->flags.ref_time)
   {
-    frame_data_set_after_dissect(fdata, &cum_bytes, &prev_dis_ts);
+    frame_data_set_after_dissect(fdata, &cum_bytes);
+    prev_dis = fdata;
 
     /* If we haven't yet seen the first frame, this is it.
 
@@ -1172,6 +1482,50 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
   return row;
 }
 
+/*
+ * Add all the frames of a file from its frame index, without reading or
+ * dissecting them; the packet list dissects rows when they're shown.
+ * Only used when there's no display or read filter and no tap listener
+ * that wants to see the frames.
+ */
+static void
+read_packets_from_index(capture_file *cf)
+{
+  struct wtap_pkthdr phdr;
+  gint64        data_offset;
+  guint32       i, count;
+  frame_data    fdlocal;
+  frame_data   *fdata;
+
+  count = wtap_index_count(cf->wth);
+  for (i = 0; i < count; i++) {
+    if (!wtap_index_get(cf->wth, i, &phdr, &data_offset))
+      break;
+
+    cf_add_encapsulation_type(cf, phdr.pkt_encap);
+    frame_data_init(&fdlocal, cf->count + 1, &phdr, data_offset, cum_bytes);
+
+    /* This does a shallow copy of fdlocal, which is good enough. */
+    fdata = frame_data_sequence_add(cf->frames, &fdlocal);
+    cf->count++;
+    cf->f_datalen = data_offset + fdlocal.cap_len;
+
+    frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                  &ref, prev_dis);
+    fdata->flags.passed_dfilter = 1;
+    cf->displayed_count++;
+    frame_data_set_after_dissect(fdata, &cum_bytes);
+    prev_dis = fdata;
+
+    /* See add_packet_to_packet_list() for why this comes first. */
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+    cf->last_displayed = fdata->num;
+
+    new_packet_list_append(NULL, fdata, NULL);
+  }
+}
+
 /* read in a new packet */
 /* returns the row of the new packet in the packet list or -1 if not displayed */
 static int
@@ -1216,7 +1570,7 @@ read_packet(capture_file *cf, dfilter_t *dfcode,
     fdata = frame_data_sequence_add(cf->frames, &fdlocal);
 
     cf->count++;
-    if (fdlocal.opt_comment != NULL)
+    if (fdlocal.flags.has_comment)
       cf->packet_comment_count++;
     cf->f_datalen = offset + fdlocal.cap_len;
 
@@ -1225,6 +1579,9 @@ read_packet(capture_file *cf, dfilter_t *dfcode,
                                       filtering_tap_listeners, tap_flags,
                                       pseudo_header, buf, TRUE, TRUE);
     }
+  } else {
+    /* We won't see this frame again. */
+    frame_data_cleanup(&fdlocal);
   }
 
   return row;
@@ -1564,6 +1921,8 @@ cf_filter_packets(capture_file *cf, gchar *dftext, gboolean force)
 void
 cf_reftime_packets(capture_file *cf)
 {
+  /* frame.ref_time and the relative times may have changed */
+  cf_filter_results_invalidate(cf);
 
   ref_time_packets(cf);
 }
@@ -1670,6 +2029,9 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
   guint       tap_flags;
   gboolean    add_to_packet_list = FALSE;
   gboolean compiled;
+  gchar      *filter_text;
+  filter_result *known = NULL;
+  filter_result *narrowed = NULL;
 
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
@@ -1685,6 +2047,23 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
   tap_flags = union_of_tap_listener_flags();
 
   reset_tap_listeners();
+
+  /* The packets displayed may change, so "Find all" has to be done again. */
+  cf_find_hits_clear(cf);
+
+  filter_text = filter_canonical_text(cf->dfilter);
+  if (redissect) {
+    /* Everything we knew about filter results is out of date. */
+    filter_results_clear();
+  } else if (refilter && filter_text != NULL &&
+             !tap_listeners_require_dissection()) {
+    /* If nothing other than the filter wants to see the frames, we
+       can skip the ones whose fate we already know. */
+    known = filter_results_lookup(filter_text);
+    if (known == NULL)
+      narrowed = filter_results_narrowed(filter_text);
+  }
+
   /* Which frame, if any, is the currently selected frame?
      XXX - should the selected frame or the focus frame be the "current"
      frame, that frame being the one from which "Find Frame" searches
@@ -1729,9 +2108,8 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
   /* Iterate through the list of frames.  Call a routine for each frame
      to check whether it should be displayed and, if so, add it to
      the display list. */
-  nstime_set_unset(&first_ts);
-  nstime_set_unset(&prev_dis_ts);
-  nstime_set_unset(&prev_cap_ts);
+  ref = NULL;
+  prev_dis = NULL;
   cum_bytes = 0;
 
   /* Update the progress bar when it gets to this value. */
@@ -1812,9 +2190,8 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
 
     if (redissect) {
       /* Since all state for the frame was destroyed, mark the frame
-       * as not visited, free the GSList referring to the state
-       * data (the per-frame data itself was freed by
-       * "init_dissection()"), and null out the GSList pointer. */
+       * as not visited and free the map of state data (the per-frame
+       * data itself was freed by "init_dissection()"). */
       fdata->flags.visited = 0;
       frame_data_cleanup(fdata);
     }
@@ -1826,9 +2203,6 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
       fdata->flags.dependent_of_displayed = 0;
     }
 
-    if (!cf_read_frame(cf, fdata))
-      break; /* error reading the frame */
-
     /* If the previous frame is displayed, and we haven't yet seen the
        selected frame, remember that frame - it's the closest one we've
        yet seen before the selected frame. */
@@ -1836,10 +2210,25 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
       preceding_frame_num = prev_frame_num;
       preceding_frame = prev_frame;
     }
-    add_packet_to_packet_list(fdata, cf, dfcode, filtering_tap_listeners,
-                                    tap_flags, &cf->pseudo_header, cf->pd,
-                                    refilter,
-                                    add_to_packet_list);
+
+    if (known != NULL && framenum <= known->count) {
+      /* We've filtered this frame with this filter before. */
+      add_filtered_packet_to_packet_list(fdata, cf,
+                                         FILTER_RESULT_BIT(known->passed, framenum),
+                                         FILTER_RESULT_BIT(known->dependent, framenum));
+    } else if (narrowed != NULL && framenum <= narrowed->count &&
+               !FILTER_RESULT_BIT(narrowed->passed, framenum)) {
+      /* It didn't pass the filter this one narrows. */
+      add_filtered_packet_to_packet_list(fdata, cf, FALSE, FALSE);
+    } else {
+      if (!cf_read_frame(cf, fdata))
+        break; /* error reading the frame */
+
+      add_packet_to_packet_list(fdata, cf, dfcode, filtering_tap_listeners,
+                                      tap_flags, &cf->pseudo_header, cf->pd,
+                                      refilter,
+                                      add_to_packet_list);
+    }
 
     /* If this frame is displayed, and this is the first frame we've
        seen displayed after the selected frame, remember this frame -
@@ -1864,6 +2253,12 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item,
   /* We are done redissecting the packet list. */
   cf->redissecting = FALSE;
 
+  /* If we got through all the frames, remember which ones passed. */
+  if (filter_text != NULL && refilter && framenum > cf->count)
+    filter_results_add(cf, filter_text);
+  else
+    g_free(filter_text);
+
   if (redissect) {
     /* Clear out what remains of the visited flags and per-frame data
        pointers.
@@ -1969,9 +2364,10 @@ ref_time_packets(capture_file *cf)
 {
   guint32 framenum;
   frame_data *fdata;
+  nstime_t rel_ts;
 
-  nstime_set_unset(&first_ts);
-  nstime_set_unset(&prev_dis_ts);
+  ref = NULL;
+  prev_dis = NULL;
   cum_bytes = 0;
 
   for (framenum = 1; framenum <= cf->count; framenum++) {
@@ -1984,42 +2380,30 @@ ref_time_packets(capture_file *cf)
      *Timestamps
      */
 
-    /* If we don't have the time stamp of the first packet in the
-     capture, it's because this is the first packet.  Save the time
-     stamp of this packet as the time stamp of the first packet. */
-    if (nstime_is_unset(&first_ts)) {
-        first_ts  = fdata->abs_ts;
-    }
-      /* if this frames is marked as a reference time frame, reset
-        firstsec and firstusec to this frame */
-    if(fdata->flags.ref_time){
-        first_ts = fdata->abs_ts;
-    }
-
-    /* If we don't have the time stamp of the previous displayed packet,
-     it's because this is the first displayed packet.  Save the time
-     stamp of this packet as the time stamp of the previous displayed
-     packet. */
-    if (nstime_is_unset(&prev_dis_ts)) {
-        prev_dis_ts = fdata->abs_ts;
+    /* If we don't have the frame the time stamps are relative to, it's
+     because this is the first packet; if this frame is marked as a
+     reference time frame, they're relative to it from now on. */
+    if (ref == NULL || fdata->flags.ref_time) {
+        ref = fdata;
     }
+    fdata->frame_ref_num = ref->num;
 
     /* Get the time elapsed between the first packet and this packet. */
-    nstime_delta(&fdata->rel_ts, &fdata->abs_ts, &first_ts);
+    nstime_delta(&rel_ts, &fdata->abs_ts, &ref->abs_ts);
 
     /* If it's greater than the current elapsed time, set the elapsed time
      to it (we check for "greater than" so as not to be confused by
      time moving backwards). */
-    if ((gint32)cf->elapsed_time.secs < fdata->rel_ts.secs
-        || ((gint32)cf->elapsed_time.secs == fdata->rel_ts.secs && (gint32)cf->elapsed_time.nsecs < fdata->rel_ts.nsecs)) {
-        cf->elapsed_time = fdata->rel_ts;
+    if ((gint32)cf->elapsed_time.secs < rel_ts.secs
+        || ((gint32)cf->elapsed_time.secs == rel_ts.secs && (gint32)cf->elapsed_time.nsecs < rel_ts.nsecs)) {
+        cf->elapsed_time = rel_ts;
     }
 
-    /* If this frame is displayed, get the time elapsed between the
-     previous displayed packet and this packet. */
+    /* If this frame is displayed, the time elapsed between the previous
+     displayed packet and this packet is worked out from that packet. */
     if( fdata->flags.passed_dfilter ) {
-        nstime_delta(&fdata->del_dis_ts, &fdata->abs_ts, &prev_dis_ts);
-        prev_dis_ts = fdata->abs_ts;
+        fdata->prev_dis_num = (prev_dis != NULL) ? prev_dis->num : 0;
+        prev_dis = fdata;
     }
 
     /*
@@ -2239,6 +2623,62 @@ cf_retap_packets(capture_file *cf)
   return CF_READ_OK;
 }
 
+static gboolean
+dissect_frame_only(capture_file *cf _U_, frame_data *fdata,
+                   union wtap_pseudo_header *pseudo_header, const guint8 *pd,
+                   void *argsp _U_)
+{
+  epan_dissect_t edt;
+
+  epan_dissect_init(&edt, FALSE, FALSE);
+  epan_dissect_run(&edt, pseudo_header, pd, fdata, NULL);
+  epan_dissect_cleanup(&edt);
+
+  return TRUE;
+}
+
+cf_read_status_t
+cf_dissect_frames(capture_file *cf, const guint32 *frames, guint nframes)
+{
+  packet_range_t range;
+  frame_data    *fdata;
+  guint          i;
+  union wtap_pseudo_header pseudo_header;
+  guint8         pd[WTAP_MAX_PACKET_SIZE+1];
+
+  if (frames == NULL) {
+    /* All of them. */
+    packet_range_init(&range);
+    packet_range_process_init(&range);
+    switch (process_specified_packets(cf, &range, "Dissecting",
+                                      "all packets", TRUE, dissect_frame_only,
+                                      NULL)) {
+    case PSP_FINISHED:
+      return CF_READ_OK;
+
+    case PSP_STOPPED:
+      return CF_READ_ABORTED;
+
+    case PSP_FAILED:
+      return CF_READ_ERROR;
+    }
+    g_assert_not_reached();
+  }
+
+  /* Just these; there shouldn't be so many that it's worth a progress
+     dialog.  Read them into our own buffer, not cf->pd, so that we
+     don't clobber the data for the currently selected packet. */
+  for (i = 0; i < nframes; i++) {
+    fdata = frame_data_sequence_find(cf->frames, frames[i]);
+    if (fdata == NULL)
+      continue;
+    if (!cf_read_frame_r(cf, fdata, &pseudo_header, pd))
+      return CF_READ_ERROR;
+    dissect_frame_only(cf, fdata, &pseudo_header, pd, NULL);
+  }
+  return CF_READ_OK;
+}
+
 typedef struct {
   print_args_t *print_args;
   gboolean      print_header_line;
@@ -2985,14 +3425,37 @@ typedef struct {
     size_t data_len;
 } cbs_t;    /* "Counted byte string" */
 
-gboolean
-cf_find_packet_data(capture_file *cf, const guint8 *string, size_t string_size,
-                    search_direction dir)
-{
-  cbs_t info;
+/*
+ * Searches of the packet data work on a buffer rather than on cf->pd, so
+ * that "Find all" can run them in other threads; they return TRUE, and
+ * the position of the last byte of the match in *search_pos, if the data
+ * matches.
+ */
+typedef gboolean (*data_search_func)(const guint8 *pd, guint32 buf_len,
+    const cbs_t *info, gboolean case_type, guint32 *search_pos);
 
-  info.data = string;
-  info.data_len = string_size;
+typedef struct {
+    data_search_func search;
+    cbs_t            info;
+} data_search_t;
+
+static gboolean search_ascii_and_unicode(const guint8 *pd, guint32 buf_len,
+    const cbs_t *info, gboolean case_type, guint32 *search_pos);
+static gboolean search_ascii(const guint8 *pd, guint32 buf_len,
+    const cbs_t *info, gboolean case_type, guint32 *search_pos);
+static gboolean search_unicode(const guint8 *pd, guint32 buf_len,
+    const cbs_t *info, gboolean case_type, guint32 *search_pos);
+static gboolean search_binary(const guint8 *pd, guint32 buf_len,
+    const cbs_t *info, gboolean case_type, guint32 *search_pos);
+
+/* Set up the search of the packet data for "string" that the search
+   parameters in cf call for. */
+static void
+data_search_init(capture_file *cf, data_search_t *ds, const guint8 *string,
+                 size_t string_size)
+{
+  ds->info.data = string;
+  ds->info.data_len = string_size;
 
   /* String or hex search? */
   if (cf->string) {
@@ -3000,33 +3463,40 @@ cf_find_packet_data(capture_file *cf, const guint8 *string, size_t string_size,
     switch (cf->scs_type) {
 
     case SCS_ASCII_AND_UNICODE:
-      return find_packet(cf, match_ascii_and_unicode, &info, dir);
+      ds->search = search_ascii_and_unicode;
+      break;
 
     case SCS_ASCII:
-      return find_packet(cf, match_ascii, &info, dir);
+      ds->search = search_ascii;
+      break;
 
     case SCS_UNICODE:
-      return find_packet(cf, match_unicode, &info, dir);
+      ds->search = search_unicode;
+      break;
 
     default:
       g_assert_not_reached();
-      return FALSE;
+      ds->search = search_binary;
+      break;
     }
   } else
-    return find_packet(cf, match_binary, &info, dir);
+    ds->search = search_binary;
+}
+
+gboolean
+cf_find_packet_data(capture_file *cf, const guint8 *string, size_t string_size,
+                    search_direction dir)
+{
+  data_search_t ds;
+
+  data_search_init(cf, &ds, string, string_size);
+  return find_packet(cf, match_packet_data, &ds, dir);
 }
 
 static match_result
-match_ascii_and_unicode(capture_file *cf, frame_data *fdata, void *criterion)
+match_packet_data(capture_file *cf, frame_data *fdata, void *criterion)
 {
-  cbs_t        *info = criterion;
-  const guint8 *ascii_text = info->data;
-  size_t       textlen = info->data_len;
-  match_result result;
-  guint32      buf_len;
-  guint32      i;
-  guint8       c_char;
-  size_t       c_match = 0;
+  data_search_t *ds = criterion;
 
   /* Load the frame's data. */
   if (!cf_read_frame(cf, fdata)) {
@@ -3034,21 +3504,34 @@ match_ascii_and_unicode(capture_file *cf, frame_data *fdata, void *criterion)
     return MR_ERROR;
   }
 
-  result = MR_NOTMATCHED;
-  buf_len = fdata->pkt_len;
+  if ((*ds->search)(cf->pd, fdata->cap_len, &ds->info, cf->case_type,
+                    &cf->search_pos))
+    return MR_MATCHED;
+  return MR_NOTMATCHED;
+}
+
+static gboolean
+search_ascii_and_unicode(const guint8 *pd, guint32 buf_len, const cbs_t *info,
+                         gboolean case_type, guint32 *search_pos)
+{
+  const guint8 *ascii_text = info->data;
+  size_t       textlen = info->data_len;
+  guint32      i;
+  guint8       c_char;
+  size_t       c_match = 0;
+
   i = 0;
   while (i < buf_len) {
-    c_char = cf->pd[i];
-    if (cf->case_type)
+    c_char = pd[i];
+    if (case_type)
       c_char = toupper(c_char);
     if (c_char != '\0') {
       if (c_char == ascii_text[c_match]) {
         c_match += 1;
         if (c_match == textlen) {
-          result = MR_MATCHED;
-          cf->search_pos = i; /* Save the position of the last character
-                                 for highlighting the field. */
-          break;
+          *search_pos = i; /* Save the position of the last character
+                              for highlighting the field. */
+          return TRUE;
         }
       }
       else {
@@ -3059,41 +3542,32 @@ match_ascii_and_unicode(capture_file *cf, frame_data *fdata, void *criterion)
     }
     i += 1;
   }
-  return result;
+  return FALSE;
 }
 
-static match_result
-match_ascii(capture_file *cf, frame_data *fdata, void *criterion)
+static gboolean
+search_ascii(const guint8 *pd, guint32 buf_len, const cbs_t *info,
+             gboolean case_type, guint32 *search_pos)
 {
-  cbs_t        *info = criterion;
   const guint8 *ascii_text = info->data;
   size_t       textlen = info->data_len;
-  match_result result;
-  guint32      buf_len;
   guint32      i;
   guint8       c_char;
   size_t       c_match = 0;
 
-  /* Load the frame's data. */
-  if (!cf_read_frame(cf, fdata)) {
-    /* Attempt to get the packet failed. */
-    return MR_ERROR;
+  if (!case_type) {
+    /* The text is as it is in the packet; search for it as for bytes. */
+    return search_binary(pd, buf_len, info, case_type, search_pos);
   }
-
-  result = MR_NOTMATCHED;
-  buf_len = fdata->pkt_len;
   i = 0;
   while (i < buf_len) {
-    c_char = cf->pd[i];
-    if (cf->case_type)
-      c_char = toupper(c_char);
+    c_char = toupper(pd[i]);
     if (c_char == ascii_text[c_match]) {
       c_match += 1;
       if (c_match == textlen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        break;
+        *search_pos = i; /* Save the position of the last character
+                            for highlighting the field. */
+        return TRUE;
       }
     }
     else {
@@ -3103,42 +3577,30 @@ match_ascii(capture_file *cf, frame_data *fdata, void *criterion)
     }
     i += 1;
   }
-
-  return result;
+  return FALSE;
 }
 
-static match_result
-match_unicode(capture_file *cf, frame_data *fdata, void *criterion)
+static gboolean
+search_unicode(const guint8 *pd, guint32 buf_len, const cbs_t *info,
+               gboolean case_type, guint32 *search_pos)
 {
-  cbs_t        *info = criterion;
   const guint8 *ascii_text = info->data;
   size_t       textlen = info->data_len;
-  match_result result;
-  guint32      buf_len;
   guint32      i;
   guint8       c_char;
   size_t       c_match = 0;
 
-  /* Load the frame's data. */
-  if (!cf_read_frame(cf, fdata)) {
-    /* Attempt to get the packet failed. */
-    return MR_ERROR;
-  }
-
-  result = MR_NOTMATCHED;
-  buf_len = fdata->pkt_len;
   i = 0;
   while (i < buf_len) {
-    c_char = cf->pd[i];
-    if (cf->case_type)
+    c_char = pd[i];
+    if (case_type)
       c_char = toupper(c_char);
     if (c_char == ascii_text[c_match]) {
       c_match += 1;
       if (c_match == textlen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        break;
+        *search_pos = i; /* Save the position of the last character
+                            for highlighting the field. */
+        return TRUE;
       }
       i += 1;
     }
@@ -3149,47 +3611,21 @@ match_unicode(capture_file *cf, frame_data *fdata, void *criterion)
     }
     i += 1;
   }
-  return result;
+  return FALSE;
 }
 
-static match_result
-match_binary(capture_file *cf, frame_data *fdata, void *criterion)
+static gboolean
+search_binary(const guint8 *pd, guint32 buf_len, const cbs_t *info,
+              gboolean case_type _U_, guint32 *search_pos)
 {
-  cbs_t        *info = criterion;
-  const guint8 *binary_data = info->data;
-  size_t       datalen = info->data_len;
-  match_result result;
-  guint32      buf_len;
-  guint32      i;
-  size_t       c_match = 0;
-
-  /* Load the frame's data. */
-  if (!cf_read_frame(cf, fdata)) {
-    /* Attempt to get the packet failed. */
-    return MR_ERROR;
-  }
+  const guint8 *found;
 
-  result = MR_NOTMATCHED;
-  buf_len = fdata->pkt_len;
-  i = 0;
-  while (i < buf_len) {
-    if (cf->pd[i] == binary_data[c_match]) {
-      c_match += 1;
-      if (c_match == datalen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        break;
-      }
-    }
-    else {
-      g_assert(i>=c_match);
-      i -= (guint32)c_match;
-      c_match = 0;
-    }
-    i += 1;
-  }
-  return result;
+  found = epan_memmem(pd, buf_len, info->data, (guint)info->data_len);
+  if (found == NULL)
+    return FALSE;
+  /* Save the position of the last character for highlighting the field. */
+  *search_pos = (guint32)(found - pd + info->data_len - 1);
+  return TRUE;
 }
 
 gboolean
@@ -3443,6 +3879,430 @@ find_packet(capture_file *cf,
     return FALSE;   /* failure */
 }
 
+/*
+ * "Find all": every displayed packet that matches the search criterion,
+ * found in one pass, so that going to the next or previous match is a
+ * binary search of the list rather than another scan of the capture.
+ */
+struct _search_hits {
+  GArray        *frames;      /* numbers of the matching frames, in order */
+  data_search_t  data;        /* criterion for a data search... */
+  guint8        *data_string; /* ...and the bytes it looks for */
+  gboolean       is_data;     /* TRUE if it's a search of the packet data */
+};
+
+/* Most threads used for a search of the packet data, and fewest frames
+   worth a thread of their own. */
+#define FIND_ALL_MAX_THREADS  8
+#define FIND_ALL_MIN_FRAMES   2048
+
+/* Frames each thread searches, and what it found. */
+typedef struct {
+  capture_file        *cf;
+  const data_search_t *ds;
+  guint32              first;     /* first frame to search */
+  guint32              last;      /* last frame to search */
+  GArray              *hits;      /* frames that match */
+  GArray              *unread;    /* frames the main thread has to do */
+  volatile gint       *searched;  /* frames searched, by all threads */
+  volatile gint       *found;     /* matches found, by all threads */
+  volatile gint       *stop;      /* set if the user cancelled the search */
+  volatile gint        done;      /* set when the thread has finished */
+} find_all_task_t;
+
+static gpointer
+find_all_thread(gpointer data)
+{
+  find_all_task_t         *task = data;
+  capture_file            *cf = task->cf;
+  wtap                    *wth;
+  frame_data              *fdata;
+  union wtap_pseudo_header pseudo_header;
+  guint8                  *pd;
+  guint32                  framenum, search_pos;
+  int                      err;
+  gchar                   *err_info;
+
+  /* Each thread reads the file for itself; a wtap isn't thread-safe. */
+  wth = wtap_open_offline(cf->filename, &err, &err_info, TRUE);
+  pd = g_malloc(WTAP_MAX_PACKET_SIZE);
+  for (framenum = task->first; framenum <= task->last; framenum++) {
+    if (g_atomic_int_get(task->stop))
+      break;
+    fdata = frame_data_sequence_find(cf->frames, framenum);
+    if (fdata->flags.passed_dfilter) {
+      if (wth == NULL || fdata->file_off == -1 ||
+          !wtap_seek_read(wth, fdata->file_off, &pseudo_header, pd,
+                          fdata->cap_len, &err, &err_info)) {
+        /* Edited frames, and errors, are left to the main thread, which
+           can get at the former and report the latter. */
+        g_array_append_val(task->unread, framenum);
+      } else if ((*task->ds->search)(pd, fdata->cap_len, &task->ds->info,
+                                     cf->case_type, &search_pos)) {
+        g_array_append_val(task->hits, framenum);
+        g_atomic_int_inc(task->found);
+      }
+    }
+    g_atomic_int_inc(task->searched);
+  }
+  g_free(pd);
+  if (wth != NULL)
+    wtap_close(wth);
+  g_atomic_int_set(&task->done, 1);
+  return NULL;
+}
+
+static int
+find_all_thread_count(capture_file *cf)
+{
+  int n_threads = 1;
+
+  /* The threads read the file themselves, so it has to be all there. */
+  if (cf->state != FILE_READ_DONE || cf->filename == NULL)
+    return 1;
+#if !GLIB_CHECK_VERSION(2,31,0)
+  if (!g_thread_supported())
+    return 1;
+#endif
+#ifdef _SC_NPROCESSORS_ONLN
+  n_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  if (n_threads > FIND_ALL_MAX_THREADS)
+    n_threads = FIND_ALL_MAX_THREADS;
+  if (n_threads > (int)(cf->count / FIND_ALL_MIN_FRAMES))
+    n_threads = cf->count / FIND_ALL_MIN_FRAMES;
+  return n_threads < 1 ? 1 : n_threads;
+}
+
+static gboolean find_all_sequential(capture_file *cf,
+    match_result (*match_function)(capture_file *, frame_data *, void *),
+    void *criterion, GArray *hits);
+
+static gint
+compare_frame_nums(gconstpointer a, gconstpointer b)
+{
+  guint32 fa = *(const guint32 *)a;
+  guint32 fb = *(const guint32 *)b;
+
+  return fa < fb ? -1 : (fa > fb ? 1 : 0);
+}
+
+/*
+ * Search the packet data of every displayed frame, splitting the frames
+ * among threads.  Returns FALSE if the user stopped the search or a frame
+ * couldn't be read.
+ */
+static gboolean
+find_all_data(capture_file *cf, const data_search_t *ds, GArray *hits)
+{
+  find_all_task_t *tasks;
+  GThread        **threads;
+  int              n_threads, i;
+  guint32          per_thread, j, framenum;
+  volatile gint    searched = 0, found = 0, stop = 0;
+  gboolean         all_done, stop_flag = FALSE;
+  gboolean         sort = FALSE, ok = TRUE;
+  progdlg_t       *progbar = NULL;
+  GTimeVal         start_time;
+  gchar            status_str[100];
+  const char      *title = cf->sfilter ? cf->sfilter : "";
+  frame_data      *fdata;
+  match_result     result;
+
+  n_threads = find_all_thread_count(cf);
+  if (n_threads == 1) {
+    /* Not worth it; the main thread does the lot. */
+    return find_all_sequential(cf, match_packet_data, (void *)ds, hits);
+  }
+
+  tasks = g_new0(find_all_task_t, n_threads);
+  threads = g_new0(GThread *, n_threads);
+  per_thread = cf->count / n_threads;
+  for (i = 0; i < n_threads; i++) {
+    tasks[i].cf = cf;
+    tasks[i].ds = ds;
+    tasks[i].first = i * per_thread + 1;
+    tasks[i].last = (i == n_threads - 1) ? cf->count : (i + 1) * per_thread;
+    tasks[i].hits = g_array_new(FALSE, FALSE, sizeof (guint32));
+    tasks[i].unread = g_array_new(FALSE, FALSE, sizeof (guint32));
+    tasks[i].searched = &searched;
+    tasks[i].found = &found;
+    tasks[i].stop = &stop;
+  }
+
+  for (i = 0; i < n_threads; i++) {
+#if GLIB_CHECK_VERSION(2,31,0)
+    threads[i] = g_thread_new("find all", find_all_thread, &tasks[i]);
+#else
+    threads[i] = g_thread_create(find_all_thread, &tasks[i], TRUE, NULL);
+#endif
+  }
+
+  /* Keep the progress dialog going until they've all finished. */
+  g_get_current_time(&start_time);
+  do {
+    g_usleep(G_USEC_PER_SEC / 20);
+    if (progbar == NULL)
+      progbar = delayed_create_progress_dlg("Searching", title, FALSE,
+        &stop_flag, &start_time,
+        (gfloat) g_atomic_int_get(&searched) / cf->count);
+    if (progbar != NULL) {
+      g_snprintf(status_str, sizeof(status_str), "%u found, %u of %u packets",
+                 g_atomic_int_get(&found), g_atomic_int_get(&searched),
+                 cf->count);
+      update_progress_dlg(progbar,
+        (gfloat) g_atomic_int_get(&searched) / cf->count, status_str);
+    }
+    if (stop_flag)
+      g_atomic_int_set(&stop, 1);
+    all_done = TRUE;
+    for (i = 0; i < n_threads; i++) {
+      if (!g_atomic_int_get(&tasks[i].done))
+        all_done = FALSE;
+    }
+  } while (!all_done);
+
+  for (i = 0; i < n_threads; i++)
+    g_thread_join(threads[i]);
+  if (progbar != NULL)
+    destroy_progress_dlg(progbar);
+
+  for (i = 0; i < n_threads; i++) {
+    g_array_append_vals(hits, tasks[i].hits->data, tasks[i].hits->len);
+    /* The frames the thread couldn't read itself. */
+    for (j = 0; j < tasks[i].unread->len && ok && !stop_flag; j++) {
+      framenum = g_array_index(tasks[i].unread, guint32, j);
+      fdata = frame_data_sequence_find(cf->frames, framenum);
+      result = match_packet_data(cf, fdata, (void *)ds);
+      if (result == MR_ERROR)
+        ok = FALSE;
+      else if (result == MR_MATCHED) {
+        g_array_append_val(hits, framenum);
+        sort = TRUE;
+      }
+    }
+    g_array_free(tasks[i].hits, TRUE);
+    g_array_free(tasks[i].unread, TRUE);
+  }
+  if (sort)
+    g_array_sort(hits, compare_frame_nums);
+
+  g_free(threads);
+  g_free(tasks);
+  return ok && !stop_flag;
+}
+
+/*
+ * Run a match function over every displayed frame, in order, in the main
+ * thread.  That's the only way to do searches that dissect the packets:
+ * dissectors keep state from one frame to the next, and none of them are
+ * thread-safe.  Returns FALSE if the search was stopped.
+ */
+static gboolean
+find_all_sequential(capture_file *cf,
+                   match_result (*match_function)(capture_file *, frame_data *, void *),
+                   void *criterion, GArray *hits)
+{
+  guint32      framenum;
+  frame_data  *fdata;
+  progdlg_t   *progbar = NULL;
+  gboolean     stop_flag = FALSE;
+  float        progbar_val;
+  GTimeVal     start_time;
+  gchar        status_str[100];
+  guint32      progbar_nextstep = 0;
+  guint32      progbar_quantum = cf->count/N_PROGBAR_UPDATES;
+  const char  *title = cf->sfilter ? cf->sfilter : "";
+  match_result result;
+
+  g_get_current_time(&start_time);
+  for (framenum = 1; framenum <= cf->count; framenum++) {
+    progbar_val = (gfloat) framenum / cf->count;
+    if (progbar == NULL)
+      progbar = delayed_create_progress_dlg("Searching", title, FALSE,
+        &stop_flag, &start_time, progbar_val);
+    if (framenum >= progbar_nextstep) {
+      if (progbar != NULL) {
+        g_snprintf(status_str, sizeof(status_str), "%u found, %u of %u packets",
+                   hits->len, framenum, cf->count);
+        update_progress_dlg(progbar, progbar_val, status_str);
+      }
+      progbar_nextstep += progbar_quantum;
+    }
+    if (stop_flag)
+      break;
+
+    fdata = frame_data_sequence_find(cf->frames, framenum);
+    if (!fdata->flags.passed_dfilter)
+      continue;
+    result = (*match_function)(cf, fdata, criterion);
+    if (result == MR_ERROR)
+      break;
+    if (result == MR_MATCHED)
+      g_array_append_val(hits, framenum);
+  }
+
+  if (progbar != NULL)
+    destroy_progress_dlg(progbar);
+  return framenum > cf->count;
+}
+
+void
+cf_find_hits_clear(capture_file *cf)
+{
+  if (cf->search_hits == NULL)
+    return;
+  g_array_free(cf->search_hits->frames, TRUE);
+  g_free(cf->search_hits->data_string);
+  g_free(cf->search_hits);
+  cf->search_hits = NULL;
+}
+
+guint32
+cf_find_hit_count(capture_file *cf)
+{
+  return cf->search_hits != NULL ? cf->search_hits->frames->len : 0;
+}
+
+gboolean
+cf_find_all_packets(capture_file *cf)
+{
+  struct _search_hits *sh;
+  guint8              *bytes = NULL;
+  size_t               nbytes = 0;
+  char                *string;
+  match_data           mdata;
+  dfilter_t           *sfcode;
+  gboolean             completed;
+
+  cf_find_hits_clear(cf);
+  if (cf->sfilter == NULL || cf->count == 0)
+    return FALSE;
+
+  sh = g_new0(struct _search_hits, 1);
+  sh->frames = g_array_new(FALSE, FALSE, sizeof (guint32));
+
+  if (cf->hex || (cf->string && cf->packet_data)) {
+    /* The packet data; this is the search that can be split up. */
+    if (cf->hex) {
+      bytes = convert_string_to_hex(cf->sfilter, &nbytes);
+    } else {
+      bytes = (guint8 *)convert_string_case(cf->sfilter, cf->case_type);
+      nbytes = strlen((char *)bytes);
+    }
+    if (bytes == NULL) {
+      g_array_free(sh->frames, TRUE);
+      g_free(sh);
+      return FALSE;
+    }
+    sh->is_data = TRUE;
+    sh->data_string = bytes;
+    data_search_init(cf, &sh->data, bytes, nbytes);
+    completed = find_all_data(cf, &sh->data, sh->frames);
+  } else if (cf->string) {
+    string = convert_string_case(cf->sfilter, cf->case_type);
+    mdata.string = string;
+    mdata.string_len = strlen(string);
+    completed = find_all_sequential(cf,
+      cf->summary_data ? match_summary_line : match_protocol_tree,
+      &mdata, sh->frames);
+    g_free(string);
+  } else {
+    if (!dfilter_compile(cf->sfilter, &sfcode) || sfcode == NULL) {
+      g_array_free(sh->frames, TRUE);
+      g_free(sh);
+      return FALSE;
+    }
+    completed = find_all_sequential(cf, match_dfilter, sfcode, sh->frames);
+    dfilter_free(sfcode);
+  }
+
+  /* If the search was stopped part way, the list is incomplete and
+     mustn't be used to step through the matches. */
+  if (!completed || sh->frames->len == 0) {
+    g_array_free(sh->frames, TRUE);
+    g_free(sh->data_string);
+    g_free(sh);
+    return FALSE;
+  }
+
+  cf->search_hits = sh;
+  return cf_find_next_hit(cf, cf->dir);
+}
+
+gboolean
+cf_find_next_hit(capture_file *cf, search_direction dir)
+{
+  GArray     *frames;
+  guint32     current, lo, hi, mid, idx;
+  frame_data *fdata;
+  gboolean    found;
+
+  if (cf->search_hits == NULL)
+    return FALSE;
+  frames = cf->search_hits->frames;
+  current = cf->current_frame != NULL ? cf->current_frame->num : 0;
+
+  /* lo is the index of the first match after the current frame... */
+  lo = 0;
+  hi = frames->len;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (g_array_index(frames, guint32, mid) <= current)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (dir == SD_BACKWARD) {
+    /* ...so the one before the current frame is before that, unless the
+       current frame is itself a match. */
+    idx = lo;
+    if (idx > 0 && g_array_index(frames, guint32, idx - 1) == current)
+      idx--;
+    if (idx == 0) {
+      if (!prefs.gui_find_wrap) {
+        statusbar_push_temporary_msg("Search reached the beginning.");
+        return FALSE;
+      }
+      statusbar_push_temporary_msg("Search reached the beginning. Continuing at end.");
+      idx = frames->len;
+    }
+    idx--;
+  } else {
+    idx = lo;
+    if (idx == frames->len) {
+      if (!prefs.gui_find_wrap) {
+        statusbar_push_temporary_msg("Search reached the end.");
+        return FALSE;
+      }
+      statusbar_push_temporary_msg("Search reached the end. Continuing at beginning.");
+      idx = 0;
+    }
+  }
+
+  fdata = frame_data_sequence_find(cf->frames, g_array_index(frames, guint32, idx));
+
+  /* Find and select */
+  cf->search_in_progress = TRUE;
+  if (cf->search_hits->is_data) {
+    /* Get the position of the match, so that it's highlighted. */
+    match_packet_data(cf, fdata, &cf->search_hits->data);
+  }
+  found = new_packet_list_select_row_from_data(fdata);
+  cf->search_in_progress = FALSE;
+  cf->search_pos = 0; /* Reset the position */
+  if (!found) {
+    /* The frame isn't being displayed currently, so we can't select it. */
+    simple_message_box(ESD_TYPE_INFO, NULL,
+                       "The capture file is probably not fully dissected.",
+                       "End of capture exceeded!");
+    return FALSE;
+  }
+  statusbar_push_temporary_msg("Match %u of %u.", idx + 1, frames->len);
+  return TRUE;
+}
+
 gboolean
 cf_goto_frame(capture_file *cf, guint fnumber)
 {
@@ -3618,6 +4478,7 @@ void
 cf_mark_frame(capture_file *cf, frame_data *frame)
 {
   if (! frame->flags.marked) {
+    cf_filter_results_invalidate(cf);
     frame->flags.marked = TRUE;
     if (cf->count > cf->marked_count)
       cf->marked_count++;
@@ -3631,6 +4492,7 @@ void
 cf_unmark_frame(capture_file *cf, frame_data *frame)
 {
   if (frame->flags.marked) {
+    cf_filter_results_invalidate(cf);
     frame->flags.marked = FALSE;
     if (cf->marked_count > 0)
       cf->marked_count--;
@@ -3644,6 +4506,7 @@ void
 cf_ignore_frame(capture_file *cf, frame_data *frame)
 {
   if (! frame->flags.ignored) {
+    cf_filter_results_invalidate(cf);
     frame->flags.ignored = TRUE;
     if (cf->count > cf->ignored_count)
       cf->ignored_count++;
@@ -3657,6 +4520,7 @@ void
 cf_unignore_frame(capture_file *cf, frame_data *frame)
 {
   if (frame->flags.ignored) {
+    cf_filter_results_invalidate(cf);
     frame->flags.ignored = FALSE;
     if (cf->ignored_count > 0)
       cf->ignored_count--;
@@ -3712,15 +4576,17 @@ cf_update_capture_comment(capture_file *cf, gchar *comment)
 void
 cf_update_packet_comment(capture_file *cf, frame_data *fdata, gchar *comment)
 {
-  if (fdata->opt_comment != NULL) {
+  cf_filter_results_invalidate(cf);
+
+  if (fdata->flags.has_comment) {
     /* OK, remove the old comment. */
-    g_free(fdata->opt_comment);
-    fdata->opt_comment = NULL;
+    g_free(frame_data_get_comment(fdata));
+    frame_data_set_comment(fdata, NULL);
     cf->packet_comment_count--;
   }
   if (comment != NULL) {
     /* Add the new comment. */
-    fdata->opt_comment = comment;
+    frame_data_set_comment(fdata, comment);
     cf->packet_comment_count++;
   }
 
@@ -3785,7 +4651,7 @@ save_packet(capture_file *cf _U_, frame_data *fdata,
   /* pcapng */
   hdr.interface_id = fdata->interface_id;   /* identifier of the interface. */
   /* options */
-  hdr.opt_comment  = fdata->opt_comment; /* NULL if not available */
+  hdr.opt_comment  = frame_data_get_comment(fdata); /* NULL if not available */
 #if 0
   hdr.drop_count   =
   hdr.pack_flags   =     /* XXX - 0 for now (any value for "we don't have it"?) */
@@ -4352,9 +5218,9 @@ cf_save_packets(capture_file *cf, const char *fname, guint save_format,
       /* Remove packet comments. */
       for (framenum = 1; framenum <= cf->count; framenum++) {
         fdata = frame_data_sequence_find(cf->frames, framenum);
-        if (fdata->opt_comment) {
-          g_free(fdata->opt_comment);
-          fdata->opt_comment = NULL;
+        if (fdata->flags.has_comment) {
+          g_free(frame_data_get_comment(fdata));
+          frame_data_set_comment(fdata, NULL);
           cf->packet_comment_count--;
         }
       }
@@ -365,6 +365,39 @@ cf_status_t cf_filter_packets(capture_file *cf, gchar *dfilter, gboolean force);
  */
 void cf_reftime_packets(capture_file *cf);
 
+/**
+ * Something a display filter can look at, such as the time stamps, has
+ * changed for some packets; forget the results of earlier filters, which
+ * are reused to filter without dissecting.
+ *
+ * @param cf the capture file
+ */
+void cf_filter_results_invalidate(capture_file *cf);
+
+/**
+ * Something other than the filter, such as an index kept by a dissector,
+ * says that exactly these frames pass a display filter; remember that,
+ * so that filtering with it needn't dissect every frame to find out.
+ *
+ * @param cf the capture file
+ * @param dftext the display filter
+ * @param frames the numbers of the frames that pass it
+ * @param nframes the number of entries in frames
+ */
+void cf_filter_results_set(capture_file *cf, const char *dftext,
+                           const guint32 *frames, guint nframes);
+
+/**
+ * Do we know which frames pass a display filter without dissecting them,
+ * i.e. has a filtering pass with it gone through all of the frames since
+ * anything it looks at last changed?
+ *
+ * @param cf the capture file
+ * @param dftext the display filter
+ * @return TRUE if so
+ */
+gboolean cf_filter_results_known(capture_file *cf, const char *dftext);
+
 /**
  * Return the time it took to load the file
  */
@@ -385,6 +418,19 @@ void cf_redissect_packets(capture_file *cf);
  */
 cf_read_status_t cf_retap_packets(capture_file *cf);
 
+/**
+ * Dissect some frames, in the order given, without building a protocol
+ * tree or columns or running taps, for the side effects of dissecting
+ * them, e.g. reassembling a followed TCP stream.
+ *
+ * @param cf the capture file
+ * @param frames the numbers of the frames to dissect, or NULL for all of them
+ * @param nframes the number of entries in frames
+ * @return one of cf_read_status_t
+ */
+cf_read_status_t cf_dissect_frames(capture_file *cf, const guint32 *frames,
+                                   guint nframes);
+
 /**
  * Adjust timestamp precision if auto is selected.
  *
@@ -523,6 +569,44 @@ gboolean cf_find_packet_marked(capture_file *cf, search_direction dir);
  */
 gboolean cf_find_packet_time_reference(capture_file *cf, search_direction dir);
 
+/**
+ * Find all the displayed packets that match the search parameters last
+ * set in the capture file (cf->sfilter, cf->hex, cf->string etc.) and go
+ * to the first of them in direction cf->dir.  Searches of the packet
+ * data are split among several threads; other searches dissect the
+ * packets and are done in one pass.  The matches are kept until
+ * cf_find_hits_clear() is called or the packets are rescanned.
+ *
+ * @param cf the capture file
+ * @return TRUE if a packet was found, FALSE if none was or the search
+ * was stopped
+ */
+gboolean cf_find_all_packets(capture_file *cf);
+
+/**
+ * Go to the next or previous match found by cf_find_all_packets().
+ *
+ * @param cf the capture file
+ * @param dir direction in which to go
+ * @return TRUE if a packet was found, FALSE otherwise
+ */
+gboolean cf_find_next_hit(capture_file *cf, search_direction dir);
+
+/**
+ * Get the number of matches found by cf_find_all_packets().
+ *
+ * @param cf the capture file
+ * @return the number of matches, or 0 if there's been no "Find all"
+ */
+guint32 cf_find_hit_count(capture_file *cf);
+
+/**
+ * Forget the matches found by cf_find_all_packets().
+ *
+ * @param cf the capture file
+ */
+void cf_find_hits_clear(capture_file *cf);
+
 /**
  * GoTo Packet in first row.
  *
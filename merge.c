@@ -50,6 +50,8 @@ merge_open_in_files(int in_file_count, char *const *in_file_names,
     files[i].data_offset = 0;
     files[i].state       = PACKET_NOT_PRESENT;
     files[i].packet_num  = 0;
+    files[i].heap        = NULL;
+    files[i].heap_len    = 0;
     if (!files[i].wth) {
       /* Close the files we've already opened. */
       for (j = 0; j < i; j++)
@@ -65,6 +67,9 @@ merge_open_in_files(int in_file_count, char *const *in_file_names,
       return FALSE;
     }
     files[i].size = size;
+    /* Read each file ahead of the merge on another thread; there may be
+       a lot of them, so don't queue up as much from each. */
+    wtap_set_prefetch(files[i].wth, 64);
   }
   return TRUE;
 }
@@ -79,6 +84,10 @@ merge_close_in_files(int count, merge_in_file_t in_files[])
   for (i = 0; i < count; i++) {
     wtap_close(in_files[i].wth);
   }
+  if (count > 0) {
+    g_free(in_files[0].heap);
+    in_files[0].heap = NULL;
+  }
 }
 
 /*
@@ -131,20 +140,65 @@ merge_max_snapshot_length(int count, merge_in_file_t in_files[])
 }
 
 /*
- * returns TRUE if first argument is earlier than second
+ * The files that have a packet present are kept in a binary heap, ordered
+ * by the time stamp of that packet, so that finding the earliest packet
+ * doesn't mean looking at every file.  Packets with the same time stamp
+ * come from the file given last first.
+ */
+
+/*
+ * returns TRUE if the packet present in file l goes before the one in
+ * file r
  */
 static gboolean
-is_earlier(struct wtap_nstime *l, struct wtap_nstime *r) {
-  if (l->secs > r->secs) {  /* left is later */
-    return FALSE;
-  } else if (l->secs < r->secs) { /* left is earlier */
-    return TRUE;
-  } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
-    return FALSE;
+is_earlier(merge_in_file_t in_files[], int l, int r)
+{
+  struct wtap_nstime *lts = &wtap_phdr(in_files[l].wth)->ts;
+  struct wtap_nstime *rts = &wtap_phdr(in_files[r].wth)->ts;
+
+  if (lts->secs != rts->secs)
+    return lts->secs < rts->secs;
+  if (lts->nsecs != rts->nsecs)
+    return lts->nsecs < rts->nsecs;
+  return l > r;
+}
+
+static void
+heap_sift_down(merge_in_file_t in_files[], int pos)
+{
+  int *heap = in_files[0].heap;
+  int len = in_files[0].heap_len;
+  int child, fi = heap[pos];
+
+  for (;;) {
+    child = 2 * pos + 1;
+    if (child >= len)
+      break;
+    if (child + 1 < len && is_earlier(in_files, heap[child + 1], heap[child]))
+      child++;
+    if (!is_earlier(in_files, heap[child], fi))
+      break;
+    heap[pos] = heap[child];
+    pos = child;
   }
-  /* either one < two or one == two
-   * either way, return one
-   */
+  heap[pos] = fi;
+}
+
+/*
+ * Read the next packet from a file.  Returns FALSE, and sets the state of
+ * the file to GOT_ERROR, on an error.
+ */
+static gboolean
+merge_read_next(merge_in_file_t *in_file, int *err, gchar **err_info)
+{
+  if (!wtap_read(in_file->wth, err, err_info, &in_file->data_offset)) {
+    if (*err != 0) {
+      in_file->state = GOT_ERROR;
+      return FALSE;
+    }
+    in_file->state = AT_EOF;
+  } else
+    in_file->state = PACKET_PRESENT;
   return TRUE;
 }
 
@@ -166,45 +220,54 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
                   int *err, gchar **err_info)
 {
   int i;
-  int ei = -1;
-  struct wtap_nstime tv = { sizeof(time_t) > sizeof(int) ? LONG_MAX : INT_MAX, INT_MAX };
-  struct wtap_pkthdr *phdr;
+  int ei;
 
-  /*
-   * Make sure we have a packet available from each file, if there are any
-   * packets left in the file in question, and search for the packet
-   * with the earliest time stamp.
-   */
-  for (i = 0; i < in_file_count; i++) {
-    if (in_files[i].state == PACKET_NOT_PRESENT) {
-      /*
-       * No packet available, and we haven't seen an error or EOF yet,
-       * so try to read the next packet.
-       */
-      if (!wtap_read(in_files[i].wth, err, err_info, &in_files[i].data_offset)) {
-        if (*err != 0) {
-          in_files[i].state = GOT_ERROR;
-          return &in_files[i];
-        }
-        in_files[i].state = AT_EOF;
-      } else
-        in_files[i].state = PACKET_PRESENT;
+  if (in_file_count == 0) {
+    *err = 0;
+    return NULL;
+  }
+
+  if (in_files[0].heap == NULL) {
+    /*
+     * First time through: get a packet from each file, if it has any,
+     * and build the heap.
+     */
+    in_files[0].heap = g_new(int, in_file_count);
+    in_files[0].heap_len = 0;
+    for (i = 0; i < in_file_count; i++) {
+      if (in_files[i].state == PACKET_NOT_PRESENT &&
+          !merge_read_next(&in_files[i], err, err_info))
+        return &in_files[i];
+      if (in_files[i].state == PACKET_PRESENT)
+        in_files[0].heap[in_files[0].heap_len++] = i;
     }
-    
-    if (in_files[i].state == PACKET_PRESENT) {
-      phdr = wtap_phdr(in_files[i].wth);
-      if (is_earlier(&phdr->ts, &tv)) {
-        tv = phdr->ts;
-        ei = i;
+    for (i = in_files[0].heap_len / 2 - 1; i >= 0; i--)
+      heap_sift_down(in_files, i);
+  } else if (in_files[0].heap_len != 0) {
+    /*
+     * The packet we returned last time came from the file at the top
+     * of the heap; get that file's next packet, and put the file where
+     * it now belongs, if it has one.
+     */
+    ei = in_files[0].heap[0];
+    if (in_files[ei].state == PACKET_NOT_PRESENT) {
+      if (!merge_read_next(&in_files[ei], err, err_info))
+        return &in_files[ei];
+      if (in_files[ei].state != PACKET_PRESENT) {
+        in_files[0].heap_len--;
+        in_files[0].heap[0] = in_files[0].heap[in_files[0].heap_len];
       }
+      if (in_files[0].heap_len != 0)
+        heap_sift_down(in_files, 0);
     }
   }
 
-  if (ei == -1) {
+  if (in_files[0].heap_len == 0) {
     /* All the streams are at EOF.  Return an EOF indication. */
     *err = 0;
     return NULL;
   }
+  ei = in_files[0].heap[0];
 
   /* We'll need to read another packet from this file. */
   in_files[ei].state = PACKET_NOT_PRESENT;
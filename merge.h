@@ -46,6 +46,9 @@ typedef struct merge_in_file_s {
   in_file_state_e state;
   guint32         packet_num;	/* current packet number */
   gint64          size;		/* file size */
+  int            *heap;		/* first file only: the files with a packet
+				   present, as a heap, earliest first */
+  int             heap_len;	/* first file only: entries in heap */
 } merge_in_file_t;
 
 /** Open a number of input files to merge.
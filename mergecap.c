@@ -226,6 +226,10 @@ main(int argc, char *argv[])
 #ifdef _WIN32
   arg_list_utf_16to8(argc, argv);
 #endif /* _WIN32 */
+#if !GLIB_CHECK_VERSION(2,31,0)
+  /* Initialize the thread system; wiretap reads ahead of us on one. */
+  g_thread_init(NULL);
+#endif
 
   /* Process the options first */
   while ((opt = getopt(argc, argv, "hvas:T:F:w:")) != -1) {
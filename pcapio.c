@@ -51,6 +51,11 @@
 #include <errno.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
 #include <pcap.h>
 
 #include <glib.h>
@@ -195,6 +200,9 @@ struct option {
         } while (0);                                                                       \
 }
 
+/* Size of the buffer of a stream we write a capture file to. */
+#define PCAPIO_BUFFER_SIZE (256*1024)
+
 /* Returns a FILE * to write to on success, NULL on failure */
 FILE *
 libpcap_fdopen(int fd, int *err)
@@ -204,7 +212,11 @@ libpcap_fdopen(int fd, int *err)
         fp = fdopen(fd, "wb");
         if (fp == NULL) {
                 *err = errno;
+                return NULL;
         }
+        /* Packets get written a few dozen bytes at a time; collect them
+           into large writes. */
+        setvbuf(fp, NULL, _IOFBF, PCAPIO_BUFFER_SIZE);
         return fp;
 }
 
@@ -585,6 +597,165 @@ libpcap_write_enhanced_packet_block(FILE *fp,
         return TRUE;
 }
 
+#ifndef _WIN32
+/* Packets per writev(); three iovecs each keeps us well under IOV_MAX. */
+#define WRITEV_BATCH 64
+
+/* Batches smaller than this are cheaper to copy into the stream's buffer
+   than to write out on their own. */
+#define WRITEV_MIN_BYTES (64*1024)
+
+/* Write out what "iov" points to, straight to the file descriptor if the
+   stream has one and there's enough of it. */
+static gboolean
+libpcap_writev(FILE *fp, struct iovec *iov, int iovcnt, long *bytes_written,
+               int *err)
+{
+        int fd;
+        ssize_t nwritten;
+        size_t total = 0;
+        int i;
+
+        for (i = 0; i < iovcnt; i++) {
+                total += iov[i].iov_len;
+        }
+        fd = fileno(fp);
+        if (fd == -1 || total < WRITEV_MIN_BYTES) {
+                /* Go through stdio. */
+                for (i = 0; i < iovcnt; i++) {
+                        WRITE_DATA(fp, iov[i].iov_base, iov[i].iov_len, *bytes_written, err);
+                }
+                return TRUE;
+        }
+
+        /* Whatever's in the stream's buffer has to go first. */
+        if (fflush(fp) == EOF) {
+                *err = errno;
+                return FALSE;
+        }
+        while (iovcnt > 0) {
+                nwritten = writev(fd, iov, iovcnt);
+                if (nwritten == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        *err = errno;
+                        return FALSE;
+                }
+                *bytes_written += (long)nwritten;
+                while (iovcnt > 0 && (size_t)nwritten >= iov->iov_len) {
+                        nwritten -= iov->iov_len;
+                        iov++;
+                        iovcnt--;
+                }
+                if (iovcnt > 0) {
+                        iov->iov_base = (char *)iov->iov_base + nwritten;
+                        iov->iov_len -= nwritten;
+                }
+        }
+        return TRUE;
+}
+#endif
+
+gboolean
+libpcap_write_packets(FILE *fp, guint count, const struct pcap_pkthdr *phdrs,
+                      const u_char * const *pds, long *bytes_written, int *err)
+{
+#ifdef _WIN32
+        guint i;
+
+        for (i = 0; i < count; i++) {
+                if (!libpcap_write_packet(fp, &phdrs[i], pds[i], bytes_written, err))
+                        return FALSE;
+        }
+        return TRUE;
+#else
+        struct pcaprec_hdr rec_hdrs[WRITEV_BATCH];
+        struct iovec iov[2 * WRITEV_BATCH];
+        guint i, n;
+
+        while (count > 0) {
+                n = MIN(count, WRITEV_BATCH);
+                for (i = 0; i < n; i++) {
+                        rec_hdrs[i].ts_sec = phdrs[i].ts.tv_sec;
+                        rec_hdrs[i].ts_usec = phdrs[i].ts.tv_usec;
+                        rec_hdrs[i].incl_len = phdrs[i].caplen;
+                        rec_hdrs[i].orig_len = phdrs[i].len;
+                        iov[2*i].iov_base = &rec_hdrs[i];
+                        iov[2*i].iov_len = sizeof rec_hdrs[i];
+                        iov[2*i+1].iov_base = (void *)pds[i];
+                        iov[2*i+1].iov_len = phdrs[i].caplen;
+                }
+                if (!libpcap_writev(fp, iov, 2 * n, bytes_written, err))
+                        return FALSE;
+                phdrs += n;
+                pds += n;
+                count -= n;
+        }
+        return TRUE;
+#endif
+}
+
+gboolean
+libpcap_write_enhanced_packet_blocks(FILE *fp,
+                                     guint count,
+                                     const struct pcap_pkthdr *phdrs,
+                                     guint32 interface_id,
+                                     guint ts_mul,
+                                     const u_char * const *pds,
+                                     long *bytes_written,
+                                     int *err)
+{
+#ifdef _WIN32
+        guint i;
+
+        for (i = 0; i < count; i++) {
+                if (!libpcap_write_enhanced_packet_block(fp, &phdrs[i], interface_id, ts_mul, pds[i], bytes_written, err))
+                        return FALSE;
+        }
+        return TRUE;
+#else
+        struct epb epbs[WRITEV_BATCH];
+        /* padding, then the trailing Block Total Length */
+        guint32 trailers[WRITEV_BATCH][2];
+        struct iovec iov[3 * WRITEV_BATCH];
+        guint64 timestamp;
+        guint32 padding;
+        guint i, n;
+
+        while (count > 0) {
+                n = MIN(count, WRITEV_BATCH);
+                for (i = 0; i < n; i++) {
+                        padding = ADD_PADDING(phdrs[i].caplen) - phdrs[i].caplen;
+                        timestamp = (guint64)(phdrs[i].ts.tv_sec) * ts_mul +
+                                    (guint64)(phdrs[i].ts.tv_usec);
+                        epbs[i].block_type = ENHANCED_PACKET_BLOCK_TYPE;
+                        epbs[i].block_total_length = sizeof(struct epb) +
+                                                     ADD_PADDING(phdrs[i].caplen) +
+                                                     sizeof(guint32);
+                        epbs[i].interface_id = interface_id;
+                        epbs[i].timestamp_high = (guint32)((timestamp>>32) & 0xffffffff);
+                        epbs[i].timestamp_low = (guint32)(timestamp & 0xffffffff);
+                        epbs[i].captured_len = phdrs[i].caplen;
+                        epbs[i].packet_len = phdrs[i].len;
+                        trailers[i][0] = 0;
+                        trailers[i][1] = epbs[i].block_total_length;
+                        iov[3*i].iov_base = &epbs[i];
+                        iov[3*i].iov_len = sizeof(struct epb);
+                        iov[3*i+1].iov_base = (void *)pds[i];
+                        iov[3*i+1].iov_len = phdrs[i].caplen;
+                        iov[3*i+2].iov_base = (guint8 *)&trailers[i][1] - padding;
+                        iov[3*i+2].iov_len = padding + sizeof(guint32);
+                }
+                if (!libpcap_writev(fp, iov, 3 * n, bytes_written, err))
+                        return FALSE;
+                phdrs += n;
+                pds += n;
+                count -= n;
+        }
+        return TRUE;
+#endif
+}
+
 gboolean
 libpcap_write_interface_statistics_block(FILE *fp,
                                          guint32 interface_id,
@@ -96,6 +96,24 @@ libpcap_write_enhanced_packet_block(FILE *fp,
                                     long *bytes_written,
                                     int *err);
 
+/** Write records for "count" packets to a dump file, with as few
+   system calls as possible.  Returns TRUE on success, FALSE on failure. */
+extern gboolean
+libpcap_write_packets(FILE *fp, guint count, const struct pcap_pkthdr *phdrs,
+    const u_char * const *pds, long *bytes_written, int *err);
+
+/** Write enhanced packet blocks (EPB) for "count" packets, with as few
+   system calls as possible. */
+extern gboolean
+libpcap_write_enhanced_packet_blocks(FILE *fp,
+                                     guint count,
+                                     const struct pcap_pkthdr *phdrs,
+                                     guint32 interface_id,
+                                     guint ts_mul,
+                                     const u_char * const *pds,
+                                     long *bytes_written,
+                                     int *err);
+
 extern gboolean
 libpcap_dump_flush(FILE *pd, int *err);
 
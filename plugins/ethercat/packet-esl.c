@@ -252,10 +252,10 @@ void modify_times(tvbuff_t *tvb, gint offset, packet_info *pinfo)
         ts.secs = ref_time_frame.abs_ts.secs+(int)secs;
         nstime_delta(&ts_delta, &ts, &pinfo->fd->abs_ts);
 
+        /* The delta times are worked out from abs_ts when they're
+           needed, so they follow along. */
         pinfo->fd->abs_ts = ts;
-        nstime_add(&pinfo->fd->rel_ts, &ts_delta);
-        nstime_add(&pinfo->fd->del_dis_ts, &ts_delta);
-        nstime_add(&pinfo->fd->del_cap_ts, &ts_delta);
+        nstime_add(&pinfo->rel_ts, &ts_delta);
     }
 }
 
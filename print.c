@@ -77,6 +77,16 @@ typedef struct {
 	epan_dissect_t		*edt;
 } write_field_data_t;
 
+/* Rows of columnar output to put together before writing them out */
+#define FIELDS_BATCH_ROWS 4096
+
+/* A field's values in the current batch of columnar output */
+typedef struct {
+    GString* data;              /* the values, one after another */
+    GArray* offsets;            /* guint32 end of each row's value in data */
+    GByteArray* present;        /* bit per row: the row has a value */
+} field_column_t;
+
 struct _output_fields {
     gboolean print_header;
     gchar separator;
@@ -84,8 +94,15 @@ struct _output_fields {
     gchar aggregator;
     GPtrArray* fields;
     GHashTable* field_indicies;
-    emem_strbuf_t** field_values;
+    GString** field_values;     /* of the current packet; empty if none */
     gchar quote;
+    gboolean columnar;
+    /* Filled in on first use, once all the fields are registered */
+    GArray** field_ids;         /* hfids of the fields with each name */
+    gboolean need_tree;         /* some field needs a visible tree */
+    GString* line;              /* text output row being put together */
+    field_column_t* columns;    /* columnar output batch */
+    guint32 batch_rows;
 };
 
 GHashTable *output_only_tables = NULL;
@@ -1351,6 +1368,12 @@ output_fields_t* output_fields_new(void)
     fields->field_indicies = NULL;
     fields->field_values = NULL;
     fields->quote='\0';
+    fields->columnar = FALSE;
+    fields->field_ids = NULL;
+    fields->need_tree = FALSE;
+    fields->line = NULL;
+    fields->columns = NULL;
+    fields->batch_rows = 0;
     return fields;
 }
 
@@ -1375,6 +1398,22 @@ void output_fields_free(output_fields_t* fields)
          */
         g_hash_table_destroy(fields->field_indicies);
     }
+    if(NULL != fields->field_ids) {
+        gsize i;
+        for(i = 0; i < fields->fields->len; ++i) {
+            g_array_free(fields->field_ids[i], TRUE);
+            g_string_free(fields->field_values[i], TRUE);
+            if(NULL != fields->columns) {
+                g_string_free(fields->columns[i].data, TRUE);
+                g_array_free(fields->columns[i].offsets, TRUE);
+                g_byte_array_free(fields->columns[i].present, TRUE);
+            }
+        }
+        g_free(fields->field_ids);
+        g_free(fields->field_values);
+        g_free(fields->columns);
+        g_string_free(fields->line, TRUE);
+    }
     if(NULL != fields->fields) {
         gsize i;
         for(i = 0; i < fields->fields->len; ++i) {
@@ -1490,6 +1529,20 @@ gboolean output_fields_set_option(output_fields_t* info, gchar* option)
         return TRUE;
     }
 
+    if(0 == strcmp(option_name, "columnar")) {
+        switch(NULL == option_value ? '\0' : *option_value) {
+        case 'n':
+            info->columnar = FALSE;
+            break;
+        case 'y':
+            info->columnar = TRUE;
+            break;
+        default:
+            return FALSE;
+        }
+        return TRUE;
+    }
+
     if(0 == strcmp(option_name, "quote")) {
         switch(NULL == option_value ? '\0' : *option_value) {
         default: /* Fall through */
@@ -1520,8 +1573,105 @@ void output_fields_list_options(FILE *fh)
     fputs("occurrence=f|l|a  Select the occurrence of a field to use;\n     \"f\" = first, \"l\" = last, \"a\" = all (def: a: all)\n", fh);
     fputs("aggregator=,|/s|<character>   Set the aggregator to use;\n     \",\" = comma, \"/s\" = space (def: ,: comma)\n", fh);
     fputs("quote=d|s|n   Print either d: double-quotes, s: single quotes or \n     n: no quotes around field values (def: n: none)\n", fh);
+    fputs("columnar=y|n  Write the values in a binary columnar format rather\n     than as text (def: N: no)\n", fh);
+}
+
+
+/*
+ * Look the fields up, and set up what we need to print them; this is
+ * done on first use, as the fields can be given before all the protocols
+ * have been registered.
+ */
+static void output_fields_prepare(output_fields_t* fields)
+{
+    gsize i;
+    header_field_info* hfinfo;
+
+    if(NULL != fields->field_ids) {
+        return;
+    }
+
+    /* Prepare a lookup table from string abbreviation for field to its index. */
+    fields->field_indicies = g_hash_table_new(g_str_hash, g_str_equal);
+    fields->field_ids = g_new(GArray*, fields->fields->len);
+    fields->field_values = g_new(GString*, fields->fields->len);
+
+    for(i = 0; i < fields->fields->len; ++i) {
+        gchar* field = (gchar *)g_ptr_array_index(fields->fields, i);
+
+        /* Store field indicies +1 so that zero is not a valid value,
+         * and can be distinguished from NULL as a pointer.
+         */
+        g_hash_table_insert(fields->field_indicies, field, GUINT_TO_POINTER(i + 1));
+
+        fields->field_values[i] = g_string_new("");
+        fields->field_ids[i] = g_array_new(FALSE, FALSE, sizeof(int));
+
+        /* Several fields can have the same name; we want all of them. */
+        hfinfo = proto_registrar_get_byname(field);
+        if(NULL == hfinfo) {
+            continue;   /* we won't ever find it */
+        }
+        while(NULL != hfinfo->same_name_prev) {
+            hfinfo = hfinfo->same_name_prev;
+        }
+        for(; NULL != hfinfo; hfinfo = hfinfo->same_name_next) {
+            /* A protocol's, or a text item's, value is the text that's
+             * only there if the tree is visible. */
+            if(hfinfo->type == FT_PROTOCOL || hfinfo->id == hf_text_only) {
+                fields->need_tree = TRUE;
+            }
+            g_array_append_val(fields->field_ids[i], hfinfo->id);
+        }
+    }
+
+    fields->line = g_string_new("");
+    if(fields->columnar) {
+        fields->columns = g_new(field_column_t, fields->fields->len);
+        for(i = 0; i < fields->fields->len; ++i) {
+            fields->columns[i].data = g_string_new("");
+            fields->columns[i].offsets = g_array_new(FALSE, FALSE, sizeof(guint32));
+            fields->columns[i].present = g_byte_array_new();
+        }
+    }
+}
+
+gboolean output_fields_need_visible_tree(output_fields_t* fields)
+{
+    g_assert(fields);
+
+    output_fields_prepare(fields);
+    return fields->need_tree;
 }
 
+void output_fields_prime_edt(output_fields_t* fields, epan_dissect_t *edt)
+{
+    gsize i;
+    guint j;
+
+    g_assert(fields);
+    g_assert(edt);
+
+    output_fields_prepare(fields);
+
+    for(i = 0; i < fields->fields->len; ++i) {
+        for(j = 0; j < fields->field_ids[i]->len; ++j) {
+            proto_tree_prime_hfid(edt->tree, g_array_index(fields->field_ids[i], int, j));
+        }
+    }
+}
+
+/* Little-endian, whatever we're running on */
+static void put_le32(GString* buf, guint32 value)
+{
+    gchar bytes[4];
+
+    bytes[0] = (gchar)(value & 0xff);
+    bytes[1] = (gchar)((value >> 8) & 0xff);
+    bytes[2] = (gchar)((value >> 16) & 0xff);
+    bytes[3] = (gchar)((value >> 24) & 0xff);
+    g_string_append_len(buf, bytes, 4);
+}
 
 void write_fields_preamble(output_fields_t* fields, FILE *fh)
 {
@@ -1530,6 +1680,21 @@ void write_fields_preamble(output_fields_t* fields, FILE *fh)
     g_assert(fields);
     g_assert(fh);
 
+    if(fields->columnar) {
+        GString* header = g_string_new(FIELDS_COLUMNAR_MAGIC);
+
+        put_le32(header, FIELDS_COLUMNAR_VERSION);
+        put_le32(header, (guint32)fields->fields->len);
+        for(i = 0; i < fields->fields->len; ++i) {
+            const gchar* field = (const gchar *)g_ptr_array_index(fields->fields,i);
+            put_le32(header, (guint32)strlen(field));
+            g_string_append(header, field);
+        }
+        fwrite(header->str, 1, header->len, fh);
+        g_string_free(header, TRUE);
+        return;
+    }
+
     if(!fields->print_header) {
         return;
     }
@@ -1544,6 +1709,26 @@ void write_fields_preamble(output_fields_t* fields, FILE *fh)
     fputc('\n', fh);
 }
 
+static void output_fields_add_value(output_fields_t* fields, guint field_index,
+                                    const gchar* value)
+{
+    GString* field_value = fields->field_values[field_index];
+
+    if(NULL == value || '\0' == *value) {
+        return;
+    }
+    if(0 == field_value->len) {
+        g_string_assign(field_value, value);
+    } else if(fields->occurrence == 'l') {
+        /* print only the value of the last occurrence of the field */
+        g_string_assign(field_value, value);
+    } else if(fields->occurrence == 'a') {
+        /* print the value of all accurrences of the field */
+        g_string_append_c(field_value, fields->aggregator);
+        g_string_append(field_value, value);
+    }
+}
+
 static void proto_tree_get_node_field_values(proto_node *node, gpointer data)
 {
     write_field_data_t *call_data;
@@ -1557,25 +1742,9 @@ static void proto_tree_get_node_field_values(proto_node *node, gpointer data)
 
     field_index = g_hash_table_lookup(call_data->fields->field_indicies, fi->hfinfo->abbrev);
     if(NULL != field_index) {
-        const gchar* value;
-
-        value = get_node_field_value(fi, call_data->edt); /* ep_alloced string */
-
-        if(NULL != value && '\0' != *value) {
-            guint actual_index;
-            actual_index = GPOINTER_TO_UINT(field_index);
-            /* Unwrap change made to disambiguiate zero / null */
-            if ( call_data->fields->field_values[actual_index - 1] == NULL ) {
-                call_data->fields->field_values[actual_index - 1] = ep_strbuf_new(value);
-            } else if ( call_data->fields->occurrence == 'l' ) {
-                /* print only the value of the last occurrence of the field */
-                ep_strbuf_printf(call_data->fields->field_values[actual_index - 1],"%s",value);
-            } else if ( call_data->fields->occurrence == 'a' ) {
-                /* print the value of all accurrences of the field */
-                ep_strbuf_append_printf(call_data->fields->field_values[actual_index - 1],
-                    "%c%s",call_data->fields->aggregator,value);
-            }
-        }
+        /* Unwrap change made to disambiguiate zero / null */
+        output_fields_add_value(call_data->fields, GPOINTER_TO_UINT(field_index) - 1,
+                                get_node_field_value(fi, call_data->edt)); /* ep_alloced string */
     }
 
     /* Recurse here. */
@@ -1585,59 +1754,178 @@ static void proto_tree_get_node_field_values(proto_node *node, gpointer data)
     }
 }
 
-void proto_tree_write_fields(output_fields_t* fields, epan_dissect_t *edt, FILE *fh)
+/* Get the values of the fields, walking the whole tree. */
+static void output_fields_walk_tree(output_fields_t* fields, epan_dissect_t *edt)
 {
-    gsize i;
-
     write_field_data_t data;
+    gsize i;
 
-    g_assert(fields);
-    g_assert(edt);
-    g_assert(fh);
+    for(i = 0; i < fields->fields->len; ++i) {
+        g_string_truncate(fields->field_values[i], 0);
+    }
 
     data.fields = fields;
     data.edt = edt;
+    proto_tree_children_foreach(edt->tree, proto_tree_get_node_field_values,
+                                &data);
+}
+
+/*
+ * Get the values of the fields from the fields the tree was primed with;
+ * the occurrences of a field come in the order they were added to the
+ * tree.
+ */
+static void output_fields_get_primed(output_fields_t* fields, epan_dissect_t *edt)
+{
+    GPtrArray* finfos;
+    gsize i;
+    guint j, k;
 
-    if(NULL == fields->field_indicies) {
-        /* Prepare a lookup table from string abbreviation for field to its index. */
-        fields->field_indicies = g_hash_table_new(g_str_hash, g_str_equal);
-
-        i = 0;
-        while( i < fields->fields->len) {
-            gchar* field = (gchar *)g_ptr_array_index(fields->fields, i);
-             /* Store field indicies +1 so that zero is not a valid value,
-              * and can be distinguished from NULL as a pointer.
-              */
-            ++i;
-            g_hash_table_insert(fields->field_indicies, field, GUINT_TO_POINTER(i));
+    for(i = 0; i < fields->fields->len; ++i) {
+        g_string_truncate(fields->field_values[i], 0);
+        for(j = 0; j < fields->field_ids[i]->len; ++j) {
+            finfos = proto_get_finfo_ptr_array(edt->tree,
+                g_array_index(fields->field_ids[i], int, j));
+            if(NULL == finfos) {
+                continue;
+            }
+            for(k = 0; k < finfos->len; ++k) {
+                output_fields_add_value(fields, (guint)i,
+                    get_node_field_value((field_info *)g_ptr_array_index(finfos, k), edt));
+            }
         }
     }
+}
 
-    /* Buffer to store values for this packet */
-    fields->field_values = ep_alloc_array0(emem_strbuf_t*, fields->fields->len);
-
-    proto_tree_children_foreach(edt->tree, proto_tree_get_node_field_values,
-                                &data);
+static void output_fields_write_line(output_fields_t* fields, FILE *fh,
+                                     gboolean newline)
+{
+    GString* line = fields->line;
+    gsize i;
 
+    g_string_truncate(line, 0);
     for(i = 0; i < fields->fields->len; ++i) {
         if(0 != i) {
-            fputc(fields->separator, fh);
+            g_string_append_c(line, fields->separator);
         }
-        if(NULL != fields->field_values[i]) {
+        if(0 != fields->field_values[i]->len) {
             if(fields->quote != '\0') {
-                fputc(fields->quote, fh);
+                g_string_append_c(line, fields->quote);
             }
-            fputs(fields->field_values[i]->str, fh);
+            g_string_append_len(line, fields->field_values[i]->str,
+                                fields->field_values[i]->len);
             if(fields->quote != '\0') {
-                fputc(fields->quote, fh);
+                g_string_append_c(line, fields->quote);
             }
         }
     }
+    if(newline) {
+        g_string_append_c(line, '\n');
+    }
+    fwrite(line->str, 1, line->len, fh);
+}
+
+void proto_tree_write_fields(output_fields_t* fields, epan_dissect_t *edt, FILE *fh)
+{
+    g_assert(fields);
+    g_assert(edt);
+    g_assert(fh);
+
+    output_fields_prepare(fields);
+    output_fields_walk_tree(fields, edt);
+    output_fields_write_line(fields, fh, FALSE);
+}
+
+void write_fields_packet(output_fields_t* fields, epan_dissect_t *edt, FILE *fh)
+{
+    gsize i;
+    guint32 end;
+    field_column_t* column;
+
+    g_assert(fields);
+    g_assert(edt);
+    g_assert(fh);
+
+    output_fields_prepare(fields);
+    if(fields->need_tree) {
+        output_fields_walk_tree(fields, edt);
+    } else {
+        output_fields_get_primed(fields, edt);
+    }
+
+    if(!fields->columnar) {
+        output_fields_write_line(fields, fh, TRUE);
+        return;
+    }
+
+    for(i = 0; i < fields->fields->len; ++i) {
+        column = &fields->columns[i];
+        if(0 == fields->batch_rows % 8) {
+            guint8 none = 0;
+            g_byte_array_append(column->present, &none, 1);
+        }
+        if(0 != fields->field_values[i]->len) {
+            column->present->data[fields->batch_rows / 8] |= 1 << (fields->batch_rows % 8);
+            g_string_append_len(column->data, fields->field_values[i]->str,
+                                fields->field_values[i]->len);
+        }
+        end = (guint32)column->data->len;
+        g_array_append_val(column->offsets, end);
+    }
+    if(++fields->batch_rows == FIELDS_BATCH_ROWS) {
+        write_fields_flush(fields, fh);
+    }
 }
 
-void write_fields_finale(output_fields_t* fields _U_ , FILE *fh _U_)
+void write_fields_flush(output_fields_t* fields, FILE *fh)
 {
-    /* Nothing to do */
+    GString* batch;
+    field_column_t* column;
+    gsize i;
+    guint32 row;
+
+    g_assert(fields);
+    g_assert(fh);
+
+    if(!fields->columnar || 0 == fields->batch_rows) {
+        return;
+    }
+
+    batch = g_string_sized_new(64 * 1024);
+    put_le32(batch, fields->batch_rows);
+    for(i = 0; i < fields->fields->len; ++i) {
+        column = &fields->columns[i];
+        g_string_append_len(batch, (const gchar *)column->present->data,
+                            column->present->len);
+        put_le32(batch, 0);
+        for(row = 0; row < fields->batch_rows; ++row) {
+            put_le32(batch, g_array_index(column->offsets, guint32, row));
+        }
+        g_string_append_len(batch, column->data->str, column->data->len);
+
+        g_byte_array_set_size(column->present, 0);
+        g_array_set_size(column->offsets, 0);
+        g_string_truncate(column->data, 0);
+    }
+    fwrite(batch->str, 1, batch->len, fh);
+    g_string_free(batch, TRUE);
+    fields->batch_rows = 0;
+}
+
+void write_fields_finale(output_fields_t* fields, FILE *fh)
+{
+    g_assert(fields);
+    g_assert(fh);
+
+    if(fields->columnar) {
+        GString* end = g_string_new("");
+
+        write_fields_flush(fields, fh);
+        /* A batch with no rows marks the end. */
+        put_le32(end, 0);
+        fwrite(end->str, 1, end->len, fh);
+        g_string_free(end, TRUE);
+    }
 }
 
 /* Returns an ep_alloced string or a static constant*/
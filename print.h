@@ -120,6 +120,38 @@ extern gsize output_fields_num_fields(output_fields_t* info);
 extern gboolean output_fields_set_option(output_fields_t* info, gchar* option);
 extern void output_fields_list_options(FILE *fh);
 
+/*
+ * write_fields_packet() gets the values of the fields from the ones the
+ * tree was primed with by output_fields_prime_edt(), so the tree needn't
+ * be visible, and no other fields need be there at all, unless
+ * output_fields_need_visible_tree() says so; then it walks the tree.
+ */
+extern gboolean output_fields_need_visible_tree(output_fields_t* info);
+extern void output_fields_prime_edt(output_fields_t* info, epan_dissect_t *edt);
+
+/*
+ * With the "columnar" option, the values are written in batches of rows,
+ * each field's values together, rather than as lines of text.  The output
+ * is the magic number, then, with all numbers 32-bit little-endian:
+ *
+ *   the format version and the number of fields;
+ *   for each field, the length of its name and the name;
+ *
+ * then the batches, each of them:
+ *
+ *   the number of rows, n, or 0 at the end of the output;
+ *   for each field:
+ *     (n + 7) / 8 bytes of bitmap, bit i set if row i has a value;
+ *     n + 1 offsets into the data, the value of row i being the bytes
+ *       from offset i up to offset i + 1;
+ *     the data.
+ *
+ * Batches stand on their own, so they can be put together from several
+ * writers.
+ */
+#define FIELDS_COLUMNAR_MAGIC   "WSFC"
+#define FIELDS_COLUMNAR_VERSION 1
+
 /*
  * Output only these protocols
  */
@@ -151,6 +183,8 @@ extern void write_carrays_finale(FILE *fh);
 
 extern void write_fields_preamble(output_fields_t* fields, FILE *fh);
 extern void proto_tree_write_fields(output_fields_t* fields, epan_dissect_t *edt, FILE *fh);
+extern void write_fields_packet(output_fields_t* fields, epan_dissect_t *edt, FILE *fh);
+extern void write_fields_flush(output_fields_t* fields, FILE *fh);
 extern void write_fields_finale(output_fields_t* fields, FILE *fh);
 
 extern const gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt);
@@ -121,9 +121,12 @@
 static const gchar decode_as_arg_template[] = "<layer_type>==<selector>,<decode_as_protocol>";
 
 static guint32 cum_bytes;
-static nstime_t first_ts;
-static nstime_t prev_dis_ts;
-static nstime_t prev_cap_ts;
+/* Copies of the frames the time stamps of the frame being dissected are
+   relative to; we don't keep any others. */
+static const frame_data *ref;
+static frame_data ref_frame;
+static frame_data *prev_dis;
+static frame_data prev_dis_frame;
 
 /*
  * The way the packet decode is to be written.
@@ -1071,7 +1074,11 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
     printf("%lu", (unsigned long int) cf->count);
 
     frame_data_set_before_dissect(&fdata, &cf->elapsed_time,
-                                  &first_ts, &prev_dis_ts, &prev_cap_ts);
+                                  &ref, prev_dis);
+    if (ref == &fdata) {
+        ref_frame = fdata;
+        ref = &ref_frame;
+    }
 
     /* We only need the columns if we're printing packet info but we're
      *not* verbose; in verbose mode, we print the protocol tree, not
@@ -1080,7 +1087,9 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
 
     tap_push_tapped_queue(&edt);
 
-    frame_data_set_after_dissect(&fdata, &cum_bytes, &prev_dis_ts);
+    frame_data_set_after_dissect(&fdata, &cum_bytes);
+    prev_dis_frame = fdata;
+    prev_dis = &prev_dis_frame;
 
     for(i = 0; i < n_rfilters; i++) {
         /* Run the read filter if we have one. */
@@ -1560,6 +1569,21 @@ open_failure_message(const char *filename, int err, gboolean for_writing)
     fprintf(stderr, "\n");
 }
 
+/* How frame_delta_abs_time() gets at other frames' time stamps.  Every
+   frame counts as displayed, so the previous displayed frame is also the
+   previous captured one. */
+static const nstime_t *
+raw_get_frame_ts(void *data _U_, guint32 frame_num)
+{
+    if (ref != NULL && ref->num == frame_num)
+        return &ref->abs_ts;
+
+    if (prev_dis != NULL && prev_dis->num == frame_num)
+        return &prev_dis->abs_ts;
+
+    return NULL;
+}
+
 cf_status_t
 raw_cf_open(capture_file *cf, const char *fname)
 {
@@ -1594,9 +1618,9 @@ raw_cf_open(capture_file *cf, const char *fname)
     cf->has_snap = FALSE;
     cf->snap = WTAP_MAX_PACKET_SIZE;
     nstime_set_zero(&cf->elapsed_time);
-    nstime_set_unset(&first_ts);
-    nstime_set_unset(&prev_dis_ts);
-    nstime_set_unset(&prev_cap_ts);
+    ref = NULL;
+    prev_dis = NULL;
+    frame_data_set_ts_func(raw_get_frame_ts, NULL);
 
     return CF_OK;
 }
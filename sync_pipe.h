@@ -56,6 +56,8 @@
 #define SP_PACKET_COUNT 'P'     /* count of packets captured since last message */
 #define SP_DROPS        'D'     /* count of packets dropped in capture */
 #define SP_SUCCESS      'S'     /* success indication, no extra data */
+#define SP_QUEUE_HWM    'H'     /* interface:high-water mark:size of a writer queue */
+#define SP_RING_DROPS   'R'     /* interface:ring:received:dropped:times full of a capture ring */
 /*
  * Win32 only: Indications sent out on the signal pipe (from parent to child)
  * (UNIX-like sends signals for this)
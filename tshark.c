@@ -51,6 +51,14 @@
 # include <sys/stat.h>
 #endif
 
+#ifdef HAVE_SYS_WAIT_H
+# include <sys/wait.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
+
 #ifndef HAVE_GETOPT
 #include "wsutil/wsgetopt.h"
 #endif
@@ -95,6 +103,7 @@
 #endif /* HAVE_LIBPCAP */
 #include "log.h"
 #include <epan/funnel.h>
+#include <epan/conversation.h>
 #include "capture_opts.h"
 
 /*
@@ -104,14 +113,58 @@
 static const gchar decode_as_arg_template[] = "<layer_type>==<selector>,<decode_as_protocol>";
 
 static guint32 cum_bytes;
-static nstime_t first_ts;
-static nstime_t prev_dis_ts;
-static nstime_t prev_cap_ts;
+/* The frames the time stamps of the frame being dissected are relative
+   to.  Unless we're doing two passes we don't keep the frames, so we keep
+   copies of these. */
+static const frame_data *ref;
+static frame_data ref_frame;
+static frame_data *prev_dis;
+static frame_data prev_dis_frame;
+static frame_data *prev_cap;
+static frame_data prev_cap_frame;
 
 static gboolean print_packet_info;      /* TRUE if we're to print packet information */
 
 static gboolean perform_two_pass_analysis;
 
+#ifndef _WIN32
+/*
+ * Number of worker processes to use for the second pass of a two-pass
+ * analysis, changeable via the -j option; 0 means "dissect in this
+ * process".
+ *
+ * The first pass is always done sequentially by this process, so that
+ * stateful dissectors (conversations, reassembly, TCP analysis) see every
+ * frame in order and record whatever per-frame state they need; the
+ * workers are forked after that, so each of them inherits that state and
+ * then dissects its share of the frames exactly as the second pass of a
+ * "-2" run would, with its own epan_dissect_t and ep memory.  The frames
+ * are handed out in chunks of PARALLEL_CHUNK_FRAMES frames, and the output
+ * of each chunk is written out in frame order.
+ */
+static guint parallel_workers;
+
+#define PARALLEL_CHUNK_FRAMES 1024
+
+/*
+ * Number of worker processes to dissect a capture file with in a single
+ * pass, changeable via the -J option; 0 means "dissect in this process".
+ *
+ * Each frame is handed to the worker chosen by a hash of its addresses
+ * and ports, so that all frames of a conversation go to the same worker
+ * and each worker's conversation, reassembly and TCP analysis state only
+ * covers its own conversations.  The output is written in frame order.
+ */
+static guint flow_shards;
+#endif
+
+/*
+ * TRUE if, when the dissection is done only to apply a read filter, the
+ * dissectors of protocols the filter can't look at should be skipped once
+ * those it looks at have been dissected; set with the -U option.
+ */
+static gboolean prune_dissection = FALSE;
+
 /*
  * The way the packet decode is to be written.
  */
@@ -162,12 +215,20 @@ static void report_counts_siginfo(int);
 #endif /* HAVE_LIBPCAP */
 
 static int load_cap_file(capture_file *, char *, int, gboolean, int, gint64);
+#ifndef _WIN32
+static gboolean process_second_pass_parallel(capture_file *cf, int *err,
+    gchar **err_info, gboolean filtering_tap_listeners, guint tap_flags);
+static gboolean process_packets_sharded(capture_file *cf, int *err,
+    gchar **err_info, gboolean filtering_tap_listeners, guint tap_flags,
+    int max_packet_count, gint64 max_byte_count);
+#endif
 static gboolean process_packet(capture_file *cf, gint64 offset,
     const struct wtap_pkthdr *whdr, union wtap_pseudo_header *pseudo_header,
     const guchar *pd, gboolean filtering_tap_listeners, guint tap_flags);
 static void show_capture_file_io_error(const char *, int, gboolean);
 static void show_print_file_io_error(int err);
 static gboolean write_preamble(capture_file *cf);
+static gboolean fields_from_primed_tree(void);
 static gboolean print_packet(capture_file *cf, epan_dissect_t *edt);
 static gboolean write_finale(void);
 static const char *cf_open_error_message(int err, gchar *err_info,
@@ -278,7 +339,17 @@ print_usage(gboolean print_ver)
   fprintf(output, "\n");
   fprintf(output, "Processing:\n");
   fprintf(output, "  -2                       perform a two-pass analysis\n");
+#ifndef _WIN32
+  fprintf(output, "  -j <workers>             do the second pass of a two-pass analysis in\n");
+  fprintf(output, "                           parallel, using n worker processes (implies -2)\n");
+  fprintf(output, "  -J <workers>             dissect in parallel, using n worker processes that\n");
+  fprintf(output, "                           each handle a share of the conversations\n");
+#endif
   fprintf(output, "  -R <read filter>         packet filter in Wireshark display filter syntax\n");
+  fprintf(output, "  -U                       with -R and -q or -w, skip the dissectors of\n");
+  fprintf(output, "                           protocols the read filter doesn't look at\n");
+  fprintf(output, "  -M <secs>[:<count>]      forget conversations idle for secs seconds, and\n");
+  fprintf(output, "                           the least recently used ones beyond count\n");
   fprintf(output, "  -n                       disable all name resolutions (def: all enabled)\n");
   fprintf(output, "  -N <name resolve flags>  enable specific name resolution(s): \"mntC\"\n");
   fprintf(output, "  -d %s ...\n", decode_as_arg_template);
@@ -856,16 +927,24 @@ main(int argc, char *argv[])
 #define OPTSTRING_I ""
 #endif
 
-#define OPTSTRING "2a:A:b:" OPTSTRING_B "c:C:d:De:E:f:F:G:hH:i:" OPTSTRING_I "K:lLnN:o:O:pPqr:R:s:S:t:T:u:vVw:W:xX:y:z:"
+#ifndef _WIN32
+#define OPTSTRING_j "j:J:"
+#else
+#define OPTSTRING_j ""
+#endif
+
+#define OPTSTRING "2a:A:b:" OPTSTRING_B "c:C:d:De:E:f:F:G:hH:i:" OPTSTRING_I OPTSTRING_j "K:lLM:nN:o:O:pPqr:R:s:S:t:T:u:UvVw:W:xX:y:z:"
 
   static const char    optstring[] = OPTSTRING;
 
 #ifdef _WIN32
   arg_list_utf_16to8(argc, argv);
+#endif /* _WIN32 */
 #if !GLIB_CHECK_VERSION(2,31,0)
+  /* Initialize the thread system; it's used for parallel dissection
+     as well as on Windows. */
   g_thread_init(NULL);
 #endif
-#endif /* _WIN32 */
 
   /*
    * Get credential information for later use.
@@ -1132,6 +1211,29 @@ main(int argc, char *argv[])
       read_keytab_file(optarg);
       break;
 #endif
+#ifndef _WIN32
+    case 'j':        /* Number of second-pass worker processes */
+      parallel_workers = get_positive_int(optarg, "number of dissection workers");
+      perform_two_pass_analysis = TRUE;
+      break;
+    case 'J':        /* Number of flow-sharded worker processes */
+      flow_shards = get_positive_int(optarg, "number of dissection workers");
+      break;
+#endif
+    case 'M':        /* Age out conversations */
+      {
+        char *max_p;
+        guint max_conversations = 0;
+
+        max_p = strchr(optarg, ':');
+        if (max_p != NULL) {
+          *max_p++ = '\0';
+          max_conversations = get_natural_int(max_p, "maximum number of conversations");
+        }
+        conversation_set_aging(get_natural_int(optarg, "conversation idle timeout"),
+                               max_conversations);
+      }
+      break;
     case 'D':        /* Print a list of capture devices and exit */
 #ifdef HAVE_LIBPCAP
       if_list = capture_interface_list(&err, &err_str);
@@ -1312,6 +1414,9 @@ main(int argc, char *argv[])
         return 1;
       }
       break;
+    case 'U':        /* Prune dissection to what the read filter needs */
+      prune_dissection = TRUE;
+      break;
     case 'u':        /* Seconds type */
       if (strcmp(optarg, "s") == 0)
         timestamp_set_seconds_type(TS_SECONDS_DEFAULT);
@@ -1643,6 +1748,73 @@ main(int argc, char *argv[])
   }
 #endif
 
+#ifndef _WIN32
+  if (parallel_workers > 1 && flow_shards > 1) {
+    cmdarg_err("-j and -J can't both be specified.");
+    return 1;
+  }
+  if (parallel_workers > 1 || flow_shards > 1) {
+    /* Each worker process has its own copy of the tap listeners' state;
+       flow-sharded workers see each packet once, so we can add up their
+       results if all the tap listeners know how, but second-pass workers
+       all redo the first pass.  Only one process can write the output
+       capture file, so we don't support that with parallel dissection. */
+    if (cf_name == NULL) {
+      cmdarg_err("Parallel dissection is only supported when reading a capture file.");
+      return 1;
+    }
+    if (parallel_workers > 1 && tap_listeners_require_dissection()) {
+      cmdarg_err("Taps aren't supported with -j.");
+      return 1;
+    }
+    if (flow_shards > 1 && !tap_listeners_mergeable()) {
+      cmdarg_err("The only statistics supported with -J are \"http,stat\", \"sip,stat\" and the\n"
+                 "statistics trees, such as \"http,tree\".");
+      return 1;
+    }
+#ifdef HAVE_LIBPCAP
+    if (global_capture_opts.saving_to_file) {
+      cmdarg_err("Writing a capture file isn't supported with parallel dissection.");
+      return 1;
+    }
+#endif
+  }
+#endif
+
+  if (prune_dissection) {
+    /* Pruning leaves out of the protocol tree, the columns and the taps
+       everything the read filter doesn't look at, so only do it when
+       the filter is all the dissection is done for. */
+    if (rfilter == NULL) {
+      cmdarg_err("-U requires a read filter (-R).");
+      return 1;
+    }
+    if (print_packet_info) {
+      cmdarg_err("-U can't be used when dissected packets are printed; use -q or -w.");
+      return 1;
+    }
+    if (tap_listeners_require_dissection()) {
+      cmdarg_err("-U can't be used with taps.");
+      return 1;
+    }
+    if (perform_two_pass_analysis) {
+      cmdarg_err("-U can't be used with a two-pass analysis.");
+      return 1;
+    }
+  }
+
+  if (conversation_aging_enabled() && perform_two_pass_analysis) {
+    cmdarg_err("-M can't be used with a two-pass analysis.");
+    return 1;
+  }
+
+#ifndef _WIN32
+  if (flow_shards > 1 && perform_two_pass_analysis) {
+    cmdarg_err("-J can't be used with a two-pass analysis.");
+    return 1;
+  }
+#endif
+
   /* disabled protocols as per configuration file */
   if (gdp_path == NULL && dp_path == NULL) {
     set_disabled_protos_list();
@@ -1835,6 +2007,16 @@ main(int argc, char *argv[])
       print_packet_counts = TRUE;
     }
 
+    /*
+     * If we're going to dissect what's captured, and the user asked
+     * for it, have dumpcap hand the packets to us through a shared
+     * ring rather than reading them back from the capture file.  We
+     * can only read the ring once, so not for a two-pass analysis.
+     */
+    if (do_dissection && !perform_two_pass_analysis &&
+        prefs_p->capture_shared_ring_size > 0)
+      global_capture_opts.shm_ring_size = prefs_p->capture_shared_ring_size;
+
     /* For now, assume libpcap gives microsecond precision. */
     timestamp_set_precision(TS_PREC_AUTO_USEC);
 
@@ -1864,6 +2046,16 @@ main(int argc, char *argv[])
 #endif
   }
 
+  if (conversation_aging_enabled()) {
+    conversation_stats_t conv_stats;
+
+    conversation_get_stats(&conv_stats);
+    fprintf(stderr, "%u conversations at the end, %u at most; %" G_GINT64_MODIFIER "u created,\n"
+            "%" G_GINT64_MODIFIER "u forgotten when idle, %" G_GINT64_MODIFIER "u to stay under the limit\n",
+            conv_stats.live, conv_stats.peak, conv_stats.created,
+            conv_stats.evicted_idle, conv_stats.evicted_limit);
+  }
+
   g_free(cf_name);
 
   if (cfile.frames != NULL) {
@@ -2432,6 +2624,12 @@ capture_input_closed(capture_options *capture_opts, gchar *msg)
       ws_unlink(cf->filename);
     }
   }
+  if(capture_opts->shm_ring_file != NULL) {
+    /* dumpcap's done with the ring, and so are we */
+    ws_unlink(capture_opts->shm_ring_file);
+    g_free(capture_opts->shm_ring_file);
+    capture_opts->shm_ring_file = NULL;
+  }
 #ifdef USE_BROKEN_G_MAIN_LOOP
   /*g_main_loop_quit(loop);*/
   g_main_quit(loop);
@@ -2536,7 +2734,11 @@ process_packet_first_pass(capture_file *cf,
       epan_dissect_prime_dfilter(&edt, cf->rfcode);
 
     frame_data_set_before_dissect(&fdlocal, &cf->elapsed_time,
-                                  &first_ts, &prev_dis_ts, &prev_cap_ts);
+                                  &ref, prev_dis);
+    if (ref == &fdlocal) {
+      ref_frame = fdlocal;
+      ref = &ref_frame;
+    }
 
     epan_dissect_run(&edt, pseudo_header, pd, &fdlocal, NULL);
 
@@ -2546,13 +2748,19 @@ process_packet_first_pass(capture_file *cf,
   }
 
   if (passed) {
-    frame_data_set_after_dissect(&fdlocal, &cum_bytes, &prev_dis_ts);
-    frame_data_sequence_add(cf->frames, &fdlocal);
+    frame_data_set_after_dissect(&fdlocal, &cum_bytes);
+    prev_dis = frame_data_sequence_add(cf->frames, &fdlocal);
     cf->count++;
+  } else {
+    /* We won't see this frame again. */
+    frame_data_cleanup(&fdlocal);
   }
 
-  if (do_dissection)
+  if (do_dissection) {
+    prev_cap_frame = fdlocal;
+    prev_cap = &prev_cap_frame;
     epan_dissect_cleanup(&edt);
+  }
 
   return passed;
 }
@@ -2589,8 +2797,14 @@ process_packet_second_pass(capture_file *cf, frame_data *fdata,
     /* The protocol tree will be "visible", i.e., printed, only if we're
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode ("verbose"
-       is true). */
-    epan_dissect_init(&edt, create_proto_tree, print_packet_info && verbose);
+       is true), other than just the values of some fields. */
+    epan_dissect_init(&edt, create_proto_tree,
+                      print_packet_info && verbose && !fields_from_primed_tree());
+
+    /* If we're printing the values of some fields, prime the
+       epan_dissect_t with those fields. */
+    if (print_packet_info && output_action == WRITE_FIELDS)
+      output_fields_prime_edt(output_fields, &edt);
 
     /* If we're running a read filter, prime the epan_dissect_t with that
        filter. */
@@ -2669,6 +2883,24 @@ process_packet_second_pass(capture_file *cf, frame_data *fdata,
   return passed;
 }
 
+/* Say how well reading ahead kept up with the dissectors, for whoever
+   has turned on debug messages with the console.log.level preference. */
+static void
+log_prefetch_stats(wtap *wth)
+{
+  wtap_prefetch_stats stats;
+
+  if (!wtap_get_prefetch_stats(wth, &stats))
+    return;
+  g_log(LOG_DOMAIN_MAIN, G_LOG_LEVEL_DEBUG,
+        "Read ahead %" G_GINT64_MODIFIER "u records; queue of %u held up to %u, "
+        "%.1f on average; dissectors waited %" G_GINT64_MODIFIER "u times, "
+        "reader %" G_GINT64_MODIFIER "u times",
+        stats.records, stats.depth, stats.max_queued,
+        stats.reads ? (double)stats.queued_total / stats.reads : 0.0,
+        stats.caller_waits, stats.reader_waits);
+}
+
 static int
 load_cap_file(capture_file *cf, char *save_file, int out_file_type,
     gboolean out_file_name_res, int max_packet_count, gint64 max_byte_count)
@@ -2683,6 +2915,7 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   char         *save_file_string = NULL;
   gboolean     filtering_tap_listeners;
   guint        tap_flags;
+  gboolean     indexing = FALSE;
   wtapng_section_t *shb_hdr;
   wtapng_iface_descriptions_t *idb_inf;
   char         appname[100];
@@ -2775,6 +3008,23 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   /* Get the union of the flags for all tap listeners. */
   tap_flags = union_of_tap_listener_flags();
 
+  /* A frame index left behind by an earlier read has the seek points
+     that let a compressed file be inflated in parallel; if there isn't
+     one, record one if we're going to read all of the file. */
+  if (prefs.gui_frame_index && !cf->is_tempfile &&
+      strcmp(cf->filename, "-") != 0 &&
+      !wtap_index_load(cf->wth, cf->filename) &&
+      max_packet_count == 0 && max_byte_count == 0)
+    indexing = wtap_index_start(cf->wth);
+
+  /* Have wiretap read the file ahead of the dissectors on another
+     thread, unless we're about to fork workers, which would get a copy
+     of us without that thread. */
+#ifndef _WIN32
+  if (flow_shards <= 1)
+#endif
+    wtap_set_prefetch(cf->wth, 0);
+
   if (perform_two_pass_analysis) {
     frame_data *fdata;
     int old_max_packet_count = max_packet_count;
@@ -2797,6 +3047,8 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       }
     }
 
+    log_prefetch_stats(cf->wth);
+
     /* Close the sequential I/O side, to free up memory it requires. */
     wtap_sequential_close(cf->wth);
 
@@ -2806,6 +3058,20 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
 
     max_packet_count = old_max_packet_count;
 
+#ifndef _WIN32
+    if (parallel_workers > 1) {
+      /* The packet count limit has already been applied by the first
+         pass, and we don't write a capture file in this mode, so the
+         workers just dissect every frame we kept. */
+      if (err == 0 &&
+          !process_second_pass_parallel(cf, &err, &err_info,
+                                        filtering_tap_listeners, tap_flags)) {
+        /* A worker died without reporting why; that's already been
+           reported, and there's no point in writing the finale. */
+        goto out;
+      }
+    } else
+#endif
     for (framenum = 1; err == 0 && framenum <= cf->count; framenum++) {
       fdata = frame_data_sequence_find(cf->frames, framenum);
       if (wtap_seek_read(cf->wth, fdata->file_off, &cf->pseudo_header,
@@ -2859,6 +3125,17 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       }
     }
   }
+#ifndef _WIN32
+  else if (flow_shards > 1) {
+    if (!process_packets_sharded(cf, &err, &err_info,
+                                 filtering_tap_listeners, tap_flags,
+                                 max_packet_count, max_byte_count)) {
+      /* A worker died without reporting why; that's already been
+         reported, and there's no point in writing the finale. */
+      goto out;
+    }
+  }
+#endif
   else {
     framenum = 0;
     while (wtap_read(cf->wth, &err, &err_info, &data_offset)) {
@@ -2910,6 +3187,15 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
     }
   }
 
+  log_prefetch_stats(cf->wth);
+
+  /* It's only a cache, so failing to write it isn't worth mentioning. */
+  if (indexing && err == 0) {
+    int index_err;
+
+    wtap_index_write(cf->wth, cf->filename, &index_err);
+  }
+
   if (err != 0) {
     /*
      * Print a message noting that the read failed somewhere along the line.
@@ -3005,6 +3291,907 @@ out:
   return err;
 }
 
+#ifndef _WIN32
+/*
+ * Header sent by a second-pass worker ahead of the output for each chunk
+ * of frames.  If err is non-zero, the worker couldn't read a frame, the
+ * data following the header is the wiretap error information string, if
+ * any, and the worker has quit.
+ */
+typedef struct {
+  guint32 len;
+  gint32  err;
+  guint32 nframes;      /* number of frame_output_t entries that follow */
+} chunk_hdr_t;
+
+/*
+ * Sent by flow-sharded workers, whose chunks aren't runs of consecutive
+ * frames, after the chunk header: which frames the chunk covers and how
+ * much of the chunk's output belongs to each of them.
+ */
+typedef struct {
+  guint32 framenum;
+  guint32 len;
+} frame_output_t;
+
+static gboolean
+write_all(int fd, const void *buf, size_t len)
+{
+  const char *p = (const char *)buf;
+  ssize_t     nwritten;
+
+  while (len != 0) {
+    nwritten = ws_write(fd, p, (unsigned int)len);
+    if (nwritten < 0) {
+      if (errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    p += nwritten;
+    len -= nwritten;
+  }
+  return TRUE;
+}
+
+static gboolean
+read_all(int fd, void *buf, size_t len)
+{
+  char    *p = (char *)buf;
+  ssize_t  nread;
+
+  while (len != 0) {
+    nread = ws_read(fd, p, (unsigned int)len);
+    if (nread < 0) {
+      if (errno == EINTR)
+        continue;
+      return FALSE;
+    }
+    if (nread == 0)
+      return FALSE;     /* EOF */
+    p += nread;
+    len -= nread;
+  }
+  return TRUE;
+}
+
+/*
+ * Send everything printed for the current chunk, which the worker has
+ * written to the temporary file on its standard output, to the parent,
+ * along with the frame_output_t entries in frame_index, if any, and empty
+ * that file and frame_index for the next chunk.
+ */
+static gboolean
+worker_send_chunk(int out_fd, GArray *frame_index)
+{
+  chunk_hdr_t chunk_hdr;
+  char        buf[65536];
+  gint64      chunk_len;
+  ssize_t     nread;
+
+  if (output_action == WRITE_FIELDS)
+    write_fields_flush(output_fields, stdout);
+  if (fflush(stdout) == EOF)
+    return FALSE;
+  chunk_len = ws_lseek64(1, 0, SEEK_CUR);
+  if (chunk_len < 0 || chunk_len > G_MAXUINT32)
+    return FALSE;
+  chunk_hdr.len = (guint32)chunk_len;
+  chunk_hdr.err = 0;
+  chunk_hdr.nframes = frame_index != NULL ? frame_index->len : 0;
+  if (!write_all(out_fd, &chunk_hdr, sizeof chunk_hdr))
+    return FALSE;
+  if (chunk_hdr.nframes != 0) {
+    if (!write_all(out_fd, frame_index->data,
+                   chunk_hdr.nframes * sizeof (frame_output_t)))
+      return FALSE;
+    g_array_set_size(frame_index, 0);
+  }
+  if (ws_lseek64(1, 0, SEEK_SET) < 0)
+    return FALSE;
+  while (chunk_len != 0) {
+    nread = ws_read(1, buf, (unsigned int)MIN(chunk_len, (gint64)sizeof buf));
+    if (nread <= 0)
+      return FALSE;
+    if (!write_all(out_fd, buf, nread))
+      return FALSE;
+    chunk_len -= nread;
+  }
+  if (ftruncate(1, 0) < 0)
+    return FALSE;
+  return fseek(stdout, 0L, SEEK_SET) == 0;
+}
+
+static void
+worker_send_error(int out_fd, int err, const gchar *err_info)
+{
+  chunk_hdr_t chunk_hdr;
+
+  chunk_hdr.len = err_info != NULL ? (guint32)strlen(err_info) : 0;
+  chunk_hdr.err = err;
+  chunk_hdr.nframes = 0;
+  if (write_all(out_fd, &chunk_hdr, sizeof chunk_hdr) && chunk_hdr.len != 0)
+    write_all(out_fd, err_info, chunk_hdr.len);
+}
+
+/*
+ * Body of a second-pass worker process: dissect and print chunks
+ * worker, worker + parallel_workers, worker + 2*parallel_workers, ...
+ * of the frames found by the first pass, sending the output for each
+ * chunk to the parent through out_fd.  Returns the exit status for the
+ * worker.
+ */
+static int
+second_pass_worker(capture_file *cf, guint worker, int out_fd,
+                   gboolean filtering_tap_listeners, guint tap_flags)
+{
+  FILE       *chunk_fh;
+  guint32     chunk_start, chunk_end;
+  guint32     framenum;
+  frame_data *fdata;
+  int         err;
+  gchar      *err_info = NULL;
+
+  /* Get random-access file descriptors of our own, so that our seeks
+     don't move the file offset out from under the other workers; the
+     fast seek points gathered by the first pass are kept. */
+  wtap_fdclose(cf->wth);
+  if (!wtap_fdreopen(cf->wth, cf->filename, &err)) {
+    worker_send_error(out_fd, err, NULL);
+    return 2;
+  }
+
+  /* Everything we print goes to a temporary file first, so that we
+     know how much output each chunk produced. */
+  chunk_fh = tmpfile();
+  if (chunk_fh == NULL || dup2(fileno(chunk_fh), 1) < 0) {
+    worker_send_error(out_fd, errno, NULL);
+    return 2;
+  }
+
+  for (chunk_start = 1 + worker * PARALLEL_CHUNK_FRAMES;
+       chunk_start <= cf->count;
+       chunk_start += parallel_workers * PARALLEL_CHUNK_FRAMES) {
+    chunk_end = MIN(chunk_start + PARALLEL_CHUNK_FRAMES - 1, cf->count);
+    for (framenum = chunk_start; framenum <= chunk_end; framenum++) {
+      fdata = frame_data_sequence_find(cf->frames, framenum);
+      if (!wtap_seek_read(cf->wth, fdata->file_off, &cf->pseudo_header,
+          cf->pd, fdata->cap_len, &err, &err_info)) {
+        worker_send_error(out_fd, err, err_info);
+        return 2;
+      }
+      process_packet_second_pass(cf, fdata, &cf->pseudo_header, cf->pd,
+                                 filtering_tap_listeners, tap_flags);
+    }
+    if (!worker_send_chunk(out_fd, NULL)) {
+      /* Either we can't write our own temporary file, or the parent has
+         gone away; either way there's nobody to tell. */
+      return 2;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Do the second pass of a two-pass analysis with parallel_workers worker
+ * processes, copying their output to our standard output in frame order.
+ *
+ * Returns TRUE if all the frames were processed or a worker reported a
+ * read error, in which case *err and *err_info are set; returns FALSE,
+ * after reporting it, if a worker died or couldn't be started.
+ */
+static gboolean
+process_second_pass_parallel(capture_file *cf, int *err, gchar **err_info,
+                             gboolean filtering_tap_listeners, guint tap_flags)
+{
+  int         *worker_fds;
+  pid_t       *worker_pids;
+  int          pipe_fds[2];
+  guint        worker, nworkers;
+  guint32      chunk, nchunks;
+  chunk_hdr_t  chunk_hdr;
+  char         buf[65536];
+  guint32      len, n;
+  gboolean     ok = TRUE;
+  int          wstatus;
+
+  /* Don't let the workers inherit, and then write out, whatever we've
+     already buffered up (such as the preamble). */
+  fflush(stdout);
+
+  worker_fds = g_new(int, parallel_workers);
+  worker_pids = g_new(pid_t, parallel_workers);
+  for (nworkers = 0; nworkers < parallel_workers; nworkers++) {
+    if (pipe(pipe_fds) < 0) {
+      cmdarg_err("Couldn't create a pipe for a dissection worker: %s.",
+                 g_strerror(errno));
+      ok = FALSE;
+      break;
+    }
+    worker_pids[nworkers] = fork();
+    if (worker_pids[nworkers] < 0) {
+      cmdarg_err("Couldn't create a dissection worker: %s.",
+                 g_strerror(errno));
+      ws_close(pipe_fds[0]);
+      ws_close(pipe_fds[1]);
+      ok = FALSE;
+      break;
+    }
+    if (worker_pids[nworkers] == 0) {
+      /* Child process - don't hang on to the other workers' pipes. */
+      for (worker = 0; worker < nworkers; worker++)
+        ws_close(worker_fds[worker]);
+      ws_close(pipe_fds[0]);
+      _exit(second_pass_worker(cf, nworkers, pipe_fds[1],
+                               filtering_tap_listeners, tap_flags));
+    }
+    ws_close(pipe_fds[1]);
+    worker_fds[nworkers] = pipe_fds[0];
+  }
+
+  /* Chunk n is always done by worker n % parallel_workers, so reading
+     the chunks in order gives us the output in frame order. */
+  nchunks = (cf->count + PARALLEL_CHUNK_FRAMES - 1) / PARALLEL_CHUNK_FRAMES;
+  for (chunk = 0; ok && *err == 0 && chunk < nchunks; chunk++) {
+    worker = chunk % parallel_workers;
+    if (!read_all(worker_fds[worker], &chunk_hdr, sizeof chunk_hdr)) {
+      cmdarg_err("Dissection worker %u exited unexpectedly.", worker + 1);
+      ok = FALSE;
+      break;
+    }
+    if (chunk_hdr.err != 0) {
+      *err = chunk_hdr.err;
+      if (chunk_hdr.len != 0) {
+        *err_info = g_malloc(chunk_hdr.len + 1);
+        if (!read_all(worker_fds[worker], *err_info, chunk_hdr.len))
+          chunk_hdr.len = 0;
+        (*err_info)[chunk_hdr.len] = '\0';
+      }
+      break;
+    }
+    for (len = chunk_hdr.len; len != 0; len -= n) {
+      n = MIN(len, (guint32)sizeof buf);
+      if (!read_all(worker_fds[worker], buf, n)) {
+        cmdarg_err("Dissection worker %u exited unexpectedly.", worker + 1);
+        ok = FALSE;
+        break;
+      }
+      fwrite(buf, 1, n, stdout);
+    }
+    if (line_buffered)
+      fflush(stdout);
+    if (ferror(stdout)) {
+      show_print_file_io_error(errno);
+      exit(2);
+    }
+  }
+
+  /* Closing the pipes makes any worker we've stopped listening to quit
+     with a SIGPIPE. */
+  for (worker = 0; worker < nworkers; worker++) {
+    ws_close(worker_fds[worker]);
+    while (waitpid(worker_pids[worker], &wstatus, 0) < 0 && errno == EINTR)
+      ;
+  }
+  g_free(worker_fds);
+  g_free(worker_pids);
+
+  if (!ok)
+    *err = ECHILD;
+  return ok;
+}
+
+/*
+ * Flow-sharded dissection.
+ */
+
+/* Mix a 32-bit value into a hash (the 32-bit finalizer from MurmurHash3). */
+static guint32
+flow_hash_mix(guint32 h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+static guint32
+flow_hash_bytes(const guchar *p, guint len, guint32 h)
+{
+  while (len-- != 0)
+    h = (h ^ *p++) * 16777619;          /* FNV-1a */
+  return h;
+}
+
+/*
+ * Hash one end of a conversation; the hashes of the two ends are XORed
+ * together, so that both directions of a conversation hash the same.
+ */
+static guint32
+flow_hash_endpoint(const guchar *addr, guint addr_len, guint16 port)
+{
+  guint32 h;
+
+  h = flow_hash_bytes(addr, addr_len, 2166136261U);
+  return flow_hash_mix(h ^ port);
+}
+
+/*
+ * Hash the addresses, protocol and, unless the packet is a fragment, the
+ * ports of an IPv4 or IPv6 packet.  Fragments are hashed on addresses and
+ * protocol alone, so all of the fragments of a datagram end up with the
+ * same worker and can be reassembled.
+ */
+static guint32
+flow_hash_ip(const guchar *pd, guint32 len)
+{
+  const guchar *src, *dst;
+  guint         addr_len, hdr_len;
+  guint8        proto;
+  gboolean      is_fragment;
+  guint16       sport = 0, dport = 0;
+
+  if (len < 1)
+    return 0;
+  switch (pd[0] >> 4) {
+
+  case 4:
+    if (len < 20)
+      return 0;
+    hdr_len = (pd[0] & 0x0f) * 4;
+    proto = pd[9];
+    src = pd + 12;
+    dst = pd + 16;
+    addr_len = 4;
+    is_fragment = (pntohs(pd + 6) & 0x3fff) != 0;  /* MF or offset set */
+    break;
+
+  case 6:
+    if (len < 40)
+      return 0;
+    hdr_len = 40;
+    proto = pd[6];
+    src = pd + 8;
+    dst = pd + 24;
+    addr_len = 16;
+    is_fragment = FALSE;
+    /* Skip the extension headers that can precede the transport header. */
+    while (proto == 0 || proto == 43 || proto == 44 || proto == 60) {
+      if (len < hdr_len + 8)
+        return flow_hash_endpoint(src, addr_len, 0) ^
+               flow_hash_endpoint(dst, addr_len, 0);
+      if (proto == 44) {
+        is_fragment = TRUE;
+        proto = pd[hdr_len];
+        hdr_len += 8;
+        break;
+      }
+      proto = pd[hdr_len];
+      hdr_len += (pd[hdr_len + 1] + 1) * 8;
+    }
+    break;
+
+  default:
+    return 0;
+  }
+
+  if (!is_fragment && len >= hdr_len + 4) {
+    switch (proto) {
+
+    case 6:     /* TCP */
+    case 17:    /* UDP */
+    case 33:    /* DCCP */
+    case 132:   /* SCTP */
+    case 136:   /* UDP-Lite */
+      sport = pntohs(pd + hdr_len);
+      dport = pntohs(pd + hdr_len + 2);
+      break;
+    }
+  }
+  return flow_hash_mix((flow_hash_endpoint(src, addr_len, sport) ^
+                        flow_hash_endpoint(dst, addr_len, dport)) + proto);
+}
+
+/*
+ * Hash a frame so that all frames of a conversation get the same hash.
+ * We only look at the encapsulations and protocols we can find without
+ * dissecting; everything else hashes to 0, and thus goes to the first
+ * worker.
+ */
+static guint32
+flow_hash_frame(int encap, const guchar *pd, guint32 len)
+{
+  guint    offset;
+  guint16  ethertype;
+
+  switch (encap) {
+
+  case WTAP_ENCAP_ETHERNET:
+    if (len < 14)
+      return 0;
+    offset = 12;
+    ethertype = pntohs(pd + offset);
+    /* Skip 802.1Q/802.1ad VLAN tags. */
+    while ((ethertype == 0x8100 || ethertype == 0x88a8 ||
+            ethertype == 0x9100) && len >= offset + 6) {
+      offset += 4;
+      ethertype = pntohs(pd + offset);
+    }
+    offset += 2;
+    if (ethertype == 0x0800 || ethertype == 0x86dd)
+      return flow_hash_ip(pd + offset, len - offset);
+    /* Not IP; keep traffic between the same pair of stations together. */
+    return flow_hash_mix(flow_hash_endpoint(pd, 6, 0) ^
+                         flow_hash_endpoint(pd + 6, 6, 0));
+
+  case WTAP_ENCAP_SLL:
+    if (len < 16)
+      return 0;
+    ethertype = pntohs(pd + 14);
+    if (ethertype == 0x0800 || ethertype == 0x86dd)
+      return flow_hash_ip(pd + 16, len - 16);
+    return 0;
+
+  case WTAP_ENCAP_RAW_IP:
+  case WTAP_ENCAP_RAW_IP4:
+  case WTAP_ENCAP_RAW_IP6:
+    return flow_hash_ip(pd, len);
+
+  default:
+    return 0;
+  }
+}
+
+/*
+ * Header sent by the parent to a flow-sharded worker ahead of each frame;
+ * it's followed by comment_len bytes of packet comment and by the
+ * phdr.caplen bytes of packet data.
+ *
+ * Without a read filter every frame is displayed, so the parent knows the
+ * previous displayed frame and the cumulative byte count; with one, only
+ * the workers know which frames pass it, and prev_dis_num is 0.
+ */
+typedef struct {
+  guint32                  framenum;
+  guint32                  comment_len;
+  gint64                   offset;
+  struct wtap_pkthdr       phdr;
+  union wtap_pseudo_header pseudo_header;
+  nstime_t                 first_ts;
+  nstime_t                 prev_cap_ts;
+  guint32                  prev_dis_num;
+  nstime_t                 prev_dis_ts;
+  guint32                  cum_bytes;
+} shard_rec_hdr_t;
+
+static gboolean
+fd_readable(int fd)
+{
+  fd_set         readfds;
+  struct timeval timeout;
+
+  FD_ZERO(&readfds);
+  FD_SET(fd, &readfds);
+  timeout.tv_sec = 0;
+  timeout.tv_usec = 0;
+  return select(fd + 1, &readfds, NULL, NULL, &timeout) > 0;
+}
+
+/*
+ * Body of a flow-sharded worker process: dissect and print the frames
+ * the parent sends us through in_fd, sending the output back through
+ * out_fd, followed, if there are any taps, by a chunk with no frames
+ * holding the tap listeners' results.  Returns the exit status for the
+ * worker.
+ */
+static int
+shard_worker(capture_file *cf, int in_fd, int out_fd,
+             gboolean filtering_tap_listeners, guint tap_flags)
+{
+  FILE            *chunk_fh;
+  GArray          *frame_index;
+  shard_rec_hdr_t  rec_hdr;
+  frame_output_t   frame_output;
+  long             chunk_pos, prev_chunk_pos = 0;
+  gchar           *comment;
+  GByteArray      *tap_results;
+  chunk_hdr_t      chunk_hdr;
+
+  /* Everything we print goes to a temporary file first, so that we
+     know how much output each frame produced. */
+  chunk_fh = tmpfile();
+  if (chunk_fh == NULL || dup2(fileno(chunk_fh), 1) < 0)
+    return 2;
+
+  frame_index = g_array_new(FALSE, FALSE, sizeof (frame_output_t));
+  for (;;) {
+    /* The parent writes the output in frame order, so it may well be
+       waiting for the output we've buffered up; send it if we'd have to
+       wait for the next frame. */
+    if (frame_index->len != 0 &&
+        (frame_index->len >= PARALLEL_CHUNK_FRAMES || !fd_readable(in_fd))) {
+      if (!worker_send_chunk(out_fd, frame_index))
+        return 2;
+      prev_chunk_pos = 0;
+    }
+
+    if (!read_all(in_fd, &rec_hdr, sizeof rec_hdr))
+      break;    /* the parent has no more frames for us */
+    if (rec_hdr.phdr.caplen > WTAP_MAX_PACKET_SIZE)
+      return 2;
+    comment = NULL;
+    if (rec_hdr.comment_len != 0) {
+      comment = g_malloc(rec_hdr.comment_len + 1);
+      if (!read_all(in_fd, comment, rec_hdr.comment_len))
+        return 2;
+      comment[rec_hdr.comment_len] = '\0';
+    }
+    rec_hdr.phdr.opt_comment = comment;
+    if (!read_all(in_fd, cf->pd, rec_hdr.phdr.caplen))
+      return 2;
+
+    /* Frame numbers and times relative to the first frame and to the
+       previous frame are those of the whole capture, not of the frames
+       we get to see. */
+    cf->count = rec_hdr.framenum - 1;
+    ref_frame.num = 1;
+    ref_frame.abs_ts = rec_hdr.first_ts;
+    ref = &ref_frame;
+    prev_cap_frame.num = rec_hdr.framenum - 1;
+    prev_cap_frame.abs_ts = rec_hdr.prev_cap_ts;
+    prev_cap = &prev_cap_frame;
+    if (rec_hdr.prev_dis_num != 0) {
+      prev_dis_frame.num = rec_hdr.prev_dis_num;
+      prev_dis_frame.abs_ts = rec_hdr.prev_dis_ts;
+      prev_dis = &prev_dis_frame;
+      cum_bytes = rec_hdr.cum_bytes;
+    }
+    process_packet(cf, rec_hdr.offset, &rec_hdr.phdr,
+                   &rec_hdr.pseudo_header, cf->pd,
+                   filtering_tap_listeners, tap_flags);
+    g_free(comment);
+
+    /* The parent needs each frame's output on its own. */
+    if (output_action == WRITE_FIELDS)
+      write_fields_flush(output_fields, stdout);
+
+    chunk_pos = ftell(stdout);
+    if (chunk_pos < 0)
+      return 2;
+    frame_output.framenum = rec_hdr.framenum;
+    frame_output.len = (guint32)(chunk_pos - prev_chunk_pos);
+    prev_chunk_pos = chunk_pos;
+    g_array_append_val(frame_index, frame_output);
+  }
+  if (frame_index->len != 0 && !worker_send_chunk(out_fd, frame_index))
+    return 2;
+  g_array_free(frame_index, TRUE);
+
+  if (tap_listeners_require_dissection()) {
+    tap_results = g_byte_array_new();
+    save_tap_listeners(tap_results);
+    chunk_hdr.len = tap_results->len;
+    chunk_hdr.err = 0;
+    chunk_hdr.nframes = 0;
+    if (!write_all(out_fd, &chunk_hdr, sizeof chunk_hdr) ||
+        !write_all(out_fd, tap_results->data, tap_results->len))
+      return 2;
+    g_byte_array_free(tap_results, TRUE);
+  }
+  return 0;
+}
+
+/* What the parent knows about the chunk it's copying from a worker. */
+typedef struct {
+  chunk_hdr_t     hdr;
+  frame_output_t *frames;
+  guint32         next_frame;
+  gchar          *data;
+  guint32         data_offset;
+} shard_chunk_t;
+
+#define SHARD_QUEUE_END G_MAXUINT
+
+typedef struct {
+  GAsyncQueue   *dispatched;    /* worker + 1 for each frame, in frame order */
+  int           *out_fds;
+  guint          nworkers;
+  shard_chunk_t *chunks;
+  volatile gint  failed;
+} shard_collector_t;
+
+static gboolean
+shard_read_chunk(int fd, shard_chunk_t *chunk)
+{
+  g_free(chunk->frames);
+  g_free(chunk->data);
+  chunk->frames = NULL;
+  chunk->data = NULL;
+  chunk->next_frame = 0;
+  chunk->data_offset = 0;
+  if (!read_all(fd, &chunk->hdr, sizeof chunk->hdr) || chunk->hdr.err != 0 ||
+      chunk->hdr.nframes == 0)
+    return FALSE;
+  chunk->frames = g_new(frame_output_t, chunk->hdr.nframes);
+  chunk->data = g_malloc(chunk->hdr.len);
+  return read_all(fd, chunk->frames,
+                  chunk->hdr.nframes * sizeof (frame_output_t)) &&
+         read_all(fd, chunk->data, chunk->hdr.len);
+}
+
+/*
+ * Give up on the workers' output; closing our ends of their output pipes
+ * makes the workers quit, so the main thread won't block handing them
+ * more frames.
+ */
+static void
+shard_collector_fail(shard_collector_t *collector)
+{
+  guint worker;
+
+  g_atomic_int_set(&collector->failed, TRUE);
+  for (worker = 0; worker < collector->nworkers; worker++) {
+    ws_close(collector->out_fds[worker]);
+    collector->out_fds[worker] = -1;
+  }
+}
+
+/*
+ * Thread that copies the workers' output to our standard output in frame
+ * order while the main thread reads the capture file and hands out the
+ * frames.
+ */
+static gpointer
+shard_output_collector(gpointer data)
+{
+  shard_collector_t *collector = (shard_collector_t *)data;
+  shard_chunk_t     *chunk;
+  frame_output_t    *frame_output;
+  guint              worker;
+
+  for (;;) {
+    worker = GPOINTER_TO_UINT(g_async_queue_pop(collector->dispatched));
+    if (worker == SHARD_QUEUE_END)
+      break;
+    if (g_atomic_int_get(&collector->failed))
+      continue;         /* just drain the queue */
+    worker--;
+    chunk = &collector->chunks[worker];
+    if (chunk->next_frame == chunk->hdr.nframes &&
+        !shard_read_chunk(collector->out_fds[worker], chunk)) {
+      cmdarg_err("Dissection worker %u exited unexpectedly.", worker + 1);
+      shard_collector_fail(collector);
+      continue;
+    }
+    frame_output = &chunk->frames[chunk->next_frame++];
+    if (frame_output->len > chunk->hdr.len - chunk->data_offset) {
+      cmdarg_err("Dissection worker %u sent bad output.", worker + 1);
+      shard_collector_fail(collector);
+      continue;
+    }
+    fwrite(chunk->data + chunk->data_offset, 1, frame_output->len, stdout);
+    chunk->data_offset += frame_output->len;
+    if (line_buffered)
+      fflush(stdout);
+    if (ferror(stdout)) {
+      show_print_file_io_error(errno);
+      exit(2);
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Read the capture file, handing each frame to one of flow_shards worker
+ * processes according to its flow hash, and copy their output to our
+ * standard output in frame order.
+ *
+ * Returns TRUE if the file was read, in which case *err and *err_info are
+ * set as they would be by wtap_read(); returns FALSE, after reporting it,
+ * if a worker died or couldn't be started.
+ */
+static gboolean
+process_packets_sharded(capture_file *cf, int *err, gchar **err_info,
+                        gboolean filtering_tap_listeners, guint tap_flags,
+                        int max_packet_count, gint64 max_byte_count)
+{
+  shard_collector_t         collector;
+  GThread                  *collector_thread;
+  int                      *in_fds;
+  pid_t                    *worker_pids;
+  int                       in_pipe[2], out_pipe[2];
+  guint                     worker, nworkers, i;
+  gboolean                  ok = TRUE;
+  gint64                    data_offset;
+  guint32                   framenum = 0;
+  const struct wtap_pkthdr *whdr;
+  const guchar             *pd;
+  shard_rec_hdr_t           rec_hdr;
+  nstime_t                  file_first_ts, file_prev_cap_ts;
+  guint32                   file_cum_bytes = 0;
+  chunk_hdr_t               chunk_hdr;
+  guint8                   *tap_results;
+  int                       wstatus;
+  void                    (*old_sigpipe)(int);
+
+  /* Don't let the workers inherit, and then write out, whatever we've
+     already buffered up (such as the preamble). */
+  fflush(stdout);
+
+  /* If a worker dies, we want to find out by getting an error writing
+     to it, not by being killed. */
+  old_sigpipe = signal(SIGPIPE, SIG_IGN);
+
+  in_fds = g_new(int, flow_shards);
+  worker_pids = g_new(pid_t, flow_shards);
+  collector.out_fds = g_new(int, flow_shards);
+  collector.chunks = g_new0(shard_chunk_t, flow_shards);
+  collector.failed = FALSE;
+  for (nworkers = 0; nworkers < flow_shards; nworkers++) {
+    if (pipe(in_pipe) < 0) {
+      cmdarg_err("Couldn't create a pipe for a dissection worker: %s.",
+                 g_strerror(errno));
+      ok = FALSE;
+      break;
+    }
+    if (pipe(out_pipe) < 0) {
+      cmdarg_err("Couldn't create a pipe for a dissection worker: %s.",
+                 g_strerror(errno));
+      ws_close(in_pipe[0]);
+      ws_close(in_pipe[1]);
+      ok = FALSE;
+      break;
+    }
+    worker_pids[nworkers] = fork();
+    if (worker_pids[nworkers] < 0) {
+      cmdarg_err("Couldn't create a dissection worker: %s.",
+                 g_strerror(errno));
+      ws_close(in_pipe[0]);
+      ws_close(in_pipe[1]);
+      ws_close(out_pipe[0]);
+      ws_close(out_pipe[1]);
+      ok = FALSE;
+      break;
+    }
+    if (worker_pids[nworkers] == 0) {
+      /* Child process - don't hang on to the other workers' pipes, or
+         the capture file, and let the parent going away kill us. */
+      for (i = 0; i < nworkers; i++) {
+        ws_close(in_fds[i]);
+        ws_close(collector.out_fds[i]);
+      }
+      ws_close(in_pipe[1]);
+      ws_close(out_pipe[0]);
+      wtap_fdclose(cf->wth);
+      signal(SIGPIPE, SIG_DFL);
+      _exit(shard_worker(cf, in_pipe[0], out_pipe[1],
+                         filtering_tap_listeners, tap_flags));
+    }
+    ws_close(in_pipe[0]);
+    ws_close(out_pipe[1]);
+    in_fds[nworkers] = in_pipe[1];
+    collector.out_fds[nworkers] = out_pipe[0];
+  }
+
+  if (ok) {
+    collector.dispatched = g_async_queue_new();
+    collector.nworkers = nworkers;
+#if GLIB_CHECK_VERSION(2,31,0)
+    collector_thread = g_thread_new("Shard output", shard_output_collector, &collector);
+#else
+    collector_thread = g_thread_create(shard_output_collector, &collector, TRUE, NULL);
+#endif
+
+    nstime_set_unset(&file_first_ts);
+    nstime_set_unset(&file_prev_cap_ts);
+    while (!g_atomic_int_get(&collector.failed) &&
+           wtap_read(cf->wth, err, err_info, &data_offset)) {
+      framenum++;
+      whdr = wtap_phdr(cf->wth);
+      pd = wtap_buf_ptr(cf->wth);
+
+      rec_hdr.framenum = framenum;
+      rec_hdr.comment_len = whdr->opt_comment != NULL ?
+                              (guint32)strlen(whdr->opt_comment) : 0;
+      rec_hdr.offset = data_offset;
+      rec_hdr.phdr = *whdr;
+      rec_hdr.pseudo_header = *wtap_pseudoheader(cf->wth);
+      if (nstime_is_unset(&file_first_ts)) {
+        file_first_ts.secs = whdr->ts.secs;
+        file_first_ts.nsecs = whdr->ts.nsecs;
+      }
+      rec_hdr.first_ts = file_first_ts;
+      rec_hdr.prev_cap_ts = file_prev_cap_ts;
+      if (cf->rfcode == NULL) {
+        rec_hdr.prev_dis_num = framenum - 1;
+        rec_hdr.prev_dis_ts = file_prev_cap_ts;
+        rec_hdr.cum_bytes = file_cum_bytes;
+      } else {
+        rec_hdr.prev_dis_num = 0;
+        nstime_set_unset(&rec_hdr.prev_dis_ts);
+        rec_hdr.cum_bytes = 0;
+      }
+      file_prev_cap_ts.secs = whdr->ts.secs;
+      file_prev_cap_ts.nsecs = whdr->ts.nsecs;
+      file_cum_bytes += whdr->len;
+
+      worker = flow_hash_frame(whdr->pkt_encap, pd, whdr->caplen) % nworkers;
+      if (!write_all(in_fds[worker], &rec_hdr, sizeof rec_hdr) ||
+          (rec_hdr.comment_len != 0 &&
+           !write_all(in_fds[worker], whdr->opt_comment, rec_hdr.comment_len)) ||
+          !write_all(in_fds[worker], pd, whdr->caplen)) {
+        cmdarg_err("Dissection worker %u exited unexpectedly.", worker + 1);
+        g_atomic_int_set(&collector.failed, TRUE);
+        break;
+      }
+      g_async_queue_push(collector.dispatched, GUINT_TO_POINTER(worker + 1));
+
+      /* We don't know which packets pass the read filter, so the
+         packet count limit applies to the packets read. */
+      if ((--max_packet_count == 0) ||
+          (max_byte_count != 0 && data_offset >= max_byte_count)) {
+        *err = 0; /* This is not an error */
+        break;
+      }
+    }
+
+    /* Closing the workers' input tells them there are no more frames. */
+    for (worker = 0; worker < nworkers; worker++) {
+      ws_close(in_fds[worker]);
+      in_fds[worker] = -1;
+    }
+    g_async_queue_push(collector.dispatched, GUINT_TO_POINTER(SHARD_QUEUE_END));
+    g_thread_join(collector_thread);
+    g_async_queue_unref(collector.dispatched);
+    if (g_atomic_int_get(&collector.failed))
+      ok = FALSE;
+
+    /* All the frames' output has been copied, so what's left from each
+       worker is its tap listeners' results; add them to ours. */
+    if (ok && tap_listeners_require_dissection()) {
+      for (worker = 0; worker < nworkers; worker++) {
+        if (!read_all(collector.out_fds[worker], &chunk_hdr, sizeof chunk_hdr) ||
+            chunk_hdr.err != 0 || chunk_hdr.nframes != 0) {
+          cmdarg_err("Dissection worker %u exited unexpectedly.", worker + 1);
+          ok = FALSE;
+          break;
+        }
+        tap_results = g_malloc(chunk_hdr.len);
+        if (!read_all(collector.out_fds[worker], tap_results, chunk_hdr.len) ||
+            !merge_tap_listeners(tap_results, chunk_hdr.len)) {
+          cmdarg_err("Dissection worker %u sent bad statistics.", worker + 1);
+          g_free(tap_results);
+          ok = FALSE;
+          break;
+        }
+        g_free(tap_results);
+      }
+    }
+  }
+
+  for (worker = 0; worker < nworkers; worker++) {
+    if (in_fds[worker] != -1)
+      ws_close(in_fds[worker]);
+    if (collector.out_fds[worker] != -1)
+      ws_close(collector.out_fds[worker]);
+    while (waitpid(worker_pids[worker], &wstatus, 0) < 0 && errno == EINTR)
+      ;
+    g_free(collector.chunks[worker].frames);
+    g_free(collector.chunks[worker].data);
+  }
+  g_free(in_fds);
+  g_free(worker_pids);
+  g_free(collector.out_fds);
+  g_free(collector.chunks);
+  signal(SIGPIPE, old_sigpipe);
+
+  if (!ok)
+    *err = ECHILD;
+  return ok;
+}
+#endif /* _WIN32 */
+
 static gboolean
 process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
                union wtap_pseudo_header *pseudo_header, const guchar *pd,
@@ -3043,13 +4230,24 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
     /* The protocol tree will be "visible", i.e., printed, only if we're
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode ("verbose"
-       is true). */
-    epan_dissect_init(&edt, create_proto_tree, print_packet_info && verbose);
+       is true), other than just the values of some fields. */
+    epan_dissect_init(&edt, create_proto_tree,
+                      print_packet_info && verbose && !fields_from_primed_tree());
+
+    /* If we're printing the values of some fields, prime the
+       epan_dissect_t with those fields. */
+    if (print_packet_info && output_action == WRITE_FIELDS)
+      output_fields_prime_edt(output_fields, &edt);
 
     /* If we're running a read filter, prime the epan_dissect_t with that
-       filter. */
-    if (cf->rfcode)
-      epan_dissect_prime_dfilter(&edt, cf->rfcode);
+       filter; if it's all we're dissecting for, and we've been asked to,
+       let the dissection stop at the protocols it looks at. */
+    if (cf->rfcode) {
+      if (prune_dissection)
+        epan_dissect_prune_dfilter(&edt, cf->rfcode);
+      else
+        epan_dissect_prime_dfilter(&edt, cf->rfcode);
+    }
 
     col_custom_prime_edt(&edt, &cf->cinfo);
 
@@ -3068,8 +4266,15 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
     else
       cinfo = NULL;
 
+    /* Between packets is the only safe time to age out conversations. */
+    conversation_age(&fdata.abs_ts);
+
     frame_data_set_before_dissect(&fdata, &cf->elapsed_time,
-                                  &first_ts, &prev_dis_ts, &prev_cap_ts);
+                                  &ref, prev_dis);
+    if (ref == &fdata) {
+      ref_frame = fdata;
+      ref = &ref_frame;
+    }
 
     epan_dissect_run(&edt, pseudo_header, pd, &fdata, cinfo);
 
@@ -3081,7 +4286,9 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
   }
 
   if (passed) {
-    frame_data_set_after_dissect(&fdata, &cum_bytes, &prev_dis_ts);
+    frame_data_set_after_dissect(&fdata, &cum_bytes);
+    prev_dis_frame = fdata;
+    prev_dis = &prev_dis_frame;
 
     /* Process this packet. */
     if (print_packet_info) {
@@ -3123,6 +4330,8 @@ process_packet(capture_file *cf, gint64 offset, const struct wtap_pkthdr *whdr,
   }
 
   if (do_dissection) {
+    prev_cap_frame = fdata;
+    prev_cap = &prev_cap_frame;
     epan_dissect_cleanup(&edt);
     frame_data_cleanup(&fdata);
   }
@@ -3409,6 +4618,17 @@ print_columns(capture_file *cf)
   return print_line(print_stream, 0, line_bufp);
 }
 
+/*
+ * If all we're printing is the values of some fields, and they can be
+ * found without the protocol tree being visible, the tree needn't be.
+ */
+static gboolean
+fields_from_primed_tree(void)
+{
+  return output_action == WRITE_FIELDS &&
+         !output_fields_need_visible_tree(output_fields);
+}
+
 static gboolean
 print_packet(capture_file *cf, epan_dissect_t *edt)
 {
@@ -3445,8 +4665,9 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
       printf("\n");
       return !ferror(stdout);
     case WRITE_FIELDS:
-      proto_tree_write_fields(output_fields, edt, stdout);
-      printf("\n");
+      write_fields_packet(output_fields, edt, stdout);
+      if (line_buffered)
+        write_fields_flush(output_fields, stdout);
       return !ferror(stdout);
     }
   } else {
@@ -3503,6 +4724,33 @@ write_finale(void)
   }
 }
 
+/* How frame_delta_abs_time() gets at other frames' time stamps.  When
+   we're doing two passes the frames that passed the read filter are kept,
+   and numbered, in cf->frames; otherwise only the copies above are. */
+static const nstime_t *
+tshark_get_frame_ts(void *data, guint32 frame_num)
+{
+  capture_file *cf = (capture_file *) data;
+  frame_data   *fdata;
+
+  if (cf->frames != NULL) {
+    fdata = frame_data_sequence_find(cf->frames, frame_num);
+    if (fdata != NULL)
+      return &fdata->abs_ts;
+  }
+
+  if (ref != NULL && ref->num == frame_num)
+    return &ref->abs_ts;
+
+  if (prev_dis != NULL && prev_dis->num == frame_num)
+    return &prev_dis->abs_ts;
+
+  if (prev_cap != NULL && prev_cap->num == frame_num)
+    return &prev_cap->abs_ts;
+
+  return NULL;
+}
+
 cf_status_t
 cf_open(capture_file *cf, const char *fname, gboolean is_tempfile, int *err)
 {
@@ -3547,9 +4795,10 @@ cf_open(capture_file *cf, const char *fname, gboolean is_tempfile, int *err)
   } else
     cf->has_snap = TRUE;
   nstime_set_zero(&cf->elapsed_time);
-  nstime_set_unset(&first_ts);
-  nstime_set_unset(&prev_dis_ts);
-  nstime_set_unset(&prev_cap_ts);
+  ref = NULL;
+  prev_dis = NULL;
+  prev_cap = NULL;
+  frame_data_set_ts_func(tshark_get_frame_ts, cf);
 
   cf->state = FILE_READ_IN_PROGRESS;
 
@@ -255,6 +255,89 @@ httpstat_packet(void *psp , packet_info *pinfo _U_, epan_dissect_t *edt _U_, con
 }
 
 
+static void
+http_save_hash_responses( gint *key _U_ , http_response_code_t *data, GByteArray *buf)
+{
+	if (data->packets==0)
+		return;
+	tap_save_bytes(buf, &data->response_code, sizeof data->response_code);
+	tap_save_bytes(buf, &data->packets, sizeof data->packets);
+}
+
+static void
+http_save_hash_requests( gchar *key _U_ , http_request_methode_t *data, GByteArray *buf)
+{
+	if (data->packets==0)
+		return;
+	tap_save_string(buf, data->response);
+	tap_save_bytes(buf, &data->packets, sizeof data->packets);
+}
+
+/* Save our counts, for httpstat_merge() in another process */
+static void
+httpstat_save(void *psp, GByteArray *buf)
+{
+	httpstat_t *sp=psp;
+	guint no_more_responses=0;
+
+	/* No response code is 0 and no request method is NULL, so those end the lists */
+	g_hash_table_foreach( sp->hash_responses, (GHFunc)http_save_hash_responses, buf);
+	tap_save_bytes(buf, &no_more_responses, sizeof no_more_responses);
+	g_hash_table_foreach( sp->hash_requests, (GHFunc)http_save_hash_requests, buf);
+	tap_save_string(buf, NULL);
+}
+
+/* Add the counts httpstat_save() wrote in another process to ours */
+static gboolean
+httpstat_merge(void *psp, tap_merge_data_t *md)
+{
+	httpstat_t *sp=psp;
+	guint response_code;
+	guint32 packets;
+	gint key;
+	gchar *method;
+	http_response_code_t *sc;
+	http_request_methode_t *sm;
+
+	for (;;) {
+		if (!tap_merge_bytes(md, &response_code, sizeof response_code))
+			return FALSE;
+		if (response_code==0)
+			break;
+		if (!tap_merge_bytes(md, &packets, sizeof packets))
+			return FALSE;
+		/* httpstat_packet() only counts codes that are in the table */
+		key=response_code;
+		sc=g_hash_table_lookup(sp->hash_responses, &key);
+		if (sc==NULL)
+			return FALSE;
+		sc->packets+=packets;
+	}
+
+	for (;;) {
+		if (!tap_merge_string(md, &method))
+			return FALSE;
+		if (method==NULL)
+			break;
+		if (!tap_merge_bytes(md, &packets, sizeof packets)) {
+			g_free(method);
+			return FALSE;
+		}
+		sm=g_hash_table_lookup(sp->hash_requests, method);
+		if (sm==NULL) {
+			sm=g_malloc( sizeof(http_request_methode_t) );
+			sm->response=method;
+			sm->packets=packets;
+			sm->sp = sp;
+			g_hash_table_insert( sp->hash_requests, sm->response, sm);
+		} else {
+			sm->packets+=packets;
+			g_free(method);
+		}
+	}
+	return TRUE;
+}
+
 static void
 httpstat_draw(void *psp  )
 {
@@ -318,6 +401,7 @@ gtk_httpstat_init(const char *optarg,void* userdata _U_)
 		g_string_free(error_string, TRUE);
 		exit(1);
 	}
+	set_tap_listener_merge(sp, httpstat_save, httpstat_merge);
 
 	http_init_hash(sp);
 }
@@ -364,6 +364,122 @@ sipstat_packet(void *psp, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const
     return 1;
 }
 
+static void
+sip_save_hash_responses(gint *key _U_, sip_response_code_t *data, GByteArray *buf)
+{
+	if (data->packets==0)
+		return;
+	tap_save_bytes(buf, &data->response_code, sizeof data->response_code);
+	tap_save_bytes(buf, &data->packets, sizeof data->packets);
+}
+
+static void
+sip_save_hash_requests(gchar *key _U_, sip_request_method_t *data, GByteArray *buf)
+{
+	if (data->packets==0)
+		return;
+	tap_save_string(buf, data->response);
+	tap_save_bytes(buf, &data->packets, sizeof data->packets);
+}
+
+/* Save our counts, for sipstat_merge() in another process */
+static void
+sipstat_save(void *psp, GByteArray *buf)
+{
+	sipstat_t *sp=psp;
+	guint no_more_responses = 0;
+
+	tap_save_bytes(buf, &sp->packets, sizeof sp->packets);
+	tap_save_bytes(buf, &sp->resent_packets, sizeof sp->resent_packets);
+	tap_save_bytes(buf, &sp->no_of_completed_calls, sizeof sp->no_of_completed_calls);
+	tap_save_bytes(buf, &sp->total_setup_time, sizeof sp->total_setup_time);
+	tap_save_bytes(buf, &sp->min_setup_time, sizeof sp->min_setup_time);
+	tap_save_bytes(buf, &sp->max_setup_time, sizeof sp->max_setup_time);
+
+	/* No response code is 0 and no request method is NULL, so those end the lists */
+	g_hash_table_foreach( sp->hash_responses, (GHFunc)sip_save_hash_responses, buf);
+	tap_save_bytes(buf, &no_more_responses, sizeof no_more_responses);
+	g_hash_table_foreach( sp->hash_requests, (GHFunc)sip_save_hash_requests, buf);
+	tap_save_string(buf, NULL);
+}
+
+/* Add the counts sipstat_save() wrote in another process to ours */
+static gboolean
+sipstat_merge(void *psp, tap_merge_data_t *md)
+{
+	sipstat_t *sp=psp;
+	guint32 packets, resent_packets, completed_calls, min_setup_time, max_setup_time;
+	guint64 total_setup_time;
+	guint response_code;
+	gint key;
+	gchar *method;
+	sip_response_code_t *sc;
+	sip_request_method_t *sm;
+
+	if (!tap_merge_bytes(md, &packets, sizeof packets) ||
+	    !tap_merge_bytes(md, &resent_packets, sizeof resent_packets) ||
+	    !tap_merge_bytes(md, &completed_calls, sizeof completed_calls) ||
+	    !tap_merge_bytes(md, &total_setup_time, sizeof total_setup_time) ||
+	    !tap_merge_bytes(md, &min_setup_time, sizeof min_setup_time) ||
+	    !tap_merge_bytes(md, &max_setup_time, sizeof max_setup_time))
+		return FALSE;
+
+	sp->packets += packets;
+	sp->resent_packets += resent_packets;
+	if (completed_calls != 0) {
+		if (sp->no_of_completed_calls == 0) {
+			sp->min_setup_time = min_setup_time;
+			sp->max_setup_time = max_setup_time;
+		} else {
+			if (min_setup_time < sp->min_setup_time)
+				sp->min_setup_time = min_setup_time;
+			if (max_setup_time > sp->max_setup_time)
+				sp->max_setup_time = max_setup_time;
+		}
+		sp->no_of_completed_calls += completed_calls;
+		sp->total_setup_time += total_setup_time;
+		sp->average_setup_time = (guint32)(sp->total_setup_time / sp->no_of_completed_calls);
+	}
+
+	for (;;) {
+		if (!tap_merge_bytes(md, &response_code, sizeof response_code))
+			return FALSE;
+		if (response_code == 0)
+			break;
+		if (!tap_merge_bytes(md, &packets, sizeof packets))
+			return FALSE;
+		/* sipstat_packet() only counts codes that are in the table */
+		key = response_code;
+		sc = g_hash_table_lookup(sp->hash_responses, &key);
+		if (sc == NULL)
+			return FALSE;
+		sc->packets += packets;
+	}
+
+	for (;;) {
+		if (!tap_merge_string(md, &method))
+			return FALSE;
+		if (method == NULL)
+			break;
+		if (!tap_merge_bytes(md, &packets, sizeof packets)) {
+			g_free(method);
+			return FALSE;
+		}
+		sm = g_hash_table_lookup(sp->hash_requests, method);
+		if (sm == NULL) {
+			sm = g_malloc(sizeof(sip_request_method_t));
+			sm->response = method;
+			sm->packets = packets;
+			sm->sp = sp;
+			g_hash_table_insert(sp->hash_requests, sm->response, sm);
+		} else {
+			sm->packets += packets;
+			g_free(method);
+		}
+	}
+	return TRUE;
+}
+
 static void
 sipstat_draw(void *psp  )
 {
@@ -426,10 +542,10 @@ sipstat_init(const char *optarg, void* userdata _U_)
 		g_string_free(error_string, TRUE);
 		exit(1);
 	}
+	set_tap_listener_merge(sp, sipstat_save, sipstat_merge);
 
-	sp->packets = 0;
-	sp->resent_packets = 0;
 	sip_init_hash(sp);
+	sipstat_reset(sp);
 }
 
 void
@@ -113,6 +113,7 @@ init_stats_tree(const char *optarg, void *userdata _U_)
 		report_failure("stats_tree for: %s failed to attach to the tap: %s",cfg->name,error_string->str);
 		return;
 	}
+	set_tap_listener_merge(st, stats_tree_save, stats_tree_merge);
 
 	if (cfg->init) cfg->init(st);
 
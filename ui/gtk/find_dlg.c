@@ -65,11 +65,13 @@
 #define E_SOURCE_DECODE_KEY   "decode_data_source"
 #define E_SOURCE_SUMMARY_KEY  "summary_data_source"
 #define E_FILT_TE_BUTTON_KEY  "find_filter_button"
+#define E_FIND_ALL_KEY        "find_all"
 
 static gboolean case_type = TRUE;
 static gboolean summary_data = FALSE;
 static gboolean decode_data = FALSE;
 static gboolean packet_data = FALSE;
+static gboolean find_all = FALSE;
 
 static void
 find_filter_te_syntax_check_cb(GtkWidget *w, gpointer parent_w);
@@ -118,7 +120,7 @@ find_frame_cb(GtkWidget *w _U_, gpointer d _U_)
                 *filter_hb, *filter_bt,
 
                 *direction_frame, *direction_vb,
-                *up_rb, *down_rb,
+                *up_rb, *down_rb, *find_all_cb,
 
                 *data_frame, *data_vb,
                 *packet_data_rb, *decode_data_rb, *summary_data_rb,
@@ -320,6 +322,12 @@ find_frame_cb(GtkWidget *w _U_, gpointer d _U_)
   gtk_box_pack_start(GTK_BOX(direction_vb), down_rb, FALSE, FALSE, 0);
   gtk_widget_show(down_rb);
 
+  find_all_cb = gtk_check_button_new_with_mnemonic("Find _all");
+  gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(find_all_cb), find_all);
+  gtk_box_pack_start(GTK_BOX(direction_vb), find_all_cb, FALSE, FALSE, 0);
+  gtk_widget_set_tooltip_text(find_all_cb, "Find all the matching packets at once; Find Next and Find Previous then go straight to the next or previous one");
+  gtk_widget_show(find_all_cb);
+
 
   /* Button row */
   bbox = dlg_button_row_new(GTK_STOCK_FIND, GTK_STOCK_CANCEL, GTK_STOCK_HELP, NULL);
@@ -348,6 +356,7 @@ find_frame_cb(GtkWidget *w _U_, gpointer d _U_)
   g_object_set_data(G_OBJECT(find_frame_w), E_SOURCE_DECODE_KEY, decode_data_rb);
   g_object_set_data(G_OBJECT(find_frame_w), E_SOURCE_SUMMARY_KEY, summary_data_rb);
   g_object_set_data(G_OBJECT(find_frame_w), E_FILT_TE_BUTTON_KEY, filter_bt);
+  g_object_set_data(G_OBJECT(find_frame_w), E_FIND_ALL_KEY, find_all_cb);
 
   /*
    * Now that we've attached the pointers, connect the signals - if
@@ -545,7 +554,8 @@ static void
 find_frame_ok_cb(GtkWidget *ok_bt _U_, gpointer parent_w)
 {
   GtkWidget       *filter_te, *up_rb, *hex_rb, *string_rb, *combo_cb,
-                  *case_cb, *packet_data_rb, *decode_data_rb, *summary_data_rb;
+                  *case_cb, *packet_data_rb, *decode_data_rb, *summary_data_rb,
+                  *find_all_cb;
   const gchar     *filter_text;
   search_charset_t scs_type = SCS_ASCII_AND_UNICODE;
   guint8          *bytes = NULL;
@@ -566,6 +576,7 @@ find_frame_ok_cb(GtkWidget *ok_bt _U_, gpointer parent_w)
   packet_data_rb = (GtkWidget *)g_object_get_data(G_OBJECT(parent_w), E_SOURCE_DATA_KEY);
   decode_data_rb = (GtkWidget *)g_object_get_data(G_OBJECT(parent_w), E_SOURCE_DECODE_KEY);
   summary_data_rb = (GtkWidget *)g_object_get_data(G_OBJECT(parent_w), E_SOURCE_SUMMARY_KEY);
+  find_all_cb = (GtkWidget *)g_object_get_data(G_OBJECT(parent_w), E_FIND_ALL_KEY);
 
   filter_text = gtk_entry_get_text(GTK_ENTRY(filter_te));
 
@@ -584,6 +595,7 @@ find_frame_ok_cb(GtkWidget *ok_bt _U_, gpointer parent_w)
   packet_data   =  gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(packet_data_rb));
   decode_data   =  gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(decode_data_rb));
   summary_data  =  gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(summary_data_rb));
+  find_all      =  gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(find_all_cb));
   hex_search    =  gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON (hex_rb));
   string_search =  gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON (string_rb));
   /*
@@ -655,7 +667,20 @@ find_frame_ok_cb(GtkWidget *ok_bt _U_, gpointer parent_w)
   cfile.decode_data  = decode_data;
   cfile.summary_data = summary_data;
 
-  if (cfile.hex) {
+  /* Any earlier "Find all" was for some other search. */
+  cf_find_hits_clear(&cfile);
+
+  if (find_all) {
+    /* cf_find_all_packets() works from the search parameters in cfile. */
+    g_free(bytes);
+    g_free(string);
+    if (sfcode != NULL)
+      dfilter_free(sfcode);
+    if (!cf_find_all_packets(&cfile)) {
+      statusbar_push_temporary_msg("No packet matched.");
+      return;
+    }
+  } else if (cfile.hex) {
     /* Hex value in packet data */
     found_packet = cf_find_packet_data(&cfile, bytes, nbytes, cfile.dir);
     g_free(bytes);
@@ -727,7 +752,10 @@ find_previous_next(GtkWidget *w, gpointer d, search_direction dir)
 
   if (cfile.sfilter) {
     cfile.dir = dir;
-    if (cfile.hex) {
+    if (cf_find_hit_count(&cfile) != 0) {
+      /* "Find all" has already found them. */
+      cf_find_next_hit(&cfile, dir);
+    } else if (cfile.hex) {
       bytes = convert_string_to_hex(cfile.sfilter, &nbytes);
       if (bytes == NULL) {
 	/*
@@ -106,6 +106,10 @@ follow_tcp_stream_cb(GtkWidget * w _U_, gpointer data _U_)
 	tcp_stream_chunk sc;
 	size_t              nchars;
 	gchar           *data_out_filename;
+	FILE            *out_fp;
+	guint32         *frames;
+	guint            nframes;
+	cf_read_status_t status;
 
 	/* we got tcp so we can follow */
 	if (cfile.edt->pi.ipproto != IP_PROTO_TCP) {
@@ -131,8 +135,8 @@ follow_tcp_stream_cb(GtkWidget * w _U_, gpointer data _U_)
 	}
 
 	/* Create a temporary file into which to dump the reassembled data
-	   from the TCP stream, and set "data_out_file" to refer to it, so
-	   that the TCP code will write to it.
+	   from the TCP stream; "data_out_file" is set to refer to it once
+	   the filter has been applied, so that the TCP code will write to it.
 
 	   XXX - it might be nicer to just have the TCP code directly
 	   append stuff to the text widget for the TCP stream window,
@@ -151,8 +155,8 @@ follow_tcp_stream_cb(GtkWidget * w _U_, gpointer data _U_)
 	    return;
 	}
 
-	data_out_file = fdopen(tmp_fd, "w+b");
-	if (data_out_file == NULL) {
+	out_fp = fdopen(tmp_fd, "w+b");
+	if (out_fp == NULL) {
 	    simple_dialog(ESD_TYPE_ERROR, ESD_BTN_OK,
 			  "Could not create temporary file %s: %s",
 			  follow_info->data_out_filename, g_strerror(errno));
@@ -192,12 +196,49 @@ follow_tcp_stream_cb(GtkWidget * w _U_, gpointer data _U_)
 	gtk_entry_set_text(GTK_ENTRY(filter_te), follow_filter);
 
 	/* Run the display filter so it goes in effect - even if it's the
-	   same as the previous display filter. */
-	main_filter_packets(&cfile, follow_filter, TRUE);
+	   same as the previous display filter - and dump the stream's data.
+
+	   If the TCP dissector has indexed the stream's segments, the
+	   index tells the filter which frames are in the stream, and
+	   dumping the data is just a matter of dissecting those frames,
+	   in order.  Otherwise, the filter has to dissect every frame, so
+	   have the TCP dissector dump the data while it's at it; make
+	   sure it doesn't skip any frames because it already knows the
+	   result. */
+	if (follow_tcp_stream_frames(&frames, &nframes)) {
+	    cf_filter_results_set(&cfile, follow_filter, frames, nframes);
+	    main_filter_packets(&cfile, follow_filter, TRUE);
+	    data_out_file = out_fp;
+	    status = cf_dissect_frames(&cfile, frames, nframes);
+	    g_free(frames);
+	} else {
+	    cf_filter_results_invalidate(&cfile);
+	    data_out_file = out_fp;
+	    main_filter_packets(&cfile, follow_filter, TRUE);
+	    /* If it got through all the frames, it remembered the result. */
+	    status = cf_filter_results_known(&cfile, follow_filter) ?
+		CF_READ_OK : CF_READ_ABORTED;
+	}
 
 	/* Free the filter string, as we're done with it. */
 	g_free(follow_filter);
 
+	/* If we didn't get through all of the stream's packets, what we
+	   have is only part of the stream; don't show that.  Read errors
+	   have already been reported. */
+	if (status != CF_READ_OK) {
+	    if (status == CF_READ_ABORTED)
+		simple_dialog(ESD_TYPE_ERROR, ESD_BTN_OK,
+			      "Following the stream was stopped before all of its data was read.");
+	    fclose(data_out_file);
+	    data_out_file = NULL;
+	    ws_unlink(follow_info->data_out_filename);
+	    g_free(follow_info->data_out_filename);
+	    g_free(follow_info->filter_out_filter);
+	    g_free(follow_info);
+	    return;
+	}
+
 	/* Check whether we got any data written to the file. */
 	if (empty_tcp_stream) {
 	    simple_dialog(ESD_TYPE_ERROR, ESD_BTN_OK,
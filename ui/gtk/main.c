@@ -64,6 +64,7 @@
 
 #include <epan/epan.h>
 #include <epan/filesystem.h>
+#include <epan/follow.h>
 #include <wsutil/privileges.h>
 #include <epan/epan_dissect.h>
 #include <epan/timestamp.h>
@@ -2511,6 +2512,10 @@ main(int argc, char *argv[])
             failure_alert_box,open_failure_alert_box,read_failure_alert_box,
             write_failure_alert_box);
 
+  /* Have the TCP dissector index the segments of every stream, so that
+     Follow TCP Stream needs to read only the stream's frames. */
+  follow_tcp_set_indexing(TRUE);
+
   splash_update(RA_LISTENERS, NULL, (gpointer)splash_win);
 
   /* Register all tap listeners; we do this before we parse the arguments,
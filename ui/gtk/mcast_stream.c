@@ -202,8 +202,8 @@ mcaststream_packet(void *arg, packet_info *pinfo, epan_dissect_t *edt _U_, const
 		tmp_strinfo.first_frame_num = pinfo->fd->num;
 		tmp_strinfo.start_sec = (guint32) pinfo->fd->abs_ts.secs;
 		tmp_strinfo.start_usec = pinfo->fd->abs_ts.nsecs/1000;
-		tmp_strinfo.start_rel_sec = (guint32) pinfo->fd->rel_ts.secs;
-		tmp_strinfo.start_rel_usec = pinfo->fd->rel_ts.nsecs/1000;
+		tmp_strinfo.start_rel_sec = (guint32) pinfo->rel_ts.secs;
+		tmp_strinfo.start_rel_usec = pinfo->rel_ts.nsecs/1000;
 		tmp_strinfo.vlan_id = 0;
 
 		/* reset Mcast stats */
@@ -235,8 +235,8 @@ mcaststream_packet(void *arg, packet_info *pinfo, epan_dissect_t *edt _U_, const
 			tapinfo->allstreams = g_malloc(sizeof(mcast_stream_info_t));
 			tapinfo->allstreams->element.buff =
 					(struct timeval *)g_malloc(buffsize * sizeof(struct timeval));
-			tapinfo->allstreams->start_rel_sec = (guint32) pinfo->fd->rel_ts.secs;
-			tapinfo->allstreams->start_rel_usec = pinfo->fd->rel_ts.nsecs/1000;
+			tapinfo->allstreams->start_rel_sec = (guint32) pinfo->rel_ts.secs;
+			tapinfo->allstreams->start_rel_usec = pinfo->rel_ts.nsecs/1000;
 			tapinfo->allstreams->total_bytes = 0;
 			tapinfo->allstreams->element.first=0;
 			tapinfo->allstreams->element.last=0;
@@ -254,8 +254,8 @@ mcaststream_packet(void *arg, packet_info *pinfo, epan_dissect_t *edt _U_, const
 	}
 
 	/* time between first and last packet in the group */
-	strinfo->stop_rel_sec = (guint32) pinfo->fd->rel_ts.secs;
-	strinfo->stop_rel_usec = pinfo->fd->rel_ts.nsecs/1000;
+	strinfo->stop_rel_sec = (guint32) pinfo->rel_ts.secs;
+	strinfo->stop_rel_usec = pinfo->rel_ts.nsecs/1000;
 	deltatime = ((float)((strinfo->stop_rel_sec * 1000000 + strinfo->stop_rel_usec)
 					- (strinfo->start_rel_sec*1000000 + strinfo->start_rel_usec)))/1000000;
 
@@ -269,8 +269,8 @@ mcaststream_packet(void *arg, packet_info *pinfo, epan_dissect_t *edt _U_, const
 	strinfo->apackets = (guint32) (strinfo->npackets / deltatime);
 
 	/* time between first and last packet in any group */
-	tapinfo->allstreams->stop_rel_sec = (guint32) pinfo->fd->rel_ts.secs;
-	tapinfo->allstreams->stop_rel_usec = pinfo->fd->rel_ts.nsecs/1000;
+	tapinfo->allstreams->stop_rel_sec = (guint32) pinfo->rel_ts.secs;
+	tapinfo->allstreams->stop_rel_usec = pinfo->rel_ts.nsecs/1000;
 	deltatime = ((float)((tapinfo->allstreams->stop_rel_sec * 1000000 + tapinfo->allstreams->stop_rel_usec)
 		- (tapinfo->allstreams->start_rel_sec*1000000 + tapinfo->allstreams->start_rel_usec)))/1000000;
 
@@ -436,8 +436,8 @@ slidingwindow(mcast_stream_info_t *strinfo, packet_info *pinfo)
 	}
 
 	/* burst count */
-	buffer[strinfo->element.last].tv_sec = (guint32) pinfo->fd->rel_ts.secs;
-	buffer[strinfo->element.last].tv_usec = pinfo->fd->rel_ts.nsecs/1000;
+	buffer[strinfo->element.last].tv_sec = (guint32) pinfo->rel_ts.secs;
+	buffer[strinfo->element.last].tv_usec = pinfo->rel_ts.nsecs/1000;
 	while(comparetimes((struct timeval *)&(buffer[strinfo->element.first]),
 			   (struct timeval *)&(buffer[strinfo->element.last]), mcast_stream_burstint)){
 		strinfo->element.first++;
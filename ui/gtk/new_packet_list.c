@@ -1714,7 +1714,7 @@ new_packet_list_get_packet_comment(void)
 
 	record = new_packet_list_get_record(model, &iter);
 
-	return record->fdata->opt_comment;
+	return frame_data_get_comment(record->fdata);
 }
 
 void
@@ -1734,8 +1734,8 @@ new_packet_list_update_packet_comment(gchar *new_packet_comment)
 	record = new_packet_list_get_record(model, &iter);
 
 	/* Check if the comment has changed */
-	if (record->fdata->opt_comment) {
-		if (strcmp(record->fdata->opt_comment, new_packet_comment) == 0) {
+	if (record->fdata->flags.has_comment) {
+		if (strcmp(frame_data_get_comment(record->fdata), new_packet_comment) == 0) {
 			g_free(new_packet_comment);
 			return;
 		}
@@ -1802,6 +1802,9 @@ new_packet_list_get_widget(void)
 void
 new_packet_list_colorize_packets(void)
 {
+	/* frame.coloring_rule.name and .string can be filtered on, so
+	   remembered filter results may go with the old coloring rules. */
+	cf_filter_results_invalidate(&cfile);
 	packet_list_reset_colorized(packetlist);
 	gtk_widget_queue_draw (packetlist->view);
 }
@@ -32,8 +32,13 @@
 #include "config.h"
 #endif
 
+#include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include <gtk/gtk.h>
 #include <glib.h>
 
@@ -104,10 +109,9 @@ static void packet_list_sortable_set_default_sort_func(GtkTreeSortable
 static gboolean packet_list_sortable_has_default_sort_func(GtkTreeSortable
 							   *sortable);
 static void packet_list_sortable_init(GtkTreeSortableIface *iface);
-static gint packet_list_compare_records(gint sort_id _U_, PacketListRecord *a,
-					PacketListRecord *b);
 static void packet_list_resort(PacketList *packet_list);
 static void packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *record, gboolean dissect_columns, gboolean dissect_color );
+static void packet_list_dissect_and_cache_frame(PacketList *packet_list, PacketListRecord *record, union wtap_pseudo_header *pseudo_header, const guint8 *pd, gboolean dissect_columns, gboolean dissect_color);
 
 static GObjectClass *parent_class = NULL;
 
@@ -777,6 +781,187 @@ packet_list_column_contains_values(PacketList *packet_list, gint sort_col_id)
 		return FALSE;
 }
 
+/*
+ * Columnizing the whole list means reading and dissecting every frame
+ * that hasn't been columnized yet.  The dissection can't be spread over
+ * several threads - the dissectors keep state of their own, such as
+ * conversations and reassembly tables, that assumes frames are dissected
+ * one at a time - but the reading can: a thread with a wtap of its own
+ * reads frames ahead of the dissection, which for a compressed file, or
+ * one on slow storage, is where much of the time goes.
+ */
+#define COLUMNIZE_READ_AHEAD	256
+
+typedef struct {
+	union wtap_pseudo_header pseudo_header;
+	guint8		*pd;
+	guint		pd_size;
+	gboolean	read_ok;	/* if not, read it the usual way */
+} columnize_frame;
+
+typedef struct {
+	wtap		*wth;
+	GPtrArray	*records;	/* the ones to columnize, in order */
+	columnize_frame	frames[COLUMNIZE_READ_AHEAD];
+	GThread		*thread;
+	GMutex		*mtx;
+	GCond		*cond;
+	guint		read;		/* frames read */
+	guint		taken;		/* frames dissected */
+	gboolean	stop;
+} columnize_reader;
+
+static void columnize_reader_stop(columnize_reader *reader);
+
+static gint
+columnize_record_compare(gconstpointer a, gconstpointer b)
+{
+	const PacketListRecord *ra = *(const PacketListRecord * const *)a;
+	const PacketListRecord *rb = *(const PacketListRecord * const *)b;
+
+	return (ra->fdata->num > rb->fdata->num) - (ra->fdata->num < rb->fdata->num);
+}
+
+static gpointer
+columnize_reader_thread(gpointer data)
+{
+	columnize_reader *reader = (columnize_reader *)data;
+	PacketListRecord *record;
+	columnize_frame *frame;
+	guint i;
+	gboolean stop;
+	int err;
+	gchar *err_info;
+
+	for (i = 0; i < reader->records->len; i++) {
+		g_mutex_lock(reader->mtx);
+		while (!reader->stop && i - reader->taken == COLUMNIZE_READ_AHEAD)
+			g_cond_wait(reader->cond, reader->mtx);
+		stop = reader->stop;
+		g_mutex_unlock(reader->mtx);
+		if (stop)
+			break;
+
+		record = g_ptr_array_index(reader->records, i);
+		frame = &reader->frames[i % COLUMNIZE_READ_AHEAD];
+		frame->read_ok = FALSE;
+		if (record->fdata->file_off != -1) {	/* not an edited frame */
+			if (frame->pd_size < record->fdata->cap_len) {
+				frame->pd_size = record->fdata->cap_len;
+				frame->pd = g_realloc(frame->pd, frame->pd_size);
+			}
+			if (wtap_seek_read(reader->wth, record->fdata->file_off,
+			    &frame->pseudo_header, frame->pd,
+			    record->fdata->cap_len, &err, &err_info))
+				frame->read_ok = TRUE;
+			else
+				g_free(err_info);
+		}
+
+		g_mutex_lock(reader->mtx);
+		reader->read++;
+		g_cond_broadcast(reader->cond);
+		g_mutex_unlock(reader->mtx);
+	}
+	return NULL;
+}
+
+/* Start reading "records" ahead; returns NULL if we can't. */
+static columnize_reader *
+columnize_reader_start(GPtrArray *records)
+{
+	columnize_reader *reader;
+	wtap *wth;
+	int err;
+	gchar *err_info;
+
+#if !GLIB_CHECK_VERSION(2,31,0)
+	if (!g_thread_supported())
+		return NULL;
+#endif
+	/* Not while the file's still being read in, or for only a few frames. */
+	if (cfile.filename == NULL || cfile.state != FILE_READ_DONE ||
+	    records->len < COLUMNIZE_READ_AHEAD)
+		return NULL;
+	wth = wtap_open_offline(cfile.filename, &err, &err_info, TRUE);
+	if (wth == NULL) {
+		g_free(err_info);
+		return NULL;
+	}
+
+	reader = g_new0(columnize_reader, 1);
+	reader->wth = wth;
+	reader->records = records;
+#if GLIB_CHECK_VERSION(2,31,0)
+	reader->mtx = g_new(GMutex, 1);
+	g_mutex_init(reader->mtx);
+	reader->cond = g_new(GCond, 1);
+	g_cond_init(reader->cond);
+	reader->thread = g_thread_new("columnize read", columnize_reader_thread, reader);
+#else
+	reader->mtx = g_mutex_new();
+	reader->cond = g_cond_new();
+	reader->thread = g_thread_create(columnize_reader_thread, reader, TRUE, NULL);
+#endif
+	if (reader->thread == NULL) {
+		reader->stop = TRUE;
+		columnize_reader_stop(reader);
+		return NULL;
+	}
+	return reader;
+}
+
+/* Wait for the next frame to be read; the caller must hand it back
+   with columnize_reader_done(). */
+static columnize_frame *
+columnize_reader_next(columnize_reader *reader)
+{
+	columnize_frame *frame;
+
+	g_mutex_lock(reader->mtx);
+	while (reader->read == reader->taken)
+		g_cond_wait(reader->cond, reader->mtx);
+	frame = &reader->frames[reader->taken % COLUMNIZE_READ_AHEAD];
+	g_mutex_unlock(reader->mtx);
+	return frame;
+}
+
+static void
+columnize_reader_done(columnize_reader *reader)
+{
+	g_mutex_lock(reader->mtx);
+	reader->taken++;
+	g_cond_broadcast(reader->cond);
+	g_mutex_unlock(reader->mtx);
+}
+
+static void
+columnize_reader_stop(columnize_reader *reader)
+{
+	guint i;
+
+	if (reader->thread != NULL) {
+		g_mutex_lock(reader->mtx);
+		reader->stop = TRUE;
+		g_cond_broadcast(reader->cond);
+		g_mutex_unlock(reader->mtx);
+		g_thread_join(reader->thread);
+	}
+	wtap_close(reader->wth);
+	for (i = 0; i < COLUMNIZE_READ_AHEAD; i++)
+		g_free(reader->frames[i].pd);
+#if GLIB_CHECK_VERSION(2,31,0)
+	g_mutex_clear(reader->mtx);
+	g_free(reader->mtx);
+	g_cond_clear(reader->cond);
+	g_free(reader->cond);
+#else
+	g_mutex_free(reader->mtx);
+	g_cond_free(reader->cond);
+#endif
+	g_free(reader);
+}
+
 /* packet_list_dissect_and_cache_all()
  *  returns:
  *   TRUE   if columnization completed;
@@ -789,6 +974,10 @@ static gboolean
 packet_list_dissect_and_cache_all(PacketList *packet_list)
 {
 	PacketListRecord *record;
+	GPtrArray	*records;
+	columnize_reader *reader;
+	columnize_frame *frame;
+	guint		phy_idx;
 
 	int 		progbar_nextstep;
 	int 		progbar_quantum;
@@ -803,7 +992,18 @@ packet_list_dissect_and_cache_all(PacketList *packet_list)
 
 	g_assert(packet_list->columnized == FALSE);
 
-	progbar_loop_max = PACKET_LIST_RECORD_COUNT(packet_list->physical_rows);
+	/* Rows that have been displayed are already columnized. */
+	records = g_ptr_array_sized_new(PACKET_LIST_RECORD_COUNT(packet_list->physical_rows));
+	for (phy_idx = 0; phy_idx < PACKET_LIST_RECORD_COUNT(packet_list->physical_rows); ++phy_idx) {
+		record = PACKET_LIST_RECORD_GET(packet_list->physical_rows, phy_idx);
+		if (!record->columnized)
+			g_ptr_array_add(records, record);
+	}
+	/* Go through the file in order, whatever order the list is in. */
+	g_ptr_array_sort(records, columnize_record_compare);
+	reader = columnize_reader_start(records);
+
+	progbar_loop_max = records->len;
 	/* Update the progress bar when it gets to this value. */
 	progbar_nextstep = 0;
 	/* When we reach the value that triggers a progress bar update,
@@ -818,8 +1018,20 @@ packet_list_dissect_and_cache_all(PacketList *packet_list)
 	main_window_update();
 
 	for (progbar_loop_var = 0; progbar_loop_var < progbar_loop_max; ++progbar_loop_var) {
-		record = PACKET_LIST_RECORD_GET(packet_list->physical_rows, progbar_loop_var);
-		packet_list_dissect_and_cache_record(packet_list, record, TRUE, FALSE);
+		record = g_ptr_array_index(records, progbar_loop_var);
+		if (reader != NULL) {
+			frame = columnize_reader_next(reader);
+			/* The record may have been drawn, and columnized, meanwhile. */
+			if (record->columnized)
+				;
+			else if (frame->read_ok)
+				packet_list_dissect_and_cache_frame(packet_list, record, &frame->pseudo_header, frame->pd, TRUE, FALSE);
+			else
+				packet_list_dissect_and_cache_record(packet_list, record, TRUE, FALSE);
+			columnize_reader_done(reader);
+		} else if (!record->columnized) {
+			packet_list_dissect_and_cache_record(packet_list, record, TRUE, FALSE);
+		}
 
 		/* Create the progress bar if necessary.
 		   We check on every iteration of the loop, so that it takes no
@@ -858,6 +1070,10 @@ packet_list_dissect_and_cache_all(PacketList *packet_list)
 		}
 	}
 
+	if (reader != NULL)
+		columnize_reader_stop(reader);
+	g_ptr_array_free(records, TRUE);
+
 	/* We're done; destroy the progress bar if it was created. */
 	if (progbar != NULL)
 		destroy_progress_dlg(progbar);
@@ -942,86 +1158,317 @@ packet_list_sortable_has_default_sort_func(GtkTreeSortable *sortable _U_)
 			 set_default_sort_func are not implemented. */
 }
 
-static gint
-packet_list_compare_custom(gint sort_id, PacketListRecord *a, PacketListRecord *b)
+/*
+ * Sorting.
+ *
+ * Rather than looking a column's type up, and converting its text to a
+ * number, on every comparison, each record gets a key up front, holding
+ * the column's value as a number where the column has numbers in it.
+ * The keys are then sorted in chunks, one per thread, and the chunks
+ * merged pairwise, again in parallel.
+ */
+#define SORT_MAX_THREADS	8
+#define SORT_MIN_CHUNK		32768	/* rows; fewer aren't worth a thread */
+
+typedef enum {
+	SORT_KEY_FRAME_DATA,	/* compare with frame_data_compare() */
+	SORT_KEY_TEXT,		/* compare the text */
+	SORT_KEY_NUMBER,	/* all numbers, like a numeric custom column */
+	SORT_KEY_MAYBE_NUMBER	/* numbers, if there's one at the start */
+} sort_key_kind;
+
+typedef struct {
+	PacketListRecord *record;
+	const gchar	*text;
+	gdouble		num;
+	gboolean	is_num;
+} sort_key;
+
+typedef struct {
+	gint		sort_id;
+	gint		col_fmt;	/* for SORT_KEY_FRAME_DATA */
+	sort_key_kind	kind;
+	gboolean	descending;
+} sort_context;
+
+typedef struct {
+	const sort_context *ctx;
+	GPtrArray	*rows;
+	sort_key	*src;
+	sort_key	*dst;
+	guint		lo;
+	guint		mid;
+	guint		hi;
+} sort_task;
+
+static sort_key_kind
+packet_list_sort_key_kind(gint sort_id, gint *col_fmt)
 {
 	header_field_info *hfi;
 
-	hfi = proto_registrar_get_byname(cfile.cinfo.col_custom_field[sort_id]);
-
-	if (hfi == NULL) {
-		return frame_data_compare(a->fdata, b->fdata, COL_NUMBER);
-	} else if ((hfi->strings == NULL) &&
-		   (((IS_FT_INT(hfi->type) || IS_FT_UINT(hfi->type)) &&
-		     ((hfi->display == BASE_DEC) || (hfi->display == BASE_DEC_HEX) ||
-		      (hfi->display == BASE_OCT))) ||
-		    (hfi->type == FT_DOUBLE) || (hfi->type == FT_FLOAT) ||
-		    (hfi->type == FT_BOOLEAN) || (hfi->type == FT_FRAMENUM) ||
-		    (hfi->type == FT_RELATIVE_TIME)))
-	  {
-		/* Attempt to convert to numbers */
-		double num_a = atof(a->col_text[sort_id]);
-		double num_b = atof(b->col_text[sort_id]);
-
-		if (num_a < num_b)
-			return -1;
-		else if (num_a > num_b)
-			return 1;
-		else
-			return frame_data_compare(a->fdata, b->fdata, COL_NUMBER);
-	  }
+	*col_fmt = cfile.cinfo.col_fmt[sort_id];
+	if (col_based_on_frame_data(&cfile.cinfo, sort_id))
+		return SORT_KEY_FRAME_DATA;
 
-	return strcmp(a->col_text[sort_id], b->col_text[sort_id]);
+	switch (cfile.cinfo.col_fmt[sort_id]) {
+
+	case COL_CUSTOM:
+		hfi = proto_registrar_get_byname(cfile.cinfo.col_custom_field[sort_id]);
+		if (hfi == NULL) {
+			/* Nothing to sort on; keep them in frame order. */
+			*col_fmt = COL_NUMBER;
+			return SORT_KEY_FRAME_DATA;
+		}
+		if ((hfi->strings == NULL) &&
+		    (((IS_FT_INT(hfi->type) || IS_FT_UINT(hfi->type)) &&
+		      ((hfi->display == BASE_DEC) || (hfi->display == BASE_DEC_HEX) ||
+		       (hfi->display == BASE_OCT))) ||
+		     (hfi->type == FT_DOUBLE) || (hfi->type == FT_FLOAT) ||
+		     (hfi->type == FT_BOOLEAN) || (hfi->type == FT_FRAMENUM) ||
+		     (hfi->type == FT_RELATIVE_TIME)))
+			return SORT_KEY_NUMBER;
+		return SORT_KEY_TEXT;
+
+	/* These are numbers, unless they've been resolved to names. */
+	case COL_8021Q_VLAN_ID:
+	case COL_CIRCUIT_ID:
+	case COL_VSAN:
+	case COL_DCE_CALL:
+	case COL_DELTA_CONV_TIME:
+	case COL_RES_DST_PORT:
+	case COL_UNRES_DST_PORT:
+	case COL_DEF_DST_PORT:
+	case COL_FREQ_CHAN:
+	case COL_RSSI:
+	case COL_TX_RATE:
+	case COL_DSCP_VALUE:
+	case COL_DEF_SRC_PORT:
+	case COL_RES_SRC_PORT:
+	case COL_UNRES_SRC_PORT:
+	case COL_TEI:
+		return SORT_KEY_MAYBE_NUMBER;
+
+	default:
+		return SORT_KEY_TEXT;
+	}
 }
 
-static gint
-_packet_list_compare_records(gint sort_id, PacketListRecord *a,
-				PacketListRecord *b)
+static void
+packet_list_sort_key_fill(const sort_context *ctx, sort_key *key, PacketListRecord *record)
 {
-	g_assert(a->col_text);
-	g_assert(b->col_text);
-	g_assert(a->col_text[sort_id]);
-	g_assert(b->col_text[sort_id]);
+	gchar *end;
+
+	key->record = record;
+	key->text = NULL;
+	key->num = 0;
+	key->is_num = FALSE;
+
+	if (ctx->kind == SORT_KEY_FRAME_DATA)
+		return;
 
-	if(a->col_text[sort_id] == b->col_text[sort_id])
-		return 0; /* no need to call strcmp() */
+	g_assert(record->col_text);
+	g_assert(record->col_text[ctx->sort_id]);
+	key->text = record->col_text[ctx->sort_id];
 
-	if (cfile.cinfo.col_fmt[sort_id] == COL_CUSTOM) {
-		return packet_list_compare_custom (sort_id, a, b);
+	switch (ctx->kind) {
+
+	case SORT_KEY_NUMBER:
+		key->num = atof(key->text);
+		key->is_num = TRUE;
+		break;
+
+	case SORT_KEY_MAYBE_NUMBER:
+		key->num = g_ascii_strtod(key->text, &end);
+		key->is_num = (end != key->text);
+		break;
+
+	default:
+		break;
 	}
-	return strcmp(a->col_text[sort_id], b->col_text[sort_id]);
 }
 
 static gint
-packet_list_compare_records(gint sort_id, PacketListRecord *a,
-				PacketListRecord *b)
+packet_list_sort_key_compare(const sort_key *a, const sort_key *b, const sort_context *ctx)
 {
 	gint ret;
 
-	if (col_based_on_frame_data(&cfile.cinfo, sort_id))
-		return frame_data_compare(a->fdata, b->fdata, cfile.cinfo.col_fmt[sort_id]);
+	if (ctx->kind == SORT_KEY_FRAME_DATA) {
+		ret = frame_data_compare(a->record->fdata, b->record->fdata, ctx->col_fmt);
+	} else {
+		if (a->text == b->text)
+			ret = 0; /* no need to call strcmp() */
+		else if (a->is_num && b->is_num)
+			ret = (a->num < b->num) ? -1 : (a->num > b->num);
+		else if (a->is_num != b->is_num)
+			ret = a->is_num ? -1 : 1; /* numbers before names */
+		else
+			ret = strcmp(a->text, b->text);
+		if (ret == 0)
+			ret = a->record->fdata->num - b->record->fdata->num;
+	}
+
+	/* Swap -1 and 1 if sort order is reverse */
+	if (ret != 0 && ctx->descending)
+		ret = (ret < 0) ? 1 : -1;
 
-	ret = _packet_list_compare_records(sort_id, a, b);
-	if (ret == 0)
-		ret = a->fdata->num - b->fdata->num;
 	return ret;
 }
 
-static gint
-packet_list_qsort_physical_compare_func(PacketListRecord **a, PacketListRecord **b,
-				   PacketList *packet_list)
+/* Fill in the keys for rows lo up to hi, and sort them. */
+static gpointer
+packet_list_sort_chunk(gpointer data)
 {
-	gint ret;
+	sort_task *task = (sort_task *)data;
+	guint i;
 
-	g_assert((a) && (b) && (packet_list));
+	for (i = task->lo; i < task->hi; i++)
+		packet_list_sort_key_fill(task->ctx, &task->src[i],
+					  PACKET_LIST_RECORD_GET(task->rows, i));
 
-	ret = packet_list_compare_records(packet_list->sort_id, *a, *b);
+	g_qsort_with_data(task->src + task->lo, task->hi - task->lo, sizeof(sort_key),
+			  (GCompareDataFunc) packet_list_sort_key_compare, (gpointer) task->ctx);
+	return NULL;
+}
 
-	/* Swap -1 and 1 if sort order is reverse */
-	if(ret != 0 && packet_list->sort_order == GTK_SORT_DESCENDING)
-		ret = (ret < 0) ? 1 : -1;
+/* Merge the sorted runs lo up to mid and mid up to hi of src into dst. */
+static gpointer
+packet_list_sort_merge(gpointer data)
+{
+	sort_task *task = (sort_task *)data;
+	const sort_key *src = task->src;
+	sort_key *dst = task->dst + task->lo;
+	guint i = task->lo;
+	guint j = task->mid;
+
+	while (i < task->mid && j < task->hi) {
+		/* Take from the left run on a tie, to keep the sort stable. */
+		if (packet_list_sort_key_compare(&src[j], &src[i], task->ctx) < 0)
+			*dst++ = src[j++];
+		else
+			*dst++ = src[i++];
+	}
+	if (i < task->mid)
+		memcpy(dst, &src[i], (task->mid - i) * sizeof(sort_key));
+	else if (j < task->hi)
+		memcpy(dst, &src[j], (task->hi - j) * sizeof(sort_key));
+	return NULL;
+}
 
-	return ret;
+/* Run func on every task, tasks[0] on this thread and the rest on threads
+   of their own, if we can have them. */
+static void
+packet_list_sort_run(GThreadFunc func, sort_task *tasks, guint count)
+{
+	GThread **threads;
+	guint i;
+
+	threads = g_new0(GThread *, count);
+	for (i = 1; i < count; i++) {
+#if GLIB_CHECK_VERSION(2,31,0)
+		threads[i] = g_thread_new("packet list sort", func, &tasks[i]);
+#else
+		threads[i] = g_thread_create(func, &tasks[i], TRUE, NULL);
+#endif
+		if (threads[i] == NULL)
+			func(&tasks[i]);
+	}
+	func(&tasks[0]);
+	for (i = 1; i < count; i++) {
+		if (threads[i] != NULL)
+			g_thread_join(threads[i]);
+	}
+	g_free(threads);
+}
+
+static guint
+packet_list_sort_threads(guint rows)
+{
+	long ncpus = 1;
+	guint nthreads;
+
+#if !GLIB_CHECK_VERSION(2,31,0)
+	if (!g_thread_supported())
+		return 1;
+#endif
+#ifdef _SC_NPROCESSORS_ONLN
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (ncpus < 1)
+		ncpus = 1;
+	nthreads = MIN((guint) ncpus, SORT_MAX_THREADS);
+	return MAX(1, MIN(nthreads, rows / SORT_MIN_CHUNK));
+}
+
+/* Sort the physical rows on the sort column. */
+static void
+packet_list_sort_physical_rows(PacketList *packet_list)
+{
+	GPtrArray *rows = packet_list->physical_rows;
+	sort_context ctx;
+	sort_task *tasks;
+	sort_key *keys, *tmp, *swap;
+	guint *bounds;
+	guint count = PACKET_LIST_RECORD_COUNT(rows);
+	guint nchunks, nmerges, i;
+
+	ctx.sort_id = packet_list->sort_id;
+	ctx.kind = packet_list_sort_key_kind(packet_list->sort_id, &ctx.col_fmt);
+	ctx.descending = (packet_list->sort_order == GTK_SORT_DESCENDING);
+
+	nchunks = packet_list_sort_threads(count);
+	keys = g_new(sort_key, count);
+	tmp = (nchunks > 1) ? g_new(sort_key, count) : NULL;
+	tasks = g_new0(sort_task, nchunks);
+	bounds = g_new(guint, nchunks + 1);
+
+	for (i = 0; i <= nchunks; i++)
+		bounds[i] = (guint) ((guint64) count * i / nchunks);
+
+	for (i = 0; i < nchunks; i++) {
+		tasks[i].ctx = &ctx;
+		tasks[i].rows = rows;
+		tasks[i].src = keys;
+		tasks[i].lo = bounds[i];
+		tasks[i].hi = bounds[i + 1];
+	}
+	packet_list_sort_run(packet_list_sort_chunk, tasks, nchunks);
+
+	while (nchunks > 1) {
+		nmerges = nchunks / 2;
+		for (i = 0; i < nmerges; i++) {
+			tasks[i].ctx = &ctx;
+			tasks[i].src = keys;
+			tasks[i].dst = tmp;
+			tasks[i].lo = bounds[2 * i];
+			tasks[i].mid = bounds[2 * i + 1];
+			tasks[i].hi = bounds[2 * i + 2];
+		}
+		packet_list_sort_run(packet_list_sort_merge, tasks, nmerges);
+
+		/* An odd run out has nothing to merge with this time around. */
+		if (nchunks % 2)
+			memcpy(&tmp[bounds[nchunks - 1]], &keys[bounds[nchunks - 1]],
+			       (count - bounds[nchunks - 1]) * sizeof(sort_key));
+
+		for (i = 0; i < nmerges; i++)
+			bounds[i] = bounds[2 * i];
+		if (nchunks % 2)
+			bounds[i++] = bounds[nchunks - 1];
+		bounds[i] = count;
+		nchunks = i;
+
+		swap = keys;
+		keys = tmp;
+		tmp = swap;
+	}
+
+	for (i = 0; i < count; i++)
+		PACKET_LIST_RECORD_SET(rows, i, keys[i].record);
+
+	g_free(bounds);
+	g_free(tasks);
+	g_free(tmp);
+	g_free(keys);
 }
 
 static void
@@ -1040,9 +1487,7 @@ packet_list_resort(PacketList *packet_list)
 		return;
 
 	/* resort physical rows according to sorting column */
-	g_ptr_array_sort_with_data(packet_list->physical_rows,
-			  (GCompareDataFunc) packet_list_qsort_physical_compare_func,
-			  packet_list);
+	packet_list_sort_physical_rows(packet_list);
 
 	/* let other objects know about the new order */
 	neworder = g_new0(gint, PACKET_LIST_RECORD_COUNT(packet_list->visible_rows));
@@ -1120,11 +1565,9 @@ packet_list_dissect_and_cache_iter(PacketList *packet_list, GtkTreeIter *iter, g
 static void
 packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *record, gboolean dissect_columns, gboolean dissect_color)
 {
-	epan_dissect_t edt;
 	frame_data *fdata;
 	column_info *cinfo;
 	gint col;
-	gboolean create_proto_tree;
 	union wtap_pseudo_header pseudo_header; /* Packet pseudo_header */
 	guint8 pd[WTAP_MAX_PACKET_SIZE];  /* Packet data */
 
@@ -1169,6 +1612,25 @@ packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *
 		return;	/* error reading the frame */
 	}
 
+	packet_list_dissect_and_cache_frame(packet_list, record, &pseudo_header, pd, dissect_columns, dissect_color);
+}
+
+static void
+packet_list_dissect_and_cache_frame(PacketList *packet_list, PacketListRecord *record, union wtap_pseudo_header *pseudo_header, const guint8 *pd, gboolean dissect_columns, gboolean dissect_color)
+{
+	epan_dissect_t edt;
+	frame_data *fdata;
+	column_info *cinfo;
+	gint col;
+	gboolean create_proto_tree;
+
+	fdata = record->fdata;
+
+	if (dissect_columns)
+		cinfo = &cfile.cinfo;
+	else
+		cinfo = NULL;
+
 	create_proto_tree = (color_filters_used() && dissect_color) ||
 						(have_custom_cols(cinfo) && dissect_columns);
 
@@ -1185,7 +1647,7 @@ packet_list_dissect_and_cache_record(PacketList *packet_list, PacketListRecord *
 	 * XXX - need to catch an OutOfMemoryError exception and
 	 * attempt to recover from it.
 	 */
-	epan_dissect_run(&edt, &pseudo_header, pd, fdata, cinfo);
+	epan_dissect_run(&edt, pseudo_header, pd, fdata, cinfo);
 
 	if (dissect_color)
 		fdata->color_filter = color_filters_colorize_packet(&edt);
@@ -1221,6 +1683,19 @@ packet_list_reset_colorized(PacketList *packet_list)
 	}
 }
 
+static void
+packet_list_widest_delta(frame_data *fdata, guint32 prev_num,
+			 nstime_t *widest_delta, frame_data **widest_fd)
+{
+	nstime_t delta;
+
+	frame_delta_abs_time(fdata, prev_num, &delta);
+	if (*widest_fd == NULL || nstime_cmp(&delta, widest_delta) > 0) {
+		*widest_delta = delta;
+		*widest_fd = fdata;
+	}
+}
+
 const char*
 packet_list_get_widest_column_string(PacketList *packet_list, gint col)
 {
@@ -1236,12 +1711,15 @@ packet_list_get_widest_column_string(PacketList *packet_list, gint col)
 		guint vis_idx;
 
 		frame_data fdata;
+		/* Relative and delta times aren't stored in the frame, so for
+		   those we remember the frame that has the widest one. */
+		frame_data *widest_fd = NULL;
+		nstime_t widest_delta;
+
 		memset (&fdata, 0, sizeof fdata);
 
 		nstime_set_zero(&fdata.abs_ts);
-		nstime_set_zero(&fdata.rel_ts);
-		nstime_set_zero(&fdata.del_cap_ts);
-		nstime_set_zero(&fdata.del_dis_ts);
+		nstime_set_zero(&widest_delta);
 
 		for(vis_idx = 0; vis_idx < PACKET_LIST_RECORD_COUNT(packet_list->visible_rows); ++vis_idx) {
 			record = PACKET_LIST_RECORD_GET(packet_list->visible_rows, vis_idx);
@@ -1267,16 +1745,16 @@ packet_list_get_widest_column_string(PacketList *packet_list, gint col)
 					fdata.abs_ts = record->fdata->abs_ts;
 				break;
 			case COL_REL_TIME:
-				if (nstime_cmp(&record->fdata->rel_ts, &fdata.rel_ts) > 0)
-					fdata.rel_ts = record->fdata->rel_ts;
+				packet_list_widest_delta(record->fdata, record->fdata->frame_ref_num,
+							 &widest_delta, &widest_fd);
 				break;
 			case COL_DELTA_TIME:
-				if (nstime_cmp(&record->fdata->del_cap_ts, &fdata.del_cap_ts) > 0)
-					fdata.del_cap_ts = record->fdata->del_cap_ts;
+				packet_list_widest_delta(record->fdata, record->fdata->num - 1,
+							 &widest_delta, &widest_fd);
 				break;
 			case COL_DELTA_TIME_DIS:
-				if (nstime_cmp(&record->fdata->del_dis_ts, &fdata.del_dis_ts) > 0)
-					fdata.del_dis_ts = record->fdata->del_dis_ts;
+				packet_list_widest_delta(record->fdata, record->fdata->prev_dis_num,
+							 &widest_delta, &widest_fd);
 				break;
 			case COL_CLS_TIME:
 				switch (timestamp_get_type()) {
@@ -1289,18 +1767,18 @@ packet_list_get_widest_column_string(PacketList *packet_list, gint col)
 				  break;
 
 				case TS_RELATIVE:
-				  if (nstime_cmp(&record->fdata->rel_ts, &fdata.rel_ts) > 0)
-					  fdata.rel_ts = record->fdata->rel_ts;
+				  packet_list_widest_delta(record->fdata, record->fdata->frame_ref_num,
+							   &widest_delta, &widest_fd);
 				  break;
 
 				case TS_DELTA:
-				  if (nstime_cmp(&record->fdata->del_cap_ts, &fdata.del_cap_ts) > 0)
-					  fdata.del_cap_ts = record->fdata->del_cap_ts;
+				  packet_list_widest_delta(record->fdata, record->fdata->num - 1,
+							   &widest_delta, &widest_fd);
 				  break;
 
 				case TS_DELTA_DIS:
-				  if (nstime_cmp(&record->fdata->del_dis_ts, &fdata.del_dis_ts) > 0)
-					  fdata.del_dis_ts = record->fdata->del_dis_ts;
+				  packet_list_widest_delta(record->fdata, record->fdata->prev_dis_num,
+							   &widest_delta, &widest_fd);
 				  break;
 
 				case TS_EPOCH:
@@ -1320,7 +1798,8 @@ packet_list_get_widest_column_string(PacketList *packet_list, gint col)
 			}
 		}
 
-		col_fill_in_frame_data(&fdata, &cfile.cinfo, col, FALSE);
+		col_fill_in_frame_data(widest_fd != NULL ? widest_fd : &fdata,
+				       &cfile.cinfo, col, FALSE);
 
 		return cfile.cinfo.col_buf[col];
 	}
@@ -708,8 +708,8 @@ packet(void *tapdata _U_, packet_info *pinfo , epan_dissect_t *edt _U_ , const v
 				addr = g_malloc(tmp_info.dst.len);
 				memcpy(addr, tmp_info.dst.data, tmp_info.dst.len);
 				sack->dst.data = addr;
-				sack->secs=tsn->secs   = (guint32)pinfo->fd->rel_ts.secs;
-				sack->usecs=tsn->usecs = (guint32)pinfo->fd->rel_ts.nsecs/1000;
+				sack->secs=tsn->secs   = (guint32)pinfo->rel_ts.secs;
+				sack->usecs=tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
 				if (((tvb_get_guint8(sctp_info->tvb[0],0)) == SCTP_DATA_CHUNK_ID) ||
 				    ((tvb_get_guint8(sctp_info->tvb[0],0)) == SCTP_SACK_CHUNK_ID) ||
 				    ((tvb_get_guint8(sctp_info->tvb[0],0)) == SCTP_NR_SACK_CHUNK_ID))
@@ -829,8 +829,8 @@ packet(void *tapdata _U_, packet_info *pinfo , epan_dissect_t *edt _U_ , const v
 						datachunk = TRUE;
 						tsn_s = g_malloc(sizeof(struct tsn_sort));
 						tsn_s->tsnumber = tsnumber;
-						tsn_s->secs     = tsn->secs = (guint32)pinfo->fd->rel_ts.secs;
-						tsn_s->usecs    = tsn->usecs = (guint32)pinfo->fd->rel_ts.nsecs/1000;
+						tsn_s->secs     = tsn->secs = (guint32)pinfo->rel_ts.secs;
+						tsn_s->usecs    = tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
 						tsn_s->offset   = 0;
 						tsn_s->framenumber = framenumber;
 						tsn_s->length   = length-DATA_CHUNK_HEADER_LENGTH;
@@ -870,8 +870,8 @@ packet(void *tapdata _U_, packet_info *pinfo , epan_dissect_t *edt _U_ , const v
 						sackchunk = TRUE;
 						tsn_s = g_malloc(sizeof(struct tsn_sort));
 						tsn_s->tsnumber = tsnumber;
-						tsn_s->secs     = tsn->secs = (guint32)pinfo->fd->rel_ts.secs;
-						tsn_s->usecs    = tsn->usecs = (guint32)pinfo->fd->rel_ts.nsecs/1000;
+						tsn_s->secs     = tsn->secs = (guint32)pinfo->rel_ts.secs;
+						tsn_s->usecs    = tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
 						tsn_s->offset   = 0;
 						tsn_s->framenumber = framenumber;
 						tsn_s->length   =  tvb_get_ntohl(sctp_info->tvb[chunk_number], SACK_CHUNK_ADV_REC_WINDOW_CREDIT_OFFSET);
@@ -966,8 +966,8 @@ packet(void *tapdata _U_, packet_info *pinfo , epan_dissect_t *edt _U_ , const v
 			addr = g_malloc(tmp_info.dst.len);
 			memcpy(addr, tmp_info.dst.data, tmp_info.dst.len);
 			sack->dst.data = addr;
-			sack->secs=tsn->secs = (guint32)pinfo->fd->rel_ts.secs;
-			sack->usecs=tsn->usecs = (guint32)pinfo->fd->rel_ts.nsecs/1000;
+			sack->secs=tsn->secs = (guint32)pinfo->rel_ts.secs;
+			sack->usecs=tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
 			if (((tvb_get_guint8(sctp_info->tvb[0],0)) == SCTP_DATA_CHUNK_ID) ||
 			((tvb_get_guint8(sctp_info->tvb[0],0)) == SCTP_SACK_CHUNK_ID) ||
 			((tvb_get_guint8(sctp_info->tvb[0],0)) == SCTP_NR_SACK_CHUNK_ID))
@@ -1127,8 +1127,8 @@ packet(void *tapdata _U_, packet_info *pinfo , epan_dissect_t *edt _U_ , const v
 					info->n_data_bytes+=length;
 					tsn_s = g_malloc(sizeof(struct tsn_sort));
 					tsn_s->tsnumber = tsnumber;
-					tsn_s->secs  = tsn->secs = (guint32)pinfo->fd->rel_ts.secs;
-					tsn_s->usecs = tsn->usecs = (guint32)pinfo->fd->rel_ts.nsecs/1000;
+					tsn_s->secs  = tsn->secs = (guint32)pinfo->rel_ts.secs;
+					tsn_s->usecs = tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
 					tsn_s->offset = 0;
 					tsn_s->framenumber = framenumber;
 					tsn_s->length = length;
@@ -1215,8 +1215,8 @@ packet(void *tapdata _U_, packet_info *pinfo , epan_dissect_t *edt _U_ , const v
 					sackchunk = TRUE;
 					tsn_s = g_malloc(sizeof(struct tsn_sort));
 					tsn_s->tsnumber = tsnumber;
-					tsn_s->secs   = tsn->secs = (guint32)pinfo->fd->rel_ts.secs;
-					tsn_s->usecs  = tsn->usecs = (guint32)pinfo->fd->rel_ts.nsecs/1000;
+					tsn_s->secs   = tsn->secs = (guint32)pinfo->rel_ts.secs;
+					tsn_s->usecs  = tsn->usecs = (guint32)pinfo->rel_ts.nsecs/1000;
 					tsn_s->offset = 0;
 					tsn_s->framenumber = framenumber;
 					tsn_s->length = tvb_get_ntohl(sctp_info->tvb[chunk_number], SACK_CHUNK_ADV_REC_WINDOW_CREDIT_OFFSET);
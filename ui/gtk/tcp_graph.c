@@ -1828,8 +1828,8 @@ tapall_tcpip_packet(void *pct, packet_info *pinfo, epan_dissect_t *edt _U_, cons
 			    ts->direction)) {
 		segment->next = NULL;
 		segment->num = pinfo->fd->num;
-		segment->rel_secs = (guint32) pinfo->fd->rel_ts.secs;
-		segment->rel_usecs = pinfo->fd->rel_ts.nsecs/1000;
+		segment->rel_secs = (guint32) pinfo->rel_ts.secs;
+		segment->rel_usecs = pinfo->rel_ts.nsecs/1000;
 		segment->abs_secs = (guint32) pinfo->fd->abs_ts.secs;
 		segment->abs_usecs = pinfo->fd->abs_ts.nsecs/1000;
 		segment->th_seq=tcphdr->th_seq;
@@ -1938,6 +1938,7 @@ tap_tcpip_packet(void *pct, packet_info *pinfo _U_, epan_dissect_t *edt _U_, con
 static struct tcpheader *select_tcpip_session (capture_file *cf, struct segment *hdrs)
 {
 	frame_data *fdata;
+	nstime_t rel_ts;
 	epan_dissect_t edt;
 	dfilter_t *sfcode;
 	GString *error_string;
@@ -1994,8 +1995,9 @@ static struct tcpheader *select_tcpip_session (capture_file *cf, struct segment
 
 	/* For now, still always choose the first/only one */
 	hdrs->num = fdata->num;
-	hdrs->rel_secs = (guint32) fdata->rel_ts.secs;
-	hdrs->rel_usecs = fdata->rel_ts.nsecs/1000;
+	frame_delta_abs_time(fdata, fdata->frame_ref_num, &rel_ts);
+	hdrs->rel_secs = (guint32) rel_ts.secs;
+	hdrs->rel_usecs = rel_ts.nsecs/1000;
 	hdrs->abs_secs = (guint32) fdata->abs_ts.secs;
 	hdrs->abs_usecs = fdata->abs_ts.nsecs/1000;
 	hdrs->th_seq=th.tcphdrs[0]->th_seq;
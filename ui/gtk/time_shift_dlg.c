@@ -78,7 +78,6 @@ static void error_message(const gchar *msg);
 #define	SHIFT_NEG		1
 #define	SHIFT_SETTOZERO		1
 #define	SHIFT_KEEPOFFSET	0
-static void modify_time_init(frame_data *fd);
 static void modify_time_perform(frame_data *fd, int neg, nstime_t *offset,
     int settozero);
 
@@ -611,15 +610,12 @@ action_timeshift(GtkWindow *parent_w)
   offset_float -= offset.secs;
   offset.nsecs = (int)(offset_float * 1000000000);
 
-  if ((fd = frame_data_sequence_find(cfile.frames, 1)) == NULL)
-    return(1); /* Shouldn't happen */
-  modify_time_init(fd);
-
   for (i = 1; i <= cfile.count; i++) {
     if ((fd = frame_data_sequence_find(cfile.frames, i)) == NULL)
       continue;	/* Shouldn't happen */
     modify_time_perform(fd, neg, &offset, SHIFT_KEEPOFFSET);
   }
+  cf_filter_results_invalidate(&cfile);
   new_packet_list_queue_draw();
   
   return(0);
@@ -714,7 +710,7 @@ action_settime(GtkWindow *parent_w)
   long		packetnumber;
   GtkWidget	*time_te;
   const gchar	*time_text;
-  nstime_t	settime, difftime, packettime;
+  nstime_t	settime, difftime, packettime, shift_offset;
   frame_data	*fd, *packetfd;
   guint32	i;
 
@@ -733,7 +729,8 @@ action_settime(GtkWindow *parent_w)
    */
   if ((packetfd = frame_data_sequence_find(cfile.frames, packetnumber)) == NULL)
     return;
-  nstime_delta(&packettime, &(packetfd->abs_ts), &(packetfd->shift_offset));
+  frame_data_get_shift_offset(packetfd, &shift_offset);
+  nstime_delta(&packettime, &(packetfd->abs_ts), &shift_offset);
 
   if (timestring2nstime(time_text, &packettime, &settime) != 0)
     return;
@@ -743,10 +740,6 @@ action_settime(GtkWindow *parent_w)
 
   /* Up to here nothing is changed */
 
-  if ((fd = frame_data_sequence_find(cfile.frames, 1)) == NULL)
-    return; /* Shouldn't happen */
-  modify_time_init(fd);
-
   /* Set everything back to the original time */
   for (i = 1; i <= cfile.count; i++) {
     if ((fd = frame_data_sequence_find(cfile.frames, i)) == NULL)
@@ -754,6 +747,7 @@ action_settime(GtkWindow *parent_w)
     modify_time_perform(fd, SHIFT_POS, &difftime, SHIFT_SETTOZERO);
   }
 
+  cf_filter_results_invalidate(&cfile);
   new_packet_list_queue_draw();
 }
 
@@ -807,7 +801,7 @@ action_adjtime(GtkWindow *parent_w _U_)
   GtkWidget	*time_te;
   const gchar	*time1_text, *time2_text;
   nstime_t	nt1, nt2, ot1, ot2, nt3;
-  nstime_t	dnt, dot, d3t;
+  nstime_t	dnt, dot, d3t, shift_offset;
   frame_data	*fd, *packet1fd, *packet2fd;
   guint32	i;
 
@@ -847,7 +841,8 @@ action_adjtime(GtkWindow *parent_w _U_)
   if ((packet1fd = frame_data_sequence_find(cfile.frames, packetnumber1)) == NULL)
     return;
   nstime_copy(&ot1, &(packet1fd->abs_ts));
-  nstime_subtract(&ot1, &(packet1fd->shift_offset));
+  frame_data_get_shift_offset(packet1fd, &shift_offset);
+  nstime_subtract(&ot1, &shift_offset);
 
   if (timestring2nstime(time1_text, &ot1, &nt1) != 0)
     return;
@@ -859,7 +854,8 @@ action_adjtime(GtkWindow *parent_w _U_)
   if ((packet2fd = frame_data_sequence_find(cfile.frames, packetnumber2)) == NULL)
     return;
   nstime_copy(&ot2, &(packet2fd->abs_ts));
-  nstime_subtract(&ot2, &(packet2fd->shift_offset));
+  frame_data_get_shift_offset(packet2fd, &shift_offset);
+  nstime_subtract(&ot2, &shift_offset);
 
   if (timestring2nstime(time2_text, &ot2, &nt2) != 0)
     return;
@@ -871,17 +867,15 @@ action_adjtime(GtkWindow *parent_w _U_)
   nstime_subtract(&dnt, &nt1);
 
   /* Up to here nothing is changed */
-  if ((fd = frame_data_sequence_find(cfile.frames, 1)) == NULL)
-    return; /* Shouldn't happen */
-  modify_time_init(fd);
-
   for (i = 1; i <= cfile.count; i++) {
     if ((fd = frame_data_sequence_find(cfile.frames, i)) == NULL)
       continue;	/* Shouldn't happen */
 
     /* Set everything back to the original time */
-    nstime_subtract(&(fd->abs_ts), &(fd->shift_offset));
-    nstime_set_zero(&(fd->shift_offset));
+    frame_data_get_shift_offset(fd, &shift_offset);
+    nstime_subtract(&(fd->abs_ts), &shift_offset);
+    nstime_set_zero(&shift_offset);
+    frame_data_set_shift_offset(fd, &shift_offset);
 
     /* Add the difference to each packet */
     calcNT3(&ot1, &(fd->abs_ts), &nt1, &nt3, &dot, &dnt);
@@ -892,6 +886,7 @@ action_adjtime(GtkWindow *parent_w _U_)
     modify_time_perform(fd, SHIFT_POS, &d3t, SHIFT_SETTOZERO);
   }
 
+  cf_filter_results_invalidate(&cfile);
   new_packet_list_queue_draw();
 }
 
@@ -904,15 +899,12 @@ action_undo(GtkWindow *parent_w _U_)
 
   nulltime.secs = nulltime.nsecs = 0;
 
-  if ((fd = frame_data_sequence_find(cfile.frames, 1)) == NULL)
-    return; /* Shouldn't happen */
-  modify_time_init(fd);
-
   for (i = 1; i <= cfile.count; i++) {
     if ((fd = frame_data_sequence_find(cfile.frames, i)) == NULL)
       continue;	/* Shouldn't happen */
     modify_time_perform(fd, SHIFT_NEG, &nulltime, SHIFT_SETTOZERO);
   }
+  cf_filter_results_invalidate(&cfile);
   new_packet_list_queue_draw();
 }
 
@@ -930,74 +922,33 @@ time_shift_frame_destroy_cb(GtkWidget *win _U_, gpointer user_data _U_)
   time_shift_frame_w = NULL;
 }
 
-static void
-modify_time_init(frame_data *fd)
-{
-  modify_time_perform(fd, SHIFT_NEG, NULL, SHIFT_KEEPOFFSET);
-}
-
 static void
 modify_time_perform(frame_data *fd, int neg, nstime_t *offset, int settozero)
 {
-  static frame_data *first_packet = NULL;
-  static frame_data *lastdisplayed_packet = NULL;
-  static frame_data *prevcaptured_packet = NULL;
-  static nstime_t nulltime;
-
-  /* Only for initializing */
-  if (offset == NULL) {
-    first_packet = fd;
-    lastdisplayed_packet = NULL;
-    prevcaptured_packet = NULL;
-    nulltime.secs = nulltime.nsecs = 0;
-    return;
-  }
-  if (first_packet == NULL) {
-    fprintf(stderr, "modify_time_perform: not initialized?\n");
-    return;
-  }
+  nstime_t shift_offset;
+
+  frame_data_get_shift_offset(fd, &shift_offset);
 
   /* The actual shift */
 
   if (settozero == SHIFT_SETTOZERO) {
-    nstime_subtract(&(fd->abs_ts), &(fd->shift_offset));
-    nstime_copy(&(fd->shift_offset), &nulltime);
+    nstime_subtract(&(fd->abs_ts), &shift_offset);
+    nstime_set_zero(&shift_offset);
   }
 
   if (neg == SHIFT_POS) {
     nstime_add(&(fd->abs_ts), offset);
-    nstime_add(&(fd->shift_offset), offset);
+    nstime_add(&shift_offset, offset);
   } else if (neg == SHIFT_NEG) {
     nstime_subtract(&(fd->abs_ts), offset);
-    nstime_subtract(&(fd->shift_offset), offset);
+    nstime_subtract(&shift_offset, offset);
   } else {
     fprintf(stderr, "modify_time_perform: neg = %d?\n", neg);
   }
 
-  /*
-   * rel_ts     - Relative timestamp to first packet
-   * del_dis_ts - Delta timestamp to previous displayed frame
-   * del_cap_ts - Delta timestamp to previous captured frame
-   */
-  if (first_packet != NULL) {
-    nstime_copy(&(fd->rel_ts), &(fd->abs_ts));
-    nstime_subtract(&(fd->rel_ts), &(first_packet->abs_ts));
-  } else
-    nstime_copy(&(fd->rel_ts), &nulltime);
-
-  if (prevcaptured_packet != NULL) {
-    nstime_copy(&(fd->del_cap_ts), &(fd->abs_ts));
-    nstime_subtract(&(fd->del_cap_ts), &(prevcaptured_packet->abs_ts));
-  } else
-    nstime_copy(&(fd->del_cap_ts), &nulltime);
-
-  if (lastdisplayed_packet != NULL) {
-    nstime_copy(&(fd->del_dis_ts), &(fd->abs_ts));
-    nstime_subtract(&(fd->del_dis_ts), &(lastdisplayed_packet->abs_ts));
-  } else
-    nstime_copy(&(fd->del_dis_ts), &nulltime);
-
-  prevcaptured_packet = fd;
-  if (fd->flags.passed_dfilter)
-    lastdisplayed_packet = fd;
+  frame_data_set_shift_offset(fd, &shift_offset);
+
+  /* The relative and delta time stamps are worked out from abs_ts when
+     they're needed; the callers forget the remembered display filter
+     results, which may have looked at them, once every frame is done. */
 }
@@ -616,7 +616,7 @@ static void RTP_packet_draw(void *prs _U_)
 			/* if RTP was already in the Graph, just update the comment information */
 			gai = g_hash_table_lookup(the_tapinfo_struct.graph_analysis->ht, &rtp_listinfo->start_fd->num);
 			if(gai != NULL) {
-				duration = (guint32)(nstime_to_msec(&rtp_listinfo->stop_fd->rel_ts) - nstime_to_msec(&rtp_listinfo->start_fd->rel_ts));
+				duration = (guint32)(nstime_to_msec(&rtp_listinfo->stop_fd->abs_ts) - nstime_to_msec(&rtp_listinfo->start_fd->abs_ts));
 				g_free(gai->comment);
 				gai->comment = g_strdup_printf("%s Num packets:%u  Duration:%u.%03us SSRC:0x%X",
 												(rtp_listinfo->is_srtp)?"SRTP":"RTP", rtp_listinfo->npackets,
@@ -628,7 +628,7 @@ static void RTP_packet_draw(void *prs _U_)
 				COPY_ADDRESS(&(new_gai->dst_addr),&(rtp_listinfo->dest_addr));
 				new_gai->port_src = rtp_listinfo->src_port;
 				new_gai->port_dst = rtp_listinfo->dest_port;
-				duration = (guint32)(nstime_to_msec(&rtp_listinfo->stop_fd->rel_ts) - nstime_to_msec(&rtp_listinfo->start_fd->rel_ts));
+				duration = (guint32)(nstime_to_msec(&rtp_listinfo->stop_fd->abs_ts) - nstime_to_msec(&rtp_listinfo->start_fd->abs_ts));
 				new_gai->frame_label = g_strdup_printf("%s (%s) %s",
 										(rtp_listinfo->is_srtp)?"SRTP":"RTP",
 										rtp_listinfo->pt_str,
@@ -681,7 +681,7 @@ static void RTP_packet_draw(void *prs _U_)
 					gai = voip_calls_graph_list->data;
 					/* if RTP was already in the Graph, just update the comment information */
 					if (rtp_listinfo->start_fd->num == gai->fd->num) {
-						duration = (guint32)(nstime_to_msec(&rtp_listinfo->stop_fd->rel_ts) - nstime_to_msec(&rtp_listinfo->start_fd->rel_ts));
+						duration = (guint32)(nstime_to_msec(&rtp_listinfo->stop_fd->abs_ts) - nstime_to_msec(&rtp_listinfo->start_fd->abs_ts));
 						g_free(gai->comment);
 						gai->comment = g_strdup_printf("%s Num packets:%u  Duration:%u.%03us SSRC:0x%X",
 														(rtp_listinfo->is_srtp)?"SRTP":"RTP", rtp_listinfo->npackets,
@@ -701,7 +701,7 @@ static void RTP_packet_draw(void *prs _U_)
 						COPY_ADDRESS(&(new_gai->dst_addr),&(rtp_listinfo->dest_addr));
 						new_gai->port_src = rtp_listinfo->src_port;
 						new_gai->port_dst = rtp_listinfo->dest_port;
-						duration = (guint32)(nstime_to_msec(&rtp_listinfo->stop_fd->rel_ts) - nstime_to_msec(&rtp_listinfo->start_fd->rel_ts));
+						duration = (guint32)(nstime_to_msec(&rtp_listinfo->stop_fd->abs_ts) - nstime_to_msec(&rtp_listinfo->start_fd->abs_ts));
 						new_gai->frame_label = g_strdup_printf("%s (%s) %s",
 										       (rtp_listinfo->is_srtp)?"SRTP":"RTP",
 										       rtp_listinfo->pt_str,
@@ -869,7 +869,7 @@ T38_packet( void *ptr _U_, packet_info *pinfo, epan_dissect_t *edt _U_, const vo
 				comment = g_strdup_printf("WARNING: received t38:%s:HDLC:%s", val_to_str(pi->data_value, t38_T30_data_vals, "Ukn (0x%02X)"), pi->Data_Field_field_type_value == 3 ? "fcs-BAD" : "fcs-BAD-sig-end");
 				break;
 			case 7: /* t4-non-ecm-sig-end */
-				duration = nstime_to_sec(&pinfo->fd->rel_ts) - pi->time_first_t4_data;
+				duration = nstime_to_sec(&pinfo->rel_ts) - pi->time_first_t4_data;
 				frame_label = g_strdup_printf("t4-non-ecm-data:%s",val_to_str(pi->data_value, t38_T30_data_vals, "Ukn (0x%02X)") );
 				comment = g_strdup_printf("t38:t4-non-ecm-data:%s Duration: %.2fs %s",val_to_str(pi->data_value, t38_T30_data_vals, "Ukn (0x%02X)"), duration, pi->desc_comment );
 				insert_to_graph_t38(tapinfo, pinfo, frame_label, comment, (guint16)conv_num, &(pinfo->src), &(pinfo->dst), line_style, pi->frame_num_first_t4_data);
@@ -2404,7 +2404,7 @@ MGCPcalls_packet( void *ptr _U_, packet_info *pinfo, epan_dissect_t *edt _U_, co
 						   check first if it is an ended call. We can still match packets to this Endpoint 2 seconds
 						   after the call has been released
 						*/
-						diff_time = nstime_to_sec(&pinfo->fd->rel_ts) - nstime_to_sec(&tmp_listinfo->stop_fd->rel_ts);
+						diff_time = nstime_to_sec(&pinfo->fd->abs_ts) - nstime_to_sec(&tmp_listinfo->stop_fd->abs_ts);
 						if ( ((tmp_listinfo->call_state == VOIP_CANCELLED) ||
 						     (tmp_listinfo->call_state == VOIP_COMPLETED)  ||
 						     (tmp_listinfo->call_state == VOIP_REJECTED)) &&
@@ -4080,7 +4080,7 @@ prot_calls_packet(void *ptr _U_, packet_info *pinfo, epan_dissect_t *edt _U_, co
 	voip_calls_tapinfo_t *tapinfo = &the_tapinfo_struct;
 	if (callsinfo!=NULL) {
 		callsinfo->stop_abs = pinfo->fd->abs_ts;
-		callsinfo->stop_rel = pinfo->fd->rel_ts;
+		callsinfo->stop_rel = pinfo->rel_ts;
 		callsinfo->last_frame_num=pinfo->fd->num;
 		++(callsinfo->npackets);
 		++(tapinfo->npackets);
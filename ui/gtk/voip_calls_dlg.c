@@ -440,6 +440,10 @@ add_to_list_store(voip_calls_info_t* strinfo)
 	isup_calls_info_t *isupinfo;
 	h323_calls_info_t *h323info;
 	gboolean flag = FALSE;
+	nstime_t start_rel_ts, stop_rel_ts;
+
+	frame_delta_abs_time(strinfo->start_fd, strinfo->start_fd->frame_ref_num, &start_rel_ts);
+	frame_delta_abs_time(strinfo->stop_fd, strinfo->stop_fd->frame_ref_num, &stop_rel_ts);
 
 	g_snprintf(field[CALL_COL_INITIAL_SPEAKER], 30, "%s", get_addr_name(&(strinfo->initial_speaker)));
 	g_snprintf(field[CALL_COL_FROM],            50, "%s", strinfo->from_identity);
@@ -481,8 +485,8 @@ add_to_list_store(voip_calls_info_t* strinfo)
 
 	/* Fill the new row */
 	gtk_list_store_set(list_store, &list_iter,
-			   CALL_COL_START_TIME,       nstime_to_sec(&strinfo->start_fd->rel_ts),
-			   CALL_COL_STOP_TIME,        nstime_to_sec(&strinfo->stop_fd->rel_ts),
+			   CALL_COL_START_TIME,       nstime_to_sec(&start_rel_ts),
+			   CALL_COL_STOP_TIME,        nstime_to_sec(&stop_rel_ts),
 			   CALL_COL_INITIAL_SPEAKER,  &field[CALL_COL_INITIAL_SPEAKER][0],
 			   CALL_COL_FROM,             &field[CALL_COL_FROM][0],
 			   CALL_COL_TO,               &field[CALL_COL_TO][0],
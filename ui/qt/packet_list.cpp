@@ -48,6 +48,7 @@
 #include <QTreeWidget>
 #include <QTabWidget>
 #include <QTextEdit>
+#include <QScrollBar>
 
 static gboolean enable_color;
 
@@ -284,6 +285,7 @@ PacketList::PacketList(QWidget *parent) :
 
     m_packet_list_model = new PacketListModel(this, &cfile);
     setModel(m_packet_list_model);
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(vScrollBarValueChanged(int)));
 
     g_assert(cur_packet_list == NULL);
     cur_packet_list = this;
@@ -322,6 +324,15 @@ void PacketList::showEvent (QShowEvent *event) {
     }
 }
 
+// Have the rows we're scrolling to columnized first.
+void PacketList::vScrollBarValueChanged(int value) {
+    Q_UNUSED(value);
+    QModelIndex first = indexAt(viewport()->rect().topLeft());
+
+    if (first.isValid())
+        m_packet_list_model->setFirstVisibleRow(first.row());
+}
+
 void PacketList::selectionChanged (const QItemSelection & selected, const QItemSelection & deselected) {
     QTreeView::selectionChanged(selected, deselected);
 
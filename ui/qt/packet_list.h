@@ -56,6 +56,9 @@ signals:
 
 public slots:
 
+private slots:
+    void vScrollBarValueChanged(int value);
+
 };
 
 #endif // PACKET_LIST_H
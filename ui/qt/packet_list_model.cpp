@@ -35,13 +35,34 @@
 
 #include "globals.h"
 
+#include <QApplication>
 #include <QColor>
+#include <QTime>
+#include <QtAlgorithms>
 
+// The background columnizer gives the GUI a chance to run at least this
+// often, in milliseconds.
+#define COLUMNIZE_SLICE_MS 40
+
+// How long the background columnizer waits while a file is being read.
+#define COLUMNIZE_WAIT_MS 250
 
 PacketListModel::PacketListModel(QObject *parent, capture_file *cfPtr) :
-    QAbstractItemModel(parent)
+    QAbstractItemModel(parent),
+    sortColumn(-1),
+    sortOrder(Qt::AscendingOrder),
+    columnizeNext(0),
+    columnizeRemaining(0)
 {
     cf = cfPtr;
+    stringPool = g_string_chunk_new(4096);
+    connect(&columnizeTimer, SIGNAL(timeout()), this, SLOT(columnizeSome()));
+}
+
+PacketListModel::~PacketListModel()
+{
+    qDeleteAll(physicalRows);
+    g_string_chunk_free(stringPool);
 }
 
 gint PacketListModel::appendPacket(frame_data *fdata)
@@ -55,6 +76,13 @@ gint PacketListModel::appendPacket(frame_data *fdata)
         beginInsertRows(QModelIndex(), pos, pos);
         visibleRows << record;
         endInsertRows();
+
+        if (!columnizeTimer.isActive()) {
+            columnizeNext = visibleRows.count() - 1;
+            columnizeRemaining = 0;
+            columnizeTimer.start(0);
+        }
+        columnizeRemaining++;
     } else {
         pos = -1;
     }
@@ -101,6 +129,9 @@ guint PacketListModel::recreateVisibleRows()
         }
     }
     endInsertRows();
+    if (sortColumn >= 0)
+        sort(sortColumn, sortOrder);
+    startColumnizing(0);
     return visibleRows.count();
 }
 
@@ -170,6 +201,8 @@ QVariant PacketListModel::data(const QModelIndex &index, int role) const
 //    case Qt::TextAlignmentRole:
     case Qt::BackgroundRole:
         const color_t *color;
+        if (!record->isColorized())
+            columnizeRecord(record);
         if (fdata->flags.ignored) {
             color = &prefs.gui_ignored_bg;
         } else if (fdata->flags.marked) {
@@ -183,6 +216,8 @@ QVariant PacketListModel::data(const QModelIndex &index, int role) const
 //        g_log(NULL, G_LOG_LEVEL_DEBUG, "i: %d m: %d cf: %p bg: %d %d %d", fdata->flags.ignored, fdata->flags.marked, fdata->color_filter, color->red, color->green, color->blue);
         return QColor(color->red >> 8, color->green >> 8, color->blue >> 8);
     case Qt::ForegroundRole:
+        if (!record->isColorized())
+            columnizeRecord(record);
         if (fdata->flags.ignored) {
             color = &prefs.gui_ignored_fg;
         } else if (fdata->flags.marked) {
@@ -204,92 +239,133 @@ QVariant PacketListModel::data(const QModelIndex &index, int role) const
     int col_num = index.column();
 //    g_log(NULL, G_LOG_LEVEL_DEBUG, "showing col %d", col_num);
 
-    if (col_num > cf->cinfo.num_cols)
+    if (col_num >= cf->cinfo.num_cols)
         return QVariant();
 
-    epan_dissect_t edt;
-    column_info *cinfo;
-    gboolean create_proto_tree;
-    union wtap_pseudo_header pseudo_header; /* Packet pseudo_header */
-    guint8 pd[WTAP_MAX_PACKET_SIZE];  /* Packet data */
-    gboolean dissect_columns = TRUE; // XXX - Currently only a placeholder
-    gboolean dissect_color = TRUE; // XXX - Currently only a placeholder
-
-    if (dissect_columns)
-        cinfo = &cf->cinfo;
-    else
-        cinfo = NULL;
-
-    if (!cf_read_frame_r(cf, fdata, &pseudo_header, pd)) {
-        /*
-         * Error reading the frame.
-         *
-         * Don't set the color filter for now (we might want
-         * to colorize it in some fashion to warn that the
-         * row couldn't be filled in or colorized), and
-         * set the columns to placeholder values, except
-         * for the Info column, where we'll put in an
-         * error message.
-         */
-        if (dissect_columns) {
-            col_fill_in_error(cinfo, fdata, FALSE, FALSE /* fill_fd_columns */);
-
-            //            for(gint col = 0; col < cinfo->num_cols; ++col) {
-            //                /* Skip columns based on frame_data because we already store those. */
-            //                if (!col_based_on_frame_data(cinfo, col))
-            //                    packet_list_change_record(packet_list, record->physical_pos, col, cinfo);
-            //            }
-            //            record->columnized = TRUE;
-        }
-        if (dissect_color) {
-            fdata->color_filter = NULL;
-            //            record->colorized = TRUE;
-        }
-        return QVariant();	/* error reading the frame */
-    }
+    // Only rows that haven't been columnized in the background yet get
+    // dissected here, and only once.
+    if (!col_based_on_frame_data(&cf->cinfo, col_num) && !record->isColumnized())
+        columnizeRecord(record);
+
+    return record->data(col_num, &cf->cinfo);
+}
+
+// Dissect a record once, for both its column text and its coloring.
+void PacketListModel::columnizeRecord(PacketListRecord *record) const
+{
+    record->dissect(cf, stringPool, !record->isColumnized(), !record->isColorized());
+}
+
+// Columnize every visible row, starting at "row" and wrapping around.
+void PacketListModel::startColumnizing(int row)
+{
+    if (visibleRows.count() < 1)
+        return;
 
-    create_proto_tree = (color_filters_used() && dissect_color) ||
-                        (have_custom_cols(cinfo) && dissect_columns);
+    columnizeNext = qBound(0, row, visibleRows.count() - 1);
+    columnizeRemaining = visibleRows.count();
+    if (!columnizeTimer.isActive())
+        columnizeTimer.start(0);
+}
 
-    epan_dissect_init(&edt,
-                      create_proto_tree,
-                      FALSE /* proto_tree_visible */);
+// The view has scrolled; what it shows, and what follows it, come first.
+void PacketListModel::setFirstVisibleRow(int row)
+{
+    startColumnizing(row);
+}
 
-    if (dissect_color)
-        color_filters_prime_edt(&edt);
-    if (dissect_columns)
-        col_custom_prime_edt(&edt, cinfo);
+void PacketListModel::columnizeSome()
+{
+    QTime slice;
+
+    // Dissecting while a file is being read (or a capture is running)
+    // would only slow that down; the rows being shown get columnized as
+    // they're drawn in any case.
+    if (cf->state == FILE_READ_IN_PROGRESS) {
+        columnizeTimer.setInterval(COLUMNIZE_WAIT_MS);
+        return;
+    }
+    columnizeTimer.setInterval(0);
 
-    epan_dissect_run(&edt, &pseudo_header, pd, fdata, cinfo);
+    slice.start();
+    while (columnizeRemaining > 0 && slice.elapsed() < COLUMNIZE_SLICE_MS) {
+        if (columnizeNext >= visibleRows.count())
+            columnizeNext = 0;
+        if (visibleRows.count() < 1)
+            break;
+        PacketListRecord *record = visibleRows[columnizeNext];
+        if (!record->isColumnized() || !record->isColorized())
+            columnizeRecord(record);
+        columnizeNext++;
+        columnizeRemaining--;
+    }
+    if (columnizeRemaining <= 0 || visibleRows.count() < 1)
+        columnizeTimer.stop();
+}
 
-    if (dissect_color)
-        fdata->color_filter = color_filters_colorize_packet(&edt);
+// qStableSort() wants a "less than" functor.
+class PacketListRecordLessThan
+{
+public:
+    PacketListRecordLessThan(column_info *cinfo, int column, Qt::SortOrder order) :
+        cinfo(cinfo), column(column), order(order) {}
+    bool operator()(const PacketListRecord *a, const PacketListRecord *b) const {
+        int ret = PacketListRecord::compare(a, b, column, cinfo);
+        return order == Qt::AscendingOrder ? ret < 0 : ret > 0;
+    }
+
+private:
+    column_info *cinfo;
+    int column;
+    Qt::SortOrder order;
+};
+
+void PacketListModel::sort(int column, Qt::SortOrder order)
+{
+    sortColumn = column;
+    sortOrder = order;
+
+    if (!cf || column < 0 || column >= cf->cinfo.num_cols || visibleRows.count() < 2)
+        return;
+
+    if (!col_based_on_frame_data(&cf->cinfo, column)) {
+        // Finish what the background columnizer started; after that,
+        // sorting works on the cached text and dissects nothing.
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        foreach (PacketListRecord *record, visibleRows) {
+            if (!record->isColumnized())
+                columnizeRecord(record);
+        }
+        QApplication::restoreOverrideCursor();
+    }
 
-    if (dissect_columns) {
-        /* "Stringify" non frame_data vals */
-        epan_dissect_fill_in_columns(&edt, FALSE, FALSE /* fill_fd_columns */);
+    emit layoutAboutToBeChanged();
 
-        //            for(col = 0; col < cinfo->num_cols; ++col) {
-        //                    /* Skip columns based on frame_data because we already store those. */
-        //                    if (!col_based_on_frame_data(cinfo, col))
-        //                            packet_list_change_record(packet_list, record->physical_pos, col, cinfo);
-        //            }
-//        g_log(NULL, G_LOG_LEVEL_DEBUG, "d_c %d: %s", col_num, cinfo->col_data[col_num]);
+    QModelIndexList oldIndexes = persistentIndexList();
+    QList<PacketListRecord *> oldRecords;
+    foreach (QModelIndex oldIndex, oldIndexes) {
+        oldRecords << static_cast<PacketListRecord*>(oldIndex.internalPointer());
     }
 
-    //    if (dissect_columns)
-    //            record->columnized = TRUE;
-    //    if (dissect_color)
-    //            record->colorized = TRUE;
+    qStableSort(visibleRows.begin(), visibleRows.end(),
+                PacketListRecordLessThan(&cf->cinfo, column, order));
 
-    epan_dissect_cleanup(&edt);
+    QModelIndexList newIndexes;
+    for (int i = 0; i < oldIndexes.count(); i++) {
+        newIndexes << index(visibleRows.indexOf(oldRecords[i]), oldIndexes[i].column());
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
 
-    return record->data(col_num, cinfo);
+    emit layoutChanged();
 }
 
 void PacketListModel::clear() {
     beginResetModel();
+    columnizeTimer.stop();
+    columnizeRemaining = 0;
+    qDeleteAll(physicalRows);
     physicalRows.clear();
     visibleRows.clear();
+    g_string_chunk_clear(stringPool);
     endResetModel();
 }
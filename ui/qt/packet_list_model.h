@@ -34,6 +34,7 @@
 
 #include <QAbstractItemModel>
 #include <QFont>
+#include <QTimer>
 #include <QVector>
 
 #include "packet_list_record.h"
@@ -45,6 +46,7 @@ class PacketListModel : public QAbstractItemModel
     Q_OBJECT
 public:
     explicit PacketListModel(QObject *parent = 0, capture_file *cfPtr = NULL);
+    ~PacketListModel();
     QModelIndex index(int row, int column,
                       const QModelIndex &parent = QModelIndex()) const;
     QModelIndex parent(const QModelIndex &index) const;
@@ -58,14 +60,19 @@ public:
     int columnCount(const QModelIndex &parent = QModelIndex()) const;
     QVariant headerData(int section, Qt::Orientation orientation,
                              int role = Qt::DisplayRole) const;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
     guint recreateVisibleRows();
     int visibleIndexOf(frame_data *fdata) const;
+    void setFirstVisibleRow(int row);
 
 
 signals:
 
 public slots:
 
+private slots:
+    void columnizeSome();
+
 private:
     capture_file *cf;
     QList<QString> colNames;
@@ -73,6 +80,17 @@ private:
     QVector<PacketListRecord *> physicalRows;
     QFont plFont;
     int headerHeight;
+    /** Column text of all the records, interned */
+    GStringChunk *stringPool;
+    int sortColumn;
+    Qt::SortOrder sortOrder;
+    /** Columnizes rows in the background, starting with the visible ones */
+    QTimer columnizeTimer;
+    int columnizeNext;
+    int columnizeRemaining;
+
+    void columnizeRecord(PacketListRecord *record) const;
+    void startColumnizing(int row);
 };
 
 #endif // PACKET_LIST_MODEL_H
@@ -23,9 +23,29 @@
 
 #include "packet_list_record.h"
 
-PacketListRecord::PacketListRecord(frame_data *frameData)
+#include <stdlib.h>
+#include <string.h>
+
+#include <epan/epan_dissect.h>
+#include <epan/column.h>
+#include <epan/proto.h>
+
+#include "color.h"
+#include "color_filters.h"
+#include "file.h"
+
+PacketListRecord::PacketListRecord(frame_data *frameData) :
+    col_text(NULL),
+    fdata(frameData),
+    columnized(false),
+    colorized(false)
+{
+}
+
+PacketListRecord::~PacketListRecord()
 {
-    fdata = frameData;
+    // The strings themselves belong to the model's string pool.
+    g_free(col_text);
 }
 
 QVariant PacketListRecord::data(int col_num, column_info *cinfo) const
@@ -35,15 +55,198 @@ QVariant PacketListRecord::data(int col_num, column_info *cinfo) const
     if (!cinfo)
         return QVariant();
 
-    if (col_based_on_frame_data(cinfo, col_num)) //{
+    if (col_based_on_frame_data(cinfo, col_num)) {
         col_fill_in_frame_data(fdata, cinfo, col_num, FALSE);
         return cinfo->col_data[col_num];
-//    } else {
-//        QString unknown;
-//        return unknown.sprintf("Unknown: frame %d col %d", fdata->num, col_num);
-//    }
+    }
+
+    if (!col_text || !col_text[col_num])
+        return QVariant();
+    return col_text[col_num];
 }
 
 frame_data *PacketListRecord::getFdata() {
     return fdata;
 }
+
+void PacketListRecord::dissect(capture_file *cap_file, GStringChunk *string_pool, bool dissect_columns, bool dissect_color)
+{
+    epan_dissect_t edt;
+    column_info *cinfo;
+    gboolean create_proto_tree;
+    union wtap_pseudo_header pseudo_header; /* Packet pseudo_header */
+    guint8 pd[WTAP_MAX_PACKET_SIZE];  /* Packet data */
+
+    if (!cap_file)
+        return;
+
+    if (dissect_columns)
+        cinfo = &cap_file->cinfo;
+    else
+        cinfo = NULL;
+
+    if (!cf_read_frame_r(cap_file, fdata, &pseudo_header, pd)) {
+        /*
+         * Error reading the frame.
+         *
+         * Don't set the color filter for now (we might want
+         * to colorize it in some fashion to warn that the
+         * row couldn't be filled in or colorized), and
+         * set the columns to placeholder values, except
+         * for the Info column, where we'll put in an
+         * error message.
+         */
+        if (dissect_columns) {
+            col_fill_in_error(cinfo, fdata, FALSE, FALSE /* fill_fd_columns */);
+            cacheColumnStrings(cinfo, string_pool);
+        }
+        if (dissect_color) {
+            fdata->color_filter = NULL;
+            colorized = true;
+        }
+        return;    /* error reading the frame */
+    }
+
+    create_proto_tree = (color_filters_used() && dissect_color) ||
+                        (have_custom_cols(cinfo) && dissect_columns);
+
+    epan_dissect_init(&edt,
+                      create_proto_tree,
+                      FALSE /* proto_tree_visible */);
+
+    if (dissect_color)
+        color_filters_prime_edt(&edt);
+    if (dissect_columns)
+        col_custom_prime_edt(&edt, cinfo);
+
+    epan_dissect_run(&edt, &pseudo_header, pd, fdata, cinfo);
+
+    if (dissect_color) {
+        fdata->color_filter = color_filters_colorize_packet(&edt);
+        colorized = true;
+    }
+
+    if (dissect_columns) {
+        /* "Stringify" non frame_data vals */
+        epan_dissect_fill_in_columns(&edt, FALSE, FALSE /* fill_fd_columns */);
+        cacheColumnStrings(cinfo, string_pool);
+    }
+
+    epan_dissect_cleanup(&edt);
+}
+
+// Keep the text of the columns that aren't based on frame data. As in
+// the GTK+ packet list, constant strings are used as they are and
+// everything else is interned, so that the many rows with the same
+// protocol or address share one copy.
+void PacketListRecord::cacheColumnStrings(column_info *cinfo, GStringChunk *string_pool)
+{
+    if (!col_text)
+        col_text = g_new0(const gchar *, cinfo->num_cols);
+
+    for (int col = 0; col < cinfo->num_cols; ++col) {
+        /* Skip columns based on frame_data because we already store those. */
+        if (col_based_on_frame_data(cinfo, col))
+            continue;
+
+        switch (cinfo->col_fmt[col]) {
+        case COL_DEF_SRC:
+        case COL_RES_SRC:   /* COL_DEF_SRC is currently just like COL_RES_SRC */
+        case COL_UNRES_SRC:
+        case COL_DEF_DL_SRC:
+        case COL_RES_DL_SRC:
+        case COL_UNRES_DL_SRC:
+        case COL_DEF_NET_SRC:
+        case COL_RES_NET_SRC:
+        case COL_UNRES_NET_SRC:
+        case COL_DEF_DST:
+        case COL_RES_DST:   /* COL_DEF_DST is currently just like COL_RES_DST */
+        case COL_UNRES_DST:
+        case COL_DEF_DL_DST:
+        case COL_RES_DL_DST:
+        case COL_UNRES_DL_DST:
+        case COL_DEF_NET_DST:
+        case COL_RES_NET_DST:
+        case COL_UNRES_NET_DST:
+        case COL_PROTOCOL:
+        case COL_INFO:
+        case COL_IF_DIR:
+        case COL_DCE_CALL:
+        case COL_8021Q_VLAN_ID:
+        case COL_EXPERT:
+        case COL_FREQ_CHAN:
+            if (cinfo->col_data[col] && cinfo->col_data[col] != cinfo->col_buf[col]) {
+                /* This is a constant string, so we don't have to copy it */
+                col_text[col] = cinfo->col_data[col];
+                break;
+            }
+            /* !! FALL-THROUGH!! */
+
+        default:
+            if (!cinfo->col_data[col] || !cinfo->col_data[col][0]) {
+                col_text[col] = "";
+            } else if (!get_column_resolved(col) && cinfo->col_expr.col_expr_val[col]) {
+                /* Use the unresolved value in col_expr_val */
+                col_text[col] = g_string_chunk_insert_const(string_pool, cinfo->col_expr.col_expr_val[col]);
+            } else {
+                col_text[col] = g_string_chunk_insert_const(string_pool, cinfo->col_data[col]);
+            }
+            break;
+        }
+    }
+    columnized = true;
+}
+
+// Numeric custom columns are compared by value.
+static int
+compare_custom(const gchar *text_a, const gchar *text_b, int col_num, column_info *cinfo)
+{
+    header_field_info *hfi;
+
+    hfi = proto_registrar_get_byname(cinfo->col_custom_field[col_num]);
+
+    if (hfi == NULL) {
+        return 0;
+    } else if ((hfi->strings == NULL) &&
+               (((IS_FT_INT(hfi->type) || IS_FT_UINT(hfi->type)) &&
+                 ((hfi->display == BASE_DEC) || (hfi->display == BASE_DEC_HEX) ||
+                  (hfi->display == BASE_OCT))) ||
+                (hfi->type == FT_DOUBLE) || (hfi->type == FT_FLOAT) ||
+                (hfi->type == FT_BOOLEAN) || (hfi->type == FT_FRAMENUM) ||
+                (hfi->type == FT_RELATIVE_TIME))) {
+        /* Attempt to convert to numbers */
+        double num_a = atof(text_a);
+        double num_b = atof(text_b);
+
+        if (num_a < num_b)
+            return -1;
+        else if (num_a > num_b)
+            return 1;
+        return 0;
+    }
+
+    return strcmp(text_a, text_b);
+}
+
+int PacketListRecord::compare(const PacketListRecord *a, const PacketListRecord *b, int col_num, column_info *cinfo)
+{
+    const gchar *text_a, *text_b;
+    int ret;
+
+    if (col_based_on_frame_data(cinfo, col_num))
+        return frame_data_compare(a->fdata, b->fdata, cinfo->col_fmt[col_num]);
+
+    text_a = (a->col_text && a->col_text[col_num]) ? a->col_text[col_num] : "";
+    text_b = (b->col_text && b->col_text[col_num]) ? b->col_text[col_num] : "";
+
+    if (text_a == text_b) {
+        ret = 0; /* interned; no need to call strcmp() */
+    } else if (cinfo->col_fmt[col_num] == COL_CUSTOM) {
+        ret = compare_custom(text_a, text_b, col_num, cinfo);
+    } else {
+        ret = strcmp(text_a, text_b);
+    }
+    if (ret == 0)
+        ret = a->fdata->num - b->fdata->num;
+    return ret;
+}
@@ -31,6 +31,8 @@
 #include <epan/column_info.h>
 #include <epan/packet.h>
 
+#include "cfile.h"
+
 #include <QList>
 #include <QVariant>
 
@@ -38,28 +40,32 @@ class PacketListRecord
 {
 public:
     PacketListRecord(frame_data *frameData);
+    ~PacketListRecord();
     QVariant data(int col_num, column_info *cinfo) const;
     frame_data *getFdata();
+    bool isColumnized() const { return columnized; }
+    bool isColorized() const { return colorized; }
+    /** Dissect the frame, keeping the text of the columns that aren't
+     *  based on frame data in string_pool and/or setting its color filter. */
+    void dissect(capture_file *cap_file, GStringChunk *string_pool, bool dissect_columns, bool dissect_color);
+    /** Compare the values of a column as the GTK+ packet list does.
+     *  Both records must have been columnized unless the column is
+     *  based on frame data. */
+    static int compare(const PacketListRecord *a, const PacketListRecord *b, int col_num, column_info *cinfo);
 
 private:
-    /** The column text for some columns */
-    gchar **col_text;
-    /**< The length of the column text strings in 'col_text' */
-    guint *col_text_len;
+    /** The column text for columns that aren't based on frame data,
+     *  interned in the model's string pool or constant */
+    const gchar **col_text;
 
     frame_data *fdata;
 
     /** Has this record been columnized? */
-    gboolean columnized;
+    bool columnized;
     /** Has this record been colorized? */
-    gboolean colorized;
-
-    /* admin stuff used by the custom list model */
-    /** position within the physical array */
-    guint physical_pos;
-    /** position within the visible array */
-    gint visible_pos;
+    bool colorized;
 
+    void cacheColumnStrings(column_info *cinfo, GStringChunk *string_pool);
 };
 
 #endif // PACKET_LIST_RECORD_H
@@ -1410,6 +1410,23 @@ gboolean wtap_dump_set_addrinfo_list(wtap_dumper *wdh, struct addrinfo *addrinfo
 	return TRUE;
 }
 
+/* Size of the buffer of an uncompressed file we write; records are
+   written a few dozen bytes at a time, so collect them into large
+   writes.  Only regular files get it; a reader at the other end of a
+   pipe or a terminal should see records about as soon as they're
+   written, so those keep the default buffering. */
+#define WTAP_DUMP_BUFFER_SIZE (1024*1024)
+
+static FILE *wtap_dump_file_buffer(FILE *fp)
+{
+	ws_statb64 statb;
+
+	if (fp != NULL && ws_fstat64(fileno(fp), &statb) == 0 &&
+	    S_ISREG(statb.st_mode))
+		setvbuf(fp, NULL, _IOFBF, WTAP_DUMP_BUFFER_SIZE);
+	return fp;
+}
+
 /* internally open a file for writing (compressed or not) */
 #ifdef HAVE_LIBZ
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
@@ -1417,13 +1434,13 @@ static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 	if(wdh->compressed) {
 		return gzwfile_open(filename);
 	} else {
-		return ws_fopen(filename, "wb");
+		return wtap_dump_file_buffer(ws_fopen(filename, "wb"));
 	}
 }
 #else
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename)
 {
-	return ws_fopen(filename, "wb");
+	return wtap_dump_file_buffer(ws_fopen(filename, "wb"));
 }
 #endif
 
@@ -1434,13 +1451,13 @@ static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
 	if(wdh->compressed) {
 		return gzwfile_fdopen(fd);
 	} else {
-		return fdopen(fd, "wb");
+		return wtap_dump_file_buffer(fdopen(fd, "wb"));
 	}
 }
 #else
 static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh _U_, int fd)
 {
-	return fdopen(fd, "wb");
+	return wtap_dump_file_buffer(fdopen(fd, "wb"));
 }
 #endif
 
@@ -55,14 +55,60 @@
 #include <fcntl.h>
 #endif /* HAVE_FCNTL_H */
 #include <string.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <time.h>
+#endif
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
+#include <wsutil/shm_ring.h>
 
 #ifdef HAVE_LIBZ
 #include <zlib.h>
 #endif /* HAVE_LIBZ */
 
+/*
+ * Once we have a complete set of fast seek points for a gzipped file
+ * (from a frame index, see wtap_index.c), the stretches of compressed
+ * data between them can be inflated independently, so sequential reads
+ * hand that work to a pool of threads that inflate ahead of the reader.
+ * The threads read the file with pread(), so we don't do this on
+ * Windows.
+ */
+#if defined(HAVE_LIBZ) && !defined(_WIN32)
+#define PARALLEL_INFLATE
+
+/*
+ * One stretch of uncompressed data between two consecutive fast seek
+ * points, inflated by a worker thread.
+ */
+struct inflate_span {
+	guint index;            /* index of the seek point it starts at */
+	struct fast_seek_point *from, *to;
+	unsigned char *buf;
+	unsigned int size;      /* allocated size of buf */
+	unsigned int len;       /* to->out - from->out */
+	gboolean queued;        /* handed to the thread pool */
+	gboolean done;          /* inflated, or failed */
+	gboolean ok;
+};
+
+struct parallel_inflate {
+	int fd;
+	GThreadPool *pool;
+	GMutex *mtx;            /* protects "done" and "ok" of the spans */
+	GCond *cond;
+	guint nspans;
+	struct inflate_span *spans;     /* span i is in spans[i % nspans] */
+	guint first;            /* first span we still need */
+	unsigned char *cur;     /* buffer of the span being read */
+	gboolean stale;         /* strm is behind what we've handed out */
+	gboolean seeked;        /* strm was just set up for a seek */
+	gint64 raw_pos;         /* where the span being read ends in the file */
+};
+#endif
+
 /*
  * See RFC 1952 for a description of the gzip file format.
  *
@@ -139,6 +185,22 @@ struct wtap_reader {
 	/* fast seeking */
 	GPtrArray *fast_seek;
 	void *fast_seek_cur;
+#ifdef HAVE_MMAP
+	/* plain files mapped into memory */
+	unsigned char *map;     /* the mapping, or NULL if not mapped */
+	gint64 map_off;         /* offset in the file of the start of the mapping */
+	gint64 map_size;        /* size of the mapping, to the end of the file when it was made */
+#endif
+#ifdef PARALLEL_INFLATE
+	/* inflating in parallel */
+	guint par_threads;      /* threads to use, 0 if we shouldn't */
+	struct parallel_inflate *par;   /* set up when first needed */
+#endif
+#ifdef SHM_RING_SUPPORTED
+	/* a ring dumpcap is writing to, rather than a file */
+	shm_ring_t *ring;       /* the ring, or NULL if we're reading a file */
+	gboolean ring_random;   /* random access; leave releasing to the other stream */
+#endif
 };
 
 /* values for wtap_reader compression */
@@ -149,6 +211,217 @@ struct wtap_reader {
 #define GZIP_AFTER_HEADER 3
 #endif
 
+#ifdef HAVE_MMAP
+/*
+ * Uncompressed regular files are mapped into memory.  The output buffer
+ * then just points into the mapping, so that reading data doesn't take
+ * a read() call and a copy, seeking is pointer arithmetic rather than an
+ * lseek() call, and file_read_mapped() can hand out packet data without
+ * copying it at all.
+ *
+ * The mapping is private and writable, so that callers may modify data
+ * handed to them, as they could with a copy; nothing is written back to
+ * the file.  gz_head() drops the mapping if the file turns out to be
+ * compressed.
+ *
+ * Touching a page of a mapping past the end of a file that's been
+ * truncated gets a SIGBUS, so we only map files that nothing seems to be
+ * writing: ones that haven't been modified for MAP_STABLE_SECS.  Others,
+ * such as a capture that's still being written, are read with read().
+ * If a mapped file does turn out to have grown when we get to the end of
+ * the mapping, only the part from there on is mapped; if it's shrunk, we
+ * stop using the mapping and read the rest.
+ */
+#define MAP_WINDOW	G_GINT64_CONSTANT(1073741824)	/* "have" is only an unsigned */
+#define MAP_STABLE_SECS	2
+
+static void
+file_map(FILE_T state)
+{
+	ws_statb64 st;
+	void *map;
+
+	state->map = NULL;
+	state->map_off = 0;
+	state->map_size = 0;
+#ifdef SHM_RING_SUPPORTED
+	if (state->ring != NULL)
+		return;		/* already mapped */
+#endif
+	if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+	    st.st_size <= 0 || (guint64)st.st_size > G_MAXSIZE)
+		return;
+	if (time(NULL) - st.st_mtime < MAP_STABLE_SECS)
+		return;		/* may still be being written */
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+	    state->fd, 0);
+	if (map == MAP_FAILED)
+		return;		/* fall back on reading */
+	state->map = (unsigned char *)map;
+	state->map_size = st.st_size;
+}
+
+static void
+file_unmap(FILE_T state)
+{
+#ifdef SHM_RING_SUPPORTED
+	if (state->ring != NULL) {
+		shm_ring_detach(state->ring);
+		state->ring = NULL;
+	}
+#endif
+	if (state->map != NULL) {
+		munmap(state->map, (size_t)state->map_size);
+		state->map = NULL;
+		state->map_off = 0;
+		state->map_size = 0;
+	}
+}
+
+/*
+ * Stop using the mapping, and read the file from offset "off" on.
+ */
+static int
+file_map_drop(FILE_T state, gint64 off)
+{
+	file_unmap(state);
+	if (ws_lseek64(state->fd, off, SEEK_SET) == -1) {
+		state->err = errno;
+		state->err_info = NULL;
+		return -1;
+	}
+	state->raw_pos = off;
+	state->next = state->out;
+	state->have = 0;
+	state->avail_in = 0;
+	state->eof = 0;
+	return 0;
+}
+
+/*
+ * Make the output buffer the part of the mapping starting at file offset
+ * "off".  If that's not in the mapping, the file may have grown since we
+ * mapped it, or we may have seeked back to before the part we mapped
+ * last, so map the file from the page "off" is in to its end.
+ */
+static int
+file_map_from(FILE_T state, gint64 off)
+{
+	ws_statb64 st;
+	void *map;
+	gint64 map_off, len;
+
+	if (off < state->map_off || off >= state->map_off + state->map_size) {
+		if (ws_fstat64(state->fd, &st) == -1) {
+			state->err = errno;
+			state->err_info = NULL;
+			return -1;
+		}
+		if (st.st_size < state->map_off + state->map_size)
+			return file_map_drop(state, off);	/* truncated */
+		if (off > st.st_size)
+			off = st.st_size;
+		if (off == st.st_size) {
+			/* nothing more yet */
+			state->next = state->out;
+			state->have = 0;
+			state->raw_pos = off;
+			state->avail_in = 0;
+			state->eof = 1;
+			return 0;
+		}
+		map_off = off & ~(gint64)(sysconf(_SC_PAGESIZE) - 1);
+		len = st.st_size - map_off;
+		if ((guint64)len > G_MAXSIZE)
+			return file_map_drop(state, off);
+		map = mmap(NULL, (size_t)len, PROT_READ|PROT_WRITE,
+		    MAP_PRIVATE, state->fd, map_off);
+		if (map == MAP_FAILED)
+			return file_map_drop(state, off);
+		munmap(state->map, (size_t)state->map_size);
+		state->map = (unsigned char *)map;
+		state->map_off = map_off;
+		state->map_size = len;
+	}
+
+	len = state->map_off + state->map_size - off;
+	if (len > MAP_WINDOW)
+		len = MAP_WINDOW;
+	state->next = state->map + (off - state->map_off);
+	state->have = (unsigned)len;
+	state->raw_pos = off + len;
+	state->avail_in = 0;
+	state->eof = (state->raw_pos == state->map_off + state->map_size);
+	return 0;
+}
+#endif
+
+#ifdef SHM_RING_SUPPORTED
+/*
+ * A capture that dumpcap is handing us through a shared ring (see
+ * wsutil/shm_ring.h) is read much like a mapped file: the output buffer
+ * is whatever the writer has put in the ring past the current position,
+ * and the ring only ever holds uncompressed data.  Positions in the ring
+ * are just the low 32 bits of positions in the capture.
+ *
+ * What we've read is handed back to the writer when we next need more,
+ * except for the last quarter of the ring, so that callers can still
+ * seek back a little (wtap_open_offline() goes back to the start of the
+ * file after each open routine looks at the header, and data handed out
+ * by file_read_mapped() has to stay put until the next read).  Once the
+ * records are being read, wtap_read() hands back everything before the
+ * record it's read with file_release() straight away: the writer may be
+ * waiting for room in the middle of a record, and we may have stopped
+ * reading before it until we're told there's more, which the writer
+ * can't do until it has the room.
+ *
+ * A stream for random access only reads what's still there; the
+ * sequential stream decides what the writer gets back.
+ */
+static void
+file_ring_at(FILE_T state)
+{
+	guint32 pos = (guint32)state->pos;
+
+	state->next = shm_ring_ptr(state->ring, pos);
+	state->have = shm_ring_head(state->ring) - pos;
+	state->raw_pos = state->pos + state->have;
+	state->avail_in = 0;
+	state->eof = (state->have == 0);	/* nothing more yet, anyway */
+}
+
+static int
+file_ring_fill(FILE_T state)
+{
+	guint32 pos = (guint32)state->pos;
+	guint32 keep = shm_ring_size(state->ring) / 4;
+
+	if (!state->ring_random && pos - shm_ring_tail(state->ring) > keep)
+		shm_ring_release(state->ring, pos - keep);
+	file_ring_at(state);
+	return 0;
+}
+#endif
+
+/*
+ * Everything before "pos" in the stream has been used and won't be
+ * sought back to; if we're reading a ring, let the writer have it.
+ */
+void
+file_release(FILE_T stream _U_, gint64 pos _U_)
+{
+#ifdef SHM_RING_SUPPORTED
+	guint32 tail;
+
+	if (stream->ring == NULL || stream->ring_random)
+		return;
+	/* only ever forward, and not past where we are */
+	tail = shm_ring_tail(stream->ring);
+	if ((guint32)pos - tail <= (guint32)stream->pos - tail)
+		shm_ring_release(stream->ring, (guint32)pos);
+#endif
+}
+
 static int	/* gz_load */
 raw_read(FILE_T state, unsigned char *buf, unsigned int count, unsigned *have)
 {
@@ -589,6 +862,9 @@ gz_head(FILE_T state)
 			/* we have a gzip header, woo hoo! */
 			state->avail_in--;
 			state->next_in++;
+#ifdef HAVE_MMAP
+			file_unmap(state);
+#endif
 
 			/* read rest of header */
 
@@ -683,6 +959,13 @@ gz_head(FILE_T state)
 	   input to output -- this assumes that the output buffer is larger than
 	   the input buffer, which also assures space for gzungetc() */
 	state->raw = state->pos;
+#ifdef HAVE_MMAP
+	if (state->map != NULL) {
+		/* hand out the rest of the file from the mapping */
+		state->compression = UNCOMPRESSED;
+		return file_map_from(state, state->raw_pos - state->avail_in - state->have);
+	}
+#endif
 	state->next = state->out;
 	if (state->avail_in) {
 		memcpy(state->next + state->have, state->next_in, state->avail_in);
@@ -693,9 +976,405 @@ gz_head(FILE_T state)
 	return 0;
 }
 
+/*
+ * Set up to read from a fast seek point, for a seek to "target" in the
+ * uncompressed data.  Returns the position in the uncompressed data
+ * the stream is at afterwards, or -1 on error.
+ */
+static gint64
+fast_seek_restore(FILE_T file, struct fast_seek_point *here, gint64 target, int *err)
+{
+	gint64 off, off2;
+
+#ifdef HAVE_LIBZ
+	if (here->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+		off = here->in - (here->data.zlib.bits ? 1 : 0);
+#else
+		off = here->in;
+#endif
+		off2 = here->out;
+	} else if (here->compression == GZIP_AFTER_HEADER) {
+		off = here->in;
+		off2 = here->out;
+	} else
+#endif
+	{
+		off2 = target;
+		off = here->in + (off2 - here->out);
+	}
+
+	if (ws_lseek64(file->fd, off, SEEK_SET) == -1) {
+		*err = errno;
+		return -1;
+	}
+	fast_seek_reset(file);
+#ifdef PARALLEL_INFLATE
+	if (file->par != NULL) {
+		file->par->stale = FALSE;
+		file->par->seeked = TRUE;
+		file->par->cur = NULL;
+	}
+#endif
+
+	file->raw_pos = off;
+	file->have = 0;
+	file->next = file->out;	/* nothing to back up over */
+	file->eof = 0;
+	file->seek = 0;
+	file->err = 0;
+	file->err_info = NULL;
+	file->avail_in = 0;
+
+#ifdef HAVE_LIBZ
+	if (here->compression == ZLIB) {
+		z_stream *strm = &file->strm;
+
+		inflateReset(strm);
+		strm->adler = here->data.zlib.adler;
+		strm->total_out = here->data.zlib.total_out;
+#ifdef HAVE_INFLATEPRIME
+		if (here->data.zlib.bits) {
+			FILE_T state = file;
+			int ret = GZ_GETC();
+
+			if (ret == -1) {
+				if (state->err == 0) {
+					/* EOF */
+					*err = WTAP_ERR_SHORT_READ;
+				} else
+					*err = state->err;
+				return -1;
+			}
+			(void)inflatePrime(strm, here->data.zlib.bits, ret >> (8 - here->data.zlib.bits));
+		}
+#endif
+		(void)inflateSetDictionary(strm, here->data.zlib.window, ZLIB_WINSIZE);
+		file->compression = ZLIB;
+	} else if (here->compression == GZIP_AFTER_HEADER) {
+		z_stream *strm = &file->strm;
+
+		inflateReset(strm);
+		strm->adler = crc32(0L, Z_NULL, 0);
+		file->compression = ZLIB;
+	} else
+#endif
+		file->compression = here->compression;
+#ifdef HAVE_MMAP
+	/* a compressed file is never read through the mapping */
+	if (file->compression != UNCOMPRESSED)
+		file_unmap(file);
+#endif
+
+	return off2;
+}
+
+#ifdef PARALLEL_INFLATE
+/* Don't use spans that would tie up silly amounts of memory. */
+#define PARALLEL_MAX_SPAN	(64 * 1048576)
+#define PARALLEL_MAX_THREADS	8
+
+static gboolean
+inflate_span(int fd, struct inflate_span *span)
+{
+	unsigned char in[GZBUFSIZE * 4];
+	z_stream strm;
+	gint64 off;
+	ssize_t n;
+	int ret;
+	gboolean ok;
+
+	memset(&strm, 0, sizeof strm);
+	if (inflateInit2(&strm, -15) != Z_OK)	/* raw inflate */
+		return FALSE;
+
+	off = span->from->in;
+	if (span->from->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+		if (span->from->data.zlib.bits) {
+			unsigned char c;
+
+			if (pread(fd, &c, 1, (off_t)(off - 1)) != 1) {
+				inflateEnd(&strm);
+				return FALSE;
+			}
+			(void)inflatePrime(&strm, span->from->data.zlib.bits,
+			    c >> (8 - span->from->data.zlib.bits));
+		}
+#endif
+		(void)inflateSetDictionary(&strm, span->from->data.zlib.window, ZLIB_WINSIZE);
+	}
+
+	strm.next_out = span->buf;
+	strm.avail_out = span->len;
+	while (strm.avail_out != 0) {
+		if (strm.avail_in == 0) {
+			n = pread(fd, in, sizeof in, (off_t)off);
+			if (n <= 0)
+				break;
+			off += n;
+			strm.next_in = in;
+			strm.avail_in = (unsigned int)n;
+		}
+		ret = inflate(&strm, Z_NO_FLUSH);
+		/*
+		 * Z_STREAM_END before we have all of the span means it runs
+		 * into the next gzip member; the reader does that one itself.
+		 */
+		if (ret != Z_OK && !(ret == Z_BUF_ERROR && strm.avail_in == 0))
+			break;
+	}
+	ok = (strm.avail_out == 0);
+	inflateEnd(&strm);
+	return ok;
+}
+
+static void
+inflate_span_thread(gpointer data, gpointer user_data)
+{
+	struct inflate_span *span = (struct inflate_span *)data;
+	struct parallel_inflate *par = (struct parallel_inflate *)user_data;
+	gboolean ok;
+
+	ok = inflate_span(par->fd, span);
+
+	g_mutex_lock(par->mtx);
+	span->ok = ok;
+	span->done = TRUE;
+	g_cond_broadcast(par->cond);
+	g_mutex_unlock(par->mtx);
+}
+
+static void
+par_wait(struct parallel_inflate *par, struct inflate_span *span)
+{
+	g_mutex_lock(par->mtx);
+	while (!span->done)
+		g_cond_wait(par->cond, par->mtx);
+	g_mutex_unlock(par->mtx);
+}
+
+static void
+par_free(FILE_T state)
+{
+	struct parallel_inflate *par = state->par;
+	guint i;
+
+	if (par == NULL)
+		return;
+	/* let the threads finish what they've been given */
+	g_thread_pool_free(par->pool, FALSE, TRUE);
+	for (i = 0; i < par->nspans; i++)
+		g_free(par->spans[i].buf);
+	g_free(par->spans);
+#if GLIB_CHECK_VERSION(2,31,0)
+	g_mutex_clear(par->mtx);
+	g_free(par->mtx);
+	g_cond_clear(par->cond);
+	g_free(par->cond);
+#else
+	g_mutex_free(par->mtx);
+	g_cond_free(par->cond);
+#endif
+	g_free(par);
+	state->par = NULL;
+}
+
+static struct parallel_inflate *
+par_new(FILE_T state)
+{
+	struct parallel_inflate *par;
+
+	par = g_new0(struct parallel_inflate, 1);
+	par->fd = state->fd;
+#if GLIB_CHECK_VERSION(2,31,0)
+	par->mtx = g_new(GMutex, 1);
+	g_mutex_init(par->mtx);
+	par->cond = g_new(GCond, 1);
+	g_cond_init(par->cond);
+#else
+	par->mtx = g_mutex_new();
+	par->cond = g_cond_new();
+#endif
+	par->pool = g_thread_pool_new(inflate_span_thread, par,
+	    (gint)state->par_threads, FALSE, NULL);
+	if (par->pool == NULL) {
+		state->par = par;
+		par->spans = NULL;
+		par_free(state);
+		return NULL;
+	}
+	/* keep every thread busy, with as much again ready to go */
+	par->nspans = 2 * state->par_threads;
+	par->spans = g_new0(struct inflate_span, par->nspans);
+	return par;
+}
+
+/*
+ * Make sure the spans from "index" on are being inflated, forgetting
+ * about any spans before it.
+ */
+static void
+par_queue(FILE_T state, guint index)
+{
+	struct parallel_inflate *par = state->par;
+	struct inflate_span *span;
+	struct fast_seek_point *from, *to;
+	guint i;
+
+	if (index < par->first || index >= par->first + par->nspans) {
+		/* a seek; what's queued is of no use */
+		for (i = 0; i < par->nspans; i++) {
+			if (par->spans[i].queued) {
+				par_wait(par, &par->spans[i]);
+				par->spans[i].queued = FALSE;
+			}
+		}
+	}
+	par->first = index;
+
+	for (i = index; i < index + par->nspans && i + 1 < state->fast_seek->len; i++) {
+		span = &par->spans[i % par->nspans];
+		if (span->queued) {
+			if (span->index == i)
+				continue;
+			/* an old span we've finished with */
+			par_wait(par, span);
+		}
+		from = (struct fast_seek_point *)state->fast_seek->pdata[i];
+		to = (struct fast_seek_point *)state->fast_seek->pdata[i + 1];
+		if ((from->compression != ZLIB && from->compression != GZIP_AFTER_HEADER) ||
+		    to->out - from->out > PARALLEL_MAX_SPAN) {
+			span->queued = FALSE;
+			continue;
+		}
+		span->index = i;
+		span->from = from;
+		span->to = to;
+		span->len = (unsigned int)(to->out - from->out);
+		if (span->size < span->len) {
+			g_free(span->buf);
+			span->buf = (unsigned char *)g_malloc(span->len);
+			span->size = span->len;
+		}
+		span->done = FALSE;
+		span->ok = FALSE;
+		span->queued = TRUE;
+		g_thread_pool_push(par->pool, span, NULL);
+	}
+}
+
+/*
+ * Fill the output buffer from the inflate threads if we can.  Returns 0
+ * if it did, -1 on an error, and 1 if the caller should inflate
+ * serially; in that case *count is set to the most it may inflate, so
+ * that it stops where the threads can take over again.
+ */
+static int
+par_fill(FILE_T state, unsigned int *count)
+{
+	struct parallel_inflate *par;
+	struct fast_seek_point *here, *next;
+	struct inflate_span *span;
+	guint low, i, max;
+	int err;
+
+	if (state->fast_seek == NULL || state->fast_seek->len < 2)
+		return 1;
+
+	/* find the first seek point after where we are */
+	for (low = 0, max = state->fast_seek->len; low < max; ) {
+		i = (low + max) / 2;
+		if (((struct fast_seek_point *)state->fast_seek->pdata[i])->out <= state->pos)
+			low = i + 1;
+		else
+			max = i;
+	}
+	if (low == 0)
+		return 1;
+	i = low - 1;
+	here = (struct fast_seek_point *)state->fast_seek->pdata[i];
+
+	par = state->par;
+	if (low == state->fast_seek->len) {
+		/*
+		 * The rest of the file is after the last seek point; we
+		 * inflate that ourselves, so stop the threads, and pick up
+		 * where they left off.
+		 */
+		if (par != NULL) {
+			if (par->stale && fast_seek_restore(state, here, state->pos, &err) == -1) {
+				state->err = err;
+				return -1;
+			}
+			par_free(state);
+		}
+		return 1;
+	}
+	next = (struct fast_seek_point *)state->fast_seek->pdata[low];
+
+	if (here->out != state->pos) {
+		/*
+		 * We're part of the way through a span (we only get here
+		 * inflating serially); inflate to its end.
+		 */
+		if ((guint64)(next->out - state->pos) < *count)
+			*count = (unsigned int)(next->out - state->pos);
+		return 1;
+	}
+
+	if (par != NULL && par->seeked) {
+		/*
+		 * Don't start inflating ahead after a seek until the
+		 * reader shows it's reading sequentially, by getting to
+		 * the end of this span.
+		 */
+		par->seeked = FALSE;
+		if ((guint64)(next->out - state->pos) < *count)
+			*count = (unsigned int)(next->out - state->pos);
+		return 1;
+	}
+
+	if (par == NULL) {
+		par = state->par = par_new(state);
+		if (par == NULL) {
+			state->par_threads = 0;
+			return 1;
+		}
+	}
+	par_queue(state, i);
+	span = &par->spans[i % par->nspans];
+	if (span->queued && span->index == i)
+		par_wait(par, span);
+	if (!span->queued || span->index != i || !span->ok) {
+		/* do this span ourselves, from the right place */
+		if (par->stale) {
+			if (fast_seek_restore(state, here, state->pos, &err) == -1) {
+				state->err = err;
+				return -1;
+			}
+			par->seeked = FALSE;
+		}
+		if ((guint64)(next->out - state->pos) < *count)
+			*count = (unsigned int)(next->out - state->pos);
+		return 1;
+	}
+
+	state->next = par->cur = span->buf;
+	state->have = span->len;
+	par->stale = TRUE;
+	par->raw_pos = span->to->in;
+	return 0;
+}
+#endif
+
 static int /* gz_make */
 fill_out_buffer(FILE_T state)
 {
+#ifdef PARALLEL_INFLATE
+	if (state->par != NULL)
+		state->par->cur = NULL;
+#endif
 	if (state->compression == UNKNOWN) {           /* look for gzip header */
 		if (gz_head(state) == -1)
 			return -1;
@@ -703,13 +1382,30 @@ fill_out_buffer(FILE_T state)
 			return 0;
 	}
 	if (state->compression == UNCOMPRESSED) {           /* straight copy */
+#ifdef SHM_RING_SUPPORTED
+		if (state->ring != NULL)
+			return file_ring_fill(state);
+#endif
+#ifdef HAVE_MMAP
+		if (state->map != NULL)
+			return file_map_from(state, state->raw_pos);
+#endif
 		if (raw_read(state, state->out, state->size /* << 1 */, &(state->have)) == -1)
 			return -1;
 		state->next = state->out;
 	}
 #ifdef HAVE_LIBZ
 	else if (state->compression == ZLIB) {      /* decompress */
-		zlib_read(state, state->out, state->size << 1);
+		unsigned int count = state->size << 1;
+#ifdef PARALLEL_INFLATE
+		if (state->par_threads != 0) {
+			int ret = par_fill(state, &count);
+
+			if (ret != 1)
+				return ret;
+		}
+#endif
+		zlib_read(state, state->out, count);
 	}
 #endif
 	return 0;
@@ -784,6 +1480,10 @@ file_fdopen(int fd)
 
 	state->fast_seek_cur = NULL;
 	state->fast_seek = NULL;
+#ifdef PARALLEL_INFLATE
+	state->par_threads = 0;
+	state->par = NULL;
+#endif
 
 	/* open the file with the appropriate mode (or just use fd) */
 	state->fd = fd;
@@ -799,6 +1499,25 @@ file_fdopen(int fd)
 	/* initialize stream */
 	gz_reset(state);
 
+#ifdef SHM_RING_SUPPORTED
+	state->ring = NULL;
+	state->ring_random = FALSE;
+	if (shm_ring_fd_is_ring(fd)) {
+		int err;
+
+		state->ring = shm_ring_attach(fd, FALSE, &err);
+		if (state->ring == NULL) {
+			g_free(state);
+			errno = err;
+			return NULL;
+		}
+		state->compression = UNCOMPRESSED;
+	}
+#endif
+#ifdef HAVE_MMAP
+	file_map(state);
+#endif
+
 #ifdef _STATBUF_ST_BLKSIZE
 	if (fstat(fd, &st) >= 0) {
 		want = st.st_blksize;
@@ -811,6 +1530,9 @@ file_fdopen(int fd)
 	state->out = (unsigned char *)g_try_malloc(want << 1);
 	state->size = want;
 	if (state->in == NULL || state->out == NULL) {
+#ifdef HAVE_MMAP
+		file_unmap(state);
+#endif
 		g_free(state->out);
 		g_free(state->in);
 		g_free(state);
@@ -826,6 +1548,9 @@ file_fdopen(int fd)
 	state->strm.avail_in = 0;
 	state->strm.next_in = Z_NULL;
 	if (inflateInit2(&(state->strm), -15) != Z_OK) {    /* raw inflate */
+#ifdef HAVE_MMAP
+		file_unmap(state);
+#endif
 		g_free(state->out);
 		g_free(state->in);
 		g_free(state);
@@ -861,6 +1586,18 @@ file_open(const char *path)
 	if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
 		return NULL;
 
+#ifdef SHM_RING_SUPPORTED
+	/*
+	 * If it's a ring that dumpcap is writing to, we have to tell
+	 * dumpcap how far we've read, so we need to be able to write it.
+	 */
+	if (shm_ring_fd_is_ring(fd)) {
+		ws_close(fd);
+		if ((fd = ws_open(path, O_RDWR|O_BINARY, 0000)) == -1)
+			return NULL;
+	}
+#endif
+
 	/* open file handle */
 	ft = file_fdopen(fd);
 	if (ft == NULL) {
@@ -896,6 +1633,151 @@ void
 file_set_random_access(FILE_T stream, gboolean random _U_, GPtrArray *seek)
 {
 	stream->fast_seek = seek;
+#ifdef SHM_RING_SUPPORTED
+	stream->ring_random = random;
+#endif
+}
+
+/*
+ * Have a stream opened for sequential access only record fast seek
+ * points from now on, as random access streams do, so that they can be
+ * saved in a frame index.  They're only of use if they go all the way
+ * back to the start of the compressed data, so if we've already read
+ * some of it while opening the file, we go back to the beginning and
+ * skip to where we were; that inflates what we've read again, but that
+ * isn't much.
+ */
+int
+file_record_fast_seek(FILE_T stream, GPtrArray *seek, int *err)
+{
+	gint64 pos;
+
+	if (stream->fast_seek != NULL)
+		return 0;
+	stream->fast_seek = seek;
+
+	switch (stream->compression) {
+
+	case UNKNOWN:
+		/* gz_head() hasn't been called yet; it'll start them */
+		return 0;
+
+	case UNCOMPRESSED:
+		/* there's only the one, where the raw data starts */
+		fast_seek_header(stream, stream->start + stream->raw, stream->raw, UNCOMPRESSED);
+		return 0;
+	}
+
+	pos = stream->seek ? stream->pos + stream->skip : stream->pos;
+	if (ws_lseek64(stream->fd, stream->start, SEEK_SET) == -1) {
+		*err = errno;
+		stream->fast_seek = NULL;
+		return -1;
+	}
+	stream->raw_pos = stream->start;
+	gz_reset(stream);
+	stream->next = stream->out;	/* nothing to back up over */
+	if (pos != 0) {
+		stream->seek = 1;
+		stream->skip = pos;
+	}
+	return 0;
+}
+
+/*
+ * Tell the OS that we're going to read all of the file from start to
+ * end, so that it reads further ahead of us.
+ */
+void
+file_advise_sequential(FILE_T stream _U_)
+{
+#ifdef HAVE_POSIX_FADVISE
+	(void)posix_fadvise(stream->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+/*
+ * Inflate gzipped data with a pool of threads, working ahead of the
+ * reader between the fast seek points; only worth doing once the seek
+ * points cover the whole file.  Returns FALSE if we can't.
+ */
+gboolean
+file_set_parallel_inflate(FILE_T stream _U_)
+{
+#ifdef PARALLEL_INFLATE
+	long ncpus = 0;
+
+#if !GLIB_CHECK_VERSION(2,31,0)
+	if (!g_thread_supported())
+		return FALSE;
+#endif
+	if (stream->fast_seek == NULL)
+		return FALSE;
+#ifdef _SC_NPROCESSORS_ONLN
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (ncpus < 2)
+		return FALSE;
+	stream->par_threads = (guint)MIN(ncpus, PARALLEL_MAX_THREADS);
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+/*
+ * Fast seek points are saved verbatim in frame index sidecar files (see
+ * wtap_index.c), so that reopening a compressed file doesn't require
+ * decompressing all of it again before random access is cheap.  The
+ * on-disk record is the in-memory structure, so the size is recorded
+ * in the index header and checked before loading.
+ */
+guint
+file_fast_seek_point_size(void)
+{
+	return (guint) sizeof(struct fast_seek_point);
+}
+
+gboolean
+file_fast_seek_write(GPtrArray *seek, FILE *fp)
+{
+	guint i;
+
+	if (seek == NULL)
+		return TRUE;
+	for (i = 0; i < seek->len; i++) {
+		if (fwrite(seek->pdata[i], sizeof(struct fast_seek_point), 1, fp) != 1)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+gboolean
+file_fast_seek_load(GPtrArray *seek, const guint8 *data, guint count)
+{
+	struct fast_seek_point *val;
+	guint i;
+
+	if (seek == NULL)
+		return FALSE;
+	if (count == 0)
+		return TRUE;
+
+	/*
+	 * Opening the file has already recorded the point after the gzip
+	 * header, and perhaps a few more; they're for the same file as the
+	 * ones we're loading, which start with them, so just replace them,
+	 * keeping the points sorted.
+	 */
+	for (i = 0; i < seek->len; i++)
+		g_free(seek->pdata[i]);
+	g_ptr_array_set_size(seek, 0);
+	for (i = 0; i < count; i++) {
+		val = g_new(struct fast_seek_point, 1);
+		memcpy(val, data + (gsize)i * sizeof(struct fast_seek_point), sizeof(struct fast_seek_point));
+		g_ptr_array_add(seek, val);
+	}
+	return TRUE;
 }
 
 gint64
@@ -920,13 +1802,64 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 		offset += file->skip;
 	file->seek = 0;
 
+#ifdef SHM_RING_SUPPORTED
+	if (file->ring != NULL) {
+		guint32 avail;
+
+		/* the writer may have reused anything before the tail */
+		if (offset < 0 && (file->pos + offset < 0 || -offset >
+		    (gint64)((guint32)file->pos - shm_ring_tail(file->ring)))) {
+			*err = EINVAL;
+			return -1;
+		}
+		file->err = 0;
+		file->err_info = NULL;
+		avail = shm_ring_head(file->ring) - (guint32)file->pos;
+		if (offset > (gint64)avail) {
+			/* skip the rest once it's been written */
+			file->pos += avail;
+			file->have = 0;
+			file->eof = 0;
+			file->seek = 1;
+			file->skip = offset - avail;
+			return file->pos + file->skip;
+		}
+		file->pos += offset;
+		file_ring_at(file);
+		return file->pos;
+	}
+#endif
+#ifdef HAVE_MMAP
+	if (file->map != NULL && file->compression == UNCOMPRESSED) {
+		if (file->pos + offset < 0) {	/* before start of file! */
+			*err = EINVAL;
+			return -1;
+		}
+		file->err = 0;
+		file->err_info = NULL;
+		if (file_map_from(file, file->start + file->pos + offset) == -1) {
+			*err = file->err;
+			return -1;
+		}
+		file->pos += offset;
+		return file->pos;
+	}
+#endif
+
 	if (offset < 0 && file->next) {
 		/*
 		 * This is guaranteed to fit in an unsigned int.
 		 * To squelch compiler warnings, we cast the
 		 * result.
 		 */
-		unsigned had = (unsigned)(file->next - file->out);
+		unsigned had;
+
+#ifdef PARALLEL_INFLATE
+		if (file->par != NULL && file->par->cur != NULL)
+			had = (unsigned)(file->next - file->par->cur);
+		else
+#endif
+			had = (unsigned)(file->next - file->out);
 		if (-offset <= had) {
 			/*
 			 * Offset is negative, so -offset is
@@ -950,74 +1883,11 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 
 	/* XXX, profile */
 	if ((here = fast_seek_find(file, file->pos + offset)) && (offset < 0 || offset > SPAN || here->compression == UNCOMPRESSED)) {
-		gint64 off, off2;
-
-#ifdef HAVE_LIBZ
-		if (here->compression == ZLIB) {
-#ifdef HAVE_INFLATEPRIME
-			off = here->in - (here->data.zlib.bits ? 1 : 0);
-#else
-			off = here->in;
-#endif
-			off2 = here->out;
-		} else if (here->compression == GZIP_AFTER_HEADER) {
-			off = here->in;
-			off2 = here->out;
-		} else
-#endif
-		{
-			off2 = (file->pos + offset);
-			off = here->in + (off2 - here->out);
-		}
+		gint64 off2;
 
-		if (ws_lseek64(file->fd, off, SEEK_SET) == -1) {
-			*err = errno;
+		off2 = fast_seek_restore(file, here, file->pos + offset, err);
+		if (off2 == -1)
 			return -1;
-		}
-		fast_seek_reset(file);
-
-		file->raw_pos = off;
-		file->have = 0;
-		file->eof = 0;
-		file->seek = 0;
-		file->err = 0;
-		file->err_info = NULL;
-		file->avail_in = 0;
-
-#ifdef HAVE_LIBZ
-		if (here->compression == ZLIB) {
-			z_stream *strm = &file->strm;
-
-			inflateReset(strm);
-			strm->adler = here->data.zlib.adler;
-			strm->total_out = here->data.zlib.total_out;
-#ifdef HAVE_INFLATEPRIME
-			if (here->data.zlib.bits) {
-				FILE_T state = file;
-				int ret = GZ_GETC();
-
-				if (ret == -1) {
-					if (state->err == 0) {
-						/* EOF */
-						*err = WTAP_ERR_SHORT_READ;
-					} else
-						*err = state->err;
-					return -1;
-				}
-				(void)inflatePrime(strm, here->data.zlib.bits, ret >> (8 - here->data.zlib.bits));
-			}
-#endif
-			(void)inflateSetDictionary(strm, here->data.zlib.window, ZLIB_WINSIZE);
-			file->compression = ZLIB;
-		} else if (here->compression == GZIP_AFTER_HEADER) {
-			z_stream *strm = &file->strm;
-
-			inflateReset(strm);
-			strm->adler = crc32(0L, Z_NULL, 0);
-			file->compression = ZLIB;
-		} else
-#endif
-			file->compression = here->compression;
 
 		offset = (file->pos + offset) - off2;
 		file->pos = off2;
@@ -1064,8 +1934,16 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 			return -1;
 		}
 		fast_seek_reset(file);
+#ifdef PARALLEL_INFLATE
+		if (file->par != NULL) {
+			file->par->stale = FALSE;
+			file->par->seeked = TRUE;
+			file->par->cur = NULL;
+		}
+#endif
 		file->raw_pos = file->start;
 		gz_reset(file);
+		file->next = file->out;	/* nothing to back up over */
 	}
 
 	/* skip what's in output buffer (one less gzgetc() check) */
@@ -1106,6 +1984,20 @@ file_tell(FILE_T stream)
 gint64
 file_tell_raw(FILE_T stream)
 {
+#ifdef SHM_RING_SUPPORTED
+	if (stream->ring != NULL)
+		return stream->pos;
+#endif
+#ifdef HAVE_MMAP
+	/* raw_pos is the end of the mapped window, not how far we've got */
+	if (stream->map != NULL && stream->compression == UNCOMPRESSED)
+		return stream->raw_pos - stream->have;
+#endif
+#ifdef PARALLEL_INFLATE
+	/* the threads are reading ahead; report where the reader is */
+	if (stream->par != NULL && stream->par->stale)
+		return stream->par->raw_pos;
+#endif
 	return stream->raw_pos;
 }
 
@@ -1184,6 +2076,57 @@ file_read(void *buf, unsigned int len, FILE_T file)
 	return (int)got;
 }
 
+/*
+ * If the file is mapped, return a pointer to the next "len" bytes of it
+ * and skip past them, rather than copying them as file_read() does.  The
+ * data stays valid until the next read from, or seek on, the file.
+ * Returns NULL if the file isn't mapped or the data isn't all there;
+ * use file_read() then, which also reports any error.
+ */
+guint8 *
+file_read_mapped(FILE_T file, unsigned int len)
+{
+#ifdef HAVE_MMAP
+	unsigned char *p;
+	gboolean in_memory = (file->map != NULL);
+
+#ifdef SHM_RING_SUPPORTED
+	if (file->ring != NULL)
+		in_memory = TRUE;
+#endif
+	if (!in_memory || file->compression != UNCOMPRESSED || file->err)
+		return NULL;
+
+	/* process a skip request */
+	if (file->seek) {
+		file->seek = 0;
+		if (gz_skip(file, file->skip) == -1)
+			return NULL;
+	}
+
+	/* the data may straddle the end of the mapped window */
+	if (file->have < len) {
+#ifdef SHM_RING_SUPPORTED
+		if (file->ring != NULL)
+			file_ring_fill(file);
+		else
+#endif
+		if (file_map_from(file, file->raw_pos - file->have) == -1)
+			return NULL;
+	}
+	if (file->have < len)
+		return NULL;
+
+	p = file->next;
+	file->next += len;
+	file->have -= len;
+	file->pos += len;
+	return p;
+#else
+	return NULL;
+#endif
+}
+
 int
 file_getc(FILE_T file)
 {
@@ -1307,6 +2250,10 @@ file_clearerr(FILE_T stream)
 void
 file_fdclose(FILE_T file)
 {
+#ifdef PARALLEL_INFLATE
+	par_free(file);
+	file->par_threads = 0;
+#endif
 	ws_close(file->fd);
 	file->fd = -1;
 }
@@ -1318,6 +2265,13 @@ file_fdreopen(FILE_T file, const char *path)
 
 	if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
 		return FALSE;
+#ifdef PARALLEL_INFLATE
+	/* the threads read the old file descriptor */
+	if (file->par != NULL) {
+		par_free(file);
+		file->par_threads = 0;
+	}
+#endif
 	file->fd = fd;
 	return TRUE;
 }
@@ -1327,6 +2281,9 @@ file_close(FILE_T file)
 {
 	int fd = file->fd;
 
+#ifdef PARALLEL_INFLATE
+	par_free(file);
+#endif
 	/* free memory and close file */
 	if (file->size) {
 #ifdef HAVE_LIBZ
@@ -1335,6 +2292,9 @@ file_close(FILE_T file)
 		g_free(file->out);
 		g_free(file->in);
 	}
+#ifdef HAVE_MMAP
+	file_unmap(file);
+#endif
 	g_free(file->fast_seek_cur);
 	file->err = 0;
 	file->err_info = NULL;
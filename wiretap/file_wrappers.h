@@ -23,6 +23,7 @@
 #ifndef __FILE_H__
 #define __FILE_H__
 
+#include <stdio.h>
 #include <glib.h>
 #include <wtap.h>
 #include <wsutil/file_util.h>
@@ -30,13 +31,21 @@
 extern FILE_T file_open(const char *path);
 extern FILE_T file_fdopen(int fildes);
 extern void file_set_random_access(FILE_T stream, gboolean random, GPtrArray *seek);
+extern int file_record_fast_seek(FILE_T stream, GPtrArray *seek, int *err);
+extern gboolean file_set_parallel_inflate(FILE_T stream);
+extern void file_advise_sequential(FILE_T stream);
+extern guint file_fast_seek_point_size(void);
+extern gboolean file_fast_seek_write(GPtrArray *seek, FILE *fp);
+extern gboolean file_fast_seek_load(GPtrArray *seek, const guint8 *data, guint count);
 extern gint64 file_seek(FILE_T stream, gint64 offset, int whence, int *err);
 extern gint64 file_skip(FILE_T file, gint64 delta, int *err);
 extern gint64 file_tell(FILE_T stream);
 extern gint64 file_tell_raw(FILE_T stream);
+extern void file_release(FILE_T stream, gint64 pos);
 extern int file_fstat(FILE_T stream, ws_statb64 *statb, int *err);
 extern gboolean file_iscompressed(FILE_T stream);
 extern int file_read(void *buf, unsigned int count, FILE_T file);
+extern guint8 *file_read_mapped(FILE_T file, unsigned int len);
 extern int file_getc(FILE_T stream);
 extern char *file_gets(char *buf, int len, FILE_T stream);
 extern int file_eof(FILE_T stream);
@@ -663,10 +663,20 @@ static gboolean libpcap_read(wtap *wth, int *err, gchar **err_info,
 	orig_size -= phdr_len;
 	packet_size -= phdr_len;
 
-	buffer_assure_space(wth->frame_buffer, packet_size);
-	if (!libpcap_read_rec_data(wth->fh, buffer_start_ptr(wth->frame_buffer),
-	    packet_size, err, err_info))
-		return FALSE;	/* Read error */
+	/*
+	 * If the file is mapped, use the packet data where it is, unless
+	 * we'd have to fix it up.
+	 */
+	if (!pcap_read_post_process_writes(wth->file_encap,
+	    libpcap->byte_swapped))
+		wth->frame_ptr = file_read_mapped(wth->fh, packet_size);
+	if (wth->frame_ptr == NULL) {
+		buffer_assure_space(wth->frame_buffer, packet_size);
+		if (!libpcap_read_rec_data(wth->fh,
+		    buffer_start_ptr(wth->frame_buffer), packet_size, err,
+		    err_info))
+			return FALSE;	/* Read error */
+	}
 
 	wth->phdr.presence_flags = WTAP_HAS_TS|WTAP_HAS_CAP_LEN;
 
@@ -687,7 +697,7 @@ static gboolean libpcap_read(wtap *wth, int *err, gchar **err_info,
 	wth->phdr.len = orig_size;
 
 	pcap_read_post_process(wth->file_type, wth->file_encap,
-	    &wth->pseudo_header, buffer_start_ptr(wth->frame_buffer),
+	    &wth->pseudo_header, wtap_buf_ptr(wth),
 	    wth->phdr.caplen, libpcap->byte_swapped, -1);
 	return TRUE;
 }
@@ -1747,6 +1747,26 @@ pcap_read_post_process(int file_type, int wtap_encap,
 	}
 }
 
+/*
+ * Returns TRUE if pcap_read_post_process() may rewrite the packet data,
+ * in which case the data must be read into a buffer of our own rather
+ * than used in place in a mapped file; reading the same packet again
+ * would otherwise fix it up twice.
+ */
+gboolean
+pcap_read_post_process_writes(int wtap_encap, gboolean bytes_swapped)
+{
+	switch (wtap_encap) {
+
+	case WTAP_ENCAP_USB_LINUX:
+	case WTAP_ENCAP_USB_LINUX_MMAPPED:
+		return bytes_swapped;
+
+	default:
+		return FALSE;
+	}
+}
+
 int
 pcap_get_phdr_size(int encap, const union wtap_pseudo_header *pseudo_header)
 {
@@ -38,6 +38,9 @@ extern void pcap_read_post_process(int file_type, int wtap_encap,
     union wtap_pseudo_header *pseudo_header,
     guint8 *pd, guint packet_size, gboolean bytes_swapped, int fcs_len);
 
+extern gboolean pcap_read_post_process_writes(int wtap_encap,
+    gboolean bytes_swapped);
+
 extern int pcap_get_phdr_size(int encap,
     const union wtap_pseudo_header *pseudo_header);
 
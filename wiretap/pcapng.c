@@ -370,6 +370,7 @@ typedef struct wtapng_block_s {
         const union wtap_pseudo_header *pseudo_header;
         struct wtap_pkthdr *packet_header;
         const guint8 *frame_buffer;
+        guint8 **frame_ptr;     /* if not NULL, where to point at the packet data in a mapped file instead of copying it to frame_buffer */
         int *file_encap;
 } wtapng_block_t;
 
@@ -911,6 +912,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
         int pseudo_header_len;
         char *option_content = NULL; /* Allocate as large as the options block */
         int fcslen;
+        guint8 *data;
 
         /* "(Enhanced) Packet Block" read fixed part */
         errno = WTAP_ERR_CANT_READ;
@@ -1094,7 +1096,15 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
 
         /* "(Enhanced) Packet Block" read capture data */
         errno = WTAP_ERR_CANT_READ;
-        bytes_read = file_read((guint8 *) (wblock->frame_buffer), wblock->data.packet.cap_len - pseudo_header_len, fh);
+        data = (guint8 *) (wblock->frame_buffer);
+        if (wblock->frame_ptr != NULL &&
+            !pcap_read_post_process_writes(int_data.wtap_encap, pn->byte_swapped) &&
+            (*wblock->frame_ptr = file_read_mapped(fh, wblock->data.packet.cap_len - pseudo_header_len)) != NULL) {
+                /* use it in place in the mapped file */
+                data = *wblock->frame_ptr;
+                bytes_read = (int) (wblock->data.packet.cap_len - pseudo_header_len);
+        } else
+                bytes_read = file_read(data, wblock->data.packet.cap_len - pseudo_header_len, fh);
         if (bytes_read != (int) (wblock->data.packet.cap_len - pseudo_header_len)) {
                 *err = file_error(fh, err_info);
                 pcapng_debug1("pcapng_read_packet_block: couldn't read %u bytes of captured data",
@@ -1215,7 +1225,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
 
         pcap_read_post_process(WTAP_FILE_PCAPNG, int_data.wtap_encap,
             (union wtap_pseudo_header *)wblock->pseudo_header,
-            (guint8 *) (wblock->frame_buffer),
+            data,
             (int) (wblock->data.packet.cap_len - pseudo_header_len),
             pn->byte_swapped, fcslen);
         return block_read;
@@ -1231,6 +1241,7 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
         interface_data_t int_data;
         int pseudo_header_len;
         pcapng_simple_packet_block_t spb;
+        guint8 *data;
 
         /*
          * Is this block long enough to be an SPB?
@@ -1321,7 +1332,15 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
 
         /* "Simple Packet Block" read capture data */
         errno = WTAP_ERR_CANT_READ;
-        bytes_read = file_read((guint8 *) (wblock->frame_buffer), wblock->data.simple_packet.cap_len, fh);
+        data = (guint8 *) (wblock->frame_buffer);
+        if (wblock->frame_ptr != NULL &&
+            !pcap_read_post_process_writes(int_data.wtap_encap, pn->byte_swapped) &&
+            (*wblock->frame_ptr = file_read_mapped(fh, wblock->data.simple_packet.cap_len)) != NULL) {
+                /* use it in place in the mapped file */
+                data = *wblock->frame_ptr;
+                bytes_read = (int) wblock->data.simple_packet.cap_len;
+        } else
+                bytes_read = file_read(data, wblock->data.simple_packet.cap_len, fh);
         if (bytes_read != (int) wblock->data.simple_packet.cap_len) {
                 *err = file_error(fh, err_info);
                 pcapng_debug1("pcapng_read_simple_packet_block: couldn't read %u bytes of captured data",
@@ -1345,7 +1364,7 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
 
         pcap_read_post_process(WTAP_FILE_PCAPNG, int_data.wtap_encap,
             (union wtap_pseudo_header *)wblock->pseudo_header,
-            (guint8 *) (wblock->frame_buffer),
+            data,
             (int) wblock->data.simple_packet.cap_len,
             pn->byte_swapped, pn->if_fcslen);
         return block_read;
@@ -2000,6 +2019,7 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
 
         /* we don't expect any packet blocks yet */
         wblock.frame_buffer = NULL;
+        wblock.frame_ptr = NULL;
         wblock.pseudo_header = NULL;
         wblock.packet_header = NULL;
         wblock.file_encap = &wth->file_encap;
@@ -2149,7 +2169,6 @@ pcapng_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
         pcapng_t *pcapng = (pcapng_t *)wth->priv;
         int bytes_read;
         wtapng_block_t wblock;
-        wtapng_if_descr_t *wtapng_if_descr;
         wtapng_if_stats_t if_stats;
 
         *data_offset = file_tell(wth->fh);
@@ -2165,6 +2184,7 @@ pcapng_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
         }
 
         wblock.frame_buffer  = buffer_start_ptr(wth->frame_buffer);
+        wblock.frame_ptr     = &wth->frame_ptr;
         wblock.pseudo_header = &wth->pseudo_header;
         wblock.packet_header = &wth->phdr;
         wblock.file_encap    = &wth->file_encap;
@@ -2189,17 +2209,9 @@ pcapng_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
                     pcapng_debug0("pcapng_read: block type BLOCK_TYPE_ISB");
                     *data_offset += bytes_read;
                     pcapng_debug1("pcapng_read: *data_offset is updated to %" G_GINT64_MODIFIER "d", *data_offset);
-                    if (wth->number_of_interfaces < wblock.data.if_stats.interface_id) {
-                        pcapng_debug1("pcapng_read: BLOCK_TYPE_ISB wblock.if_stats.interface_id %u > number_of_interfaces", wblock.data.if_stats.interface_id);
+                    if (wth->number_of_interfaces <= wblock.data.if_stats.interface_id) {
+                        pcapng_debug1("pcapng_read: BLOCK_TYPE_ISB wblock.if_stats.interface_id %u >= number_of_interfaces", wblock.data.if_stats.interface_id);
                     } else {
-                        /* Get the interface description */
-                        wtapng_if_descr = &g_array_index(wth->interface_data, wtapng_if_descr_t, wblock.data.if_stats.interface_id);
-                        if (wtapng_if_descr->num_stat_entries == 0) {
-                            /* First ISB found, no previous entry */
-                            pcapng_debug0("pcapng_read: block type BLOCK_TYPE_ISB. First ISB found, no previous entry");
-                            wtapng_if_descr->interface_statistics = g_array_new(FALSE, FALSE, sizeof(wtapng_if_stats_t));
-                        }
-
                         if_stats.interface_id       = wblock.data.if_stats.interface_id;
                         if_stats.ts_high            = wblock.data.if_stats.ts_high;
                         if_stats.ts_low             = wblock.data.if_stats.ts_low;
@@ -2213,8 +2225,8 @@ pcapng_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
                         if_stats.isb_osdrop         = wblock.data.if_stats.isb_osdrop;
                         if_stats.isb_usrdeliv       = wblock.data.if_stats.isb_usrdeliv;
 
-                        g_array_append_val(wtapng_if_descr->interface_statistics, if_stats);
-                        wtapng_if_descr->num_stat_entries++;
+                        /* This may be on the thread reading ahead */
+                        wtap_add_if_stats(wth, &if_stats);
                     }
                 } else {
                     /* XXX - improve handling of "unknown" blocks */
@@ -2261,6 +2273,7 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
         pcapng_debug1("pcapng_seek_read: reading at offset %" G_GINT64_MODIFIER "u", seek_off);
 
         wblock.frame_buffer = pd;
+        wblock.frame_ptr = NULL;
         wblock.pseudo_header = pseudo_header;
         wblock.packet_header = &wth->phdr;
         wblock.file_encap = &wth->file_encap;
@@ -3497,6 +3510,7 @@ pcapng_dump_open(wtap_dumper *wdh, int *err)
 
                 /* write the interface description block */
                 wblock.frame_buffer            = NULL;
+                wblock.frame_ptr               = NULL;
                 wblock.pseudo_header           = NULL;
                 wblock.packet_header           = NULL;
                 wblock.file_encap              = NULL;
@@ -40,6 +40,18 @@
 #include "wtap.h"
 
 int wtap_fstat(wtap *wth, ws_statb64 *statb, int *err);
+void wtap_index_add(wtap *wth, gint64 data_offset);
+void wtap_index_free(wtap *wth);
+gboolean wtap_read_record(wtap *wth, int *err, gchar **err_info, gint64 *data_offset);
+gboolean wtap_prefetch_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset);
+struct wtap_pkthdr *wtap_prefetch_phdr(wtap *wth);
+union wtap_pseudo_header *wtap_prefetch_pseudoheader(wtap *wth);
+guint8 *wtap_prefetch_buf_ptr(wtap *wth);
+gint64 wtap_prefetch_read_so_far(wtap *wth);
+void wtap_prefetch_stop(wtap *wth);
+gboolean wtap_prefetch_defer_if_stats(wtap *wth, const wtapng_if_stats_t *if_stats);
+void wtap_add_if_stats(wtap *wth, const wtapng_if_stats_t *if_stats);
+void wtap_apply_if_stats(wtap *wth, const wtapng_if_stats_t *if_stats);
 
 typedef gboolean (*subtype_read_func)(struct wtap*, int*, char**, gint64*);
 typedef gboolean (*subtype_seek_read_func)(struct wtap*, gint64, union wtap_pseudo_header*,
@@ -53,6 +65,7 @@ struct wtap {
     int                         file_type;
     guint                       snapshot_length;
     struct Buffer               *frame_buffer;
+    guint8                      *frame_ptr;    /**< data of the packet wtap_read() just read, if it's in a mapped file rather than frame_buffer */
     struct wtap_pkthdr          phdr;
     struct wtapng_section_s     shb_hdr;
     guint                       number_of_interfaces;   /**< The number of interfaces a capture was made on, number of IDB:s in a pcapng file or equivalent(?)*/
@@ -76,6 +89,12 @@ struct wtap {
     wtap_new_ipv4_callback_t    add_new_ipv4;
     wtap_new_ipv6_callback_t    add_new_ipv6;
     GPtrArray                   *fast_seek;
+    GArray                      *index_recs;   /**< frame index being built by wtap_read(), see wtap_index.c */
+    gboolean                    index_unusable; /**< frame index can't describe this file */
+    guint                       index_number_of_interfaces; /**< interfaces known when the index was started */
+    GMappedFile                 *index_map;    /**< frame index loaded from a sidecar file */
+    struct wtap_prefetch        *prefetch;     /**< reading ahead on another thread, see wtap_prefetch.c */
+    struct wtap_prefetch_rec    *prefetch_rec; /**< record wtap_read() last handed out from it */
 };
 
 struct wtap_dumper;
@@ -707,6 +707,37 @@ wtap_strerror(int err)
 		return g_strerror(err);
 }
 
+/*
+ * Add interface statistics that a file type's read routine came across
+ * to the interface they're for.  If the file's being read ahead, that's
+ * on the prefetch thread, while the caller may be looking at the
+ * interfaces, so they're handed to the caller's side to add when it gets
+ * to them; see wtap_prefetch.c.
+ */
+void
+wtap_add_if_stats(wtap *wth, const wtapng_if_stats_t *if_stats)
+{
+	if (wth->prefetch != NULL && wtap_prefetch_defer_if_stats(wth, if_stats))
+		return;
+	wtap_apply_if_stats(wth, if_stats);
+}
+
+void
+wtap_apply_if_stats(wtap *wth, const wtapng_if_stats_t *if_stats)
+{
+	wtapng_if_descr_t *wtapng_if_descr;
+
+	if (if_stats->interface_id >= wth->number_of_interfaces)
+		return;
+	wtapng_if_descr = &g_array_index(wth->interface_data, wtapng_if_descr_t, if_stats->interface_id);
+	if (wtapng_if_descr->num_stat_entries == 0) {
+		/* First statistics for it */
+		wtapng_if_descr->interface_statistics = g_array_new(FALSE, FALSE, sizeof(wtapng_if_stats_t));
+	}
+	g_array_append_val(wtapng_if_descr->interface_statistics, *if_stats);
+	wtapng_if_descr->num_stat_entries++;
+}
+
 /* Close only the sequential side, freeing up memory it uses.
 
    Note that we do *not* want to call the subtype's close function,
@@ -718,6 +749,8 @@ wtap_strerror(int err)
 void
 wtap_sequential_close(wtap *wth)
 {
+	wtap_prefetch_stop(wth);
+
 	if (wth->subtype_sequential_close != NULL)
 		(*wth->subtype_sequential_close)(wth);
 
@@ -731,6 +764,7 @@ wtap_sequential_close(wtap *wth)
 		g_free(wth->frame_buffer);
 		wth->frame_buffer = NULL;
 	}
+	wth->frame_ptr = NULL;
 }
 
 static void
@@ -748,6 +782,7 @@ g_fast_seek_item_free(gpointer data, gpointer user_data _U_)
 void
 wtap_fdclose(wtap *wth)
 {
+	wtap_prefetch_stop(wth);
 	if (wth->fh != NULL)
 		file_fdclose(wth->fh);
 	if (wth->random_fh != NULL)
@@ -776,6 +811,8 @@ wtap_close(wtap *wth)
 		g_ptr_array_foreach(wth->fast_seek, g_fast_seek_item_free, NULL);
 		g_ptr_array_free(wth->fast_seek, TRUE);
 	}
+	wtap_index_free(wth);
+
 	for(i = 0; i < (gint)wth->number_of_interfaces; i++) {
 		wtapng_if_descr = &g_array_index(wth->interface_data, wtapng_if_descr_t, i);
 		if(wtapng_if_descr->opt_comment != NULL){
@@ -830,6 +867,18 @@ void wtap_set_cb_new_ipv6(wtap *wth, wtap_new_ipv6_callback_t add_new_ipv6) {
 
 gboolean
 wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
+{
+	if (wth->prefetch != NULL)
+		return wtap_prefetch_read(wth, err, err_info, data_offset);
+	return wtap_read_record(wth, err, err_info, data_offset);
+}
+
+/*
+ * Read the next record with the file type's read routine; this is what
+ * wtap_read() does, on whichever thread is doing the reading.
+ */
+gboolean
+wtap_read_record(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 {
 	/*
 	 * Set the packet encapsulation to the file's encapsulation
@@ -841,6 +890,12 @@ wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 	 */
 	wth->phdr.pkt_encap = wth->file_encap;
 
+	/*
+	 * The read routine points this at the packet data if it can hand
+	 * it out straight from a mapped file.
+	 */
+	wth->frame_ptr = NULL;
+
 	if (!wth->subtype_read(wth, err, err_info, data_offset)) {
 		/*
 		 * If we didn't get an error indication, we read
@@ -871,6 +926,12 @@ wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 	 */
 	g_assert(wth->phdr.pkt_encap != WTAP_ENCAP_PER_PACKET);
 
+	if (wth->index_recs != NULL)
+		wtap_index_add(wth, *data_offset);
+
+	/* We're done with everything before this packet. */
+	file_release(wth->fh, *data_offset);
+
 	return TRUE;	/* success */
 }
 
@@ -881,24 +942,34 @@ wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 gint64
 wtap_read_so_far(wtap *wth)
 {
+	if (wth->prefetch != NULL)
+		return wtap_prefetch_read_so_far(wth);
 	return file_tell_raw(wth->fh);
 }
 
 struct wtap_pkthdr *
 wtap_phdr(wtap *wth)
 {
+	if (wth->prefetch_rec != NULL)
+		return wtap_prefetch_phdr(wth);
 	return &wth->phdr;
 }
 
 union wtap_pseudo_header *
 wtap_pseudoheader(wtap *wth)
 {
+	if (wth->prefetch_rec != NULL)
+		return wtap_prefetch_pseudoheader(wth);
 	return &wth->pseudo_header;
 }
 
 guint8 *
 wtap_buf_ptr(wtap *wth)
 {
+	if (wth->prefetch_rec != NULL)
+		return wtap_prefetch_buf_ptr(wth);
+	if (wth->frame_ptr != NULL)
+		return wth->frame_ptr;
 	return buffer_start_ptr(wth->frame_buffer);
 }
 
@@ -1094,6 +1094,47 @@ gboolean wtap_fdreopen(wtap *wth, const char *filename, int *err);
 void wtap_sequential_close(wtap *wth);
 void wtap_close(wtap *wth);
 
+/*** frame index sidecar files ("capture.pcapng.wsidx", see wtap_index.c) ***/
+gchar *wtap_index_filename(const char *filename);
+/** Record a frame index while the file is read sequentially with wtap_read();
+ * returns FALSE if there's already one.  For file types whose frames can't
+ * be indexed, only the fast seek points are recorded. */
+gboolean wtap_index_start(wtap *wth);
+/** Write the recorded index next to the capture file.  FALSE with *err
+ * set if it couldn't be written, FALSE with *err 0 if there's nothing
+ * usable to write. */
+gboolean wtap_index_write(wtap *wth, const char *filename, int *err);
+/** Map the sidecar of a freshly opened file if it's present and still
+ * matches the file; a compressed file read with wtap_read() is then
+ * inflated in parallel.  Returns TRUE if it has the frames, which can
+ * then be fetched with wtap_index_get() and read with wtap_seek_read(). */
+gboolean wtap_index_load(wtap *wth, const char *filename);
+guint32 wtap_index_count(wtap *wth);
+/** Fill in the packet header and data offset of frame "num" (0-based). */
+gboolean wtap_index_get(wtap *wth, guint32 num, struct wtap_pkthdr *phdr,
+    gint64 *data_offset);
+
+/*** reading ahead on another thread (see wtap_prefetch.c) ***/
+typedef struct wtap_prefetch_stats {
+	guint	depth;		/* records the queue can hold */
+	guint	queued;		/* records in it now */
+	guint	max_queued;	/* most records it has held */
+	guint64	records;	/* records read ahead */
+	guint64	reads;		/* records handed out by wtap_read() */
+	guint64	queued_total;	/* sum of the queue length at each of those */
+	guint64	caller_waits;	/* wtap_read() calls that found the queue empty */
+	guint64	reader_waits;	/* times the reader found it full */
+} wtap_prefetch_stats;
+
+/** Have a thread of our own read up to "depth" records (0 for the
+ * default) ahead of wtap_read().  Until wtap_read() returns FALSE or
+ * wtap_sequential_close() is called, wtap_seek_read() mustn't be used,
+ * and wtap_cleareof() won't resume reading.  Returns FALSE if threads
+ * aren't available. */
+gboolean wtap_set_prefetch(wtap *wth, guint depth);
+/** Queue statistics; FALSE if the file isn't being read ahead. */
+gboolean wtap_get_prefetch_stats(wtap *wth, wtap_prefetch_stats *stats);
+
 /*** dump packets into a capture file ***/
 gboolean wtap_dump_can_open(int filetype);
 gboolean wtap_dump_can_write_encap(int filetype, int encap);
@@ -0,0 +1,414 @@
+/* wtap_index.c
+ *
+ * $Id$
+ *
+ * Frame index sidecar files.
+ *
+ * Opening a big capture file means reading all of it sequentially just
+ * to find out where the frames are.  While a file is read with
+ * wtap_read(), we can instead remember the data offset and the packet
+ * header of every frame and write that, together with the fast seek
+ * points of the file (which, for a compressed file, are what make random
+ * access cheap), to "<capture file>.wsidx".  The next time the file is
+ * opened the sidecar is mapped and the frames can be read directly with
+ * wtap_seek_read().
+ *
+ * The sidecar is only trusted if the size and modification time of the
+ * capture file still match what was recorded, and it's written in host
+ * byte order; an index written on a machine with a different byte order
+ * or structure layout is just ignored and rebuilt.
+ *
+ * Only file types whose random access doesn't depend on state built up
+ * by a sequential read have their frames indexed, and files with
+ * per-packet comments don't (the comments live only in the capture
+ * file).  The fast seek points don't depend on what's in the file, so
+ * for other files the sidecar has just those, which still let a
+ * compressed file be inflated in parallel the next time it's read.
+ *
+ * Wiretap Library
+ * Copyright (c) 1998 by Gilbert Ramirez <gram@alumni.rice.edu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "wtap-int.h"
+#include "file_wrappers.h"
+#include <wsutil/file_util.h>
+
+#define WTAP_INDEX_SUFFIX	".wsidx"
+#define WTAP_INDEX_MAGIC	"WSIDX\r\n\032"	/* 8 bytes, no NUL */
+#define WTAP_INDEX_VERSION	1
+#define WTAP_INDEX_BYTE_ORDER	0x1A2B3C4D
+
+/*
+ * Layout of a sidecar file: the header, "record_count" frame records
+ * and "seek_point_count" fast seek points of "seek_point_size" bytes
+ * each.  The header is a multiple of 8 bytes long so the records are
+ * naturally aligned in the mapping.
+ */
+struct wtap_index_hdr {
+	char	magic[8];
+	guint32	version;
+	guint32	byte_order;
+	gint64	file_size;	/* of the capture file when indexed */
+	gint64	file_mtime;
+	gint32	file_type;
+	gint32	file_encap;	/* after reading, may be WTAP_ENCAP_PER_PACKET */
+	guint32	number_of_interfaces;
+	guint32	record_count;
+	guint32	seek_point_count;
+	guint32	seek_point_size;
+};
+
+struct wtap_index_rec {
+	gint64	data_offset;
+	gint64	secs;
+	gint32	nsecs;
+	guint32	caplen;
+	guint32	len;
+	gint32	pkt_encap;
+	guint32	interface_id;
+	guint32	presence_flags;
+};
+
+static gboolean
+wtap_index_supported(int file_type)
+{
+	switch (file_type) {
+
+	case WTAP_FILE_PCAP:
+	case WTAP_FILE_PCAPNG:
+	case WTAP_FILE_PCAP_NSEC:
+	case WTAP_FILE_PCAP_AIX:
+	case WTAP_FILE_PCAP_SS991029:
+	case WTAP_FILE_PCAP_NOKIA:
+	case WTAP_FILE_PCAP_SS990417:
+	case WTAP_FILE_PCAP_SS990915:
+		return TRUE;
+
+	default:
+		return FALSE;
+	}
+}
+
+gchar *
+wtap_index_filename(const char *filename)
+{
+	return g_strconcat(filename, WTAP_INDEX_SUFFIX, NULL);
+}
+
+gboolean
+wtap_index_start(wtap *wth)
+{
+	int err;
+
+	if (wth->index_map != NULL)
+		return FALSE;
+
+	/*
+	 * If the file was opened for sequential access only, nothing is
+	 * recording its fast seek points; have the read record them, so
+	 * that the index has them.
+	 */
+	if (wth->fast_seek == NULL) {
+		wth->fast_seek = g_ptr_array_new();
+		if (file_record_fast_seek(wth->fh, wth->fast_seek, &err) == -1) {
+			g_ptr_array_free(wth->fast_seek, TRUE);
+			wth->fast_seek = NULL;
+			return FALSE;
+		}
+	}
+	if (wth->index_recs == NULL)
+		wth->index_recs = g_array_new(FALSE, FALSE, sizeof(struct wtap_index_rec));
+	/* If we can't index the frames, we still save the seek points. */
+	wth->index_unusable = !wtap_index_supported(wth->file_type);
+	wth->index_number_of_interfaces = wth->number_of_interfaces;
+	return TRUE;
+}
+
+/* Called by wtap_read() for every frame while an index is being built. */
+void
+wtap_index_add(wtap *wth, gint64 data_offset)
+{
+	struct wtap_index_rec rec;
+
+	if (wth->index_unusable)
+		return;
+	if (wth->phdr.opt_comment != NULL) {
+		/* We can't give the comment back without reading the frame. */
+		wth->index_unusable = TRUE;
+		g_array_set_size(wth->index_recs, 0);
+		return;
+	}
+
+	rec.data_offset    = data_offset;
+	rec.secs           = wth->phdr.ts.secs;
+	rec.nsecs          = wth->phdr.ts.nsecs;
+	rec.caplen         = wth->phdr.caplen;
+	rec.len            = wth->phdr.len;
+	rec.pkt_encap      = wth->phdr.pkt_encap;
+	rec.interface_id   = wth->phdr.interface_id;
+	rec.presence_flags = wth->phdr.presence_flags;
+	g_array_append_val(wth->index_recs, rec);
+}
+
+gboolean
+wtap_index_write(wtap *wth, const char *filename, int *err)
+{
+	struct wtap_index_hdr hdr;
+	ws_statb64 statb;
+	gchar *index_name, *tmp_name;
+	FILE *fp;
+	guint record_count;
+
+	*err = 0;
+	if (wth->index_recs == NULL)
+		return FALSE;
+
+	/*
+	 * Interfaces described further into the file than the open routine
+	 * reads would be missing when the file is opened through the index,
+	 * so in that case we can only save the seek points; they're only
+	 * worth saving if there's more than the one at the beginning.
+	 */
+	if (wth->index_unusable ||
+	    wth->number_of_interfaces != wth->index_number_of_interfaces)
+		record_count = 0;
+	else
+		record_count = wth->index_recs->len;
+	if (record_count == 0 &&
+	    (wth->fast_seek == NULL || wth->fast_seek->len < 2))
+		return FALSE;
+
+	if (wtap_fstat(wth, &statb, err) == -1)
+		return FALSE;
+
+	memset(&hdr, 0, sizeof hdr);
+	memcpy(hdr.magic, WTAP_INDEX_MAGIC, sizeof hdr.magic);
+	hdr.version              = WTAP_INDEX_VERSION;
+	hdr.byte_order           = WTAP_INDEX_BYTE_ORDER;
+	hdr.file_size            = statb.st_size;
+	hdr.file_mtime           = statb.st_mtime;
+	hdr.file_type            = wth->file_type;
+	hdr.file_encap           = wth->file_encap;
+	hdr.number_of_interfaces = (record_count != 0) ?
+	    wth->number_of_interfaces : wth->index_number_of_interfaces;
+	hdr.record_count         = record_count;
+	hdr.seek_point_count     = (wth->fast_seek != NULL) ? wth->fast_seek->len : 0;
+	hdr.seek_point_size      = file_fast_seek_point_size();
+
+	/*
+	 * Write to a temporary file and rename it into place, so nobody
+	 * ever maps a half-written index.
+	 */
+	index_name = wtap_index_filename(filename);
+	tmp_name = g_strconcat(index_name, ".tmp", NULL);
+	fp = ws_fopen(tmp_name, "wb");
+	if (fp == NULL) {
+		*err = errno;
+		g_free(tmp_name);
+		g_free(index_name);
+		return FALSE;
+	}
+	if (fwrite(&hdr, sizeof hdr, 1, fp) != 1 ||
+	    fwrite(wth->index_recs->data, sizeof(struct wtap_index_rec),
+	           record_count, fp) != record_count ||
+	    !file_fast_seek_write(wth->fast_seek, fp)) {
+		*err = errno;
+		fclose(fp);
+		ws_unlink(tmp_name);
+		g_free(tmp_name);
+		g_free(index_name);
+		return FALSE;
+	}
+	if (fclose(fp) == EOF) {
+		*err = errno;
+		ws_unlink(tmp_name);
+		g_free(tmp_name);
+		g_free(index_name);
+		return FALSE;
+	}
+#ifdef _WIN32
+	/* rename() won't replace an existing file on Windows */
+	ws_unlink(index_name);
+#endif
+	if (ws_rename(tmp_name, index_name) == -1) {
+		*err = errno;
+		ws_unlink(tmp_name);
+		g_free(tmp_name);
+		g_free(index_name);
+		return FALSE;
+	}
+	g_free(tmp_name);
+	g_free(index_name);
+	return TRUE;
+}
+
+static const struct wtap_index_hdr *
+wtap_index_hdr(wtap *wth)
+{
+	return (const struct wtap_index_hdr *)g_mapped_file_get_contents(wth->index_map);
+}
+
+gboolean
+wtap_index_load(wtap *wth, const char *filename)
+{
+	const struct wtap_index_hdr *hdr;
+	ws_statb64 statb;
+	gchar *index_name;
+	GMappedFile *map;
+	gsize len;
+	guint64 expected;
+	int err;
+
+	if (wth->index_map != NULL)
+		return FALSE;
+	if (wtap_fstat(wth, &statb, &err) == -1)
+		return FALSE;
+
+	index_name = wtap_index_filename(filename);
+	map = g_mapped_file_new(index_name, FALSE, NULL);
+	g_free(index_name);
+	if (map == NULL)
+		return FALSE;
+
+	len = g_mapped_file_get_length(map);
+	hdr = (const struct wtap_index_hdr *)g_mapped_file_get_contents(map);
+	if (len < sizeof *hdr ||
+	    memcmp(hdr->magic, WTAP_INDEX_MAGIC, sizeof hdr->magic) != 0 ||
+	    hdr->version != WTAP_INDEX_VERSION ||
+	    hdr->byte_order != WTAP_INDEX_BYTE_ORDER ||
+	    hdr->seek_point_size != file_fast_seek_point_size())
+		goto stale;
+
+	expected = sizeof *hdr +
+	    (guint64)hdr->record_count * sizeof(struct wtap_index_rec) +
+	    (guint64)hdr->seek_point_count * hdr->seek_point_size;
+	if (len != expected)
+		goto stale;
+
+	/*
+	 * The capture file must be the one we indexed, and the interfaces
+	 * we know about after opening it must be all of them; an IDB further
+	 * into a pcapng file would only be seen by a sequential read.
+	 */
+	if (hdr->file_size != statb.st_size ||
+	    hdr->file_mtime != (gint64)statb.st_mtime ||
+	    hdr->file_type != wth->file_type ||
+	    hdr->number_of_interfaces != wth->number_of_interfaces)
+		goto stale;
+
+	/*
+	 * Without a random-access stream, the seek points are still worth
+	 * having; with all of them, a compressed file can be inflated in
+	 * parallel when read sequentially.
+	 */
+	if (wth->fast_seek == NULL) {
+		wth->fast_seek = g_ptr_array_new();
+		if (file_record_fast_seek(wth->fh, wth->fast_seek, &err) == -1) {
+			g_ptr_array_free(wth->fast_seek, TRUE);
+			wth->fast_seek = NULL;
+			goto stale;
+		}
+	}
+	if (!file_fast_seek_load(wth->fast_seek,
+	    (const guint8 *)hdr + sizeof *hdr +
+	    (gsize)hdr->record_count * sizeof(struct wtap_index_rec),
+	    hdr->seek_point_count))
+		goto stale;
+
+	/*
+	 * Keep it mapped even if it only has seek points, so that we don't
+	 * record an index that would have nothing more in it.
+	 */
+	wth->index_map = map;
+	if (wth->fh != NULL && file_iscompressed(wth->fh))
+		file_set_parallel_inflate(wth->fh);
+	if (hdr->record_count == 0)
+		return FALSE;
+	wth->file_encap = hdr->file_encap;
+	return TRUE;
+
+stale:
+#if GLIB_CHECK_VERSION(2,22,0)
+	g_mapped_file_unref(map);
+#else
+	g_mapped_file_free(map);
+#endif
+	return FALSE;
+}
+
+guint32
+wtap_index_count(wtap *wth)
+{
+	if (wth->index_map == NULL)
+		return 0;
+	return wtap_index_hdr(wth)->record_count;
+}
+
+gboolean
+wtap_index_get(wtap *wth, guint32 num, struct wtap_pkthdr *phdr,
+    gint64 *data_offset)
+{
+	const struct wtap_index_hdr *hdr;
+	const struct wtap_index_rec *rec;
+
+	if (wth->index_map == NULL)
+		return FALSE;
+	hdr = wtap_index_hdr(wth);
+	if (num >= hdr->record_count)
+		return FALSE;
+	rec = (const struct wtap_index_rec *)(hdr + 1) + num;
+
+	memset(phdr, 0, sizeof *phdr);
+	phdr->presence_flags = rec->presence_flags;
+	phdr->ts.secs        = (time_t) rec->secs;
+	phdr->ts.nsecs       = rec->nsecs;
+	phdr->caplen         = rec->caplen;
+	phdr->len            = rec->len;
+	phdr->pkt_encap      = rec->pkt_encap;
+	phdr->interface_id   = rec->interface_id;
+	*data_offset = rec->data_offset;
+	return TRUE;
+}
+
+void
+wtap_index_free(wtap *wth)
+{
+	if (wth->index_recs != NULL) {
+		g_array_free(wth->index_recs, TRUE);
+		wth->index_recs = NULL;
+	}
+	if (wth->index_map != NULL) {
+#if GLIB_CHECK_VERSION(2,22,0)
+		g_mapped_file_unref(wth->index_map);
+#else
+		g_mapped_file_free(wth->index_map);
+#endif
+		wth->index_map = NULL;
+	}
+}
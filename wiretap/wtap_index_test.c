@@ -0,0 +1,277 @@
+/* wtap_index_test.c
+ *
+ * Standalone program to test frame index sidecar files (see wtap_index.c):
+ * an index recorded while a file is read sequentially has to load again
+ * when the file is reopened, whether for random access or not, and the
+ * frames read through it have to be the ones in the file.
+ *
+ * It writes its capture files, and their indices, to the temporary
+ * directory, and removes them when it's done.
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib.h>
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#include "wtap-int.h"
+#include <wsutil/file_util.h>
+
+#define ASSERT(b) do_test((b),"Assertion failed at line %i: %s\n", __LINE__, #b)
+#define ASSERT_EQ(exp,act) do_test((exp)==(act),"Assertion failed at line %i: %s==%s (%i==%i)\n", __LINE__, #exp, #act, (int)(exp), (int)(act))
+
+/* Enough data for the file to have several fast seek points once gzipped. */
+#define N_FRAMES	4096
+#define FRAME_LEN	1000
+
+static int failure = 0;
+
+static void
+do_test(gboolean condition, const char *format, ...)
+{
+	va_list ap;
+
+	if (condition)
+		return;
+
+	va_start(ap, format);
+	vfprintf(stderr, format, ap);
+	va_end(ap);
+	failure = 1;
+
+	exit(1);
+}
+
+/* The contents of a frame say which one it is. */
+static void
+fill_frame(guint8 *pd, guint32 num)
+{
+	guint i;
+
+	for (i = 0; i < FRAME_LEN; i++)
+		pd[i] = (guint8)((num * 7 + i * 13 + (i >> 8)) & 0xFF);
+	memcpy(pd, &num, sizeof num);
+}
+
+static gboolean
+check_frame(const guint8 *pd, guint32 num)
+{
+	guint8 expected[FRAME_LEN];
+
+	fill_frame(expected, num);
+	return memcmp(pd, expected, FRAME_LEN) == 0;
+}
+
+/* Write a libpcap file of N_FRAMES Ethernet frames, gzipped if asked to. */
+static void
+write_capture(const char *filename, gboolean compressed)
+{
+	struct {
+		guint32 magic;
+		guint16 version_major, version_minor;
+		gint32  thiszone;
+		guint32 sigfigs, snaplen, network;
+	} file_hdr = { 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1 };
+	struct {
+		guint32 ts_sec, ts_usec, incl_len, orig_len;
+	} rec_hdr;
+	guint8 pd[FRAME_LEN];
+	guint32 num;
+#ifdef HAVE_LIBZ
+	gzFile gz = NULL;
+#endif
+	FILE *fp = NULL;
+
+#ifdef HAVE_LIBZ
+	if (compressed) {
+		gz = gzopen(filename, "wb");
+		ASSERT(gz != NULL);
+	} else
+#endif
+	{
+		fp = ws_fopen(filename, "wb");
+		ASSERT(fp != NULL);
+	}
+
+#ifdef HAVE_LIBZ
+#define WRITE(p, n) (gz != NULL ? gzwrite(gz, (p), (unsigned)(n)) == (int)(n) : fwrite((p), (n), 1, fp) == 1)
+#else
+#define WRITE(p, n) (fwrite((p), (n), 1, fp) == 1)
+#endif
+	ASSERT(WRITE(&file_hdr, sizeof file_hdr));
+	for (num = 0; num < N_FRAMES; num++) {
+		rec_hdr.ts_sec = 1000000000 + num;
+		rec_hdr.ts_usec = num;
+		rec_hdr.incl_len = rec_hdr.orig_len = FRAME_LEN;
+		fill_frame(pd, num);
+		ASSERT(WRITE(&rec_hdr, sizeof rec_hdr));
+		ASSERT(WRITE(pd, FRAME_LEN));
+	}
+#undef WRITE
+
+#ifdef HAVE_LIBZ
+	if (gz != NULL)
+		ASSERT_EQ(Z_OK, gzclose(gz));
+	else
+#endif
+		ASSERT_EQ(0, fclose(fp));
+}
+
+/* Read the file sequentially, as single-pass TShark does, and index it. */
+static void
+test_index_write(const char *filename, gboolean compressed)
+{
+	wtap *wth;
+	int err;
+	gchar *err_info;
+	gint64 data_offset;
+	guint32 num = 0;
+
+	wth = wtap_open_offline(filename, &err, &err_info, FALSE);
+	ASSERT(wth != NULL);
+	ASSERT(wtap_index_start(wth));
+	ASSERT(wth->fast_seek != NULL);
+
+	while (wtap_read(wth, &err, &err_info, &data_offset)) {
+		ASSERT_EQ(FRAME_LEN, wtap_phdr(wth)->caplen);
+		ASSERT(check_frame(wtap_buf_ptr(wth), num));
+		num++;
+	}
+	ASSERT_EQ(0, err);
+	ASSERT_EQ(N_FRAMES, num);
+
+	/* A gzipped file needs points all through it, not just the first. */
+	if (compressed)
+		ASSERT(wth->fast_seek->len > 2);
+	else
+		ASSERT(wth->fast_seek->len >= 1);
+
+	ASSERT(wtap_index_write(wth, filename, &err));
+	wtap_close(wth);
+}
+
+/* Reopen it for random access, as Wireshark does, and read through the index. */
+static void
+test_index_load_random(const char *filename)
+{
+	wtap *wth;
+	int err;
+	gchar *err_info;
+	struct wtap_pkthdr phdr;
+	union wtap_pseudo_header pseudo_header;
+	gint64 data_offset;
+	guint8 pd[FRAME_LEN];
+	guint32 num;
+
+	wth = wtap_open_offline(filename, &err, &err_info, TRUE);
+	ASSERT(wth != NULL);
+	/* Opening it already recorded the first fast seek point. */
+	ASSERT(wth->fast_seek != NULL && wth->fast_seek->len != 0);
+	ASSERT(wtap_index_load(wth, filename));
+	ASSERT_EQ(N_FRAMES, wtap_index_count(wth));
+
+	/* Backwards, so that every read is a seek. */
+	for (num = N_FRAMES; num-- != 0; ) {
+		ASSERT(wtap_index_get(wth, num, &phdr, &data_offset));
+		ASSERT_EQ(FRAME_LEN, phdr.caplen);
+		ASSERT_EQ(1000000000 + num, phdr.ts.secs);
+		ASSERT(wtap_seek_read(wth, data_offset, &pseudo_header, pd,
+		    FRAME_LEN, &err, &err_info));
+		ASSERT(check_frame(pd, num));
+	}
+	ASSERT(!wtap_index_get(wth, N_FRAMES, &phdr, &data_offset));
+	wtap_close(wth);
+}
+
+/* Reopen it for sequential access, as TShark does, and read all of it. */
+static void
+test_index_load_sequential(const char *filename)
+{
+	wtap *wth;
+	int err;
+	gchar *err_info;
+	gint64 data_offset;
+	guint32 num = 0;
+
+	wth = wtap_open_offline(filename, &err, &err_info, FALSE);
+	ASSERT(wth != NULL);
+	ASSERT(wtap_index_load(wth, filename));
+	ASSERT_EQ(N_FRAMES, wtap_index_count(wth));
+	/* An index that's been loaded isn't recorded again. */
+	ASSERT(!wtap_index_start(wth));
+
+	while (wtap_read(wth, &err, &err_info, &data_offset)) {
+		ASSERT(check_frame(wtap_buf_ptr(wth), num));
+		num++;
+	}
+	ASSERT_EQ(0, err);
+	ASSERT_EQ(N_FRAMES, num);
+	wtap_close(wth);
+}
+
+static void
+test_file(gboolean compressed)
+{
+	gchar *filename, *index_name;
+
+	filename = g_strdup_printf("%s%cwtap_index_test_%d.pcap%s",
+	    g_get_tmp_dir(), G_DIR_SEPARATOR, (int)getpid(),
+	    compressed ? ".gz" : "");
+	index_name = wtap_index_filename(filename);
+
+	write_capture(filename, compressed);
+	test_index_write(filename, compressed);
+	test_index_load_random(filename);
+	test_index_load_sequential(filename);
+
+	ws_unlink(index_name);
+	ws_unlink(filename);
+	g_free(index_name);
+	g_free(filename);
+}
+
+int
+main(int argc _U_, char **argv _U_)
+{
+	test_file(FALSE);
+#ifdef HAVE_LIBZ
+	test_file(TRUE);
+#endif
+
+	printf(failure?"FAILURE\n":"SUCCESS\n");
+	return failure;
+}
@@ -0,0 +1,371 @@
+/* wtap_prefetch.c
+ *
+ * $Id$
+ *
+ * Reading a capture file ahead of the caller.
+ *
+ * wtap_read() normally reads from the file on the caller's thread, so
+ * a program that dissects what it reads stops dissecting whenever the
+ * data isn't in the page cache yet, which is most of the time for a
+ * file on a network file system.  After wtap_set_prefetch(), a thread
+ * of our own calls the file type's read routine and keeps a bounded
+ * queue of the records it has read (packet header, pseudo-header and
+ * data), and wtap_read() just takes the next one off the queue.
+ *
+ * While that thread is running it owns the sequential side of the wtap
+ * (fh, phdr, pseudo_header, frame_buffer and whatever the file type's
+ * read routine keeps in priv), so the caller must not do random-access
+ * reads with wtap_seek_read() until wtap_read() has returned FALSE or
+ * wtap_sequential_close() has been called; that rules it out for
+ * Wireshark, which reads frames at random while it's still loading the
+ * file.  Once the thread has hit the end of the file it's done, so it's
+ * also no use for reading a file that's still being written.
+ *
+ * The interface descriptions belong to the caller, who may be looking at
+ * them, so interface statistics the read routine comes across are queued
+ * up and added to them by wtap_read() when it hands out the first record
+ * that followed them.
+ *
+ * Wiretap Library
+ * Copyright (c) 1998 by Gilbert Ramirez <gram@alumni.rice.edu>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "wtap-int.h"
+#include "file_wrappers.h"
+#include "buffer.h"
+
+/* Records to read ahead if the caller doesn't say. */
+#define WTAP_PREFETCH_DEFAULT_DEPTH	512
+
+struct wtap_prefetch_rec {
+	struct wtap_pkthdr		phdr;
+	union wtap_pseudo_header	pseudo_header;
+	Buffer				buf;
+	gint64				data_offset;
+	gint64				read_so_far;
+};
+
+struct wtap_prefetch_if_stats {
+	guint64			after;	/* records read before them */
+	wtapng_if_stats_t	if_stats;
+};
+
+struct wtap_prefetch {
+	GThread			*thread;
+	GMutex			*mtx;
+	GCond			*cond;	/* a record was added, or one was freed up */
+	struct wtap_prefetch_rec *recs;
+	guint			depth;
+	guint			head;	/* next record to hand out */
+	guint			queued;	/* records read and not handed out yet */
+	gboolean		held;	/* the caller has recs[head - 1] */
+	gboolean		done;	/* the reader has stopped */
+	gboolean		stop;	/* the reader should stop */
+	int			err;	/* why it stopped */
+	gchar			*err_info;
+	gint64			read_so_far;	/* as of the record handed out */
+	GQueue			*if_stats;	/* struct wtap_prefetch_if_stats's */
+	wtap_prefetch_stats	stats;
+};
+
+/* Called on the reader's thread by wtap_add_if_stats(). */
+gboolean
+wtap_prefetch_defer_if_stats(wtap *wth, const wtapng_if_stats_t *if_stats)
+{
+	struct wtap_prefetch *pf = wth->prefetch;
+	struct wtap_prefetch_if_stats *pending;
+
+	pending = g_new(struct wtap_prefetch_if_stats, 1);
+	pending->if_stats = *if_stats;
+	g_mutex_lock(pf->mtx);
+	pending->after = pf->stats.records;
+	g_queue_push_tail(pf->if_stats, pending);
+	g_mutex_unlock(pf->mtx);
+	return TRUE;
+}
+
+/* Take the queued interface statistics that came before record number
+   "before"; called with pf->mtx held. */
+static GSList *
+wtap_prefetch_take_if_stats(struct wtap_prefetch *pf, guint64 before)
+{
+	struct wtap_prefetch_if_stats *pending;
+	GSList *taken = NULL;
+
+	while ((pending = g_queue_peek_head(pf->if_stats)) != NULL &&
+	    pending->after <= before)
+		taken = g_slist_prepend(taken, g_queue_pop_head(pf->if_stats));
+	return g_slist_reverse(taken);
+}
+
+/* Add them to the caller's interfaces, without pf->mtx held. */
+static void
+wtap_prefetch_apply_if_stats(wtap *wth, GSList *taken)
+{
+	GSList *item;
+
+	for (item = taken; item != NULL; item = g_slist_next(item)) {
+		wtap_apply_if_stats(wth,
+		    &((struct wtap_prefetch_if_stats *)item->data)->if_stats);
+		g_free(item->data);
+	}
+	g_slist_free(taken);
+}
+
+static gpointer
+wtap_prefetch_thread(gpointer data)
+{
+	wtap *wth = (wtap *)data;
+	struct wtap_prefetch *pf = wth->prefetch;
+	struct wtap_prefetch_rec *rec;
+	guint8 *pd;
+	gint64 data_offset;
+	int err = 0;
+	gchar *err_info = NULL;
+	gboolean ok;
+
+	for (;;) {
+		g_mutex_lock(pf->mtx);
+		if (!pf->stop && pf->queued + (pf->held ? 1 : 0) == pf->depth) {
+			pf->stats.reader_waits++;
+			do
+				g_cond_wait(pf->cond, pf->mtx);
+			while (!pf->stop && pf->queued + (pf->held ? 1 : 0) == pf->depth);
+		}
+		if (pf->stop) {
+			g_mutex_unlock(pf->mtx);
+			break;
+		}
+		/* Nobody else looks at this one until we've queued it. */
+		rec = &pf->recs[(pf->head + pf->queued) % pf->depth];
+		g_mutex_unlock(pf->mtx);
+
+		ok = wtap_read_record(wth, &err, &err_info, &data_offset);
+		if (ok) {
+			rec->phdr = wth->phdr;
+			rec->pseudo_header = wth->pseudo_header;
+			pd = (wth->frame_ptr != NULL) ? wth->frame_ptr :
+			    buffer_start_ptr(wth->frame_buffer);
+			buffer_clean(&rec->buf);
+			buffer_append(&rec->buf, pd, rec->phdr.caplen);
+			rec->data_offset = data_offset;
+			rec->read_so_far = file_tell_raw(wth->fh);
+		}
+
+		g_mutex_lock(pf->mtx);
+		if (ok) {
+			pf->queued++;
+			pf->stats.records++;
+			if (pf->queued > pf->stats.max_queued)
+				pf->stats.max_queued = pf->queued;
+		} else {
+			pf->err = err;
+			pf->err_info = err_info;
+			pf->done = TRUE;
+		}
+		g_cond_broadcast(pf->cond);
+		g_mutex_unlock(pf->mtx);
+		if (!ok)
+			break;
+	}
+	return NULL;
+}
+
+gboolean
+wtap_set_prefetch(wtap *wth, guint depth)
+{
+	struct wtap_prefetch *pf;
+	guint i;
+
+	if (wth->prefetch != NULL || wth->fh == NULL)
+		return FALSE;
+#if !GLIB_CHECK_VERSION(2,31,0)
+	if (!g_thread_supported())
+		return FALSE;
+#endif
+	if (depth == 0)
+		depth = WTAP_PREFETCH_DEFAULT_DEPTH;
+	else if (depth < 2)
+		depth = 2;	/* one for the caller, one being read */
+
+	pf = g_new0(struct wtap_prefetch, 1);
+#if GLIB_CHECK_VERSION(2,31,0)
+	pf->mtx = g_new(GMutex, 1);
+	g_mutex_init(pf->mtx);
+	pf->cond = g_new(GCond, 1);
+	g_cond_init(pf->cond);
+#else
+	pf->mtx = g_mutex_new();
+	pf->cond = g_cond_new();
+#endif
+	pf->depth = depth;
+	pf->if_stats = g_queue_new();
+	pf->recs = g_new0(struct wtap_prefetch_rec, depth);
+	for (i = 0; i < depth; i++)
+		buffer_init(&pf->recs[i].buf, 1500);
+	pf->stats.depth = depth;
+
+	/* We'll be reading all of it, from start to end. */
+	file_advise_sequential(wth->fh);
+
+	wth->prefetch = pf;
+#if GLIB_CHECK_VERSION(2,31,0)
+	pf->thread = g_thread_new("wtap prefetch", wtap_prefetch_thread, wth);
+#else
+	pf->thread = g_thread_create(wtap_prefetch_thread, wth, TRUE, NULL);
+#endif
+	if (pf->thread == NULL) {
+		pf->done = TRUE;
+		wtap_prefetch_stop(wth);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* wtap_read() for a wtap that's being read ahead. */
+gboolean
+wtap_prefetch_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
+{
+	struct wtap_prefetch *pf = wth->prefetch;
+	struct wtap_prefetch_rec *rec;
+	GSList *taken;
+
+	g_mutex_lock(pf->mtx);
+	if (pf->held) {
+		/* the caller's done with the previous record */
+		pf->held = FALSE;
+		g_cond_broadcast(pf->cond);
+	}
+	if (pf->queued == 0 && !pf->done) {
+		pf->stats.caller_waits++;
+		do
+			g_cond_wait(pf->cond, pf->mtx);
+		while (pf->queued == 0 && !pf->done);
+	}
+	if (pf->queued == 0) {
+		/* Hand over the error, if any, only once. */
+		*err = pf->err;
+		*err_info = pf->err_info;
+		pf->err = 0;
+		pf->err_info = NULL;
+		taken = wtap_prefetch_take_if_stats(pf, G_MAXUINT64);
+		g_mutex_unlock(pf->mtx);
+		wtap_prefetch_apply_if_stats(wth, taken);
+		wth->prefetch_rec = NULL;
+		return FALSE;
+	}
+	taken = wtap_prefetch_take_if_stats(pf, pf->stats.reads);
+	pf->stats.reads++;
+	pf->stats.queued_total += pf->queued;
+	rec = &pf->recs[pf->head];
+	pf->head = (pf->head + 1) % pf->depth;
+	pf->queued--;
+	pf->held = TRUE;
+	g_mutex_unlock(pf->mtx);
+	wtap_prefetch_apply_if_stats(wth, taken);
+
+	wth->prefetch_rec = rec;
+	pf->read_so_far = rec->read_so_far;
+	*data_offset = rec->data_offset;
+	return TRUE;
+}
+
+struct wtap_pkthdr *
+wtap_prefetch_phdr(wtap *wth)
+{
+	return &wth->prefetch_rec->phdr;
+}
+
+union wtap_pseudo_header *
+wtap_prefetch_pseudoheader(wtap *wth)
+{
+	return &wth->prefetch_rec->pseudo_header;
+}
+
+guint8 *
+wtap_prefetch_buf_ptr(wtap *wth)
+{
+	return buffer_start_ptr(&wth->prefetch_rec->buf);
+}
+
+/* Not the reader's position; that's how far ahead of the caller it is. */
+gint64
+wtap_prefetch_read_so_far(wtap *wth)
+{
+	return wth->prefetch->read_so_far;
+}
+
+gboolean
+wtap_get_prefetch_stats(wtap *wth, wtap_prefetch_stats *stats)
+{
+	struct wtap_prefetch *pf = wth->prefetch;
+
+	if (pf == NULL)
+		return FALSE;
+	g_mutex_lock(pf->mtx);
+	*stats = pf->stats;
+	stats->queued = pf->queued;
+	g_mutex_unlock(pf->mtx);
+	return TRUE;
+}
+
+/* Stop reading ahead, and throw away whatever's been read. */
+void
+wtap_prefetch_stop(wtap *wth)
+{
+	struct wtap_prefetch *pf = wth->prefetch;
+	guint i;
+
+	if (pf == NULL)
+		return;
+
+	if (pf->thread != NULL) {
+		g_mutex_lock(pf->mtx);
+		pf->stop = TRUE;
+		g_cond_broadcast(pf->cond);
+		g_mutex_unlock(pf->mtx);
+		g_thread_join(pf->thread);
+	}
+
+	/* Whatever the reader came across is the caller's now. */
+	wtap_prefetch_apply_if_stats(wth,
+	    wtap_prefetch_take_if_stats(pf, G_MAXUINT64));
+	g_queue_free(pf->if_stats);
+
+	for (i = 0; i < pf->depth; i++)
+		buffer_free(&pf->recs[i].buf);
+	g_free(pf->recs);
+	g_free(pf->err_info);
+#if GLIB_CHECK_VERSION(2,31,0)
+	g_mutex_clear(pf->mtx);
+	g_free(pf->mtx);
+	g_cond_clear(pf->cond);
+	g_free(pf->cond);
+#else
+	g_mutex_free(pf->mtx);
+	g_cond_free(pf->cond);
+#endif
+	g_free(pf);
+	wth->prefetch = NULL;
+	wth->prefetch_rec = NULL;
+}
@@ -0,0 +1,490 @@
+/* shm_ring.c
+ * Routines for a byte ring shared, through a file mapping, between one
+ * writing and one reading process.
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#ifdef HAVE_FOPENCOOKIE
+#define _GNU_SOURCE /* Otherwise fopencookie won't be defined on Linux */
+#endif
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include "file_util.h"
+#include "shm_ring.h"
+
+#ifdef SHM_RING_SUPPORTED
+
+#include <sys/mman.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS	MAP_ANON
+#endif
+
+#define SHM_RING_MAGIC		"WSRING\r\n"
+#define SHM_RING_VERSION	2
+
+/* The data starts here, which keeps it page-aligned for any page size
+   we're likely to see. */
+#define SHM_RING_HDR_SIZE	65536
+
+/* Fields written by the two sides are kept in separate cache lines. */
+#define SHM_RING_LINE		64
+
+/* How long the writer sleeps when the ring is full. */
+#define SHM_RING_WAIT_USEC	100
+
+/* How often, in sleeps, the writer makes sure the reader is still there
+   while it waits; about every 100ms. */
+#define SHM_RING_CHECK_WAITS	1000
+
+struct shm_ring_hdr {
+	char		magic[8];
+	guint32		version;
+	guint32		hdr_size;
+	guint32		size;
+	guint8		pad0[SHM_RING_LINE - 20];
+	/* written by the writer */
+	volatile gint	head;
+	volatile gint	writer_attached;
+	volatile gint	writer_done;
+	guint8		pad1[SHM_RING_LINE - 3*sizeof (gint)];
+	/* written by the reader */
+	volatile gint	tail;
+	volatile gint	reader_attached;
+	volatile gint	reader_gone;
+	volatile gint	reader_pid;	/* so the writer can tell if it died */
+};
+
+struct shm_ring {
+	struct shm_ring_hdr *hdr;
+	guint8		*data;
+	guint32		size;
+	gsize		map_len;
+	gboolean	writer;
+	/* the writer's */
+	guint64		written;	/* bytes put into the ring, ever */
+	shm_ring_full_func full_func;
+	void		*full_data;
+};
+
+gboolean
+shm_ring_init(int fd, guint32 size, int *err)
+{
+	struct shm_ring_hdr hdr;
+	guint32 ring_size;
+	ssize_t n;
+
+	if (size > SHM_RING_MAX_SIZE)
+		size = SHM_RING_MAX_SIZE;
+	for (ring_size = SHM_RING_MIN_SIZE; ring_size < size; ring_size <<= 1)
+		;
+
+	if (ftruncate(fd, (off_t)SHM_RING_HDR_SIZE + ring_size) == -1) {
+		*err = errno;
+		return FALSE;
+	}
+
+	memset(&hdr, 0, sizeof hdr);
+	memcpy(hdr.magic, SHM_RING_MAGIC, sizeof hdr.magic);
+	hdr.version = SHM_RING_VERSION;
+	hdr.hdr_size = SHM_RING_HDR_SIZE;
+	hdr.size = ring_size;
+	/* The reader makes the ring. */
+	hdr.reader_pid = (gint)getpid();
+	n = pwrite(fd, &hdr, sizeof hdr, 0);
+	if (n != (ssize_t)sizeof hdr) {
+		*err = (n == -1) ? errno : EIO;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+gboolean
+shm_ring_fd_is_ring(int fd)
+{
+	char magic[8];
+
+	return pread(fd, magic, sizeof magic, 0) == (ssize_t)sizeof magic &&
+	    memcmp(magic, SHM_RING_MAGIC, sizeof magic) == 0;
+}
+
+shm_ring_t *
+shm_ring_attach(int fd, gboolean writer, int *err)
+{
+	struct shm_ring_hdr hdr;
+	ws_statb64 st;
+	shm_ring_t *ring;
+	guint8 *base;
+	gsize map_len;
+	volatile gint *attached;
+
+	if (pread(fd, &hdr, sizeof hdr, 0) != (ssize_t)sizeof hdr ||
+	    memcmp(hdr.magic, SHM_RING_MAGIC, sizeof hdr.magic) != 0 ||
+	    hdr.version != SHM_RING_VERSION ||
+	    hdr.hdr_size != SHM_RING_HDR_SIZE ||
+	    hdr.size < SHM_RING_MIN_SIZE || hdr.size > SHM_RING_MAX_SIZE ||
+	    (hdr.size & (hdr.size - 1)) != 0) {
+		*err = EINVAL;
+		return NULL;
+	}
+	if (ws_fstat64(fd, &st) == -1) {
+		*err = errno;
+		return NULL;
+	}
+	if (st.st_size < (gint64)SHM_RING_HDR_SIZE + hdr.size) {
+		*err = EINVAL;
+		return NULL;
+	}
+
+	/*
+	 * Reserve room for the header and two copies of the data, then
+	 * map the file over the header and the first copy, and the data
+	 * again over the second copy.
+	 */
+	map_len = SHM_RING_HDR_SIZE + 2*(gsize)hdr.size;
+	base = (guint8 *)mmap(NULL, map_len, PROT_NONE,
+	    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED) {
+		*err = errno;
+		return NULL;
+	}
+	if (mmap(base, SHM_RING_HDR_SIZE + hdr.size, PROT_READ|PROT_WRITE,
+	    MAP_SHARED|MAP_FIXED, fd, 0) == MAP_FAILED ||
+	    mmap(base + SHM_RING_HDR_SIZE + hdr.size, hdr.size,
+	    PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd,
+	    SHM_RING_HDR_SIZE) == MAP_FAILED) {
+		*err = errno;
+		munmap(base, map_len);
+		return NULL;
+	}
+
+	ring = g_new(shm_ring_t, 1);
+	ring->hdr = (struct shm_ring_hdr *)base;
+	ring->data = base + SHM_RING_HDR_SIZE;
+	ring->size = hdr.size;
+	ring->map_len = map_len;
+	ring->writer = writer;
+	ring->written = 0;
+	ring->full_func = NULL;
+	ring->full_data = NULL;
+
+	/*
+	 * There's one writer at a time, which may detach and attach again.
+	 * The reader may have the ring attached more than once (a capture
+	 * file is opened once for sequential and once for random access),
+	 * and only goes away when the last of them is detached; it can come
+	 * back, but only from the same process.
+	 */
+	if (writer) {
+		if (!g_atomic_int_compare_and_exchange(&ring->hdr->writer_attached, 0, 1)) {
+			munmap(base, map_len);
+			g_free(ring);
+			*err = EBUSY;
+			return NULL;
+		}
+		g_atomic_int_set(&ring->hdr->writer_done, 0);
+	} else {
+		attached = &ring->hdr->reader_attached;
+		if (g_atomic_int_get(attached) != 0 &&
+		    g_atomic_int_get(&ring->hdr->reader_pid) != (gint)getpid()) {
+			munmap(base, map_len);
+			g_free(ring);
+			*err = EBUSY;
+			return NULL;
+		}
+		g_atomic_int_inc(attached);
+		g_atomic_int_set(&ring->hdr->reader_pid, (gint)getpid());
+		g_atomic_int_set(&ring->hdr->reader_gone, 0);
+	}
+	return ring;
+}
+
+void
+shm_ring_detach(shm_ring_t *ring)
+{
+	if (ring->writer) {
+		g_atomic_int_set(&ring->hdr->writer_done, 1);
+		g_atomic_int_set(&ring->hdr->writer_attached, 0);
+	} else if (g_atomic_int_dec_and_test(&ring->hdr->reader_attached))
+		g_atomic_int_set(&ring->hdr->reader_gone, 1);
+	munmap(ring->hdr, ring->map_len);
+	g_free(ring);
+}
+
+void
+shm_ring_set_full_func(shm_ring_t *ring, shm_ring_full_func func,
+    void *user_data)
+{
+	ring->full_func = func;
+	ring->full_data = user_data;
+}
+
+/* A reader that's killed doesn't get to say it's gone. */
+static gboolean
+shm_ring_reader_alive(shm_ring_t *ring)
+{
+	pid_t pid = (pid_t)g_atomic_int_get(&ring->hdr->reader_pid);
+
+	if (g_atomic_int_get(&ring->hdr->reader_gone))
+		return FALSE;
+	return pid == 0 || kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+gboolean
+shm_ring_write(shm_ring_t *ring, const void *data, gsize len, int *err)
+{
+	const guint8 *p = (const guint8 *)data;
+	guint32 head, space, n;
+	guint waits = 0;
+
+	/* Nobody else moves the head. */
+	head = (guint32)ring->hdr->head;
+	while (len != 0) {
+		if (g_atomic_int_get(&ring->hdr->reader_gone)) {
+			*err = EPIPE;
+			return FALSE;
+		}
+		space = ring->size -
+		    (head - (guint32)g_atomic_int_get(&ring->hdr->tail));
+		if (space == 0) {
+			/* Wait for the reader, as we would on a full pipe,
+			   but first give our caller a chance to tell it
+			   about what's in the ring. */
+			if (waits == 0 && ring->full_func != NULL)
+				ring->full_func(ring->written, ring->full_data);
+			if (++waits % SHM_RING_CHECK_WAITS == 0 &&
+			    !shm_ring_reader_alive(ring)) {
+				*err = EPIPE;
+				return FALSE;
+			}
+			g_usleep(SHM_RING_WAIT_USEC);
+			continue;
+		}
+		waits = 0;
+		n = (len < space) ? (guint32)len : space;
+		memcpy(ring->data + (head & (ring->size - 1)), p, n);
+		head += n;
+		ring->written += n;
+		g_atomic_int_set(&ring->hdr->head, (gint)head);
+		p += n;
+		len -= n;
+	}
+	return TRUE;
+}
+
+guint32
+shm_ring_head(shm_ring_t *ring)
+{
+	return (guint32)g_atomic_int_get(&ring->hdr->head);
+}
+
+gboolean
+shm_ring_writer_done(shm_ring_t *ring)
+{
+	return g_atomic_int_get(&ring->hdr->writer_done) != 0;
+}
+
+guint8 *
+shm_ring_ptr(shm_ring_t *ring, guint32 pos)
+{
+	return ring->data + (pos & (ring->size - 1));
+}
+
+guint32
+shm_ring_tail(shm_ring_t *ring)
+{
+	return (guint32)ring->hdr->tail;
+}
+
+void
+shm_ring_release(shm_ring_t *ring, guint32 pos)
+{
+	g_atomic_int_set(&ring->hdr->tail, (gint)pos);
+}
+
+guint32
+shm_ring_size(shm_ring_t *ring)
+{
+	return ring->size;
+}
+
+#if defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN)
+/*
+ * A stdio stream on top of a ring, so that dumpcap's pcapio routines
+ * can write to it as they'd write to a file.
+ */
+struct shm_ring_stream {
+	shm_ring_t *ring;
+	int spill_fd;
+};
+
+static int
+shm_ring_stream_put(struct shm_ring_stream *stream, const char *buf,
+    size_t len)
+{
+	size_t done;
+	ssize_t n;
+	int err;
+
+	/* Write the file first, so that if that fails and stdio tries
+	   again, the reader doesn't see the data twice. */
+	if (stream->spill_fd != -1) {
+		for (done = 0; done < len; done += n) {
+			n = ws_write(stream->spill_fd, buf + done, len - done);
+			if (n == -1) {
+				if (errno == EINTR) {
+					n = 0;
+					continue;
+				}
+				return -1;
+			}
+		}
+	}
+	if (!shm_ring_write(stream->ring, buf, len, &err)) {
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
+
+static int
+shm_ring_stream_close(void *cookie)
+{
+	struct shm_ring_stream *stream = (struct shm_ring_stream *)cookie;
+	int ret = 0;
+
+	shm_ring_detach(stream->ring);
+	if (stream->spill_fd != -1 && ws_close(stream->spill_fd) == -1)
+		ret = -1;
+	g_free(stream);
+	return ret;
+}
+
+#ifdef HAVE_FOPENCOOKIE
+/* fopencookie() write functions return 0, not -1, on an error. */
+static ssize_t
+shm_ring_stream_write(void *cookie, const char *buf, size_t len)
+{
+	if (shm_ring_stream_put((struct shm_ring_stream *)cookie, buf, len) == -1)
+		return 0;
+	return (ssize_t)len;
+}
+#else
+static int
+shm_ring_stream_write(void *cookie, const char *buf, int len)
+{
+	if (shm_ring_stream_put((struct shm_ring_stream *)cookie, buf, len) == -1)
+		return -1;
+	return len;
+}
+#endif
+
+FILE *
+shm_ring_fopen(const char *path, int spill_fd, shm_ring_full_func full_func,
+    void *user_data, int *err)
+{
+	struct shm_ring_stream *stream;
+	shm_ring_t *ring;
+	FILE *fp;
+	int fd;
+#ifdef HAVE_FOPENCOOKIE
+	cookie_io_functions_t funcs;
+#endif
+
+	fd = ws_open(path, O_RDWR|O_BINARY, 0000);
+	if (fd == -1) {
+		*err = errno;
+		return NULL;
+	}
+	ring = shm_ring_attach(fd, TRUE, err);
+	ws_close(fd);
+	if (ring == NULL)
+		return NULL;
+	shm_ring_set_full_func(ring, full_func, user_data);
+
+	stream = g_new(struct shm_ring_stream, 1);
+	stream->ring = ring;
+	stream->spill_fd = spill_fd;
+#ifdef HAVE_FOPENCOOKIE
+	funcs.read = NULL;
+	funcs.write = shm_ring_stream_write;
+	funcs.seek = NULL;
+	funcs.close = shm_ring_stream_close;
+	fp = fopencookie(stream, "wb", funcs);
+#else
+	fp = funopen(stream, NULL, shm_ring_stream_write, NULL,
+	    shm_ring_stream_close);
+#endif
+	if (fp == NULL) {
+		*err = errno;
+		/* Don't close the caller's file on failure. */
+		stream->spill_fd = -1;
+		shm_ring_stream_close(stream);
+		return NULL;
+	}
+	return fp;
+}
+#else
+FILE *
+shm_ring_fopen(const char *path _U_, int spill_fd _U_,
+    shm_ring_full_func full_func _U_, void *user_data _U_, int *err)
+{
+	*err = ENOTSUP;
+	return NULL;
+}
+#endif
+
+#endif /* SHM_RING_SUPPORTED */
+
+/*
+ * Editor modelines
+ *
+ * Local Variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * ex: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
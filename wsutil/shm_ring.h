@@ -0,0 +1,121 @@
+/* shm_ring.h
+ * Declarations of routines for a byte ring shared, through a file
+ * mapping, between one writing and one reading process.
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ */
+
+#ifndef __SHM_RING_H__
+#define __SHM_RING_H__
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * dumpcap can hand what it captures to its parent through one of these
+ * rather than (or as well as) through the capture file: it writes the
+ * file's contents into the ring and the parent reads them straight out
+ * of the shared mapping.  The ring is a regular file, created by the
+ * reader, so that it can be opened by name like a capture file.
+ *
+ * Positions in the ring are byte counts since it was created, modulo
+ * 2^32; the writer only ever moves the head and the reader the tail, so
+ * no locking is needed.  The data area is mapped twice, back to back,
+ * so anything up to the size of the ring starting at any position is
+ * contiguous in memory.
+ */
+#if defined(HAVE_MMAP) && !defined(_WIN32)
+#define SHM_RING_SUPPORTED
+#endif
+
+#define SHM_RING_MIN_SIZE	(1024*1024)
+#define SHM_RING_MAX_SIZE	(1024*1024*1024)
+
+typedef struct shm_ring shm_ring_t;
+
+/* Called by the writer when it finds the ring full, before it waits for
+ * the reader, with the number of bytes it has put into the ring so far;
+ * a reader that only reads as much as it's been told about can't make
+ * room until it's told about what's there. */
+typedef void (*shm_ring_full_func)(guint64 written, void *user_data);
+
+#ifdef SHM_RING_SUPPORTED
+/* Set up the file open on "fd" as an empty ring with room for "size"
+ * bytes, rounded up to a power of two. */
+extern gboolean shm_ring_init(int fd, guint32 size, int *err);
+
+/* TRUE if the file open on "fd" is a ring. */
+extern gboolean shm_ring_fd_is_ring(int fd);
+
+/* Map the ring open on "fd", which must be open for reading and
+ * writing, as its writer or its reader.  There can only be one writer
+ * at a time; the reader's process can attach as often as it likes, and
+ * the reader is gone once all of them are detached.  "fd" can be closed
+ * afterwards. */
+extern shm_ring_t *shm_ring_attach(int fd, gboolean writer, int *err);
+
+/* Unmap the ring, telling the other side we're gone if this was the
+ * last attachment. */
+extern void shm_ring_detach(shm_ring_t *ring);
+
+/* Writer: have "func", if not NULL, called when the ring is full. */
+extern void shm_ring_set_full_func(shm_ring_t *ring, shm_ring_full_func func,
+    void *user_data);
+
+/* Writer: copy "len" bytes into the ring, waiting for the reader to
+ * make room if need be.  Fails with EPIPE if the reader has gone,
+ * whether or not it said so before going. */
+extern gboolean shm_ring_write(shm_ring_t *ring, const void *data, gsize len,
+    int *err);
+
+/* Writer: open the ring at "path" and return a stdio stream that writes
+ * to it and, unless "spill_fd" is -1, to "spill_fd" as well, calling
+ * "full_func" as shm_ring_set_full_func() would.  Closing the stream
+ * detaches from the ring and closes "spill_fd". */
+extern FILE *shm_ring_fopen(const char *path, int spill_fd,
+    shm_ring_full_func full_func, void *user_data, int *err);
+
+/* Reader: how much the writer has written, and whether it's finished. */
+extern guint32 shm_ring_head(shm_ring_t *ring);
+extern gboolean shm_ring_writer_done(shm_ring_t *ring);
+
+/* Reader: where the data at "pos" is; only valid for positions between
+ * the tail and the head. */
+extern guint8 *shm_ring_ptr(shm_ring_t *ring, guint32 pos);
+
+/* Reader: where the tail is, and hand everything before "pos" back to
+ * the writer. */
+extern guint32 shm_ring_tail(shm_ring_t *ring);
+extern void shm_ring_release(shm_ring_t *ring, guint32 pos);
+
+extern guint32 shm_ring_size(shm_ring_t *ring);
+#endif /* SHM_RING_SUPPORTED */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __SHM_RING_H__ */